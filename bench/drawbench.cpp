@@ -0,0 +1,821 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    drawbench.cpp
+ * @brief   Headless benchmark of painting and drawing file round trips
+ *
+ * Generates a synthetic drawing, or takes a given one, opens it in a
+ * DrawContext the same way the application does, then times paint, pan,
+ * zoom and rotate sequences driven through the context's mouse handlers,
+ * and text round trips through the shape container. A trace recorded with
+ * the application's --record option is replayed as one more sequence, on a
+ * fresh view of the same drawing in a context the size of the recorded
+ * window. Results are written as JSON.
+ *
+ * Usage: drawbench [--lines N] [--triangles N] [--polygons N]
+ *                  [--vertices N] [--size UNITS] [--extent UNITS]
+ *                  [--frames N] [--rounds N] [--width PIXELS]
+ *                  [--height PIXELS] [--context null|framebuffer]
+ *                  [--tiles PIXELS] [--threads N] [--draw-threads N]
+ *                  [--seed N]
+ *                  [--drawing FILE] [--trace FILE] [--output FILE]
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <condition_variable>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+# include <iostream>
+# include <memory>
+# include <mutex>
+# include <random>
+# include <sstream>
+# include <string>
+# include <vector>
+
+# include <unistd.h>
+
+# include "drawbase.h"
+# include "drawcontext.h"
+# include "framebuffercontext.h"
+# include "framestats.h"
+# include "gcontext.h"
+# include "shapecontainer.h"
+# include "tracereplay.h"
+# include "viewcontext.h"
+
+
+/* ------------------------------ Allocations ------------------------------- */
+
+
+// every allocation in the process is counted by the allocation hook linked
+// in, so a frame's allocations are the difference of the count across it
+static unsigned long long allocationCount()
+{
+    return FrameStats::allocationCount();
+}
+
+
+/* -------------------------------- Contexts -------------------------------- */
+
+
+/*
+ * Graphics context that discards everything drawn to it.
+ */
+class NullContext : public GraphicsContext
+{
+public:
+
+    NullContext( int width, int height ):
+    width( width ), height( height )
+    {
+        run = false;
+    }
+
+    void setMode( drawMode ) override {}
+    void setColor( unsigned int ) override {}
+    void setPixel( int, int ) override {}
+    unsigned int getPixel( int, int ) override { return 0; }
+
+    void drawLine( int, int, int, int ) override {}
+    void drawCircle( int, int, int ) override {}
+    void drawLines( const Segment *, size_t ) override {}
+    void drawPolyline( const Point *, size_t ) override {}
+
+    void clear() override {}
+    void runLoop( DrawingBase * ) override {}
+
+    int getWindowWidth() override { return width; }
+    int getWindowHeight() override { return height; }
+
+private:
+
+    int width;
+    int height;
+};
+
+
+/*
+ * Wraps a graphics context to count the segments drawn to it, and to let the
+ * benchmark wait for the wakes the file worker sends while a drawing opens.
+ */
+template <class Context>
+class BenchContext : public Context
+{
+public:
+
+    BenchContext( int width, int height ):
+    Context( width, height )
+    {}
+
+    void drawLine( int x1, int y1, int x2, int y2 ) override
+    {
+        segments++;
+        Context::drawLine( x1, y1, x2, y2 );
+    }
+
+    void drawLines( const GraphicsContext::Segment *s, size_t count ) override
+    {
+        segments += count;
+        Context::drawLines( s, count );
+    }
+
+    void wake() override
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        woken = true;
+        wakeup.notify_one();
+    }
+
+    void waitForWake()
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+        wakeup.wait_for( lock, std::chrono::milliseconds( 100 ), [this]() { return woken; } );
+        woken = false;
+    }
+
+    unsigned long long segments = 0;
+
+private:
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool woken = false;
+};
+
+
+/* -------------------------------- Options --------------------------------- */
+
+
+struct Options
+{
+    unsigned int lines = 20000;
+    unsigned int triangles = 20000;
+    unsigned int polygons = 5000;
+    unsigned int vertices = 16;
+    double size = 0.05;
+    double extent = 1;
+    unsigned int frames = 200;
+    unsigned int rounds = 10;
+    int width = 800;
+    int height = 800;
+    std::string context = "null";
+    int tiles = 0;
+    unsigned int threads = 0;
+    unsigned int drawThreads = 1;
+    unsigned int seed = 1;
+    std::string drawing;
+    std::string trace;
+    std::string output;
+};
+
+
+/**
+ * @brief   Parses the command line
+ *
+ * @param   argc        The number of arguments
+ * @param   **argv      The arguments
+ * @param   &options    Filled in with the options given
+ *
+ * @return  True if the command line is valid, false otherwise
+ */
+static bool parse( int argc, char **argv, Options &options )
+{
+    for ( int i = 1; i < argc; i++ )
+    {
+        std::string name = argv[i];
+
+        if ( i + 1 >= argc )
+        {
+            std::cerr << "drawbench: missing value for " << name << std::endl;
+            return false;
+        }
+
+        std::string value = argv[++i];
+        unsigned long number = std::strtoul( value.c_str(), nullptr, 10 );
+
+        if ( name == "--lines" ) options.lines = number;
+        else if ( name == "--triangles" ) options.triangles = number;
+        else if ( name == "--polygons" ) options.polygons = number;
+        else if ( name == "--vertices" ) options.vertices = std::max( number, 3ul );
+        else if ( name == "--size" ) options.size = std::strtod( value.c_str(), nullptr );
+        else if ( name == "--extent" ) options.extent = std::strtod( value.c_str(), nullptr );
+        else if ( name == "--frames" ) options.frames = std::max( number, 1ul );
+        else if ( name == "--rounds" ) options.rounds = std::max( number, 1ul );
+        else if ( name == "--width" ) options.width = std::max( number, 1ul );
+        else if ( name == "--height" ) options.height = std::max( number, 1ul );
+        else if ( name == "--context" ) options.context = value;
+        else if ( name == "--tiles" ) options.tiles = number;
+        else if ( name == "--threads" ) options.threads = number;
+        else if ( name == "--draw-threads" ) options.drawThreads = number;
+        else if ( name == "--seed" ) options.seed = number;
+        else if ( name == "--drawing" ) options.drawing = value;
+        else if ( name == "--trace" ) options.trace = value;
+        else if ( name == "--output" ) options.output = value;
+        else
+        {
+            std::cerr << "drawbench: unknown option " << name << std::endl;
+            return false;
+        }
+    }
+
+    if ( ( options.context != "null" ) && ( options.context != "framebuffer" ) )
+    {
+        std::cerr << "drawbench: unknown context " << options.context << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+/* -------------------------------- Drawing --------------------------------- */
+
+
+/**
+ * @brief   Generates a drawing of randomly placed and colored shapes
+ *
+ * @param   &options    The options giving the number and size of shapes
+ * @param   &sc         The shape container to add the shapes to
+ *
+ * @return  void
+ */
+static void generate( const Options &options, ShapeContainer &sc )
+{
+    std::mt19937 random( options.seed );
+    std::uniform_real_distribution<double> place( -options.extent, options.extent );
+    std::uniform_real_distribution<double> offset( -options.size, options.size );
+    std::uniform_real_distribution<double> channel( 0, 1 );
+
+    std::vector<double> xs( std::max( options.vertices, 3u ) );
+    std::vector<double> ys( xs.size() );
+
+    auto add = [&]( ShapeStore::ShapeType type, unsigned int count, unsigned int n )
+    {
+        for ( unsigned int i = 0; i < count; i++ )
+        {
+            double cx = place( random );
+            double cy = place( random );
+
+            for ( unsigned int k = 0; k < n; k++ )
+            {
+                xs[k] = cx + offset( random );
+                ys[k] = cy + offset( random );
+            }
+
+            double red = channel( random );
+            double green = channel( random );
+            double blue = channel( random );
+
+            sc.add( type, xs.data(), ys.data(), n, 0, 0,
+                    PackedColor( red, green, blue ) );
+        }
+    };
+
+    add( ShapeStore::TYPE_LINE, options.lines, 2 );
+    add( ShapeStore::TYPE_TRIANGLE, options.triangles, 3 );
+    add( ShapeStore::TYPE_POLYGON, options.polygons, options.vertices );
+}
+
+
+/* ------------------------------- Statistics ------------------------------- */
+
+
+struct Sequence
+{
+    std::string name;
+    std::vector<double> times;
+    unsigned long long segments = 0;
+    unsigned long long allocations = 0;
+};
+
+
+/**
+ * @brief   Gets a percentile of a set of times by the nearest rank
+ *
+ * @param   times       The times, in any order
+ * @param   percentile  The percentile, from 0 to 100
+ *
+ * @return  The time at the percentile, or zero if there are none
+ */
+static double percentile( std::vector<double> times, double percentile )
+{
+    if ( times.empty() )
+    {
+        return 0;
+    }
+
+    std::sort( times.begin(), times.end() );
+
+    size_t rank = size_t( std::ceil( percentile / 100 * times.size() ) );
+    return times[std::min( std::max<size_t>( rank, 1 ), times.size() ) - 1];
+}
+
+
+/**
+ * @brief   Gets the sum of a set of times
+ *
+ * @param   &times  The times
+ *
+ * @return  The total time
+ */
+static double total( const std::vector<double> &times )
+{
+    double sum = 0;
+
+    for ( double time : times )
+    {
+        sum += time;
+    }
+
+    return sum;
+}
+
+
+/* -------------------------------- Sequences ------------------------------- */
+
+
+/**
+ * @brief   Opens a drawing file in a draw context, driving its idle handler
+ *          until the file worker is done
+ *
+ * @param   *gc         The graphics context the draw context draws to
+ * @param   *dc         The draw context to open in
+ * @param   &fileName   The name of the drawing file
+ *
+ * @return  void
+ */
+template <class Context>
+static void open( BenchContext<Context> *gc, DrawContext *dc, const std::string &fileName )
+{
+    dc->open( gc, fileName );
+
+    while ( dc->isBusy() )
+    {
+        gc->waitForWake();
+        dc->idle( gc );
+    }
+}
+
+
+/**
+ * @brief   Times a sequence of frames, each one an event handed to the draw
+ *          context
+ *
+ * @param   &name       The name of the sequence
+ * @param   *gc         The graphics context the draw context draws to
+ * @param   frames      The number of frames
+ * @param   &frame      Sends the event for a frame, given its number
+ *
+ * @return  The timings of the sequence
+ */
+template <class Context, class Frame>
+static Sequence measure( const std::string &name, BenchContext<Context> *gc,
+                         unsigned int frames, const Frame &frame )
+{
+    Sequence sequence;
+    sequence.name = name;
+    sequence.times.reserve( frames );
+
+    unsigned long long segments = gc->segments;
+
+    for ( unsigned int i = 0; i < frames; i++ )
+    {
+        unsigned long long before = allocationCount();
+        auto start = std::chrono::steady_clock::now();
+
+        frame( i );
+
+        auto end = std::chrono::steady_clock::now();
+        sequence.allocations += allocationCount() - before;
+        sequence.times.push_back( std::chrono::duration<double>( end - start ).count() );
+    }
+
+    sequence.segments = gc->segments - segments;
+    return sequence;
+}
+
+
+/**
+ * @brief   Sets up a graphics context the way the options ask for
+ *
+ * @param   &gc         The graphics context
+ * @param   &options    The benchmark options
+ *
+ * @return  void
+ */
+template <class Context>
+static void configure( BenchContext<Context> &, const Options & )
+{
+}
+
+
+/**
+ * @brief   Sets up a framebuffer context the way the options ask for,
+ *          splitting its drawing into tiles if they name a tile size
+ *
+ * @param   &gc         The framebuffer context
+ * @param   &options    The benchmark options
+ *
+ * @return  void
+ */
+static void configure( BenchContext<FramebufferContext> &gc, const Options &options )
+{
+    if ( options.tiles > 0 ) gc.setTiling( options.tiles, options.threads );
+}
+
+
+/**
+ * @brief   Runs the paint, pan, zoom and rotate sequences
+ *
+ * @param   &options    The benchmark options
+ * @param   *gc         The graphics context to draw to
+ * @param   &fileName   The name of the drawing file to open
+ * @param   &sequences  Filled in with the timings of each sequence
+ *
+ * @return  void
+ */
+template <class Context>
+static void run( const Options &options, BenchContext<Context> *gc,
+                 const std::string &fileName, std::vector<Sequence> &sequences )
+{
+    ViewContext vc( gc );
+    DrawContext dc( &vc );
+    dc.setThreads( options.drawThreads );
+
+    open( gc, &dc, fileName );
+
+    int cx = options.width / 2;
+    int cy = options.height / 2;
+    unsigned int frames = options.frames;
+
+    sequences.push_back( measure( "paint", gc, frames, [&]( unsigned int )
+       {
+           dc.paint( gc );
+       }
+    ) );
+
+    // drag back and forth with the middle button
+    dc.mouseButtonDown( gc, 2, cx, cy );
+    sequences.push_back( measure( "pan", gc, frames, [&]( unsigned int i )
+       {
+           int step = ( ( i / 20 ) % 2 == 0 ) ? int( i % 20 ) : 20 - int( i % 20 );
+           dc.mouseMove( gc, cx + 4 * step, cy + 3 * step );
+       }
+    ) );
+    dc.mouseButtonUp( gc, 2, cx, cy );
+
+    // scroll in, then back out again
+    sequences.push_back( measure( "zoom", gc, frames, [&]( unsigned int i )
+       {
+           dc.mouseButtonDown( gc, ( ( i / 10 ) % 2 == 0 ) ? 4 : 5, cx, cy );
+       }
+    ) );
+
+    // drag around the center with the right button
+    dc.mouseButtonDown( gc, 3, cx + cx / 2, cy );
+    sequences.push_back( measure( "rotate", gc, frames, [&]( unsigned int i )
+       {
+           double angle = 2 * M_PI * ( i + 1 ) / frames;
+           dc.mouseMove( gc, cx + int( cx / 2 * std::cos( angle ) ),
+                             cy + int( cx / 2 * std::sin( angle ) ) );
+       }
+    ) );
+    dc.mouseButtonUp( gc, 3, cx + cx / 2, cy );
+}
+
+
+/**
+ * @brief   Replays a trace as a sequence, in a graphics context of the size
+ *          the recorded window started at
+ *
+ * @param   &options    The benchmark options
+ * @param   &fileName   The name of the drawing file to open
+ * @param   &trace      The trace to replay
+ * @param   &sequences  Filled in with the timings of the replay
+ *
+ * @return  void
+ */
+template <class Context>
+static void replay( const Options &options, const std::string &fileName,
+                    const TraceReplay &trace, std::vector<Sequence> &sequences )
+{
+    // the recorded events' coordinates only mean the same in a window of
+    // the same size
+    int width = ( trace.getWidth() > 0 ) ? trace.getWidth() : options.width;
+    int height = ( trace.getHeight() > 0 ) ? trace.getHeight() : options.height;
+
+    BenchContext<Context> gc( width, height );
+    configure( gc, options );
+
+    ViewContext vc( &gc );
+    DrawContext dc( &vc );
+    dc.setThreads( options.drawThreads );
+
+    open( &gc, &dc, fileName );
+
+    // every recorded event is a frame, whether or not it repaints
+    const std::vector<TraceReplay::Event> &events = trace.getEvents();
+
+    sequences.push_back( measure( "replay", &gc, events.size(), [&]( unsigned int i )
+       {
+           TraceReplay::deliver( events[i], &gc, &dc );
+       }
+    ) );
+}
+
+
+/**
+ * @brief   Runs every sequence in graphics contexts of one type
+ *
+ * @param   &options    The benchmark options
+ * @param   &fileName   The name of the drawing file to open
+ * @param   *trace      The trace to replay, or null for none
+ * @param   &sequences  Filled in with the timings of each sequence
+ *
+ * @return  void
+ */
+template <class Context>
+static void bench( const Options &options, const std::string &fileName,
+                   const TraceReplay *trace, std::vector<Sequence> &sequences )
+{
+    {
+        BenchContext<Context> gc( options.width, options.height );
+        configure( gc, options );
+        run( options, &gc, fileName, sequences );
+    }
+
+    if ( trace != nullptr )
+    {
+        replay<Context>( options, fileName, *trace, sequences );
+    }
+}
+
+
+/**
+ * @brief   Times writing a drawing to text and reading it back
+ *
+ * @param   &options    The benchmark options
+ * @param   &sc         The drawing to write
+ * @param   &out        Filled in with the timing of each write
+ * @param   &in         Filled in with the timing of each read
+ *
+ * @return  The size of the text in bytes
+ */
+static size_t roundTrip( const Options &options, const ShapeContainer &sc,
+                         std::vector<double> &out, std::vector<double> &in )
+{
+    size_t bytes = 0;
+
+    for ( unsigned int i = 0; i < options.rounds; i++ )
+    {
+        std::ostringstream os;
+
+        auto start = std::chrono::steady_clock::now();
+        sc.out( os );
+        auto middle = std::chrono::steady_clock::now();
+
+        std::istringstream is( os.str() );
+        bytes = is.str().size();
+        ShapeContainer copy;
+
+        auto reading = std::chrono::steady_clock::now();
+        copy.in( is );
+        auto end = std::chrono::steady_clock::now();
+
+        out.push_back( std::chrono::duration<double>( middle - start ).count() );
+        in.push_back( std::chrono::duration<double>( end - reading ).count() );
+    }
+
+    return bytes;
+}
+
+
+/* --------------------------------- Output --------------------------------- */
+
+
+/**
+ * @brief   Writes a string as a JSON string
+ *
+ * @param   &os     The output stream to write to
+ * @param   &text   The string to write
+ *
+ * @return  void
+ */
+static void writeString( std::ostream &os, const std::string &text )
+{
+    os << '"';
+
+    for ( char c : text )
+    {
+        if ( ( c == '"' ) || ( c == '\\' ) ) os << '\\' << c;
+        else if ( ( unsigned char ) c < 0x20 ) os << ' ';
+        else os << c;
+    }
+
+    os << '"';
+}
+
+
+/**
+ * @brief   Writes the timing of a set of frames or round trips as JSON
+ *
+ * @param   &os         The output stream to write to
+ * @param   &times      The times in seconds
+ *
+ * @return  void
+ */
+static void writeTimes( std::ostream &os, const std::vector<double> &times )
+{
+    os << "\"count\": " << times.size()
+       << ", \"p50_ms\": " << percentile( times, 50 ) * 1000
+       << ", \"p99_ms\": " << percentile( times, 99 ) * 1000
+       << ", \"mean_ms\": " << ( times.empty() ? 0 : total( times ) / times.size() * 1000 );
+}
+
+
+/**
+ * @brief   Writes the results as JSON
+ *
+ * @param   &os         The output stream to write to
+ * @param   &options    The benchmark options
+ * @param   shapes      The number of shapes in the drawing
+ * @param   &sequences  The timings of each sequence
+ * @param   bytes       The size of the drawing as text
+ * @param   &out        The timing of each write
+ * @param   &in         The timing of each read
+ *
+ * @return  void
+ */
+static void write( std::ostream &os, const Options &options, unsigned int shapes,
+                   const std::vector<Sequence> &sequences, size_t bytes,
+                   const std::vector<double> &out, const std::vector<double> &in )
+{
+    os << "{\n";
+    os << "  \"drawing\": { \"file\": ";
+    writeString( os, options.drawing );
+    os << ", \"shapes\": " << shapes
+       << ", \"lines\": " << options.lines
+       << ", \"triangles\": " << options.triangles
+       << ", \"polygons\": " << options.polygons
+       << ", \"vertices\": " << options.vertices
+       << ", \"size\": " << options.size
+       << ", \"extent\": " << options.extent
+       << ", \"seed\": " << options.seed << " },\n";
+
+    os << "  \"trace\": ";
+    writeString( os, options.trace );
+    os << ",\n";
+
+    os << "  \"context\": { \"type\": \"" << options.context << "\""
+       << ", \"width\": " << options.width
+       << ", \"height\": " << options.height
+       << ", \"tiles\": " << options.tiles
+       << ", \"threads\": " << options.threads
+       << ", \"draw_threads\": " << options.drawThreads << " },\n";
+
+    os << "  \"sequences\": [\n";
+
+    for ( size_t i = 0; i < sequences.size(); i++ )
+    {
+        const Sequence &sequence = sequences[i];
+        double seconds = total( sequence.times );
+        double frames = double( sequence.times.size() );
+
+        os << "    { \"name\": \"" << sequence.name << "\", ";
+        writeTimes( os, sequence.times );
+        os << ", \"segments_per_frame\": " << sequence.segments / frames
+           << ", \"segments_per_second\": " << ( seconds > 0 ? sequence.segments / seconds : 0 )
+           << ", \"allocations_per_frame\": " << sequence.allocations / frames
+           << " }" << ( ( i + 1 < sequences.size() ) ? "," : "" ) << "\n";
+    }
+
+    os << "  ],\n";
+
+    double outSeconds = total( out );
+    double inSeconds = total( in );
+
+    os << "  \"io\": { \"bytes\": " << bytes << ",\n";
+    os << "    \"out\": { ";
+    writeTimes( os, out );
+    os << ", \"mb_per_second\": " << ( outSeconds > 0 ? bytes * out.size() / outSeconds / 1e6 : 0 ) << " },\n";
+    os << "    \"in\": { ";
+    writeTimes( os, in );
+    os << ", \"mb_per_second\": " << ( inSeconds > 0 ? bytes * in.size() / inSeconds / 1e6 : 0 ) << " }\n";
+    os << "  }\n";
+    os << "}\n";
+}
+
+
+/* -------------------------------- Functions ------------------------------- */
+
+
+int main( int argc, char **argv )
+{
+    Options options;
+
+    if ( !parse( argc, argv, options ) )
+    {
+        return 2;
+    }
+
+    ShapeContainer sc;
+    std::string fileName = options.drawing;
+
+    // a synthetic drawing goes through a file so it is opened like any other
+    if ( fileName.empty() )
+    {
+        char temporary[] = "/tmp/drawbench-XXXXXX";
+        int fd = mkstemp( temporary );
+
+        if ( fd < 0 )
+        {
+            std::cerr << "drawbench: could not create a temporary file" << std::endl;
+            return 1;
+        }
+
+        close( fd );
+        fileName = temporary;
+    }
+
+    auto cleanUp = [&]()
+    {
+        if ( options.drawing.empty() ) std::remove( fileName.c_str() );
+    };
+
+    std::vector<Sequence> sequences;
+    std::vector<double> out;
+    std::vector<double> in;
+    size_t bytes = 0;
+
+    // the draw context reports what it is doing on standard output, which
+    // would get in the way of the results
+    std::streambuf *console = std::cout.rdbuf( nullptr );
+
+    try
+    {
+        if ( options.drawing.empty() )
+        {
+            generate( options, sc );
+            sc.save( fileName, false );
+        }
+        else
+        {
+            sc.open( fileName );
+        }
+
+        std::unique_ptr<TraceReplay> trace;
+
+        if ( !options.trace.empty() )
+        {
+            trace.reset( new TraceReplay( options.trace ) );
+        }
+
+        if ( options.context == "framebuffer" )
+        {
+            bench<FramebufferContext>( options, fileName, trace.get(), sequences );
+        }
+        else
+        {
+            bench<NullContext>( options, fileName, trace.get(), sequences );
+        }
+
+        bytes = roundTrip( options, sc, out, in );
+    }
+    catch ( const std::exception &e )
+    {
+        std::cout.clear();
+        std::cout.rdbuf( console );
+        cleanUp();
+        std::cerr << "drawbench: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout.clear();
+    std::cout.rdbuf( console );
+    cleanUp();
+
+    if ( options.output.empty() )
+    {
+        write( std::cout, options, sc.size(), sequences, bytes, out, in );
+    }
+    else
+    {
+        std::ofstream fileout( options.output.c_str() );
+        write( fileout, options, sc.size(), sequences, bytes, out, in );
+    }
+
+    return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
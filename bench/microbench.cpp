@@ -0,0 +1,572 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    microbench.cpp
+ * @brief   Micro-benchmarks of the math, color and view primitives
+ *
+ * Times the primitives under every hot path with Google Benchmark, each
+ * next to the fixed-size or batched alternative that replaced it where one
+ * exists, so the two can be compared in the same run: Matrix products
+ * against Affine2D, Point2D against Vertex2d, Color against PackedColor,
+ * per-point view transforms against the batched one, and cloning shapes
+ * against adding them to a ShapeStore. Alongside the time per operation
+ * every benchmark reports the heap allocations per operation.
+ *
+ * Usage: microbench [--benchmark_filter=REGEX] [other Google Benchmark
+ *                   options]
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+# include <random>
+# include <utility>
+# include <vector>
+
+# include <benchmark/benchmark.h>
+
+# include "affine2d.h"
+# include "color.h"
+# include "framestats.h"
+# include "gcontext.h"
+# include "line.h"
+# include "matrix.h"
+# include "packedcolor.h"
+# include "point2d.h"
+# include "polygon.h"
+# include "shapestore.h"
+# include "triangle.h"
+# include "vertex2.h"
+# include "viewcontext.h"
+
+
+/* ------------------------------ Allocations ------------------------------- */
+
+
+// every allocation in the process is counted by the allocation hook linked
+// in, as in drawbench
+static unsigned long long allocationCount()
+{
+    return FrameStats::allocationCount();
+}
+
+
+/*
+ * Counts the allocations made while a benchmark's loop runs and reports
+ * them per iteration when it goes out of scope.
+ */
+class AllocationCounter
+{
+public:
+
+    explicit AllocationCounter( benchmark::State &state ):
+    state( state ), start( allocationCount() )
+    {}
+
+    ~AllocationCounter()
+    {
+        state.counters["allocs/op"] = benchmark::Counter(
+            double( allocationCount() - start ), benchmark::Counter::kAvgIterations );
+    }
+
+private:
+
+    benchmark::State &state;
+    unsigned long long start;
+};
+
+
+/* -------------------------------- Contexts -------------------------------- */
+
+
+/*
+ * Graphics context that discards everything drawn to it, for the view
+ * context to ask the window size of.
+ */
+class NullContext : public GraphicsContext
+{
+public:
+
+    NullContext( int width, int height ):
+    width( width ), height( height )
+    {
+        run = false;
+    }
+
+    void setMode( drawMode ) override {}
+    void setColor( unsigned int ) override {}
+    void setPixel( int, int ) override {}
+    unsigned int getPixel( int, int ) override { return 0; }
+
+    void drawLine( int, int, int, int ) override {}
+    void drawCircle( int, int, int ) override {}
+
+    void clear() override {}
+    void runLoop( DrawingBase * ) override {}
+
+    int getWindowWidth() override { return width; }
+    int getWindowHeight() override { return height; }
+
+private:
+
+    int width;
+    int height;
+};
+
+
+/* -------------------------------- Helpers --------------------------------- */
+
+
+/**
+ * @brief   Makes a 3x3 matrix holding a rotation, scale and translation
+ *
+ * @param   void
+ *
+ * @return  The matrix
+ */
+static Matrix<double> viewMatrix()
+{
+    Matrix<double> m( 3, 3 );
+
+    m[0][0] = 0.8;
+    m[0][1] = -0.6;
+    m[0][2] = 400;
+    m[1][0] = 0.6;
+    m[1][1] = 0.8;
+    m[1][2] = 400;
+    m[2][2] = 1;
+
+    return m;
+}
+
+
+/**
+ * @brief   Makes random model space coordinates in [-1, 1)
+ *
+ * @param   n   The number of coordinates
+ *
+ * @return  The coordinates
+ */
+static std::vector<double> coordinates( size_t n )
+{
+    std::mt19937 random( 1 );
+    std::uniform_real_distribution<double> unit( -1, 1 );
+    std::vector<double> values( n );
+
+    for ( double &v : values )
+    {
+        v = unit( random );
+    }
+
+    return values;
+}
+
+
+/**
+ * @brief   Makes a polygon with vertices on a circle
+ *
+ * @param   n   The number of vertices
+ *
+ * @return  The polygon
+ */
+static Polygon polygon( unsigned int n )
+{
+    std::vector<Shape::Vertex> verts( n );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        double angle = 6.283185307179586 * i / n;
+        verts[i].x = std::cos( angle );
+        verts[i].y = std::sin( angle );
+    }
+
+    return Polygon( std::move( verts ), PackedColor( 1, 0, 0 ) );
+}
+
+
+/* -------------------------------- Matrices -------------------------------- */
+
+
+static void matrixMultiply( benchmark::State &state )
+{
+    Matrix<double> a = viewMatrix();
+    Matrix<double> b = viewMatrix();
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Matrix<double> product = a * b;
+        benchmark::DoNotOptimize( product[0][0] );
+    }
+}
+BENCHMARK( matrixMultiply );
+
+
+static void affineMultiply( benchmark::State &state )
+{
+    Affine2D a( 0.8, -0.6, 400, 0.6, 0.8, 400 );
+    Affine2D b = a;
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( a );
+        Affine2D product = a * b;
+        benchmark::DoNotOptimize( product );
+    }
+}
+BENCHMARK( affineMultiply );
+
+
+static void matrixTransformPoint( benchmark::State &state )
+{
+    Matrix<double> m = viewMatrix();
+    Point2D p( 0.25, 0.5 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Matrix<double> product = m * p;
+        benchmark::DoNotOptimize( product[0][0] );
+    }
+}
+BENCHMARK( matrixTransformPoint );
+
+
+static void affineTransformPoint( benchmark::State &state )
+{
+    Affine2D m( 0.8, -0.6, 400, 0.6, 0.8, 400 );
+    double x = 0.25;
+    double y = 0.5;
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( x );
+        double tx = m.transformX( x, y );
+        double ty = m.transformY( x, y );
+        benchmark::DoNotOptimize( tx );
+        benchmark::DoNotOptimize( ty );
+    }
+}
+BENCHMARK( affineTransformPoint );
+
+
+/* --------------------------------- Points --------------------------------- */
+
+
+static void point2DConstruct( benchmark::State &state )
+{
+    double x = 0.25;
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( x );
+        Point2D p( x, 0.5 );
+        benchmark::DoNotOptimize( p.getX() );
+    }
+}
+BENCHMARK( point2DConstruct );
+
+
+static void point2DCopy( benchmark::State &state )
+{
+    Point2D p( 0.25, 0.5 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Point2D q( p );
+        benchmark::DoNotOptimize( q.getX() );
+    }
+}
+BENCHMARK( point2DCopy );
+
+
+static void point2DAdd( benchmark::State &state )
+{
+    Point2D p( 0.25, 0.5 );
+    Point2D q( 0.125, -0.5 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Point2D sum = p + q;
+        benchmark::DoNotOptimize( sum.getX() );
+    }
+}
+BENCHMARK( point2DAdd );
+
+
+static void vertexCopy( benchmark::State &state )
+{
+    Vertex2d p = { 0.25, 0.5 };
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( p );
+        Vertex2d q = p;
+        benchmark::DoNotOptimize( q );
+    }
+}
+BENCHMARK( vertexCopy );
+
+
+static void vertexAdd( benchmark::State &state )
+{
+    Vertex2d p = { 0.25, 0.5 };
+    Vertex2d q = { 0.125, -0.5 };
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( p );
+        Vertex2d sum = { p.x + q.x, p.y + q.y };
+        benchmark::DoNotOptimize( sum );
+    }
+}
+BENCHMARK( vertexAdd );
+
+
+static void point2DVectorDeepCopy( benchmark::State &state )
+{
+    std::vector<Point2D*> points;
+
+    for ( int64_t i = 0; i < state.range( 0 ); i++ )
+    {
+        points.push_back( new Point2D( double( i ), double( -i ) ) );
+    }
+
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        std::vector<Point2D*> copy = Point2D::vectorDeepCopy( points );
+        benchmark::DoNotOptimize( copy.data() );
+        Point2D::vectorDeepDelete( copy );
+    }
+
+    Point2D::vectorDeepDelete( points );
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( point2DVectorDeepCopy )->Arg( 16 )->Arg( 1024 );
+
+
+static void vertexVectorCopy( benchmark::State &state )
+{
+    std::vector<Vertex2d> points;
+
+    for ( int64_t i = 0; i < state.range( 0 ); i++ )
+    {
+        points.push_back( { double( i ), double( -i ) } );
+    }
+
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        std::vector<Vertex2d> copy( points );
+        benchmark::DoNotOptimize( copy.data() );
+    }
+
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( vertexVectorCopy )->Arg( 16 )->Arg( 1024 );
+
+
+/* ---------------------------------- View ---------------------------------- */
+
+
+static void viewModelToDevicePoint( benchmark::State &state )
+{
+    NullContext gc( 800, 800 );
+    ViewContext vc( &gc );
+    vc.rotate( 0.5 );
+    Point2D p( 0.25, 0.5 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Point2D device = vc.modelToDevice( p );
+        benchmark::DoNotOptimize( device.getX() );
+    }
+}
+BENCHMARK( viewModelToDevicePoint );
+
+
+static void viewModelToDeviceScalar( benchmark::State &state )
+{
+    NullContext gc( 800, 800 );
+    ViewContext vc( &gc );
+    vc.rotate( 0.5 );
+    double x = 0.25;
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        double dx;
+        double dy;
+        benchmark::DoNotOptimize( x );
+        vc.modelToDevice( x, 0.5, dx, dy );
+        benchmark::DoNotOptimize( dx );
+        benchmark::DoNotOptimize( dy );
+    }
+}
+BENCHMARK( viewModelToDeviceScalar );
+
+
+static void viewModelToDeviceBatch( benchmark::State &state )
+{
+    NullContext gc( 800, 800 );
+    ViewContext vc( &gc );
+    vc.rotate( 0.5 );
+
+    size_t n = size_t( state.range( 0 ) );
+    std::vector<double> xs = coordinates( n );
+    std::vector<double> ys = coordinates( n );
+    std::vector<int> dxs( n );
+    std::vector<int> dys( n );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        vc.transformToDevice( xs.data(), ys.data(), dxs.data(), dys.data(), n );
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( viewModelToDeviceBatch )->Arg( 1 )->Arg( 64 )->Arg( 4096 );
+
+
+static void viewUpdate( benchmark::State &state )
+{
+    NullContext gc( 800, 800 );
+    ViewContext vc( &gc );
+    vc.setRotation( 0.5 );
+    vc.setTranslation( 10, -20 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        vc.update();
+        benchmark::DoNotOptimize( vc.getVersion() );
+    }
+}
+BENCHMARK( viewUpdate );
+
+
+/* --------------------------------- Colors --------------------------------- */
+
+
+static void colorToX11( benchmark::State &state )
+{
+    Color c( 0.25, 0.5, 0.75 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( c );
+        benchmark::DoNotOptimize( c.toX11() );
+    }
+}
+BENCHMARK( colorToX11 );
+
+
+static void packedColorToX11( benchmark::State &state )
+{
+    PackedColor c( 0.25, 0.5, 0.75 );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( c );
+        benchmark::DoNotOptimize( c.toX11() );
+    }
+}
+BENCHMARK( packedColorToX11 );
+
+
+/* --------------------------------- Shapes --------------------------------- */
+
+
+static void lineClone( benchmark::State &state )
+{
+    Line line( Point2D( 0, 0 ), Point2D( 1, 1 ), PackedColor( 1, 0, 0 ) );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Shape *copy = line.clone();
+        benchmark::DoNotOptimize( copy );
+        delete copy;
+    }
+}
+BENCHMARK( lineClone );
+
+
+static void triangleClone( benchmark::State &state )
+{
+    Triangle triangle( Point2D( 0, 0 ), Point2D( 1, 0 ), Point2D( 0, 1 ), PackedColor( 1, 0, 0 ) );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Shape *copy = triangle.clone();
+        benchmark::DoNotOptimize( copy );
+        delete copy;
+    }
+}
+BENCHMARK( triangleClone );
+
+
+static void polygonClone( benchmark::State &state )
+{
+    Polygon shape = polygon( unsigned( state.range( 0 ) ) );
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        Shape *copy = shape.clone();
+        benchmark::DoNotOptimize( copy );
+        delete copy;
+    }
+}
+BENCHMARK( polygonClone )->Arg( 8 )->Arg( 256 );
+
+
+// the store grows in place, so it is emptied every so often to keep the
+// clearing out of the time per shape
+static void polygonStoreAdd( benchmark::State &state )
+{
+    Polygon shape = polygon( unsigned( state.range( 0 ) ) );
+    ShapeStore store;
+    AllocationCounter counter( state );
+
+    for ( auto _ : state )
+    {
+        benchmark::DoNotOptimize( store.add( shape ) );
+
+        if ( store.size() == 4096 )
+        {
+            state.PauseTiming();
+            store.clear();
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK( polygonStoreAdd )->Arg( 8 )->Arg( 256 );
+
+
+/* ---------------------------------- Main ---------------------------------- */
+
+
+BENCHMARK_MAIN();
+
+
+/* -------------------------------------------------------------------------- */
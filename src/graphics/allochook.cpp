@@ -0,0 +1,193 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    allochook.cpp
+ * @brief   Replacement global operator new that counts allocations for the
+ *          frame stats
+ *
+ * Replacing operator new costs every allocation in the process, so this file
+ * is kept out of the drawing library and only linked into the benchmarks and
+ * into the app when it is built with ENABLE_ALLOCATION_HOOK.
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstdlib>
+# include <new>
+
+# include "framestats.h"
+
+
+/* ------------------------------ Allocations ------------------------------- */
+
+
+// every form of operator new counts and allocates here, and every form of
+// operator delete frees what they return, so each pair matches whichever
+// overloads the compiler picks
+
+
+void *operator new( size_t size )
+{
+    FrameStats::countAllocation( size );
+
+    void *p = std::malloc( size ? size : 1 );
+
+    if ( p == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+
+void *operator new[]( size_t size )
+{
+    return operator new( size );
+}
+
+
+void *operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    FrameStats::countAllocation( size );
+    return std::malloc( size ? size : 1 );
+}
+
+
+void *operator new[]( size_t size, const std::nothrow_t &tag ) noexcept
+{
+    return operator new( size, tag );
+}
+
+
+void operator delete( void *p ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete( void *p, const std::nothrow_t& ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p, const std::nothrow_t& ) noexcept
+{
+    std::free( p );
+}
+
+
+// sized deallocation is only used from C++14 on
+# ifdef __cpp_sized_deallocation
+
+void operator delete( void *p, size_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p, size_t ) noexcept
+{
+    std::free( p );
+}
+
+# endif
+
+
+// over-aligned allocation is only used from C++17 on
+# ifdef __cpp_aligned_new
+
+void *operator new( size_t size, std::align_val_t alignment )
+{
+    FrameStats::countAllocation( size );
+
+    // aligned_alloc needs the size to be a multiple of the alignment
+    size_t align = static_cast<size_t>( alignment );
+    size_t rounded = ( ( size ? size : 1 ) + align - 1 ) / align * align;
+    void *p = std::aligned_alloc( align, rounded );
+
+    if ( p == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+
+void *operator new[]( size_t size, std::align_val_t alignment )
+{
+    return operator new( size, alignment );
+}
+
+
+void *operator new( size_t size, std::align_val_t alignment,
+                    const std::nothrow_t& ) noexcept
+{
+    try
+    {
+        return operator new( size, alignment );
+    }
+    catch ( const std::bad_alloc& )
+    {
+        return nullptr;
+    }
+}
+
+
+void *operator new[]( size_t size, std::align_val_t alignment,
+                      const std::nothrow_t &tag ) noexcept
+{
+    return operator new( size, alignment, tag );
+}
+
+
+void operator delete( void *p, std::align_val_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p, std::align_val_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete( void *p, size_t, std::align_val_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p, size_t, std::align_val_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete( void *p, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void *p, std::align_val_t, const std::nothrow_t& ) noexcept
+{
+    std::free( p );
+}
+
+# endif
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,272 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    boundingbox.cpp
+ * @brief   Axis-aligned model space bounding box class
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <limits>
+
+# include "boundingbox.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty bounding box that contains nothing
+ *
+ * @param   void
+ *
+ * @return  The created bounding box
+ */
+BoundingBox::BoundingBox():
+minX( std::numeric_limits<double>::infinity() ),
+minY( std::numeric_limits<double>::infinity() ),
+maxX( -std::numeric_limits<double>::infinity() ),
+maxY( -std::numeric_limits<double>::infinity() )
+{}
+
+
+/**
+ * @brief   Creates a bounding box with the specified extents
+ *
+ * @param   minX    The minimum x-coordinate
+ * @param   minY    The minimum y-coordinate
+ * @param   maxX    The maximum x-coordinate
+ * @param   maxY    The maximum y-coordinate
+ *
+ * @return  The created bounding box
+ */
+BoundingBox::BoundingBox( double minX, double minY, double maxX, double maxY ):
+minX( minX ), minY( minY ), maxX( maxX ), maxY( maxY )
+{}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Grows this bounding box to contain a point
+ *
+ * @param   x   The x-coordinate of the point
+ * @param   y   The y-coordinate of the point
+ *
+ * @return  void
+ */
+void BoundingBox::expand( double x, double y )
+{
+    minX = std::min( minX, x );
+    minY = std::min( minY, y );
+    maxX = std::max( maxX, x );
+    maxY = std::max( maxY, y );
+}
+
+
+/**
+ * @brief   Grows this bounding box to contain another bounding box
+ *
+ * @param   &box    The bounding box to contain
+ *
+ * @return  void
+ */
+void BoundingBox::expand( const BoundingBox &box )
+{
+    minX = std::min( minX, box.minX );
+    minY = std::min( minY, box.minY );
+    maxX = std::max( maxX, box.maxX );
+    maxY = std::max( maxY, box.maxY );
+}
+
+
+/**
+ * @brief   Grows this bounding box by the same margin on every side
+ *
+ * @param   amount  The margin to add on each side
+ *
+ * @return  void
+ */
+void BoundingBox::inflate( double amount )
+{
+    minX -= amount;
+    minY -= amount;
+    maxX += amount;
+    maxY += amount;
+}
+
+
+/**
+ * @brief   Determines if this bounding box contains nothing
+ *
+ * @param   void
+ *
+ * @return  True if this bounding box is empty, false otherwise
+ */
+bool BoundingBox::isEmpty() const
+{
+    return ( minX > maxX ) || ( minY > maxY );
+}
+
+
+/**
+ * @brief   Determines if this bounding box overlaps another bounding box
+ *
+ * @param   &box    The bounding box to test against
+ *
+ * @return  True if the bounding boxes overlap or touch, false otherwise
+ */
+bool BoundingBox::intersects( const BoundingBox &box ) const
+{
+    return ( minX <= box.maxX ) && ( box.minX <= maxX ) &&
+           ( minY <= box.maxY ) && ( box.minY <= maxY );
+}
+
+
+/**
+ * @brief   Determines if this bounding box fully contains another
+ *          bounding box
+ *
+ * @param   &box    The bounding box to test
+ *
+ * @return  True if the other bounding box is inside this one, false otherwise
+ */
+bool BoundingBox::contains( const BoundingBox &box ) const
+{
+    return ( minX <= box.minX ) && ( box.maxX <= maxX ) &&
+           ( minY <= box.minY ) && ( box.maxY <= maxY );
+}
+
+
+/**
+ * @brief   Determines if this bounding box contains a point
+ *
+ * @param   x   The x-coordinate of the point
+ * @param   y   The y-coordinate of the point
+ *
+ * @return  True if the point is inside this bounding box, false otherwise
+ */
+bool BoundingBox::contains( double x, double y ) const
+{
+    return ( minX <= x ) && ( x <= maxX ) && ( minY <= y ) && ( y <= maxY );
+}
+
+
+/**
+ * @brief   Gets the minimum x-coordinate of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The minimum x-coordinate
+ */
+double BoundingBox::getMinX() const
+{
+    return minX;
+}
+
+
+/**
+ * @brief   Gets the minimum y-coordinate of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The minimum y-coordinate
+ */
+double BoundingBox::getMinY() const
+{
+    return minY;
+}
+
+
+/**
+ * @brief   Gets the maximum x-coordinate of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The maximum x-coordinate
+ */
+double BoundingBox::getMaxX() const
+{
+    return maxX;
+}
+
+
+/**
+ * @brief   Gets the maximum y-coordinate of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The maximum y-coordinate
+ */
+double BoundingBox::getMaxY() const
+{
+    return maxY;
+}
+
+
+/**
+ * @brief   Gets the width of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The width of this bounding box
+ */
+double BoundingBox::getWidth() const
+{
+    return maxX - minX;
+}
+
+
+/**
+ * @brief   Gets the height of this bounding box
+ *
+ * @param   void
+ *
+ * @return  The height of this bounding box
+ */
+double BoundingBox::getHeight() const
+{
+    return maxY - minY;
+}
+
+
+/**
+ * @brief   Converts this bounding box to a string and writes it to an
+ *          output stream
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  The output stream
+ */
+std::ostream &BoundingBox::out( std::ostream &os ) const
+{
+    os << "BOX( " << minX << " " << minY << " " << maxX << " " << maxY << " )";
+    return os;
+}
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+/**
+ * @brief   Converts a bounding box to a string and writes it to an output
+ *          stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &box    The bounding box to convert
+ *
+ * @return  The output stream
+ */
+std::ostream &operator<<( std::ostream &os, const BoundingBox &box )
+{
+    box.out( os );
+    return os;
+}
+
+
+/* -------------------------------------------------------------------------- */
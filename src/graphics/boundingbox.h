@@ -0,0 +1,91 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    boundingbox.h
+ * @brief   Axis-aligned model space bounding box class
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_BOUNDINGBOX_H
+# define GRAPHICS_BOUNDINGBOX_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class BoundingBox
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    BoundingBox();
+    BoundingBox( double minX, double minY, double maxX, double maxY );
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void expand( double x, double y );
+    void expand( const BoundingBox &box );
+    void inflate( double amount );
+
+    bool isEmpty() const;
+    bool intersects( const BoundingBox &box ) const;
+    bool contains( const BoundingBox &box ) const;
+    bool contains( double x, double y ) const;
+
+    double getMinX() const;
+    double getMinY() const;
+    double getMaxX() const;
+    double getMaxY() const;
+
+    double getWidth() const;
+    double getHeight() const;
+
+    std::ostream &out( std::ostream &os ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+std::ostream &operator<<( std::ostream &os, const BoundingBox &box );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_BOUNDINGBOX_H
+
+
+/* -------------------------------------------------------------------------- */
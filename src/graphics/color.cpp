@@ -55,6 +55,18 @@ Color( c.getX(), c.getY(), c.getZ() )
 {}
 
 
+/**
+ * @brief   Creates a color from a packed color
+ *
+ * @param   c   The packed color to create from
+ *
+ * @return  The created color
+ */
+Color::Color( PackedColor c ):
+Color( c.getRed(), c.getGreen(), c.getBlue() )
+{}
+
+
 /* -------------------------- Overloaded Operators -------------------------- */
 
 
@@ -328,6 +340,19 @@ std::ostream &operator<<( std::ostream &os, const Color &c )
 /* ---------------------------- Public Functions ---------------------------- */
 
 
+/**
+ * @brief   Packs this color into 32 bits for storage, clamping each channel
+ *
+ * @param   void
+ *
+ * @return  The packed color
+ */
+PackedColor Color::pack() const
+{
+    return PackedColor( getX(), getY(), getZ() );
+}
+
+
 /**
  * @brief   Converts this color to an X11 compatible color
  *
@@ -337,9 +362,27 @@ std::ostream &operator<<( std::ostream &os, const Color &c )
  */
 unsigned int Color::toX11() const
 {
-    return  ( ( ( int ) ( getX() * 255 ) ) << 16 ) +
-            ( ( ( int ) ( getY() * 255 ) ) << 8 )  +
-            ( ( ( int ) ( getZ() * 255 ) ) << 0);
+    return toX11( getX(), getY(), getZ() );
+}
+
+
+/**
+ * @brief   Converts a set of color channels to an X11 compatible color
+ *          without constructing a color, truncating each channel to 8 bits
+ *          the way colors always have been; PackedColor rounds instead, so
+ *          the two can differ by one in a channel
+ *
+ * @param   r   The red channel
+ * @param   g   The green channel
+ * @param   b   The blue channel
+ *
+ * @return  An X11 compatible color
+ */
+unsigned int Color::toX11( double r, double g, double b )
+{
+    return  ( ( ( int ) ( r * 255 ) ) << 16 ) +
+            ( ( ( int ) ( g * 255 ) ) << 8 )  +
+            ( ( ( int ) ( b * 255 ) ) << 0);
 }
 
 /**
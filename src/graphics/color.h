@@ -17,6 +17,7 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include "packedcolor.h"
 # include "vector3.h"
 
 
@@ -35,6 +36,7 @@ public:
     Color();
     Color( double r, double g, double b );
     Color( const Color &c );
+    explicit Color( PackedColor c );
 
     ~Color() = default;
 
@@ -65,7 +67,10 @@ public:
     /* ------------------------------ Functions ----------------------------- */
 
 
+    PackedColor pack() const;
+
     unsigned int toX11() const;
+    static unsigned int toX11( double r, double g, double b );
 
     double brightness() const;
 
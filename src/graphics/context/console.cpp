@@ -0,0 +1,127 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    console.cpp
+ * @brief   Non-blocking line input from a terminal or pipe
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <thread>
+# include <utility>
+
+# include "console.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a console that reads from an input stream once started
+ *
+ * @param   &is     The input stream to read from, which must outlive the
+ *                  program's use of it
+ *
+ * @return  The created console
+ */
+Console::Console( std::istream &is ):
+is( is ), channel( std::make_shared<Channel>() )
+{}
+
+
+/**
+ * @brief   Console destructor, telling the reading thread to stop
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Console::~Console()
+{
+    std::lock_guard<std::mutex> lock( channel->mutex );
+    channel->stopped = true;
+    channel->notify = nullptr;
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Starts reading lines in the background
+ *
+ * @param   notify  Called from the reading thread after every line
+ *
+ * @return  void
+ */
+void Console::start( std::function<void()> notify )
+{
+    if ( started )
+    {
+        return;
+    }
+
+    channel->notify = notify;
+    std::thread( read, std::ref( is ), channel ).detach();
+    started = true;
+}
+
+
+/**
+ * @brief   Takes the oldest line read so far without waiting for one
+ *
+ * @param   &line   Replaced by the line, without its newline
+ *
+ * @return  True if a line was taken, false if none is waiting
+ */
+bool Console::poll( std::string &line )
+{
+    std::lock_guard<std::mutex> lock( channel->mutex );
+
+    if ( channel->lines.empty() )
+    {
+        return false;
+    }
+
+    line = std::move( channel->lines.front() );
+    channel->lines.pop_front();
+    return true;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Reads lines until the stream ends or the console is gone, runs on
+ *          the reading thread
+ *
+ * @param   &is         The input stream to read from
+ * @param   channel     The queue shared with the console
+ *
+ * @return  void
+ */
+void Console::read( std::istream &is, std::shared_ptr<Channel> channel )
+{
+    std::string line;
+
+    while ( std::getline( is, line ) )
+    {
+        std::lock_guard<std::mutex> lock( channel->mutex );
+
+        if ( channel->stopped )
+        {
+            return;
+        }
+
+        // notify under the lock, so the console cannot go away meanwhile
+        channel->lines.push_back( line );
+        if ( channel->notify ) channel->notify();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,102 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    console.h
+ * @brief   Non-blocking line input from a terminal or pipe
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_CONSOLE_H
+# define GRAPHICS_CONTEXT_CONSOLE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <deque>
+# include <functional>
+# include <istream>
+# include <memory>
+# include <mutex>
+# include <string>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Reads lines from an input stream on a thread of its own, so the event
+ * loop can poll for them instead of blocking until the user has typed a
+ * whole line. A blocked read cannot be interrupted, so the reading thread
+ * is detached and shares its queue with the console rather than the console
+ * itself; once the console is gone the thread stops after its next line.
+ */
+class Console
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit Console( std::istream &is );
+    Console( const Console &console ) = delete;
+
+    ~Console();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Console &operator=( const Console &console ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void start( std::function<void()> notify );
+    bool poll( std::string &line );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    struct Channel
+    {
+        std::mutex mutex;
+        std::deque<std::string> lines;
+        std::function<void()> notify;
+        bool stopped = false;
+    };
+
+    std::istream &is;
+    std::shared_ptr<Channel> channel;
+    bool started = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static void read( std::istream &is, std::shared_ptr<Channel> channel );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_CONSOLE_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -1,8 +1,7 @@
 #ifndef DRAWBASE_H
 #define DRAWBASE_H
 
-// forward reference
-class GraphicsContext;
+#include "gcontext.h"
 
 class DrawingBase
 {
@@ -10,10 +9,17 @@ class DrawingBase
         DrawingBase() = default;
 		virtual ~DrawingBase() = default;
 		virtual void paint( GraphicsContext *gc) = 0;
+		// repaint only a damaged rectangle - defaults to a full paint
+		virtual void paint( GraphicsContext *gc, const GraphicsContext::Rect &) { paint(gc); }
 		virtual void keyDown( GraphicsContext *gc, unsigned int keycode) = 0;
 		virtual void keyUp( GraphicsContext *gc, unsigned int keycode) = 0;
 		virtual void mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y) = 0;
 		virtual void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y) = 0;
 		virtual void mouseMove( GraphicsContext *gc, int x, int y) = 0;
+		// the window changed size - defaults to doing nothing
+		virtual void resize( GraphicsContext *, int, int) {}
+		// another thread called wake on the context - defaults to doing
+		// nothing
+		virtual void idle( GraphicsContext *) {}
 };
 #endif
@@ -11,16 +11,42 @@
 
 
 # include <algorithm>
-# include <fstream>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
 # include <iostream>
+# include <utility>
+
+# include <unistd.h>
 
 # include "drawcontext.h"
+# include "framestats.h"
 # include "line.h"
 # include "shape.h"
+# include "simplify.h"
+# include "tracerecorder.h"
 # include "triangle.h"
 # include "polygon.h"
 
 
+/* ------------------------------- Constants -------------------------------- */
+
+
+// frame stats overlay glyphs are 2x4 units of 2 pixels, on 6 by 12 pixel
+// cells, inside a margin
+static const int STATS_UNIT = 2;
+static const int STATS_ADVANCE = 6;
+static const int STATS_LINE_HEIGHT = 12;
+static const int STATS_MARGIN = 4;
+
+// how close the pointer has to come to a shape to hover it, and how far
+// outside the shape its outline is drawn, in pixels
+static const int HOVER_TOLERANCE = 4;
+static const int HOVER_MARGIN = 3;
+
+static const unsigned int HOVER_COLOR = 0x00A0FF;
+
+
 /* ----------------------- Constructors / Destructors ----------------------- */
 
 
@@ -37,44 +63,53 @@ DrawContext::~DrawContext() = default;
 
 void DrawContext::paint( GraphicsContext *gc )
 {
-    // cancel stroke
-    strokeCancel( gc );
+    FRAME_STATS_BEGIN();
 
     // clear the canvas
     gc->clear();
 
-    // update view context
-    vc->update();
+    frame.clear();
 
     // draw crosshair
-    if ( draw2DAxis )
+    drawAxes( frame );
+
+    // redraw shapes, unless the graphics context keeps them itself
+    if ( !gc->canRetain() )
     {
-        gc->setMode( GraphicsContext::MODE_NORMAL );
+        sc.draw( frame, vc, workers.get() );
+    }
 
-        Point2D origin = Point2D( 0, 0 );
-        Point2D xAxisVector = Point2D( 0.1, 0 );
-        Point2D yAxisVector = Point2D( 0, 0.1 );
+    // submit the frame
+    gc->setMode( GraphicsContext::MODE_NORMAL );
+    frame.submit( gc );
+    drawRetained( gc );
 
-        Point2D deviceOrigin = vc->modelToDevice( origin );
-        Point2D deviceXAxisVector = vc->modelToDevice( xAxisVector );
-        Point2D deviceYAxisVector = vc->modelToDevice( yAxisVector );
+    // overlay the last frame's stats
+    GraphicsContext::Rect window = { 0, 0, gc->getWindowWidth(), gc->getWindowHeight() };
+    drawStats( gc, window );
+    gc->resetClip();
 
-        gc->setColor( 0xFF0000 );
-        gc->drawLine(
-            deviceOrigin.getX(), deviceOrigin.getY(),
-            deviceXAxisVector.getX(), deviceXAxisVector.getY()
-        );
+    // the stroke and the hover outline follow the view
+    overlayUpdate( gc );
 
-        gc->setColor( 0x00FF00 );
-        gc->drawLine(
-            deviceOrigin.getX(), deviceOrigin.getY(),
-            deviceYAxisVector.getX(), deviceYAxisVector.getY()
-        );
-    }
+    gc->present();
+    FRAME_STATS_END();
+}
 
-    // redraw shapes
-    gc->setMode( GraphicsContext::MODE_NORMAL );
-    sc.draw( gc, vc );
+
+void DrawContext::paint( GraphicsContext *gc, const GraphicsContext::Rect &region )
+{
+    FRAME_STATS_BEGIN();
+
+    // only touch the damaged region
+    repaint( gc, region );
+
+    // overlay the last frame's stats
+    drawStats( gc, region );
+
+    gc->resetClip();
+    gc->present();
+    FRAME_STATS_END();
 }
 
 
@@ -91,62 +126,62 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
             double r = (( double ) ( rand() % 100 )) / 100;
             double g = (( double ) ( rand() % 100 )) / 100;
             double b = (( double ) ( rand() % 100 )) / 100;
-            strokeSetColor( gc, Color( r, g, b ));
+            strokeSetColor( gc, PackedColor( r, g, b ));
             break;
         }
 
         // NUMROW 1: set color black
         case DrawContext::KEY_CODE_1:
             std::cout << "COLOR SET: BLACK" << std::endl;
-            strokeSetColor( gc, Color( 0, 0, 0 ));
+            strokeSetColor( gc, PackedColor( 0, 0, 0 ));
             break;
 
         // NUMROW 2: set color gray
         case DrawContext::KEY_CODE_2:
             std::cout << "COLOR SET: GRAY" << std::endl;
-            strokeSetColor( gc, Color( 0.4, 0.4, 0.4 ));
+            strokeSetColor( gc, PackedColor( 0.4, 0.4, 0.4 ));
             break;
 
         // NUMROW 3: set color white
         case DrawContext::KEY_CODE_3:
             std::cout << "COLOR SET: WHITE" << std::endl;
-            strokeSetColor( gc, Color( 1, 1, 1 ));
+            strokeSetColor( gc, PackedColor( 1, 1, 1 ));
             break;
 
         // NUMROW 4: set color red
         case DrawContext::KEY_CODE_4:
             std::cout << "COLOR SET: RED" << std::endl;
-            strokeSetColor( gc, Color( 1, 0, 0 ));
+            strokeSetColor( gc, PackedColor( 1, 0, 0 ));
             break;
 
         // NUMROW 5: set color green
         case DrawContext::KEY_CODE_5:
             std::cout << "COLOR SET: GREEN" << std::endl;
-            strokeSetColor( gc, Color( 0.1, 0.9, 0 ));
+            strokeSetColor( gc, PackedColor( 0.1, 0.9, 0 ));
             break;
 
         // NUMROW 6: set color blue
         case DrawContext::KEY_CODE_6:
             std::cout << "COLOR SET: BLUE" << std::endl;
-            strokeSetColor( gc, Color( 0.1, 0.3, 1 ));
+            strokeSetColor( gc, PackedColor( 0.1, 0.3, 1 ));
             break;
 
         // NUMROW 7: set color cyan
         case DrawContext::KEY_CODE_7:
             std::cout << "COLOR SET: CYAN" << std::endl;
-            strokeSetColor( gc, Color( 0, 0.8, 1 ));
+            strokeSetColor( gc, PackedColor( 0, 0.8, 1 ));
             break;
 
         // NUMROW 8: set color magenta
         case DrawContext::KEY_CODE_8:
             std::cout << "COLOR SET: MAGENTA" << std::endl;
-            strokeSetColor( gc, Color( 0.9, 0, 0.9 ));
+            strokeSetColor( gc, PackedColor( 0.9, 0, 0.9 ));
             break;
 
         // NUMROW 9: set color yellow
         case DrawContext::KEY_CODE_9:
             std::cout << "COLOR SET: YELLOW" << std::endl;
-            strokeSetColor( gc, Color( 1, 0.8, 0 ));
+            strokeSetColor( gc, PackedColor( 1, 0.8, 0 ));
             break;
 
         // A: toggle draw axes
@@ -159,12 +194,33 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
         // C: clear drawing
         case DrawContext::KEY_CODE_C:
             strokeCancel( gc );
-            drawingClear( gc );
+            pendingOpen.clear();
+            drawingPrompt( PROMPT_CLEAR );
+            break;
+
+        // F: toggle frame stats overlay
+        case DrawContext::KEY_CODE_F:
+            if ( !FrameStats::isBuiltIn() )
+            {
+                std::cout << "FRAME STATS: NOT BUILT IN" << std::endl;
+                break;
+            }
+            FrameStats::setOverlay( !FrameStats::getOverlay() );
+            std::cout << "FRAME STATS: " << ( FrameStats::getOverlay() ? "ENABLED" : "DISABLED" ) << std::endl;
+            paint( gc );
+            break;
+
+        // J: toggle journaled saves
+        case DrawContext::KEY_CODE_J:
+            journalMode = !journalMode;
+            if ( !journalMode ) journal.detach();
+            std::cout << "JOURNALED SAVES: " << ( journalMode ? "ENABLED" : "DISABLED" ) << std::endl;
             break;
 
         // O: open drawing
         case DrawContext::KEY_CODE_O:
-            drawingOpen( gc );
+            strokeCancel( gc );
+            drawingPrompt( PROMPT_OPEN );
             break;
 
         // R: reset view
@@ -175,7 +231,13 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
 
         // S: save drawing
         case DrawContext::KEY_CODE_S:
-            drawingSave();
+            drawingPrompt( PROMPT_SAVE );
+            break;
+
+        // V: toggle stroke simplification
+        case DrawContext::KEY_CODE_V:
+            simplifyStrokes = !simplifyStrokes;
+            std::cout << "STROKE SIMPLIFICATION: " << ( simplifyStrokes ? "ENABLED" : "DISABLED" ) << std::endl;
             break;
 
         // X: toggle x-axis snapping
@@ -190,6 +252,16 @@ void DrawContext::keyDown( GraphicsContext *gc, unsigned int keycode )
             std::cout << "SNAP TO Y: " << ( snapToY ? "ENABLED" : "DISABLED" ) << std::endl;
             break;
 
+        // Z: undo the last change to the drawing
+        case DrawContext::KEY_CODE_Z:
+            drawingUndo( gc );
+            break;
+
+        // SHIFT-Z: redo the last change undone
+        case DrawContext::KEY_CODE_SHIFT_Z:
+            drawingRedo( gc );
+            break;
+
         // ENTER: freeze drawing
         case DrawContext::KEY_CODE_ENTER:
             strokeFreeze( gc );
@@ -236,13 +308,11 @@ void DrawContext::mouseButtonDown( GraphicsContext *gc, unsigned int button, int
     }
     else if ( button == 2 && !panActive && !rotateActive )
     {
-        strokeCancel( gc );
         panActive = true;
         lastMousePosition = Point2D( x, y );
     }
     else if ( button == 3 && !panActive && !rotateActive )
     {
-        strokeCancel( gc );
         rotateActive = true;
         lastMousePosition = Point2D( x, y );
     }
@@ -283,60 +353,21 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
 {
     // std::cout << "Mouse Move: (" << x << ", " << y << ")" << std::endl;
 
-    // draw handler
-    if ( !verts.empty() )
-    {
-        // get rubberbanding vert and most recently frozen vert
-        Point2D *startVert = verts[0];
-        Point2D *frozenVert = verts[verts.size() - 2];
-        Point2D *rbVert = verts[verts.size() - 1];
-
-        // erase old lines
-        gc->drawLine(
-            frozenVert->getX(), frozenVert->getY(),
-            rbVert->getX(), rbVert->getY()
-        );
-
-        if (( verts.size() > 2 ) && loopMode )
-        {
-            gc->drawLine(
-                startVert->getX(), startVert->getY(),
-                rbVert->getX(), rbVert->getY()
-            );
-        }
-
-        // adjust mouse coordinates for snapping
-        if ( snapToX ) y = frozenVert->getY();
-        if ( snapToY ) x = frozenVert->getX();
-
-        // update rubberbanding vert
-        rbVert->setX( x );
-        rbVert->setY( y );
-
-        // draw new line
-        gc->drawLine(
-            frozenVert->getX(), frozenVert->getY(),
-            rbVert->getX(), rbVert->getY()
-        );
-
-        if (( verts.size() > 2 ) && loopMode )
-        {
-            gc->drawLine(
-                startVert->getX(), startVert->getY(),
-                rbVert->getX(), rbVert->getY()
-            );
-        }
-    }
-
     // pan handler
-    else if ( panActive )
+    if ( panActive )
     {
         Point2D currentMousePosition = Point2D( x, y );
         Point2D mouseDeltaModel = vc->deviceToModel( currentMousePosition ) - vc->deviceToModel( lastMousePosition );
 
+        Affine2D previous = vc->getTransform();
+
         vc->translate( mouseDeltaModel.getX(), mouseDeltaModel.getY() );
         lastMousePosition = currentMousePosition;
-        paint( gc );
+
+        if ( !paintScrolled( gc, previous ) )
+        {
+            paint( gc );
+        }
     }
 
     // rotate handler
@@ -352,341 +383,1515 @@ void DrawContext::mouseMove( GraphicsContext *gc, int x, int y )
         paint( gc );
         vc->setRotation( currentRotation );
     }
+
+    // draw handler, moving the rubberbanding vert to the pointer
+    else if ( !verts.empty() )
+    {
+        strokeSnap( x, y );
+        *verts[verts.size() - 1] = vc->deviceToModel( Point2D( x, y ) );
+        overlayUpdate( gc );
+    }
+
+    // hover handler
+    else
+    {
+        hoverUpdate( gc, x, y );
+    }
 }
 
 
-/* ---------------------------- Private Functions --------------------------- */
+void DrawContext::resize( GraphicsContext *gc, int /* width */, int /* height */ )
+{
+    // the screen transform keeps the origin centered in the window, so
+    // it only needs recomputing when the window size changes
+    vc->update();
+    paint( gc );
+}
 
 
-/**
- * @brief   Adds a vertex to a stroke
- *
- * @param   *gc     The graphics context to draw the stroke to
- * @param   x       The x-coordinate of the vertex
- * @param   y       The y-coordinate of the vertex
- *
- * @return  void
- */
-void DrawContext::strokeAddVert( GraphicsContext *gc, int x, int y )
+void DrawContext::idle( GraphicsContext *gc )
 {
-    if ( verts.empty())
+    std::string line;
+
+    while ( console && console->poll( line ) )
     {
-        // set draw color and draw mode
-        gc->setColor( drawColor.toX11() ^ Color( 1, 1, 1 ).toX11());
-        gc->setMode( GraphicsContext::MODE_XOR );
+        if ( recorder ) recorder->recordCommand( line );
+        drawingCommand( gc, line );
+    }
 
-        // add new verts
-        verts.push_back( new Point2D( x, y ) );
-        verts.push_back( new Point2D( x, y ) );
+    drawingPoll( gc );
+}
 
-        // draw initial line
-        Point2D *startVert = verts[0];
-        Point2D *rbVert = verts[verts.size() - 1];
-        gc->drawLine(
-            startVert->getX(), startVert->getY(),
-            rbVert->getX(), rbVert->getY()
-        );
-    }
-    else
-    {
-        // adjust mouse coordinates for snapping
-        Point2D * frozenVert = verts[verts.size() - 2];
-        if ( snapToX ) y = frozenVert->getY();
-        if ( snapToY ) x = frozenVert->getX();
 
-        // freeze rubberbanding vert
-        verts[verts.size() - 1]->setX( x );
-        verts[verts.size() - 1]->setY( y );
+void DrawContext::listen( GraphicsContext *gc, std::istream &is )
+{
+    console.reset( new Console( is ) );
+    console->start( [gc]() { gc->wake(); } );
+}
 
-        // add new rubberbanding vert
-        verts.push_back( new Point2D( x, y ));
 
-        // draw initial loop line
-        if (( verts.size() == 3 ) & loopMode )
-        {
-            Point2D *startVert = verts[0];
-            Point2D *rbVert = verts[verts.size() - 1];
-            gc->drawLine(
-                startVert->getX(), startVert->getY(),
-                rbVert->getX(), rbVert->getY()
-            );
-        }
-    }
+void DrawContext::command( GraphicsContext *gc, const std::string &line )
+{
+    drawingCommand( gc, line );
 }
 
 
-/**
- * @brief   Freezes a stroke and converts it to a shape
- *
- * @param   *gc     The graphics context to draw the stroke to
- *
- * @return  void
- */
-void DrawContext::strokeFreeze( GraphicsContext *gc )
+void DrawContext::open( GraphicsContext *gc, const std::string &fileName )
 {
-    if ( !verts.empty())
-    {
-        // clear the rubberbanding lines
-        strokeDrawLines( gc );
+    drawingOpen( gc, fileName );
+}
 
-        // set draw mode to normal
-        gc->setMode( GraphicsContext::MODE_NORMAL );
 
-        // convert verts to model coordinates
-        for ( unsigned int i = 0; i < verts.size(); i++ )
-        {
-            *verts[i] = vc->deviceToModel( *verts[i] );
-        }
+void DrawContext::finish( GraphicsContext *gc )
+{
+    // a replay waits here for the file operation a recorded session saw
+    // finish, rather than taking it whenever the worker gets there
+    worker.wait();
+    drawingPoll( gc );
+}
 
-        // define and add shapes to container
-        if ( !loopMode )
-        {
-            for ( unsigned int i = 0; i < ( verts.size() - 2 ); i++ )
-            {
-                Line line = Line( *verts[i], *verts[i + 1], drawColor );
-                line.draw( gc, vc );
-                sc.add( line );
-            }
-        }
-        else if ( verts.size() == 3 )
-        {
-            Line line = Line( *verts[0], *verts[1], drawColor );
-            line.draw( gc, vc );
-            sc.add( line );
-        }
-        else if ( verts.size() == 4 )
-        {
-            Triangle triangle = Triangle( *verts[0], *verts[1], *verts[2], drawColor );
-            triangle.draw( gc, vc );
-            sc.add( triangle );
-        }
-        else
-        {
-            verts.erase( verts.begin() + ( verts.size() - 1 ));
-            Polygon polygon = Polygon( verts, drawColor );
-            polygon.draw( gc, vc );
-            sc.add( polygon );
-        }
 
-        // clear verts
-        strokeClearVerts();
-    }
+bool DrawContext::isBusy() const
+{
+    return worker.isBusy();
 }
 
 
-/**
- * @brief   Cancels a stroke
- *
- * @param   *gc     The graphics context to draw the stroke to
- *
- * @return  void
- */
-void DrawContext::strokeCancel( GraphicsContext *gc )
+void DrawContext::setRecorder( TraceRecorder *recorder )
 {
-    strokeDrawLines( gc );
-    strokeClearVerts();
-    gc->setMode( GraphicsContext::MODE_NORMAL );
+    this->recorder = recorder;
 }
 
 
-/**
- * @brief   Clears the vertices from a stroke
- *
- * @param   void
- *
- * @return  void
- */
-void DrawContext::strokeClearVerts()
+void DrawContext::setThreads( unsigned int threads )
 {
-    if ( !verts.empty())
+    // one thread draws without a pool, and zero is one per hardware thread
+    if ( threads == 1 )
     {
-        // clear verts
-        std::for_each(
-            verts.begin(), verts.end(), []( Point2D *p )
-            {
-                delete p;
-            }
-        );
-        verts.clear();
+        workers.reset();
+    }
+    else
+    {
+        workers.reset( new WorkPool( threads ) );
     }
 }
 
 
+/* ---------------------------- Private Functions --------------------------- */
+
+
 /**
- * @brief   Sets the color of a stroke
+ * @brief   Clears a region of the window and draws the crosshair and the
+ *          shapes that can reach it, leaving the clip on the region
  *
- * @param   *gc     The graphics context to draw the stroke to
- * @param   &color  The color of the stroke
+ * @param   *gc         The graphics context to draw to
+ * @param   &region     The part of the window to repaint
  *
  * @return  void
  */
-void DrawContext::strokeSetColor( GraphicsContext *gc, const Color &color )
+void DrawContext::repaint( GraphicsContext *gc, const GraphicsContext::Rect &region )
 {
-    strokeDrawLines( gc );
-    gc->setColor( color.toX11() ^ canvasColor.toX11());
-    drawColor = color;
-    strokeDrawLines( gc );
+    gc->setClip( region );
+    gc->setMode( GraphicsContext::MODE_NORMAL );
+    gc->clear();
+
+    frame.clear();
+
+    // draw crosshair
+    drawAxes( frame );
+
+    // redraw only the shapes that can reach the region
+    if ( !gc->canRetain() )
+    {
+        sc.draw( frame, vc, vc->deviceToModel( region ), workers.get() );
+    }
+
+    // submit the frame
+    frame.submit( gc );
+    drawRetained( gc );
 }
 
 
 /**
- * @brief   Draws the lines of a stroke
+ * @brief   Draws the shapes with a graphics context that keeps their edges
+ *          itself, first handing it the edges of shapes added since the last
+ *          draw, or of every shape if any were removed
  *
- * @param   *gc     The graphics context to draw the stroke to
+ * @param   *gc     The graphics context to draw to
  *
  * @return  void
  */
-void DrawContext::strokeDrawLines( GraphicsContext *gc )
+void DrawContext::drawRetained( GraphicsContext *gc )
 {
-    if ( !verts.empty())
+    if ( !gc->canRetain() )
     {
-        // draw all XOR lines
-        for ( unsigned int i = 0; i < verts.size() - 1; i++ )
-        {
-            Point2D *curVert = verts[i];
-            Point2D *nextVert = verts[i + 1];
-            gc->drawLine(
-                curVert->getX(), curVert->getY(),
-                nextVert->getX(), nextVert->getY()
-            );
-        }
+        return;
+    }
 
-        // draw loop lines
-        if (( verts.size() > 2 ) && loopMode )
-        {
-            Point2D *startVert = verts[0];
-            Point2D *rbVert = verts[verts.size() - 1];
-            gc->drawLine(
-                startVert->getX(), startVert->getY(),
-                rbVert->getX(), rbVert->getY()
-            );
-        }
+    if ( sc.getVersion() != retainedVersion )
+    {
+        gc->releaseLines();
+        retainedVersion = sc.getVersion();
+        retainedEnd = 0;
     }
-}
 
+    retainedVertices.clear();
+    retainedEnd = sc.edges( retainedEnd, retainedVertices );
 
-/**
- * @brief   Toggles loop mode
- *
- * @param   *gc     The graphics context to draw the stroke to
- *
- * @return  void
- */
-void DrawContext::toggleLoopMode( GraphicsContext *gc )
-{
-    loopMode = !loopMode;
+    if ( !retainedVertices.empty() )
+    {
+        gc->retainLines( retainedVertices.data(), retainedVertices.size() );
+    }
 
-    if ( verts.size() > 2 )
+    const Affine2D &transform = vc->getTransform();
+    double matrix[6];
+
+    for ( unsigned int i = 0; i < 6; i++ )
     {
-        Point2D *startVert = verts[0];
-        Point2D *rbVert = verts[verts.size() - 1];
-        gc->drawLine(
-            startVert->getX(), startVert->getY(),
-            rbVert->getX(), rbVert->getY()
-        );
+        matrix[i] = transform.get( i / 3, i % 3 );
     }
 
-    std::cout << "LOOP MODE: ";
-    std::cout << ( loopMode ? "ENABLED" : "DISABLED" ) << std::endl;
+    gc->drawRetained( matrix );
+    FRAME_STATS_ADD( shapesDrawn, sc.size() );
 }
 
 
 /**
- * @brief   Clears the canvas and opens a new drawing from file
+ * @brief   Paints a pan by scrolling what is already on the canvas and
+ *          repainting only the strips it uncovers, so a pan costs as much as
+ *          the distance moved rather than the whole drawing
  *
- * @param   *gc     The graphics context to draw to
+ * @param   *gc         The graphics context to draw to
+ * @param   &previous   The view transform before the pan
  *
- * @return  void
+ * @return  True if the pan was painted, false if the view changed by more
+ *          than whole pixels or the context cannot scroll, in which case
+ *          nothing was drawn and a full paint is needed
  */
-void DrawContext::drawingOpen( GraphicsContext *gc )
+bool DrawContext::paintScrolled( GraphicsContext *gc, const Affine2D &previous )
 {
-    strokeCancel( gc );
-
-    std::cout << "OPEN FILE: ";
+    const Affine2D &current = vc->getTransform();
 
-    std::string fileName;
-    std::cin >> fileName;
+    for ( unsigned int row = 0; row < 2; row++ )
+    {
+        for ( unsigned int col = 0; col < 2; col++ )
+        {
+            if ( current.get( row, col ) != previous.get( row, col ) )
+            {
+                return false;
+            }
+        }
+    }
 
-    std::ifstream filein( fileName.c_str());
+    double tx = current.get( 0, 2 ) - previous.get( 0, 2 );
+    double ty = current.get( 1, 2 ) - previous.get( 1, 2 );
+    int dx = int( std::round( tx ) );
+    int dy = int( std::round( ty ) );
 
-    if ( !filein )
+    // shapes land on the same pixels after a scroll only if the view moved
+    // by whole pixels
+    if ( ( std::fabs( tx - dx ) > 1e-6 ) || ( std::fabs( ty - dy ) > 1e-6 ) )
     {
-        std::cerr << "ERROR: Invalid file name or location!" << std::endl;
+        return false;
     }
-    else
+
+    int width = gc->getWindowWidth();
+    int height = gc->getWindowHeight();
+
+    if ( ( std::abs( dx ) >= width ) || ( std::abs( dy ) >= height ) )
     {
-        drawingClear( gc );
-        sc.in( filein );
-        sc.draw( gc, vc );
-        filein.close();
-        std::cout << "FILE OPENED!" << std::endl;
+        return false;
     }
 
-    vc->resetView();
-    paint( gc );
-}
+    FRAME_STATS_BEGIN();
 
+    if ( !gc->scroll( dx, dy ) )
+    {
+        return false;
+    }
 
-/**
- * @brief   Saves the current drawing to a file
- *
- * @param   void
- *
- * @return  void
- */
-void DrawContext::drawingSave()
-{
-    std::cout << "SAVE FILE: ";
+    // the full width strip above or below, then the rest of the strip
+    // left or right of what was kept
+    std::vector<GraphicsContext::Rect> strips;
 
-    std::string fileName;
-    std::cin >> fileName;
+    if ( dy != 0 )
+    {
+        strips.push_back( { 0, ( dy > 0 ) ? 0 : height + dy, width, std::abs( dy ) } );
+    }
 
-    std::ofstream fileout( fileName.c_str());
+    if ( dx != 0 )
+    {
+        strips.push_back( { ( dx > 0 ) ? 0 : width + dx, std::max( dy, 0 ),
+                            std::abs( dx ), height - std::abs( dy ) } );
+    }
 
-    if ( !fileout )
+    // the overlay stays put, so clear where it was scrolled to and draw it
+    // again over both where it was and where it will be
+    if ( FrameStats::getOverlay() )
     {
-        std::cerr << "ERROR: Invalid file name or location!" << std::endl;
+        GraphicsContext::Rect box = statsBox( FrameStats::last().summary() );
+
+        strips.push_back( { 0, 0,
+                            std::max( box.width, statsShown.width + std::max( dx, 0 ) ),
+                            std::max( box.height, statsShown.height + std::max( dy, 0 ) ) } );
     }
-    else
+
+    for ( const GraphicsContext::Rect &strip : strips )
     {
-        fileout << sc;
-        fileout.close();
-        std::cout << "FILE SAVED!" << std::endl;
+        repaint( gc, strip );
+        drawStats( gc, strip );
     }
+
+    gc->resetClip();
+    overlayUpdate( gc );
+    gc->present();
+    FRAME_STATS_END();
+
+    return true;
 }
 
 
 /**
- * @brief   Clears the drawing canvas
+ * @brief   Adds the 2D axis crosshair to a frame, if enabled
  *
- * @param   *gc     The graphics context to clear
+ * @param   &sb     The segment buffer to draw to
  *
  * @return  void
  */
-void DrawContext::drawingClear( GraphicsContext *gc )
+void DrawContext::drawAxes( SegmentBuffer &sb )
 {
-    std::string input;
-
-    do
+    if ( draw2DAxis )
     {
-        std::cout << "ARE YOU SURE YOU WANT TO CLEAR THE CANVAS? (Y/N): ";
-        std::cin >> input;
-        std::transform( input.begin(), input.end(), input.begin(), ::toupper);;
-    } while ( input != "Y" && input != "N" );
+        double originX, originY, xAxisX, xAxisY, yAxisX, yAxisY;
+        vc->modelToDevice( 0, 0, originX, originY );
+        vc->modelToDevice( 0.1, 0, xAxisX, xAxisY );
+        vc->modelToDevice( 0, 0.1, yAxisX, yAxisY );
+
+        // rounded rather than truncated, since the origin sits on a whole
+        // pixel give or take the error a pan accumulates, and scrolling
+        // relies on it staying on the same one
+        int x0 = int( std::lround( originX ) );
+        int y0 = int( std::lround( originY ) );
+
+        sb.add( 0xFF0000, x0, y0, int( std::lround( xAxisX ) ), int( std::lround( xAxisY ) ) );
+        sb.add( 0x00FF00, x0, y0, int( std::lround( yAxisX ) ), int( std::lround( yAxisY ) ) );
+    }
+}
+
+
+/**
+ * @brief   Rebuilds the graphics context's overlay from the outline of the
+ *          hovered shape and the lines of the stroke, in the current view
+ *
+ * @param   *gc     The graphics context to show the overlay on
+ *
+ * @return  void
+ */
+void DrawContext::overlayUpdate( GraphicsContext *gc )
+{
+    overlay.clear();
+
+    GraphicsContext::Rect rect;
+
+    if ( hoverRect( gc, hovered, rect ) )
+    {
+        int x0 = rect.x + 1;
+        int y0 = rect.y + 1;
+        int x1 = rect.x + rect.width - 2;
+        int y1 = rect.y + rect.height - 2;
+
+        overlay.push_back( { HOVER_COLOR, { x0, y0, x1, y0 } } );
+        overlay.push_back( { HOVER_COLOR, { x1, y0, x1, y1 } } );
+        overlay.push_back( { HOVER_COLOR, { x1, y1, x0, y1 } } );
+        overlay.push_back( { HOVER_COLOR, { x0, y1, x0, y0 } } );
+    }
+
+    if ( !verts.empty() )
+    {
+        // transformed the way shapes are, so the lines of a frozen stroke
+        // land where its rubberbanding lines were
+        strokePoints.resize( verts.size() );
+
+        for ( size_t i = 0; i < verts.size(); i++ )
+        {
+            double x = verts[i]->getX();
+            double y = verts[i]->getY();
+            vc->modelToDevice( &x, &y, &strokePoints[i].x, &strokePoints[i].y, 1 );
+        }
+
+        unsigned int color = drawColor.toX11();
+
+        for ( size_t i = 0; i + 1 < strokePoints.size(); i++ )
+        {
+            const GraphicsContext::Point &a = strokePoints[i];
+            const GraphicsContext::Point &b = strokePoints[i + 1];
+            overlay.push_back( { color, { a.x, a.y, b.x, b.y } } );
+        }
+
+        // the loop line back to the start
+        if ( ( strokePoints.size() > 2 ) && loopMode )
+        {
+            const GraphicsContext::Point &a = strokePoints.front();
+            const GraphicsContext::Point &b = strokePoints.back();
+            overlay.push_back( { color, { a.x, a.y, b.x, b.y } } );
+        }
+    }
+
+    gc->setOverlay( overlay.data(), overlay.size() );
+}
+
+
+/**
+ * @brief   Draws the last frame's stats in the top left corner of the
+ *          window, if the overlay is shown, leaving the clip on the region
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &region     The part of the window being painted
+ *
+ * @return  void
+ */
+void DrawContext::drawStats( GraphicsContext *gc, const GraphicsContext::Rect &region )
+{
+    if ( !FrameStats::getOverlay() )
+    {
+        return;
+    }
+
+    std::vector<std::string> lines = FrameStats::last().summary();
+
+    statsShown = statsBox( lines );
+
+    // the box, cut down to the part of it being painted
+    int x0 = std::max( 0, region.x );
+    int y0 = std::max( 0, region.y );
+    int x1 = std::min( statsShown.width, region.x + region.width );
+    int y1 = std::min( statsShown.height, region.y + region.height );
+
+    if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+    {
+        return;
+    }
+
+    statsText.clear();
+
+    for ( size_t row = 0; row < lines.size(); row++ )
+    {
+        for ( size_t col = 0; col < lines[row].size(); col++ )
+        {
+            int left = STATS_MARGIN + int( col ) * STATS_ADVANCE;
+            int top = STATS_MARGIN + int( row ) * STATS_LINE_HEIGHT;
+
+            // each stroke is four digits, x1 y1 x2 y2, then a space
+            for ( const char *s = statsGlyph( lines[row][col] ); s[0] != '\0'; s += ( s[4] ? 5 : 4 ) )
+            {
+                GraphicsContext::Segment segment;
+                segment.x1 = left + ( s[0] - '0' ) * STATS_UNIT;
+                segment.y1 = top + ( s[1] - '0' ) * STATS_UNIT;
+                segment.x2 = left + ( s[2] - '0' ) * STATS_UNIT;
+                segment.y2 = top + ( s[3] - '0' ) * STATS_UNIT;
+                statsText.push_back( segment );
+            }
+        }
+    }
+
+    GraphicsContext::Rect box = { x0, y0, x1 - x0, y1 - y0 };
+    gc->setClip( box );
+    gc->setMode( GraphicsContext::MODE_NORMAL );
+    gc->clear();
+
+    gc->setColor( canvasColor.toX11() ^ 0xFFFFFF );
+    gc->drawLines( statsText.data(), statsText.size() );
+
+    gc->setClip( region );
+}
+
+
+/**
+ * @brief   Gets the box the frame stats overlay takes up in the top left
+ *          corner of the window
+ *
+ * @param   &lines  The lines of text in the overlay
+ *
+ * @return  The box
+ */
+GraphicsContext::Rect DrawContext::statsBox( const std::vector<std::string> &lines )
+{
+    size_t longest = 0;
+
+    for ( const std::string &line : lines )
+    {
+        longest = std::max( longest, line.size() );
+    }
+
+    return { 0, 0, int( longest ) * STATS_ADVANCE + 2 * STATS_MARGIN,
+             int( lines.size() ) * STATS_LINE_HEIGHT + 2 * STATS_MARGIN };
+}
+
+
+/**
+ * @brief   Gets the strokes of a character of the frame stats overlay, on a
+ *          grid 3 points wide and 5 points tall
+ *
+ * @param   c   The character
+ *
+ * @return  The strokes, as "x1y1x2y2" separated by spaces, empty for
+ *          characters without a glyph
+ */
+const char *DrawContext::statsGlyph( char c )
+{
+    switch ( c )
+    {
+        case '0': return "0020 2024 0424 0004 0420";
+        case '1': return "1014 0424 0110";
+        case '2': return "0020 2022 0222 0204 0424";
+        case '3': return "0020 2024 0424 0222";
+        case '4': return "0002 0222 2024";
+        case '5': return "0020 0002 0222 2224 0424";
+        case '6': return "0020 0004 0424 2224 0222";
+        case '7': return "0020 2024";
+        case '8': return "0020 2024 0424 0004 0222";
+        case '9': return "0020 2024 0424 0002 0222";
+        case '.': return "1314";
+        case 'A': return "0004 2024 0020 0222";
+        case 'B': return "0004 0010 1021 2112 1223 2314 1404 0212";
+        case 'C': return "0020 0004 0424";
+        case 'D': return "0004 0010 1021 2123 2314 1404";
+        case 'E': return "0020 0004 0424 0212";
+        case 'F': return "0020 0004 0212";
+        case 'G': return "0020 0004 0424 2422 1222";
+        case 'H': return "0004 2024 0222";
+        case 'I': return "0020 1014 0424";
+        case 'K': return "0004 0220 0224";
+        case 'L': return "0004 0424";
+        case 'M': return "0400 0012 1220 2024";
+        case 'N': return "0400 0024 2420";
+        case 'O': return "0020 2024 0424 0004";
+        case 'P': return "0004 0020 2022 0222";
+        case 'Q': return "0020 2024 0424 0004 1324";
+        case 'R': return "0004 0020 2022 0222 1224";
+        case 'S': return "0020 0002 0222 2224 0424";
+        case 'T': return "0020 1014";
+        case 'U': return "0004 0424 2420";
+        case 'V': return "0014 1420";
+        case 'W': return "0004 0413 1324 2420";
+        case 'X': return "0024 2004";
+        case 'Y': return "0012 2012 1214";
+        default:  return "";
+    }
+}
+
+
+/**
+ * @brief   Picks the shape under the pointer and outlines it in the overlay
+ *
+ * @param   *gc     The graphics context to draw to
+ * @param   x       The x-coordinate of the pointer
+ * @param   y       The y-coordinate of the pointer
+ *
+ * @return  void
+ */
+void DrawContext::hoverUpdate( GraphicsContext *gc, int x, int y )
+{
+    Point2D pointer = vc->deviceToModel( Point2D( x, y ) );
+    double tolerance = ( vc->deviceToModel( Point2D( x + HOVER_TOLERANCE, y ) ) - pointer ).magnitude();
+
+    ShapeStore::Handle handle = sc.pick( pointer, tolerance );
+
+    if ( handle != hovered )
+    {
+        hovered = handle;
+        overlayUpdate( gc );
+    }
+}
+
+
+/**
+ * @brief   Gets the part of the window covered by the outline of a hovered
+ *          shape
+ *
+ * @param   *gc     The graphics context of the window
+ * @param   handle  The handle of the shape
+ * @param   &rect   Where to write the rectangle, clipped to just outside
+ *                  the window
+ *
+ * @return  True if the shape is stored and its outline is in the window,
+ *          false otherwise
+ */
+bool DrawContext::hoverRect( GraphicsContext *gc, ShapeStore::Handle handle, GraphicsContext::Rect &rect ) const
+{
+    if ( !sc.contains( handle ) )
+    {
+        return false;
+    }
+
+    BoundingBox box = sc.bounds( handle );
+
+    // the device space box around all four corners, for any rotation
+    double xs[4] = { box.getMinX(), box.getMaxX(), box.getMaxX(), box.getMinX() };
+    double ys[4] = { box.getMinY(), box.getMinY(), box.getMaxY(), box.getMaxY() };
+    double minX = HUGE_VAL;
+    double minY = HUGE_VAL;
+    double maxX = -HUGE_VAL;
+    double maxY = -HUGE_VAL;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        double dx, dy;
+        vc->modelToDevice( xs[i], ys[i], dx, dy );
+        minX = std::min( minX, dx );
+        minY = std::min( minY, dy );
+        maxX = std::max( maxX, dx );
+        maxY = std::max( maxY, dy );
+    }
+
+    // the outline is drawn one pixel inside the rectangle
+    int width = gc->getWindowWidth();
+    int height = gc->getWindowHeight();
+
+    double x0 = std::max( std::floor( minX ) - HOVER_MARGIN - 1, -1.0 );
+    double y0 = std::max( std::floor( minY ) - HOVER_MARGIN - 1, -1.0 );
+    double x1 = std::min( std::floor( maxX ) + HOVER_MARGIN + 2, width + 1.0 );
+    double y1 = std::min( std::floor( maxY ) + HOVER_MARGIN + 2, height + 1.0 );
+
+    if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+    {
+        return false;
+    }
+
+    rect = { int( x0 ), int( y0 ), int( x1 - x0 ), int( y1 - y0 ) };
+    return true;
+}
+
+
+/**
+ * @brief   Adds a vertex to a stroke
+ *
+ * @param   *gc     The graphics context to draw the stroke to
+ * @param   x       The x-coordinate of the vertex
+ * @param   y       The y-coordinate of the vertex
+ *
+ * @return  void
+ */
+void DrawContext::strokeAddVert( GraphicsContext *gc, int x, int y )
+{
+    if ( verts.empty())
+    {
+        // add the first vert and the rubberbanding vert on top of it
+        Point2D point = vc->deviceToModel( Point2D( x, y ) );
+        verts.push_back( new Point2D( point ) );
+        verts.push_back( new Point2D( point ) );
+
+        // the rubberbanding vert follows every motion event while the
+        // stroke is drawn, not just the newest of a run
+        gc->setMotionPolicy( GraphicsContext::MOTION_ALL );
+    }
+    else
+    {
+        // freeze rubberbanding vert
+        strokeSnap( x, y );
+        *verts[verts.size() - 1] = vc->deviceToModel( Point2D( x, y ) );
+
+        // add new rubberbanding vert
+        verts.push_back( new Point2D( *verts[verts.size() - 1] ) );
+    }
+
+    overlayUpdate( gc );
+}
+
+
+/**
+ * @brief   Freezes a stroke and converts it to a shape
+ *
+ * @param   *gc     The graphics context to draw the stroke to
+ *
+ * @return  void
+ */
+void DrawContext::strokeFreeze( GraphicsContext *gc )
+{
+    if ( !verts.empty())
+    {
+        // drop the vertices that make no visible difference first
+        if ( simplifyStrokes )
+        {
+            size_t clicked = verts.size() - 1;
+            unsigned int removed = strokeSimplify();
+            std::cout << "STROKE SIMPLIFIED: " << removed << " OF " << clicked
+                      << " VERTICES REMOVED" << std::endl;
+        }
+
+        // set draw mode to normal
+        gc->setMode( GraphicsContext::MODE_NORMAL );
+
+        // define and add shapes to container, as one step of history
+        history.begin();
+
+        if ( !loopMode )
+        {
+            for ( unsigned int i = 0; i < ( verts.size() - 2 ); i++ )
+            {
+                Line line = Line( *verts[i], *verts[i + 1], drawColor );
+                line.draw( gc, vc );
+                drawingAdd( gc, line );
+            }
+        }
+        else if ( verts.size() == 3 )
+        {
+            Line line = Line( *verts[0], *verts[1], drawColor );
+            line.draw( gc, vc );
+            drawingAdd( gc, line );
+        }
+        else if ( verts.size() == 4 )
+        {
+            Triangle triangle = Triangle( *verts[0], *verts[1], *verts[2], drawColor );
+            triangle.draw( gc, vc );
+            drawingAdd( gc, triangle );
+        }
+        else
+        {
+            verts.erase( verts.begin() + ( verts.size() - 1 ));
+            Polygon polygon = Polygon( verts, drawColor );
+            polygon.draw( gc, vc );
+            drawingAdd( gc, polygon );
+        }
+
+        history.end();
+
+        // clear verts, and the rubberbanding lines with them
+        strokeClearVerts();
+        overlayUpdate( gc );
+
+        gc->setMotionPolicy( GraphicsContext::MOTION_LATEST );
+    }
+}
+
+
+/**
+ * @brief   Removes the vertices of a stroke that are within the stroke
+ *          tolerance of the outline without them at the current zoom, using
+ *          Ramer-Douglas-Peucker
+ *
+ * @param   void
+ *
+ * @return  The number of vertices removed
+ */
+unsigned int DrawContext::strokeSimplify()
+{
+    // the last vertex is the one rubberbanding to the pointer
+    unsigned int n = verts.size() - 1;
+
+    // a loop of three is already a triangle, and an open stroke of two a line
+    if ( ( n < 3 ) || ( loopMode && ( n == 3 ) ) )
+    {
+        return 0;
+    }
+
+    // pixels per model unit; a rotation leaves the determinant alone
+    const Affine2D &transform = vc->getTransform();
+    double scale = std::sqrt( std::fabs( transform.get( 0, 0 ) * transform.get( 1, 1 ) -
+                                         transform.get( 0, 1 ) * transform.get( 1, 0 ) ) );
+
+    if ( !std::isfinite( scale ) || ( scale <= 0 ) )
+    {
+        return 0;
+    }
+
+    std::vector<double> xs( n );
+    std::vector<double> ys( n );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        xs[i] = verts[i]->getX();
+        ys[i] = verts[i]->getY();
+    }
+
+    std::vector<unsigned char> keep;
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+    unsigned int kept = simplifyPolyline( xs.data(), ys.data(), n, loopMode,
+                                          STROKE_TOLERANCE / scale, keep, ranges );
+
+    // a loop that collapsed onto a line is left as it was clicked
+    if ( loopMode && ( kept < 3 ) )
+    {
+        return 0;
+    }
+
+    unsigned int last = 0;
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        if ( keep[i] )
+        {
+            verts[last++] = verts[i];
+        }
+        else
+        {
+            delete verts[i];
+        }
+    }
+
+    verts[last++] = verts[n];
+    verts.resize( last );
+
+    return n - kept;
+}
+
+
+/**
+ * @brief   Cancels a stroke
+ *
+ * @param   *gc     The graphics context to draw the stroke to
+ *
+ * @return  void
+ */
+void DrawContext::strokeCancel( GraphicsContext *gc )
+{
+    strokeClearVerts();
+    overlayUpdate( gc );
+
+    gc->setMotionPolicy( GraphicsContext::MOTION_LATEST );
+}
+
+
+/**
+ * @brief   Clears the vertices from a stroke
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void DrawContext::strokeClearVerts()
+{
+    if ( !verts.empty())
+    {
+        // clear verts
+        std::for_each(
+            verts.begin(), verts.end(), []( Point2D *p )
+            {
+                delete p;
+            }
+        );
+        verts.clear();
+    }
+}
+
+
+/**
+ * @brief   Snaps pointer coordinates to the most recently frozen vertex of a
+ *          stroke along the enabled axes of the window
+ *
+ * @param   &x      The x-coordinate of the pointer, snapped in place
+ * @param   &y      The y-coordinate of the pointer, snapped in place
+ *
+ * @return  void
+ */
+void DrawContext::strokeSnap( int &x, int &y )
+{
+    // found the way the overlay places it, so a snapped line stays straight
+    double vx = verts[verts.size() - 2]->getX();
+    double vy = verts[verts.size() - 2]->getY();
+    int px, py;
+    vc->modelToDevice( &vx, &vy, &px, &py, 1 );
+
+    if ( snapToX ) y = py;
+    if ( snapToY ) x = px;
+}
+
+
+/**
+ * @brief   Sets the color of a stroke
+ *
+ * @param   *gc     The graphics context to draw the stroke to
+ * @param   color   The color of the stroke
+ *
+ * @return  void
+ */
+void DrawContext::strokeSetColor( GraphicsContext *gc, PackedColor color )
+{
+    drawColor = color;
+    overlayUpdate( gc );
+}
+
+
+/**
+ * @brief   Toggles loop mode
+ *
+ * @param   *gc     The graphics context to draw the stroke to
+ *
+ * @return  void
+ */
+void DrawContext::toggleLoopMode( GraphicsContext *gc )
+{
+    loopMode = !loopMode;
+    overlayUpdate( gc );
+
+    std::cout << "LOOP MODE: ";
+    std::cout << ( loopMode ? "ENABLED" : "DISABLED" ) << std::endl;
+}
+
+
+/**
+ * @brief   Adds a finished shape to the drawing and records it in the journal
+ *
+ * @param   *gc     The graphics context to wake when a compaction is done
+ * @param   &shape  The shape to add
+ *
+ * @return  void
+ */
+void DrawContext::drawingAdd( GraphicsContext *gc, const Shape &shape )
+{
+    // the history and a journal record that may be appended later, after
+    // the shape is gone, share one copy
+    std::shared_ptr<const Shape> copy( shape.clone() );
+    history.add( copy, sc.add( shape ) );
+
+    if ( journalMode )
+    {
+        drawingJournal( gc, [this, copy]() { journal.add( *copy ); } );
+    }
+}
+
+
+/**
+ * @brief   Asks a question in the terminal, to be answered by the next line
+ *          the console reads
+ *
+ * @param   question    The question to ask
+ *
+ * @return  void
+ */
+void DrawContext::drawingPrompt( Prompt question )
+{
+    // any other question replaces an open waiting on the clear prompt
+    if ( question != PROMPT_CLEAR )
+    {
+        pendingOpen.clear();
+    }
+
+    prompt = question;
+
+    switch ( prompt )
+    {
+        case PROMPT_OPEN:
+            std::cout << "OPEN FILE: " << std::flush;
+            break;
+
+        case PROMPT_SAVE:
+            std::cout << "SAVE FILE: " << std::flush;
+            break;
+
+        case PROMPT_CLEAR:
+            std::cout << "ARE YOU SURE YOU WANT TO CLEAR THE CANVAS? (Y/N): " << std::flush;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief   Handles a line read by the console, either as the answer to the
+ *          open prompt or as a command
+ *
+ * @param   *gc     The graphics context to draw to
+ * @param   &line   The line that was read
+ *
+ * @return  void
+ */
+void DrawContext::drawingCommand( GraphicsContext *gc, const std::string &line )
+{
+    size_t first = line.find_first_not_of( " \t\r" );
+
+    if ( first == std::string::npos )
+    {
+        return;
+    }
+
+    std::string input = line.substr( first, line.find_last_not_of( " \t\r" ) - first + 1 );
+
+    switch ( prompt )
+    {
+        case PROMPT_OPEN:
+            prompt = PROMPT_NONE;
+            drawingOpen( gc, input );
+            return;
+
+        case PROMPT_SAVE:
+            prompt = PROMPT_NONE;
+            drawingSave( gc, input );
+            return;
+
+        case PROMPT_CLEAR:
+        {
+            std::transform( input.begin(), input.end(), input.begin(), ::toupper );
+
+            if ( ( input != "Y" ) && ( input != "N" ) )
+            {
+                drawingPrompt( PROMPT_CLEAR );
+                return;
+            }
+
+            prompt = PROMPT_NONE;
+
+            // a save or compaction may have started since the open asked,
+            // and starting the open would throw its result away
+            if ( !pendingOpen.empty() && worker.isBusy() )
+            {
+                pendingOpen.clear();
+                std::cerr << "ERROR: Wait for the current file operation to finish!" << std::endl;
+                return;
+            }
+
+            if ( input == "Y" )
+            {
+                drawingClear( gc );
+            }
+            else
+            {
+                std::cout << "CLEAR CANCELLED" << std::endl;
+            }
+
+            // an open that asked first goes ahead either way, adding to the
+            // drawing if it was not cleared
+            if ( !pendingOpen.empty() )
+            {
+                std::string fileName;
+                fileName.swap( pendingOpen );
+                drawingLoad( gc, fileName );
+            }
+
+            return;
+        }
+
+        default:
+            break;
+    }
+
+    // without a question pending the line is a command, which lets a pipe
+    // drive the application
+    size_t split = input.find_first_of( " \t" );
+    std::string name = input.substr( 0, split );
+    std::string argument;
+
+    if ( split != std::string::npos )
+    {
+        argument = input.substr( input.find_first_not_of( " \t", split ) );
+    }
+
+    if ( ( name == "open" ) && !argument.empty() )
+    {
+        drawingOpen( gc, argument );
+    }
+    else if ( ( name == "save" ) && !argument.empty() )
+    {
+        drawingSave( gc, argument );
+    }
+    else if ( name == "clear" )
+    {
+        pendingOpen.clear();
+        drawingPrompt( PROMPT_CLEAR );
+    }
+    else if ( name == "undo" )
+    {
+        drawingUndo( gc );
+    }
+    else if ( name == "redo" )
+    {
+        drawingRedo( gc );
+    }
+    else
+    {
+        std::cerr << "ERROR: Unknown command " << input << "!" << std::endl;
+    }
+}
+
+
+/**
+ * @brief   Opens a drawing from file, first asking whether to clear the
+ *          canvas if it holds anything
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &fileName   The name of the file to open
+ *
+ * @return  void
+ */
+void DrawContext::drawingOpen( GraphicsContext *gc, const std::string &fileName )
+{
+    strokeCancel( gc );
 
-    if ( input == "Y" )
+    if ( worker.isBusy() )
     {
-        strokeCancel( gc );
-        sc.erase();
-        vc->resetView();
-        paint( gc );
-        std::cout << "CANVAS CLEARED" << std::endl;
+        std::cerr << "ERROR: Wait for the current file operation to finish!" << std::endl;
+        return;
+    }
+
+    // opening the file to check it would end a pipe's writer early, so
+    // only its permissions are looked at until the worker reads it
+    if ( access( fileName.c_str(), R_OK ) != 0 )
+    {
+        std::cerr << "ERROR: Invalid file name or location!" << std::endl;
+        return;
+    }
+
+    // clearing the canvas to open another drawing is not a change to
+    // the drawing being journaled
+    journal.detach();
+
+    if ( sc.size() == 0 )
+    {
+        drawingLoad( gc, fileName );
+        return;
+    }
+
+    pendingOpen = fileName;
+    drawingPrompt( PROMPT_CLEAR );
+}
+
+
+/**
+ * @brief   Starts reading a drawing on the file worker, whose shapes are
+ *          added as they arrive
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &fileName   The name of the file to read
+ *
+ * @return  void
+ */
+void DrawContext::drawingLoad( GraphicsContext *gc, const std::string &fileName )
+{
+    // the shapes read are not changes that can be undone
+    history.reset();
+
+    vc->resetView();
+    paint( gc );
+
+    shownProgress = -1;
+    std::cout << "OPENING " << fileName << "..." << std::endl;
+    worker.open( fileName, [gc]() { gc->wake(); } );
+}
+
+
+/**
+ * @brief   Starts saving the current drawing to a file on the file worker
+ *
+ * @param   *gc         The graphics context to wake when the save is done
+ * @param   &fileName   The name of the file to save to
+ *
+ * @return  void
+ */
+void DrawContext::drawingSave( GraphicsContext *gc, const std::string &fileName )
+{
+    if ( worker.isBusy() )
+    {
+        std::cerr << "ERROR: Wait for the current file operation to finish!" << std::endl;
+        return;
+    }
+
+    // a journaled drawing is already saved up to its last change
+    if ( journal.isAttached() && ( journal.getSnapshotName() == fileName ) )
+    {
+        std::cout << "FILE SAVED! (JOURNALED)" << std::endl;
+        return;
+    }
+
+    // the journal for the new file starts from the snapshot, so changes
+    // made while it is written are held back until it is attached
+    deferJournal = journalMode;
+    deferredJournal.clear();
+
+    // files ending in ShapeContainer::BINARY_EXTENSION are saved as binary
+    std::cout << "SAVING " << fileName << "..." << std::endl;
+    // the snapshot copies only the shapes, not their index or display list
+    worker.save( std::make_shared<const ShapeStore>( sc.getStore() ), fileName,
+                 [gc]() { gc->wake(); } );
+}
+
+
+/**
+ * @brief   Clears the drawing canvas
+ *
+ * @param   *gc     The graphics context to clear
+ *
+ * @return  void
+ */
+void DrawContext::drawingClear( GraphicsContext *gc )
+{
+    strokeCancel( gc );
+
+    // shapes still arriving from an open would otherwise reappear
+    if ( worker.getJobType() == FileWorker::JOB_OPEN )
+    {
+        worker.cancel();
+        std::cout << std::endl << "OPEN CANCELLED" << std::endl;
+    }
+
+    // the cleared shapes move into the history, for undoing the clear
+    history.clear( sc );
+    hovered = ShapeStore::INVALID_HANDLE;
+    drawingJournal( gc, [this]() { journal.clear(); } );
+    vc->resetView();
+    paint( gc );
+    std::cout << "CANVAS CLEARED" << std::endl;
+}
+
+
+/**
+ * @brief   Undoes the last change to the drawing, journaling the reverse of
+ *          it
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void DrawContext::drawingUndo( GraphicsContext *gc )
+{
+    strokeCancel( gc );
+
+    const History::Step *step = history.undo( sc );
+
+    if ( step == nullptr )
+    {
+        std::cout << "NOTHING TO UNDO" << std::endl;
+        return;
+    }
+
+    if ( journalMode && ( step->kind == History::STEP_ADD ) )
+    {
+        std::vector<std::shared_ptr<const Shape>> shapes;
+
+        for ( const History::Added &added : step->shapes )
+        {
+            shapes.push_back( added.shape );
+        }
+
+        drawingJournal( gc, [this, shapes]()
+           {
+               for ( const std::shared_ptr<const Shape> &shape : shapes )
+               {
+                   journal.erase( *shape );
+               }
+           }
+        );
+    }
+    else if ( journalMode )
+    {
+        // the journal only knows the drawing was cleared, so the restored
+        // shapes are recorded again from a copy of the drawing
+        std::shared_ptr<const ShapeContainer> restored;
+
+        if ( journal.isAttached() || deferJournal )
+        {
+            restored = std::make_shared<const ShapeContainer>( sc );
+        }
+
+        drawingJournal( gc, [this, restored]()
+           {
+               restored->forEach( [this]( const Shape &shape ) { journal.add( shape ); } );
+           }
+        );
+    }
+
+    hovered = ShapeStore::INVALID_HANDLE;
+    paint( gc );
+    std::cout << "UNDONE" << std::endl;
+}
+
+
+/**
+ * @brief   Redoes the last change to the drawing that was undone,
+ *          journaling it again
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void DrawContext::drawingRedo( GraphicsContext *gc )
+{
+    strokeCancel( gc );
+
+    const History::Step *step = history.redo( sc );
+
+    if ( step == nullptr )
+    {
+        std::cout << "NOTHING TO REDO" << std::endl;
+        return;
+    }
+
+    if ( journalMode && ( step->kind == History::STEP_ADD ) )
+    {
+        std::vector<std::shared_ptr<const Shape>> shapes;
+
+        for ( const History::Added &added : step->shapes )
+        {
+            shapes.push_back( added.shape );
+        }
+
+        drawingJournal( gc, [this, shapes]()
+           {
+               for ( const std::shared_ptr<const Shape> &shape : shapes )
+               {
+                   journal.add( *shape );
+               }
+           }
+        );
+    }
+    else if ( journalMode )
+    {
+        drawingJournal( gc, [this]() { journal.clear(); } );
+    }
+
+    hovered = ShapeStore::INVALID_HANDLE;
+    paint( gc );
+    std::cout << "REDONE" << std::endl;
+}
+
+
+/**
+ * @brief   Adds a batch of shapes read by the file worker to the drawing,
+ *          drawing just the batch over what is already shown
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &batch      The batch of shapes, which may be left empty
+ *
+ * @return  void
+ */
+void DrawContext::drawingMerge( GraphicsContext *gc, ShapeContainer &batch )
+{
+    gc->setMode( GraphicsContext::MODE_NORMAL );
+    batch.draw( gc, vc );
+
+    if ( sc.size() == 0 )
+    {
+        sc = std::move( batch );
     }
     else
     {
-        std::cout << "CLEAR CANCELLED" << std::endl;
+        // the worker built the batch's store and index, which are spliced
+        // in without going back to the vertices
+        sc.add( batch );
+    }
+}
+
+
+/**
+ * @brief   Merges the batches the file worker has parsed and handles the
+ *          result of its operation once it is done
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void DrawContext::drawingPoll( GraphicsContext *gc )
+{
+    ShapeContainer batch;
+
+    while ( worker.takeBatch( batch ) )
+    {
+        drawingMerge( gc, batch );
+    }
+
+    if ( worker.getJobType() == FileWorker::JOB_OPEN )
+    {
+        int percent = worker.getProgress() * 100;
+
+        if ( percent != shownProgress )
+        {
+            shownProgress = percent;
+            std::cout << "\rLOADING: " << percent << "%" << std::flush;
+        }
+    }
+
+    FileWorker::Result result;
+
+    if ( worker.takeResult( result ) )
+    {
+        if ( recorder ) recorder->recordFinish( result.type );
+        drawingFinish( gc, result );
+    }
+}
+
+
+/**
+ * @brief   Finishes a file operation once the file worker is done with it
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &result     The result of the operation
+ *
+ * @return  void
+ */
+void DrawContext::drawingFinish( GraphicsContext *gc, const FileWorker::Result &result )
+{
+    if ( result.type == FileWorker::JOB_OPEN )
+    {
+        if ( shownProgress >= 0 )
+        {
+            std::cout << std::endl;
+        }
+
+        if ( !result.error.empty() )
+        {
+            std::cerr << "ERROR: " << result.error << std::endl;
+            return;
+        }
+
+        // changes journaled since the drawing was saved are applied on top,
+        // unless it was read from a stream that has no fingerprint
+        try
+        {
+            bool journaled = ( result.fingerprint != 0 );
+
+            if ( journaled && ( Journal::replay( result.fileName, result.fingerprint, sc ) != 0 ) )
+            {
+                std::cout << "JOURNAL REPLAYED: " << Journal::nameOf( result.fileName ) << std::endl;
+                paint( gc );
+            }
+
+            if ( journalMode && journaled )
+            {
+                journal.attach( result.fileName, result.fingerprint, false );
+            }
+
+            std::cout << "FILE OPENED!" << std::endl;
+        }
+        catch ( const std::exception &e )
+        {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+        }
+    }
+    else if ( result.type == FileWorker::JOB_SAVE )
+    {
+        std::vector<std::function<void()>> deferred;
+        deferred.swap( deferredJournal );
+
+        bool attach = deferJournal && journalMode;
+        deferJournal = false;
+
+        if ( !result.error.empty() )
+        {
+            std::cerr << "ERROR: " << result.error << std::endl;
+            return;
+        }
+
+        if ( attach )
+        {
+            try
+            {
+                journal.attach( result.fileName, result.fingerprint, true );
+            }
+            catch ( const std::exception &e )
+            {
+                std::cerr << "ERROR: " << e.what() << std::endl;
+            }
+
+            for ( const std::function<void()> &change : deferred )
+            {
+                drawingJournal( gc, change );
+            }
+        }
+
+        std::cout << "FILE SAVED!" << std::endl;
+    }
+    else if ( result.type == FileWorker::JOB_COMPACT )
+    {
+        std::vector<std::function<void()>> deferred;
+        deferred.swap( deferredJournal );
+        deferJournal = false;
+
+        // the old journal still holds every change, so a failed write or a
+        // journal detached meanwhile just leaves it in place
+        if ( !result.error.empty() || ( journal.getStagingName() != result.fileName ) )
+        {
+            if ( !result.error.empty() )
+            {
+                std::cerr << "ERROR: " << result.error << std::endl;
+            }
+
+            std::remove( result.fileName.c_str() );
+            return;
+        }
+
+        try
+        {
+            journal.compact( result.fingerprint );
+            std::cout << "JOURNAL COMPACTED: " << journal.getSnapshotName() << std::endl;
+        }
+        catch ( const std::exception &e )
+        {
+            std::cerr << "ERROR: " << e.what() << std::endl;
+            journal.detach();
+            return;
+        }
+
+        for ( const std::function<void()> &change : deferred )
+        {
+            drawingJournal( gc, change );
+        }
+    }
+}
+
+
+/**
+ * @brief   Records a change in the journal, if one is attached, and starts
+ *          folding the journal into a fresh snapshot once it has grown too
+ *          large
+ *
+ * @param   *gc     The graphics context to wake when a compaction is done
+ * @param   change  The function that appends the change to the journal
+ *
+ * @return  void
+ */
+void DrawContext::drawingJournal( GraphicsContext *gc, std::function<void()> change )
+{
+    if ( deferJournal )
+    {
+        deferredJournal.push_back( change );
+    }
+
+    if ( !journal.isAttached() )
+    {
+        return;
     }
 
+    // a journal that cannot be written stops journaling rather than drawing
+    try
+    {
+        change();
+    }
+    catch ( const std::exception &e )
+    {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        journal.detach();
+        return;
+    }
+
+    // a compaction waits for the file worker, while the journal keeps
+    // growing a little past its threshold
+    if ( journal.needsCompaction() && !worker.isBusy() )
+    {
+        drawingCompact( gc );
+    }
+}
+
+
+/**
+ * @brief   Starts writing a fresh snapshot of the journaled drawing on the
+ *          file worker, for the journal to be folded into
+ *
+ * @param   *gc     The graphics context to wake when the write is done
+ *
+ * @return  void
+ */
+void DrawContext::drawingCompact( GraphicsContext *gc )
+{
+    // the old journal keeps every change until the new snapshot replaces
+    // its own, and the changes made meanwhile start the new journal
+    deferJournal = true;
+    deferredJournal.clear();
+
+    worker.compact( std::make_shared<const ShapeStore>( sc.getStore() ),
+                    journal.getStagingName(),
+                    ShapeContainer::isBinaryName( journal.getSnapshotName() ),
+                    [gc]() { gc->wake(); } );
 }
 
 
@@ -17,19 +17,32 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <functional>
+# include <istream>
+# include <memory>
+# include <string>
 # include <vector>
 
-# include "color.h"
+# include "console.h"
 # include "drawbase.h"
+# include "fileworker.h"
+# include "history.h"
+# include "journal.h"
+# include "packedcolor.h"
 # include "point2d.h"
+# include "segmentbuffer.h"
 # include "shapecontainer.h"
 # include "viewcontext.h"
+# include "workpool.h"
 #include "drawcontext.h"
 
 
 /* --------------------------------- Class ---------------------------------- */
 
 
+class TraceRecorder;
+
+
 class DrawContext : public DrawingBase
 {
     /* =============================== PUBLIC =============================== */
@@ -52,11 +65,16 @@ public:
 
     static constexpr unsigned int KEY_CODE_A = 97;
     static constexpr unsigned int KEY_CODE_C = 99;
+    static constexpr unsigned int KEY_CODE_F = 102;
+    static constexpr unsigned int KEY_CODE_J = 106;
     static constexpr unsigned int KEY_CODE_O = 111;
     static constexpr unsigned int KEY_CODE_R = 114;
     static constexpr unsigned int KEY_CODE_S = 115;
+    static constexpr unsigned int KEY_CODE_V = 118;
     static constexpr unsigned int KEY_CODE_X = 120;
     static constexpr unsigned int KEY_CODE_Y = 121;
+    static constexpr unsigned int KEY_CODE_Z = 122;
+    static constexpr unsigned int KEY_CODE_SHIFT_Z = 90;
 
     static constexpr unsigned int KEY_CODE_ENTER = 65293;
     static constexpr unsigned int KEY_CODE_ESC = 65307;
@@ -76,11 +94,24 @@ public:
 
 
     void paint( GraphicsContext *gc ) override;
+    void paint( GraphicsContext *gc, const GraphicsContext::Rect &region ) override;
     void keyDown( GraphicsContext *gc, unsigned int keycode ) override;
     void keyUp( GraphicsContext *gc, unsigned int keycode ) override;
     void mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y ) override;
     void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y ) override;
     void mouseMove( GraphicsContext *gc, int x, int y ) override;
+    void resize( GraphicsContext *gc, int width, int height ) override;
+    void idle( GraphicsContext *gc ) override;
+
+    void listen( GraphicsContext *gc, std::istream &is );
+    void command( GraphicsContext *gc, const std::string &line );
+    void open( GraphicsContext *gc, const std::string &fileName );
+    void finish( GraphicsContext *gc );
+    bool isBusy() const;
+
+    void setRecorder( TraceRecorder *recorder );
+
+    void setThreads( unsigned int threads );
 
 
     /* ============================== PROTECTED ============================= */
@@ -94,15 +125,72 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    Color drawColor = Color( 0, 0, 0 );
-    Color canvasColor = Color( 1, 1, 1 );
+    PackedColor drawColor = PackedColor( 0, 0, 0 );
+    PackedColor canvasColor = PackedColor( 1, 1, 1 );
 
     bool loopMode = false;
     bool snapToX = false;
     bool snapToY = false;
 
+    // strokes are simplified when frozen, keeping every vertex within this
+    // many pixels of the clicked outline at the zoom they were drawn at,
+    // which covers clicks landing on whole pixels
+    constexpr static const double STROKE_TOLERANCE = 1;
+    bool simplifyStrokes = false;
+
+    // the stroke's vertices in model space, so the stroke survives a change
+    // of view, ending in the one rubberbanding to the pointer
     std::vector<Point2D*> verts;
     ShapeContainer sc = ShapeContainer();
+    SegmentBuffer frame = SegmentBuffer();
+
+    // the threads shapes are transformed on, unless drawing on one thread
+    std::unique_ptr<WorkPool> workers;
+
+    // with a graphics context that keeps shapes' edges, the drawing version
+    // they were handed over from and the handle to hand more over from
+    unsigned long retainedVersion = 0;
+    ShapeStore::Handle retainedEnd = 0;
+    std::vector<GraphicsContext::ModelVertex> retainedVertices;
+
+    // the changes made to the drawing since it was opened, for undo
+    History history;
+
+    // the frame stats overlay's text, as strokes
+    std::vector<GraphicsContext::Segment> statsText;
+
+    // where the overlay was last drawn, for clearing it after a scroll
+    GraphicsContext::Rect statsShown = { 0, 0, 0, 0 };
+
+    // saves append to a journal next to the drawing instead of rewriting it
+    bool journalMode = false;
+    Journal journal;
+
+    // journal changes made while a save or compaction is written, for the
+    // new journal
+    bool deferJournal = false;
+    std::vector<std::function<void()>> deferredJournal;
+
+    // file operations run in the background and questions are answered by
+    // lines read from the console, so neither blocks the event loop
+    enum Prompt
+    {
+        PROMPT_NONE,
+        PROMPT_OPEN,
+        PROMPT_SAVE,
+        PROMPT_CLEAR
+    };
+
+    FileWorker worker;
+    std::unique_ptr<Console> console;
+
+    // told of the console lines and file operations idle handles, so a
+    // recorded session can be replayed
+    TraceRecorder *recorder = nullptr;
+
+    Prompt prompt = PROMPT_NONE;
+    std::string pendingOpen;
+    int shownProgress = -1;
 
     ViewContext *vc;
 
@@ -110,26 +198,60 @@ private:
 
     bool panActive = false;
     bool rotateActive = false;
+
+    // the shape under the pointer, outlined while the pointer is idle
+    ShapeStore::Handle hovered = ShapeStore::INVALID_HANDLE;
+
+    // the hover outline and the stroke, shown over the canvas rather than
+    // drawn on it, and the stroke's vertices in device space
+    std::vector<GraphicsContext::OverlayLine> overlay;
+    std::vector<GraphicsContext::Point> strokePoints;
     Point2D lastMousePosition = Point2D( 0, 0 );
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
+    void repaint( GraphicsContext *gc, const GraphicsContext::Rect &region );
+    bool paintScrolled( GraphicsContext *gc, const Affine2D &previous );
+
+    void drawAxes( SegmentBuffer &sb );
+    void drawRetained( GraphicsContext *gc );
+    void overlayUpdate( GraphicsContext *gc );
+    void drawStats( GraphicsContext *gc, const GraphicsContext::Rect &region );
+
+    static GraphicsContext::Rect statsBox( const std::vector<std::string> &lines );
+    static const char *statsGlyph( char c );
+
+    void hoverUpdate( GraphicsContext *gc, int x, int y );
+    bool hoverRect( GraphicsContext *gc, ShapeStore::Handle handle, GraphicsContext::Rect &rect ) const;
+
     void strokeAddVert( GraphicsContext *gc, int x, int y );
     void strokeFreeze( GraphicsContext *gc );
     void strokeCancel( GraphicsContext *gc );
 
     void strokeClearVerts();
+    void strokeSnap( int &x, int &y );
+    unsigned int strokeSimplify();
 
-    void strokeSetColor( GraphicsContext *gc, const Color &color );
-    void strokeDrawLines( GraphicsContext *gc );
+    void strokeSetColor( GraphicsContext *gc, PackedColor color );
 
     void toggleLoopMode( GraphicsContext *gc );
 
-    void drawingOpen( GraphicsContext *gc );
-    void drawingSave();
+    void drawingAdd( GraphicsContext *gc, const Shape &shape );
+    void drawingPrompt( Prompt question );
+    void drawingCommand( GraphicsContext *gc, const std::string &line );
+    void drawingOpen( GraphicsContext *gc, const std::string &fileName );
+    void drawingLoad( GraphicsContext *gc, const std::string &fileName );
+    void drawingSave( GraphicsContext *gc, const std::string &fileName );
     void drawingClear( GraphicsContext *gc );
+    void drawingUndo( GraphicsContext *gc );
+    void drawingRedo( GraphicsContext *gc );
+    void drawingMerge( GraphicsContext *gc, ShapeContainer &batch );
+    void drawingPoll( GraphicsContext *gc );
+    void drawingFinish( GraphicsContext *gc, const FileWorker::Result &result );
+    void drawingJournal( GraphicsContext *gc, std::function<void()> change );
+    void drawingCompact( GraphicsContext *gc );
 
 
     /* ====================================================================== */
@@ -0,0 +1,1337 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framebuffercontext.cpp
+ * @brief   Graphics context that renders into an in-memory framebuffer
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+
+# if defined( __AVX__ )
+# include <immintrin.h>
+# elif defined( __SSE2__ )
+# include <emmintrin.h>
+# endif
+
+# ifdef HAVE_PNG
+# include <png.h>
+# endif
+
+# include <X11/Xutil.h>
+
+# include "drawbase.h"
+# include "framebuffercontext.h"
+# include "framestats.h"
+
+
+/* -------------------------------- Functions ------------------------------- */
+
+
+/**
+ * @brief   Divides rounding towards positive infinity
+ *
+ * @param   n   The numerator
+ * @param   d   The denominator, which must be positive
+ *
+ * @return  The rounded up quotient
+ */
+static int64_t ceilDiv( int64_t n, int64_t d )
+{
+    return ( n >= 0 ) ? ( n + d - 1 ) / d : -( -n / d );
+}
+
+
+/**
+ * @brief   Determines if this machine stores words least significant byte
+ *          first
+ *
+ * @param   void
+ *
+ * @return  True on a little-endian machine, false otherwise
+ */
+static bool littleEndian()
+{
+    const uint32_t word = 1;
+    unsigned char first;
+    std::memcpy( &first, &word, 1 );
+    return first == 1;
+}
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a framebuffer context filled with a background color
+ *
+ * @param   width       The width of the framebuffer in pixels
+ * @param   height      The height of the framebuffer in pixels
+ * @param   background  The 24-bit RGB background color
+ *
+ * @return  The created framebuffer context
+ */
+FramebufferContext::FramebufferContext( int width, int height, unsigned int background ):
+width( 0 ), height( 0 ), background( ( background & 0xFFFFFF ) | OPAQUE )
+{
+    run = false;
+    resize( width, height );
+}
+
+
+/**
+ * @brief   Framebuffer context destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+FramebufferContext::~FramebufferContext() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Sets whether drawing copies or XORs the current color
+ *
+ * @param   newMode     The drawing mode
+ *
+ * @return  void
+ */
+void FramebufferContext::setMode( drawMode newMode )
+{
+    mode = newMode;
+}
+
+
+/**
+ * @brief   Sets the color to draw with
+ *
+ * @param   color   The 24-bit RGB color
+ *
+ * @return  void
+ */
+void FramebufferContext::setColor( unsigned int color )
+{
+    this->color = ( color & 0xFFFFFF ) | OPAQUE;
+}
+
+
+/**
+ * @brief   Sets a pixel to the current color, if it is inside the clip
+ *
+ * @param   x   The x-coordinate of the pixel
+ * @param   y   The y-coordinate of the pixel
+ *
+ * @return  void
+ */
+void FramebufferContext::setPixel( int x, int y )
+{
+    if ( tileSize != 0 )
+    {
+        record( Command::OP_PIXEL, x, y, 0, 0, ink(), mode == MODE_XOR );
+        return;
+    }
+
+    plot( clip, x, y, ink(), mode == MODE_XOR );
+}
+
+
+/**
+ * @brief   Gets the color of a pixel
+ *
+ * @param   x   The x-coordinate of the pixel
+ * @param   y   The y-coordinate of the pixel
+ *
+ * @return  The 24-bit RGB color of the pixel, or zero outside the buffer
+ */
+unsigned int FramebufferContext::getPixel( int x, int y )
+{
+    flush();
+
+    if ( ( x < 0 ) || ( y < 0 ) || ( x >= width ) || ( y >= height ) )
+    {
+        return 0;
+    }
+
+    return pixels[ size_t( y ) * width + x ] & 0xFFFFFF;
+}
+
+
+/**
+ * @brief   Reads a rectangle of pixels
+ *
+ * @param   x       The x-coordinate of the rectangle's top left corner
+ * @param   y       The y-coordinate of the rectangle's top left corner
+ * @param   width   The width of the rectangle
+ * @param   height  The height of the rectangle
+ * @param   *out    Where to write the 24-bit RGB colors, row by row, with
+ *                  zero for pixels outside the buffer
+ *
+ * @return  void
+ */
+void FramebufferContext::getPixels( int x, int y, int width, int height, uint32_t *out )
+{
+    flush();
+
+    // the part of the rectangle inside the buffer
+    int x0 = std::max( x, 0 );
+    int x1 = std::min( x + width, this->width );
+
+    for ( int row = 0; row < height; row++ )
+    {
+        uint32_t *line = out + size_t( row ) * width;
+        int py = y + row;
+
+        if ( ( py < 0 ) || ( py >= this->height ) || ( x0 >= x1 ) )
+        {
+            std::fill( line, line + width, 0 );
+            continue;
+        }
+
+        const uint32_t *source = pixels.data() + size_t( py ) * this->width;
+
+        std::fill( line, line + ( x0 - x ), 0 );
+
+        for ( int px = x0; px < x1; px++ )
+        {
+            line[px - x] = source[px] & 0xFFFFFF;
+        }
+
+        std::fill( line + ( x1 - x ), line + width, 0 );
+    }
+}
+
+
+/**
+ * @brief   Draws a line between two points, both included
+ *
+ * @param   x1  The x-coordinate of the first point
+ * @param   y1  The y-coordinate of the first point
+ * @param   x2  The x-coordinate of the second point
+ * @param   y2  The y-coordinate of the second point
+ *
+ * @return  void
+ */
+void FramebufferContext::drawLine( int x1, int y1, int x2, int y2 )
+{
+    segment( x1, y1, x2, y2, false );
+}
+
+
+/**
+ * @brief   Draws the outline of a circle with the midpoint algorithm
+ *
+ * @param   x       The x-coordinate of the center
+ * @param   y       The y-coordinate of the center
+ * @param   radius  The radius in pixels
+ *
+ * @return  void
+ */
+void FramebufferContext::drawCircle( int x, int y, int radius )
+{
+    if ( radius < 0 )
+    {
+        return;
+    }
+
+    if ( tileSize != 0 )
+    {
+        record( Command::OP_CIRCLE, x, y, radius, 0, ink(), mode == MODE_XOR );
+        return;
+    }
+
+    circle( clip, x, y, radius, ink(), mode == MODE_XOR );
+}
+
+
+/**
+ * @brief   Draws many independent line segments
+ *
+ * @param   *segments   The segments to draw
+ * @param   count       The number of segments
+ *
+ * @return  void
+ */
+void FramebufferContext::drawLines( const Segment *segments, size_t count )
+{
+    for ( size_t i = 0; i < count; i++ )
+    {
+        segment( segments[i].x1, segments[i].y1, segments[i].x2, segments[i].y2, false );
+    }
+}
+
+
+/**
+ * @brief   Draws a connected polyline, setting every joint only once
+ *
+ * @param   *points     The vertices of the polyline
+ * @param   count       The number of vertices
+ *
+ * @return  void
+ */
+void FramebufferContext::drawPolyline( const Point *points, size_t count )
+{
+    if ( count == 1 )
+    {
+        setPixel( points[0].x, points[0].y );
+        return;
+    }
+
+    // a closed polyline already set its last point as its first
+    bool closed = ( count > 2 ) &&
+                  ( points[0].x == points[count - 1].x ) &&
+                  ( points[0].y == points[count - 1].y );
+
+    for ( size_t i = 1; i < count; i++ )
+    {
+        bool last = ( i == count - 1 );
+        segment( points[i - 1].x, points[i - 1].y, points[i].x, points[i].y,
+                 !last || closed );
+    }
+}
+
+
+/**
+ * @brief   Fills the framebuffer, or only the clip rectangle when one is
+ *          set, with the background color
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FramebufferContext::clear()
+{
+    if ( tileSize != 0 )
+    {
+        record( Command::OP_FILL, 0, 0, 0, 0, background, false );
+        return;
+    }
+
+    for ( int y = clip.y0; y <= clip.y1; y++ )
+    {
+        span( clip, clip.x0, clip.x1, y, background, false );
+    }
+}
+
+
+/**
+ * @brief   Restricts drawing and clearing to a rectangle
+ *
+ * @param   &rect   The clip rectangle
+ *
+ * @return  void
+ */
+void FramebufferContext::setClip( const Rect &rect )
+{
+    clip.x0 = std::max( rect.x, 0 );
+    clip.y0 = std::max( rect.y, 0 );
+    clip.x1 = std::min( rect.x + rect.width, width ) - 1;
+    clip.y1 = std::min( rect.y + rect.height, height ) - 1;
+}
+
+
+/**
+ * @brief   Lifts the clip restriction
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FramebufferContext::resetClip()
+{
+    clip.x0 = 0;
+    clip.y0 = 0;
+    clip.x1 = width - 1;
+    clip.y1 = height - 1;
+}
+
+
+/**
+ * @brief   Moves the pixels by an offset, leaving the uncovered strips as
+ *          they were for the caller to redraw
+ *
+ * @param   dx  The horizontal offset in pixels
+ * @param   dy  The vertical offset in pixels
+ *
+ * @return  True if the pixels moved, false if the offset is a whole canvas
+ *          or more
+ */
+bool FramebufferContext::scroll( int dx, int dy )
+{
+    if ( ( std::abs( dx ) >= width ) || ( std::abs( dy ) >= height ) )
+    {
+        return false;
+    }
+
+    // drawing recorded before the scroll has to land before it moves
+    flush();
+
+    size_t run = size_t( width - std::abs( dx ) );
+    int sx = std::max( -dx, 0 );
+
+    // walk rows against the direction of motion so none is overwritten
+    // before it is copied
+    for ( int i = 0; i < height - std::abs( dy ); i++ )
+    {
+        int y = ( dy > 0 ) ? ( height - 1 - dy - i ) : ( i - dy );
+
+        uint32_t *source = pixels.data() + size_t( y ) * width + sx;
+        std::memmove( source + ptrdiff_t( dy ) * width + dx, source, run * sizeof( uint32_t ) );
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Rasterizes the drawing recorded in tiled mode
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FramebufferContext::flush()
+{
+    FRAME_STATS_ADD( flushes, 1 );
+
+    if ( commands.empty() )
+    {
+        return;
+    }
+
+    size_t chunks = bins.size();
+    size_t tiles = size_t( tilesX ) * tilesY;
+
+    // bin contiguous chunks of the commands in parallel, so that replaying
+    // the chunks in order replays the commands in order
+    pool->run( chunks, [this, chunks]( size_t chunk, unsigned int )
+       {
+           for ( std::vector<uint32_t> &tile : bins[chunk] ) tile.clear();
+           bin( bins[chunk], commands.size() * chunk / chunks,
+                commands.size() * ( chunk + 1 ) / chunks );
+       }
+    );
+
+    pool->run( tiles, [this, chunks]( size_t index, unsigned int )
+       {
+           tile( bins.data(), chunks, index );
+       }
+    );
+
+    commands.clear();
+}
+
+
+/**
+ * @brief   Paints a drawing once; there are no events to wait for without a
+ *          window
+ *
+ * @param   *drawing    The drawing to paint
+ *
+ * @return  void
+ */
+void FramebufferContext::runLoop( DrawingBase *drawing )
+{
+    run = true;
+    drawing->paint( this );
+    present();
+    run = false;
+}
+
+
+/**
+ * @brief   Gets the width of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The width in pixels
+ */
+int FramebufferContext::getWindowWidth()
+{
+    return width;
+}
+
+
+/**
+ * @brief   Gets the height of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The height in pixels
+ */
+int FramebufferContext::getWindowHeight()
+{
+    return height;
+}
+
+
+/**
+ * @brief   Switches tiled mode on or off, rasterizing anything recorded so
+ *          far first
+ *
+ * @param   tileSize    The width and height of a tile in pixels, or zero to
+ *                      draw directly
+ * @param   threads     The number of threads to rasterize with, or zero for
+ *                      one per hardware thread
+ *
+ * @return  void
+ */
+void FramebufferContext::setTiling( int tileSize, unsigned int threads )
+{
+    flush();
+
+    if ( tileSize <= 0 )
+    {
+        this->tileSize = 0;
+        pool.reset();
+        bins.clear();
+        return;
+    }
+
+    this->tileSize = tileSize;
+    pool.reset( new WorkPool( threads ) );
+    layout();
+}
+
+
+/**
+ * @brief   Gets the size of the tiles drawn in tiled mode
+ *
+ * @param   void
+ *
+ * @return  The width and height of a tile in pixels, or zero when drawing
+ *          directly
+ */
+int FramebufferContext::getTileSize() const
+{
+    return tileSize;
+}
+
+
+/**
+ * @brief   Changes the size of the framebuffer, filling it with the
+ *          background color, lifting the clip and dropping anything still
+ *          recorded in tiled mode
+ *
+ * @param   width   The new width in pixels
+ * @param   height  The new height in pixels
+ *
+ * @return  void
+ */
+void FramebufferContext::resize( int width, int height )
+{
+    this->width = std::max( width, 0 );
+    this->height = std::max( height, 0 );
+    commands.clear();
+    pixels.assign( size_t( this->width ) * this->height, background );
+    resetClip();
+
+    if ( tileSize != 0 )
+    {
+        layout();
+    }
+}
+
+
+/**
+ * @brief   Gets the pixels of the framebuffer
+ *
+ * @param   void
+ *
+ * @return  The pixels, row by row from the top left, as of the last flush
+ *          in tiled mode
+ */
+const uint32_t *FramebufferContext::data() const
+{
+    return pixels.data();
+}
+
+
+/**
+ * @brief   Writes the framebuffer to an image file, choosing PNG by the
+ *          file's extension and otherwise writing PPM
+ *
+ * @param   &fileName   The name of the file to write
+ *
+ * @return  void
+ */
+void FramebufferContext::save( const std::string &fileName ) const
+{
+    std::string extension = ".png";
+
+    bool png = ( fileName.size() >= extension.size() ) &&
+               ( fileName.compare( fileName.size() - extension.size(),
+                                   extension.size(), extension ) == 0 );
+
+    if ( png )
+    {
+        writePng( fileName );
+    }
+    else
+    {
+        writePpm( fileName );
+    }
+}
+
+
+/**
+ * @brief   Writes the framebuffer to a binary PPM image file
+ *
+ * @param   &fileName   The name of the file to write
+ *
+ * @return  void
+ */
+void FramebufferContext::writePpm( const std::string &fileName ) const
+{
+    std::ofstream fileout( fileName.c_str(), std::ios::binary );
+
+    if ( !fileout )
+    {
+        throw FramebufferException( "Could not write " + fileName + "." );
+    }
+
+    fileout << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<unsigned char> row( size_t( width ) * 3 );
+
+    for ( int y = 0; y < height; y++ )
+    {
+        const uint32_t *source = pixels.data() + size_t( y ) * width;
+
+        for ( int x = 0; x < width; x++ )
+        {
+            row[3 * x] = ( source[x] >> 16 ) & 0xFF;
+            row[3 * x + 1] = ( source[x] >> 8 ) & 0xFF;
+            row[3 * x + 2] = source[x] & 0xFF;
+        }
+
+        fileout.write( reinterpret_cast<const char*>( row.data() ), row.size() );
+    }
+
+    if ( !fileout )
+    {
+        throw FramebufferException( "Could not write " + fileName + "." );
+    }
+}
+
+
+/**
+ * @brief   Writes the framebuffer to a PNG image file
+ *
+ * @param   &fileName   The name of the file to write
+ *
+ * @return  void
+ */
+void FramebufferContext::writePng( const std::string &fileName ) const
+{
+# ifdef HAVE_PNG
+    png_image image;
+    std::memset( &image, 0, sizeof( image ) );
+    image.version = PNG_IMAGE_VERSION;
+    image.width = width;
+    image.height = height;
+
+    // the words in memory read as B, G, R, A on little-endian machines
+    image.format = littleEndian() ? PNG_FORMAT_BGRA : PNG_FORMAT_ARGB;
+
+    if ( !png_image_write_to_file( &image, fileName.c_str(), 0, pixels.data(),
+                                   width * sizeof( uint32_t ), nullptr ) )
+    {
+        throw FramebufferException( "Could not write " + fileName + ": " +
+                                    image.message + "." );
+    }
+# else
+    throw FramebufferException( "Could not write " + fileName +
+                                ": built without PNG support." );
+# endif
+}
+
+
+/**
+ * @brief   Copies the framebuffer into an X11 drawable with XPutImage
+ *
+ * @param   *display    The display connection
+ * @param   drawable    The window or pixmap to copy into, which must have
+ *                      the default 24-bit TrueColor visual
+ * @param   gc          The X11 graphics context to copy with
+ * @param   x           The x-coordinate to copy to
+ * @param   y           The y-coordinate to copy to
+ *
+ * @return  void
+ */
+void FramebufferContext::putImage( Display *display, Drawable drawable, GC gc, int x, int y ) const
+{
+    int screen = DefaultScreen( display );
+
+    // the image only borrows the pixels, it does not own them
+    XImage *image = XCreateImage( display, DefaultVisual( display, screen ),
+                                  DefaultDepth( display, screen ), ZPixmap, 0,
+                                  reinterpret_cast<char*>( const_cast<uint32_t*>( pixels.data() ) ),
+                                  width, height, 32, width * sizeof( uint32_t ) );
+
+    if ( image == nullptr )
+    {
+        throw FramebufferException( "Could not create an image for the display." );
+    }
+
+    // Xlib swaps the words if the server's byte order differs
+    image->byte_order = littleEndian() ? LSBFirst : MSBFirst;
+
+    XPutImage( display, drawable, gc, image, 0, 0, x, y, width, height );
+
+    image->data = nullptr;
+    XDestroyImage( image );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Gets the value drawing sets or XORs pixels with in the current
+ *          color and mode
+ *
+ * @param   void
+ *
+ * @return  The pixel value, without alpha when XORing
+ */
+uint32_t FramebufferContext::ink() const
+{
+    return ( mode == MODE_XOR ) ? ( color & 0xFFFFFF ) : color;
+}
+
+
+/**
+ * @brief   Records a primitive in tiled mode along with the current clip,
+ *          rasterizing early if too much is waiting
+ *
+ * @param   op          The kind of primitive
+ * @param   a           The first coordinate of the primitive
+ * @param   b           The second coordinate of the primitive
+ * @param   c           The third coordinate of the primitive
+ * @param   d           The fourth coordinate of the primitive
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::record( uint8_t op, int a, int b, int c, int d,
+                                 uint32_t value, bool xorMode )
+{
+    if ( ( clip.x1 < clip.x0 ) || ( clip.y1 < clip.y0 ) )
+    {
+        return;
+    }
+
+    if ( commands.size() >= MAX_PENDING )
+    {
+        flush();
+    }
+
+    Command command = { op, xorMode, value, a, b, c, d, clip };
+    commands.push_back( command );
+}
+
+
+/**
+ * @brief   Draws or records a line in the current color and mode
+ *
+ * @param   x1          The x-coordinate of the first point
+ * @param   y1          The y-coordinate of the first point
+ * @param   x2          The x-coordinate of the second point
+ * @param   y2          The y-coordinate of the second point
+ * @param   skipLast    True to leave out the second point
+ *
+ * @return  void
+ */
+void FramebufferContext::segment( int x1, int y1, int x2, int y2, bool skipLast )
+{
+    if ( tileSize == 0 )
+    {
+        line( clip, x1, y1, x2, y2, skipLast, ink(), mode == MODE_XOR );
+        return;
+    }
+
+    // cut down once here rather than in every tile, drawing the cut line
+    // is the same as drawing the original
+    if ( guard( x1, y1, x2, y2 ) )
+    {
+        record( skipLast ? Command::OP_OPEN_LINE : Command::OP_LINE,
+                x1, y1, x2, y2, ink(), mode == MODE_XOR );
+    }
+}
+
+
+/**
+ * @brief   Adds recorded commands to the bins of every tile they may touch
+ *
+ * @param   &tiles  The bins to add to, one per tile
+ * @param   begin   The number of the first command to bin
+ * @param   end     The number of the command after the last to bin
+ *
+ * @return  void
+ */
+void FramebufferContext::bin( std::vector<std::vector<uint32_t>> &tiles, size_t begin, size_t end ) const
+{
+    for ( size_t i = begin; i < end; i++ )
+    {
+        const Command &command = commands[i];
+        int64_t x0, y0, x1, y1;
+
+        switch ( command.op )
+        {
+        case Command::OP_LINE:
+        case Command::OP_OPEN_LINE:
+            x0 = std::min( command.a, command.c );
+            y0 = std::min( command.b, command.d );
+            x1 = std::max( command.a, command.c );
+            y1 = std::max( command.b, command.d );
+            break;
+
+        case Command::OP_CIRCLE:
+            x0 = int64_t( command.a ) - command.c;
+            y0 = int64_t( command.b ) - command.c;
+            x1 = int64_t( command.a ) + command.c;
+            y1 = int64_t( command.b ) + command.c;
+            break;
+
+        case Command::OP_PIXEL:
+            x0 = x1 = command.a;
+            y0 = y1 = command.b;
+            break;
+
+        default:
+            x0 = command.clip.x0;
+            y0 = command.clip.y0;
+            x1 = command.clip.x1;
+            y1 = command.clip.y1;
+            break;
+        }
+
+        // the clip is inside the buffer, so the box cannot be negative
+        Clip box = { int( std::max<int64_t>( x0, command.clip.x0 ) ),
+                     int( std::max<int64_t>( y0, command.clip.y0 ) ),
+                     int( std::min<int64_t>( x1, command.clip.x1 ) ),
+                     int( std::min<int64_t>( y1, command.clip.y1 ) ) };
+
+        if ( ( box.x1 < box.x0 ) || ( box.y1 < box.y0 ) )
+        {
+            continue;
+        }
+
+        bool sloped = ( ( command.op == Command::OP_LINE ) ||
+                        ( command.op == Command::OP_OPEN_LINE ) ) &&
+                      ( command.b != command.d );
+
+        for ( int ty = box.y0 / tileSize; ty <= box.y1 / tileSize; ty++ )
+        {
+            int left = box.x0;
+            int right = box.x1;
+
+            // a sloped line only crosses part of a row of tiles: its pixels
+            // are within half a pixel of the ideal line across the minor
+            // axis, so with a pixel to spare it stays within the span of
+            // the ideal line half a pixel above and below the row
+            if ( sloped )
+            {
+                double top = std::max( box.y0, ty * tileSize ) - 0.5;
+                double bottom = std::min( box.y1, ty * tileSize + tileSize - 1 ) + 0.5;
+                double slope = double( command.c - command.a ) / ( double( command.d ) - command.b );
+                double xa = command.a + ( top - command.b ) * slope;
+                double xb = command.a + ( bottom - command.b ) * slope;
+
+                left = int( std::max<double>( box.x0, std::floor( std::min( xa, xb ) ) - 1 ) );
+                right = int( std::min<double>( box.x1, std::ceil( std::max( xa, xb ) ) + 1 ) );
+
+                if ( left > right )
+                {
+                    continue;
+                }
+            }
+
+            for ( int tx = left / tileSize; tx <= right / tileSize; tx++ )
+            {
+                tiles[size_t( ty ) * tilesX + tx].push_back( uint32_t( i ) );
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief   Replays the commands binned into a tile, clipped to the tile; runs
+ *          on the pool's threads, each tile touching only its own pixels
+ *
+ * @param   *chunks     The bins of each binning chunk, in command order
+ * @param   count       The number of binning chunks
+ * @param   index       The number of the tile, in row-major order
+ *
+ * @return  void
+ */
+void FramebufferContext::tile( const std::vector<std::vector<uint32_t>> *chunks, size_t count, size_t index )
+{
+    int tx = int( index % tilesX );
+    int ty = int( index / tilesX );
+
+    Clip area = { tx * tileSize, ty * tileSize,
+                  std::min( tx * tileSize + tileSize, width ) - 1,
+                  std::min( ty * tileSize + tileSize, height ) - 1 };
+
+    for ( size_t chunk = 0; chunk < count; chunk++ )
+    {
+        for ( uint32_t i : chunks[chunk][index] )
+        {
+            const Command &command = commands[i];
+            Clip bounds = intersect( command.clip, area );
+
+            switch ( command.op )
+            {
+            case Command::OP_LINE:
+            case Command::OP_OPEN_LINE:
+                line( bounds, command.a, command.b, command.c, command.d,
+                      command.op == Command::OP_OPEN_LINE, command.value, command.xorMode );
+                break;
+
+            case Command::OP_CIRCLE:
+                circle( bounds, command.a, command.b, command.c, command.value, command.xorMode );
+                break;
+
+            case Command::OP_PIXEL:
+                plot( bounds, command.a, command.b, command.value, command.xorMode );
+                break;
+
+            default:
+                for ( int y = bounds.y0; y <= bounds.y1; y++ )
+                {
+                    span( bounds, bounds.x0, bounds.x1, y, command.value, command.xorMode );
+                }
+                break;
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief   Works out the tiles for the size of the framebuffer and the tile
+ *          size, with empty bins for every binning chunk
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FramebufferContext::layout()
+{
+    tilesX = ( width + tileSize - 1 ) / tileSize;
+    tilesY = ( height + tileSize - 1 ) / tileSize;
+    bins.assign( pool->size(), std::vector<std::vector<uint32_t>>( size_t( tilesX ) * tilesY ) );
+}
+
+
+/**
+ * @brief   Draws the part of a line inside a clip rectangle with Bresenham's
+ *          algorithm, starting at the first step inside the clip rather than
+ *          walking up to it
+ *
+ * @param   &bounds     The clip rectangle
+ * @param   x1          The x-coordinate of the first point
+ * @param   y1          The y-coordinate of the first point
+ * @param   x2          The x-coordinate of the second point
+ * @param   y2          The y-coordinate of the second point
+ * @param   skipLast    True to leave out the second point
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::line( const Clip &bounds, int x1, int y1, int x2, int y2,
+                               bool skipLast, uint32_t value, bool xorMode )
+{
+    if ( ( bounds.x1 < bounds.x0 ) || ( bounds.y1 < bounds.y0 ) || !guard( x1, y1, x2, y2 ) )
+    {
+        return;
+    }
+
+    // horizontal lines are filled as spans
+    if ( y1 == y2 )
+    {
+        if ( skipLast )
+        {
+            if ( x1 == x2 ) return;
+            x2 += ( x2 > x1 ) ? -1 : 1;
+        }
+
+        span( bounds, std::min( x1, x2 ), std::max( x1, x2 ), y1, value, xorMode );
+        return;
+    }
+
+    // walk the major axis one pixel per step, the minor axis moving by
+    // floor( ( 2 k lb + la ) / ( 2 la ) ) after k steps
+    int64_t adx = std::abs( int64_t( x2 ) - x1 );
+    int64_t ady = std::abs( int64_t( y2 ) - y1 );
+    bool xMajor = ( adx >= ady );
+
+    int64_t la = xMajor ? adx : ady;
+    int64_t lb = xMajor ? ady : adx;
+    int sx = ( x2 >= x1 ) ? 1 : -1;
+    int sy = ( y2 >= y1 ) ? 1 : -1;
+
+    int a0 = xMajor ? x1 : y1;
+    int b0 = xMajor ? y1 : x1;
+    int sa = xMajor ? sx : sy;
+    int sb = xMajor ? sy : sx;
+    int aMin = xMajor ? bounds.x0 : bounds.y0;
+    int aMax = xMajor ? bounds.x1 : bounds.y1;
+    int bMin = xMajor ? bounds.y0 : bounds.x0;
+    int bMax = xMajor ? bounds.y1 : bounds.x1;
+
+    // steps whose major coordinate is inside the clip
+    int64_t kLo = ( sa > 0 ) ? int64_t( aMin ) - a0 : int64_t( a0 ) - aMax;
+    int64_t kHi = ( sa > 0 ) ? int64_t( aMax ) - a0 : int64_t( a0 ) - aMin;
+    kLo = std::max<int64_t>( kLo, 0 );
+    kHi = std::min<int64_t>( kHi, skipLast ? la - 1 : la );
+
+    // minor offsets inside the clip, narrowed to the steps reaching them
+    int64_t mLo = ( sb > 0 ) ? int64_t( bMin ) - b0 : int64_t( b0 ) - bMax;
+    int64_t mHi = ( sb > 0 ) ? int64_t( bMax ) - b0 : int64_t( b0 ) - bMin;
+    mLo = std::max<int64_t>( mLo, 0 );
+    mHi = std::min<int64_t>( mHi, lb );
+
+    if ( mLo > mHi )
+    {
+        return;
+    }
+
+    if ( lb > 0 )
+    {
+        kLo = std::max( kLo, ceilDiv( 2 * la * mLo - la, 2 * lb ) );
+        kHi = std::min( kHi, ceilDiv( 2 * la * ( mHi + 1 ) - la, 2 * lb ) - 1 );
+    }
+
+    if ( kLo > kHi )
+    {
+        return;
+    }
+
+    // jump straight to the first visible step
+    int64_t twoLa = 2 * la;
+    int64_t twoLb = 2 * lb;
+    int64_t num = kLo * twoLb + la;
+    int64_t m = num / twoLa;
+    int64_t rem = num - m * twoLa;
+
+    int64_t a = a0 + sa * kLo;
+    int64_t b = b0 + sb * m;
+    int64_t x = xMajor ? a : b;
+    int64_t y = xMajor ? b : a;
+
+    ptrdiff_t majorStep = xMajor ? sx : ptrdiff_t( sy ) * width;
+    ptrdiff_t minorStep = xMajor ? ptrdiff_t( sy ) * width : sx;
+    ptrdiff_t index = y * width + x;
+    int64_t n = kHi - kLo + 1;
+
+    uint32_t *p = pixels.data();
+
+    if ( xorMode )
+    {
+        for ( int64_t i = 0; i < n; i++ )
+        {
+            p[index] ^= value;
+            index += majorStep;
+            rem += twoLb;
+            if ( rem >= twoLa ) { rem -= twoLa; index += minorStep; }
+        }
+    }
+    else
+    {
+        for ( int64_t i = 0; i < n; i++ )
+        {
+            p[index] = value;
+            index += majorStep;
+            rem += twoLb;
+            if ( rem >= twoLa ) { rem -= twoLa; index += minorStep; }
+        }
+    }
+}
+
+
+/**
+ * @brief   Draws the part of a circle's outline inside a clip rectangle with
+ *          the midpoint algorithm
+ *
+ * @param   &bounds     The clip rectangle
+ * @param   x           The x-coordinate of the center
+ * @param   y           The y-coordinate of the center
+ * @param   radius      The radius in pixels, not negative
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::circle( const Clip &bounds, int x, int y, int radius,
+                                 uint32_t value, bool xorMode )
+{
+    // where the octants meet the same pixel comes up twice, so only the
+    // distinct mirror images are plotted
+    auto quad = [this, &bounds, x, y, value, xorMode]( int a, int b )
+    {
+        plot( bounds, x + a, y + b, value, xorMode );
+        if ( a != 0 ) plot( bounds, x - a, y + b, value, xorMode );
+        if ( b != 0 ) plot( bounds, x + a, y - b, value, xorMode );
+        if ( ( a != 0 ) && ( b != 0 ) ) plot( bounds, x - a, y - b, value, xorMode );
+    };
+
+    int a = 0;
+    int b = radius;
+    int d = 1 - radius;
+
+    while ( a <= b )
+    {
+        quad( a, b );
+        if ( a != b ) quad( b, a );
+
+        if ( d < 0 )
+        {
+            d += 2 * a + 3;
+        }
+        else
+        {
+            d += 2 * ( a - b ) + 5;
+            b--;
+        }
+
+        a++;
+    }
+}
+
+
+/**
+ * @brief   Sets or XORs the part of a horizontal run of pixels inside a clip
+ *          rectangle
+ *
+ * @param   &bounds     The clip rectangle
+ * @param   x1          The x-coordinate of the leftmost pixel
+ * @param   x2          The x-coordinate of the rightmost pixel
+ * @param   y           The y-coordinate of the run
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::span( const Clip &bounds, int x1, int x2, int y,
+                               uint32_t value, bool xorMode )
+{
+    if ( ( y < bounds.y0 ) || ( y > bounds.y1 ) )
+    {
+        return;
+    }
+
+    x1 = std::max( x1, bounds.x0 );
+    x2 = std::min( x2, bounds.x1 );
+
+    if ( x1 > x2 )
+    {
+        return;
+    }
+
+    fill( pixels.data() + size_t( y ) * width + x1, x2 - x1 + 1, value, xorMode );
+}
+
+
+/**
+ * @brief   Sets or XORs a single pixel, if it is inside a clip rectangle
+ *
+ * @param   &bounds     The clip rectangle
+ * @param   x           The x-coordinate of the pixel
+ * @param   y           The y-coordinate of the pixel
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::plot( const Clip &bounds, int x, int y, uint32_t value, bool xorMode )
+{
+    if ( ( x < bounds.x0 ) || ( x > bounds.x1 ) || ( y < bounds.y0 ) || ( y > bounds.y1 ) )
+    {
+        return;
+    }
+
+    uint32_t &pixel = pixels[ size_t( y ) * width + x ];
+
+    if ( xorMode )
+    {
+        pixel ^= value;
+    }
+    else
+    {
+        pixel = value;
+    }
+}
+
+
+/**
+ * @brief   Cuts a line down to the guard square around the origin, so the
+ *          exact clipping arithmetic stays within 64 bits
+ *
+ * @param   &x1     The x-coordinate of the first point
+ * @param   &y1     The y-coordinate of the first point
+ * @param   &x2     The x-coordinate of the second point
+ * @param   &y2     The y-coordinate of the second point
+ *
+ * @return  False if no part of the line is inside the guard square, true
+ *          otherwise
+ */
+bool FramebufferContext::guard( int &x1, int &y1, int &x2, int &y2 )
+{
+    auto inside = []( int v ) { return ( v >= -GUARD ) && ( v <= GUARD ); };
+
+    if ( inside( x1 ) && inside( y1 ) && inside( x2 ) && inside( y2 ) )
+    {
+        return true;
+    }
+
+    // Liang-Barsky against the guard square
+    double dx = double( x2 ) - x1;
+    double dy = double( y2 ) - y1;
+    double t0 = 0;
+    double t1 = 1;
+
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { double( x1 ) + GUARD, double( GUARD ) - x1,
+                    double( y1 ) + GUARD, double( GUARD ) - y1 };
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        if ( p[i] == 0 )
+        {
+            if ( q[i] < 0 ) return false;
+            continue;
+        }
+
+        double t = q[i] / p[i];
+
+        if ( p[i] < 0 )
+        {
+            t0 = std::max( t0, t );
+        }
+        else
+        {
+            t1 = std::min( t1, t );
+        }
+    }
+
+    if ( t0 > t1 )
+    {
+        return false;
+    }
+
+    int nx1 = std::lround( x1 + t0 * dx );
+    int ny1 = std::lround( y1 + t0 * dy );
+    int nx2 = std::lround( x1 + t1 * dx );
+    int ny2 = std::lround( y1 + t1 * dy );
+
+    x1 = nx1;
+    y1 = ny1;
+    x2 = nx2;
+    y2 = ny2;
+    return true;
+}
+
+
+/**
+ * @brief   Intersects two rectangles of pixels
+ *
+ * @param   &a  The first rectangle
+ * @param   &b  The second rectangle
+ *
+ * @return  The pixels in both, which may be empty
+ */
+FramebufferContext::Clip FramebufferContext::intersect( const Clip &a, const Clip &b )
+{
+    Clip both = { std::max( a.x0, b.x0 ), std::max( a.y0, b.y0 ),
+                  std::min( a.x1, b.x1 ), std::min( a.y1, b.y1 ) };
+    return both;
+}
+
+
+/**
+ * @brief   Sets or XORs a run of pixels, several at a time where the
+ *          instruction set allows
+ *
+ * @param   *row        The first pixel of the run
+ * @param   n           The number of pixels
+ * @param   value       The pixel value to set or XOR
+ * @param   xorMode     True to XOR the value, false to set it
+ *
+ * @return  void
+ */
+void FramebufferContext::fill( uint32_t *row, size_t n, uint32_t value, bool xorMode )
+{
+    size_t i = 0;
+
+# if defined( __AVX__ )
+    // eight pixels per iteration, XORed through the float unit since
+    // integer AVX needs AVX2
+    const __m256i wide = _mm256_set1_epi32( value );
+
+    if ( xorMode )
+    {
+        const __m256 bits = _mm256_castsi256_ps( wide );
+
+        for ( ; i + 8 <= n; i += 8 )
+        {
+            __m256 current = _mm256_loadu_ps( reinterpret_cast<const float*>( row + i ) );
+            _mm256_storeu_ps( reinterpret_cast<float*>( row + i ), _mm256_xor_ps( current, bits ) );
+        }
+    }
+    else
+    {
+        for ( ; i + 8 <= n; i += 8 )
+        {
+            _mm256_storeu_si256( ( __m256i * ) ( row + i ), wide );
+        }
+    }
+# elif defined( __SSE2__ )
+    // four pixels per iteration
+    const __m128i wide = _mm_set1_epi32( value );
+
+    if ( xorMode )
+    {
+        for ( ; i + 4 <= n; i += 4 )
+        {
+            __m128i current = _mm_loadu_si128( ( const __m128i * ) ( row + i ) );
+            _mm_storeu_si128( ( __m128i * ) ( row + i ), _mm_xor_si128( current, wide ) );
+        }
+    }
+    else
+    {
+        for ( ; i + 4 <= n; i += 4 )
+        {
+            _mm_storeu_si128( ( __m128i * ) ( row + i ), wide );
+        }
+    }
+# endif
+
+    // scalar remainder
+    if ( xorMode )
+    {
+        for ( ; i < n; i++ ) row[i] ^= value;
+    }
+    else
+    {
+        for ( ; i < n; i++ ) row[i] = value;
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
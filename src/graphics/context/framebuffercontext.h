@@ -0,0 +1,213 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framebuffercontext.h
+ * @brief   Graphics context that renders into an in-memory framebuffer
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_FRAMEBUFFERCONTEXT_H
+# define GRAPHICS_CONTEXT_FRAMEBUFFERCONTEXT_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <cstdint>
+# include <memory>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <X11/Xlib.h>
+
+# include "gcontext.h"
+# include "workpool.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class FramebufferException : public std::runtime_error
+{
+public:
+    explicit FramebufferException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Framebuffer Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/*
+ * Renders into a buffer of packed 32-bit pixels it owns, so drawings can be
+ * rendered without an X server and without a round trip per primitive. Each
+ * pixel is one word holding 0xAARRGGBB with the alpha always opaque, which
+ * is also the layout a 24-bit TrueColor XImage expects, so the buffer can be
+ * put into a window as it is.
+ *
+ * Lines are clipped exactly: only the steps of a line that land inside the
+ * clip rectangle are walked, and those are the same pixels an unclipped
+ * line would set. No primitive sets a pixel twice, so XOR drawing can always
+ * be undone by drawing again.
+ *
+ * In tiled mode drawing is recorded rather than done, and rasterized on
+ * flush or present. The buffer is split into square tiles, every recorded
+ * primitive is binned into the tiles it may touch, and the tiles are drawn
+ * in parallel, each clipped to itself. A pixel belongs to exactly one tile
+ * and each tile replays its primitives in the order they were recorded, so
+ * the result is the same, bit for bit, as drawing directly, XOR included.
+ */
+class FramebufferContext : public GraphicsContext
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    constexpr static const uint32_t OPAQUE = 0xFF000000;
+    constexpr static const int DEFAULT_TILE_SIZE = 256;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    FramebufferContext( int width, int height, unsigned int background = BLACK );
+    ~FramebufferContext() override;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void setMode( drawMode newMode ) override;
+    void setColor( unsigned int color ) override;
+    void setPixel( int x, int y ) override;
+    unsigned int getPixel( int x, int y ) override;
+    void getPixels( int x, int y, int width, int height, uint32_t *out ) override;
+
+    void drawLine( int x1, int y1, int x2, int y2 ) override;
+    void drawCircle( int x, int y, int radius ) override;
+    void drawLines( const Segment *segments, size_t count ) override;
+    void drawPolyline( const Point *points, size_t count ) override;
+
+    void flush() override;
+    void clear() override;
+    void setClip( const Rect &rect ) override;
+    void resetClip() override;
+    bool scroll( int dx, int dy ) override;
+
+    void runLoop( DrawingBase *drawing ) override;
+
+    int getWindowWidth() override;
+    int getWindowHeight() override;
+
+    void setTiling( int tileSize, unsigned int threads = 0 );
+    int getTileSize() const;
+
+    void resize( int width, int height );
+    const uint32_t *data() const;
+
+    void save( const std::string &fileName ) const;
+    void writePpm( const std::string &fileName ) const;
+    void writePng( const std::string &fileName ) const;
+
+    void putImage( Display *display, Drawable drawable, GC gc, int x, int y ) const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // lines reaching further than this are cut down before they are walked
+    // so that their step arithmetic cannot overflow
+    constexpr static const int GUARD = 1 << 28;
+
+    // tiled drawing is rasterized early once this many primitives wait
+    constexpr static const size_t MAX_PENDING = 1 << 22;
+
+    // inclusive bounds of a rectangle of pixels
+    struct Clip
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    // a primitive recorded in tiled mode, with the state it was drawn in
+    struct Command
+    {
+        enum Op : uint8_t {OP_LINE, OP_OPEN_LINE, OP_CIRCLE, OP_PIXEL, OP_FILL};
+
+        uint8_t op;
+        bool xorMode;
+        uint32_t value;
+        int a;
+        int b;
+        int c;
+        int d;
+        Clip clip;
+    };
+
+    int width;
+    int height;
+    std::vector<uint32_t> pixels;
+
+    uint32_t background;
+    uint32_t color = WHITE | OPAQUE;
+    drawMode mode = MODE_NORMAL;
+
+    // always inside the buffer
+    Clip clip = { 0, 0, -1, -1 };
+
+    int tileSize = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::unique_ptr<WorkPool> pool;
+    std::vector<Command> commands;
+
+    // per binning chunk, per tile, the numbers of the commands to replay
+    std::vector<std::vector<std::vector<uint32_t>>> bins;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    uint32_t ink() const;
+    void record( uint8_t op, int a, int b, int c, int d, uint32_t value, bool xorMode );
+    void segment( int x1, int y1, int x2, int y2, bool skipLast );
+    void bin( std::vector<std::vector<uint32_t>> &tiles, size_t begin, size_t end ) const;
+    void tile( const std::vector<std::vector<uint32_t>> *chunks, size_t count, size_t index );
+
+    void layout();
+
+    void line( const Clip &bounds, int x1, int y1, int x2, int y2, bool skipLast,
+               uint32_t value, bool xorMode );
+    void circle( const Clip &bounds, int x, int y, int radius, uint32_t value, bool xorMode );
+    void span( const Clip &bounds, int x1, int x2, int y, uint32_t value, bool xorMode );
+    void plot( const Clip &bounds, int x, int y, uint32_t value, bool xorMode );
+
+    static bool guard( int &x1, int &y1, int &x2, int &y2 );
+    static Clip intersect( const Clip &a, const Clip &b );
+    static void fill( uint32_t *row, size_t n, uint32_t value, bool xorMode );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_FRAMEBUFFERCONTEXT_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -23,4 +23,125 @@ void GraphicsContext::endLoop()
 	run = false;
 }
 
+void GraphicsContext::wake()
+{
+	// nothing to do
+}
+
+void GraphicsContext::setMotionPolicy(motionPolicy policy)
+{
+	motion_policy = policy;
+}
+
+GraphicsContext::motionPolicy GraphicsContext::getMotionPolicy()
+{
+	return motion_policy;
+}
+
+void GraphicsContext::getPixels(int x, int y, int width, int height,
+								uint32_t* out)
+{
+	int window_width = getWindowWidth();
+	int window_height = getWindowHeight();
+
+	for (int row = 0; row < height; row++)
+	{
+		for (int col = 0; col < width; col++)
+		{
+			int px = x + col;
+			int py = y + row;
+			bool inside = px >= 0 && py >= 0 &&
+							px < window_width && py < window_height;
+			*out++ = inside ? getPixel(px, py) : 0;
+		}
+	}
+}
+
+void GraphicsContext::drawLines(const Segment* segments, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		drawLine(segments[i].x1, segments[i].y1,
+				 segments[i].x2, segments[i].y2);
+	}
+}
+
+void GraphicsContext::drawPolyline(const Point* points, size_t count)
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		drawLine(points[i-1].x, points[i-1].y, points[i].x, points[i].y);
+	}
+}
+
+void GraphicsContext::flush()
+{
+	// nothing to do
+}
+
+void GraphicsContext::present()
+{
+	flush();
+}
+
+void GraphicsContext::setClip(const Rect&)
+{
+	// nothing to do
+}
 
+void GraphicsContext::resetClip()
+{
+	// nothing to do
+}
+
+bool GraphicsContext::scroll(int, int)
+{
+	// cannot scroll, the caller repaints instead
+	return false;
+}
+
+void GraphicsContext::setOverlay(const OverlayLine* lines, size_t count)
+{
+	// an overlay rebuilt the same needs nothing shown again
+	bool same = count == overlay.size();
+	for (size_t i = 0; same && i < count; i++)
+	{
+		const OverlayLine& a = overlay[i];
+		const OverlayLine& b = lines[i];
+		same = a.color == b.color &&
+				a.segment.x1 == b.segment.x1 && a.segment.y1 == b.segment.y1 &&
+				a.segment.x2 == b.segment.x2 && a.segment.y2 == b.segment.y2;
+	}
+
+	if (same)
+		return;
+
+	overlay.assign(lines, lines + count);
+	overlay_changed = true;
+}
+
+const std::vector<GraphicsContext::OverlayLine>& GraphicsContext::getOverlay()
+{
+	return overlay;
+}
+
+bool GraphicsContext::canRetain()
+{
+	// keeps nothing, the caller draws every frame in device coordinates
+	return false;
+}
+
+void GraphicsContext::retainLines(const ModelVertex*, size_t)
+{
+	// nothing to do
+}
+
+void GraphicsContext::releaseLines()
+{
+	// nothing to do
+}
+
+void GraphicsContext::drawRetained(const double*)
+{
+	// nothing to do
+}
@@ -20,6 +20,10 @@
  * */    
 
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 // forward reference - needed because runLoop needs a target for events
 class DrawingBase;
 
@@ -36,6 +40,13 @@ class GraphicsContext
 		// color requested.  XOR mode will XOR the new color with the
 		// existing color so that the change is reversible.		
 		enum drawMode {MODE_NORMAL, MODE_XOR};
+
+		// This enumerated type is an argument to setMotionPolicy and
+		// controls how pointer motion reaches the drawing.  MOTION_ALL
+		// delivers every motion event.  MOTION_LATEST drops motion events
+		// that are already superseded by a newer one waiting in the queue,
+		// so a slow mouseMove handler never falls behind the pointer.
+		enum motionPolicy {MOTION_ALL, MOTION_LATEST};
 	
 		// Some colors - for fun
 		static const unsigned int BLACK = 0x000000;
@@ -47,6 +58,48 @@ class GraphicsContext
 		static const unsigned int YELLOW = 0xFFFF00;
 		static const unsigned int GRAY = 0x808080;
 		static const unsigned int WHITE = 0xFFFFFF;
+
+		// A line segment in device coordinates, used for submitting
+		// many lines at once.
+		struct Segment
+		{
+			int x1;
+			int y1;
+			int x2;
+			int y2;
+		};
+
+		// A vertex of a polyline in device coordinates.
+		struct Point
+		{
+			int x;
+			int y;
+		};
+
+		// An axis-aligned rectangle of pixels in device coordinates.
+		struct Rect
+		{
+			int x;
+			int y;
+			int width;
+			int height;
+		};
+
+		// A line of the overlay, in its own 24-bit RGB color.
+		struct OverlayLine
+		{
+			unsigned int color;
+			Segment segment;
+		};
+
+		// An end of a retained line, in model coordinates, with the
+		// line's 24-bit RGB color.
+		struct ModelVertex
+		{
+			float x;
+			float y;
+			unsigned int color;
+		};
 	
 	
 		/*********************************************************
@@ -83,12 +136,73 @@ class GraphicsContext
 		// it is large enough to hold a 16-bit color.
 		virtual unsigned int getPixel(int x, int y) = 0;
 
+		// Read a width x height rectangle of 24-bit RGB pixels into out,
+		// row by row with no padding.  Pixels outside the canvas read as
+		// zero.  The default calls getPixel for each one, so contexts
+		// that can read a whole area at once should override it.
+		virtual void getPixels(int x, int y, int width, int height,
+								uint32_t* out);
+
         virtual void drawLine(int x1, int y1, int x2, int y2) = 0;
         virtual void drawCircle(int x, int y, int radius) = 0;
 
+		// Draw many independent segments / one connected polyline in
+		// the current color.  The default versions loop over drawLine,
+		// but contexts that can submit primitives in bulk should
+		// override them.
+		virtual void drawLines(const Segment* segments, size_t count);
+		virtual void drawPolyline(const Point* points, size_t count);
+
+		// Push any buffered drawing through to the display.  Drawing
+		// operations are not required to be visible until this is
+		// called, so callers should flush once at the end of a frame
+		// rather than after every primitive.  Default does nothing.
+		virtual void flush();
+
+		// Make the frame drawn so far visible.  Contexts that draw into
+		// an off-screen buffer copy it to the display here; the default
+		// simply flushes.
+		virtual void present();
+
 		// This should reset entire context to the current background
+		// (or only the clip rectangle, when one is set)
 		virtual void clear() = 0;
 
+		// Restrict drawing and clearing to a rectangle, or lift the
+		// restriction.  Defaults do nothing, so a context that does not
+		// clip must not ask its drawing for partial (region) repaints.
+		virtual void setClip(const Rect& rect);
+		virtual void resetClip();
+
+		// Move the whole canvas by (dx, dy) pixels, leaving the strips
+		// it uncovers with stale content for the caller to redraw.
+		// Returns false, having moved nothing, if the context cannot
+		// scroll, which the default never does.
+		virtual bool scroll(int dx, int dy);
+
+		// Replace the overlay - transient lines such as rubber bands and
+		// highlights, kept apart from the canvas.  present() shows them
+		// over the canvas without drawing them into it, so the overlay
+		// can change without any of the canvas being repainted or the
+		// old lines erased, and reading pixels never sees it.  Contexts
+		// that cannot composite, which is the default, never show it.
+		void setOverlay(const OverlayLine* lines, size_t count);
+		const std::vector<OverlayLine>& getOverlay();
+
+		// Retained lines - model coordinate lines the context keeps
+		// between frames, such as in GPU memory, and draws itself under
+		// a transform, so a change of view costs no work per vertex on
+		// the way.  retainLines appends lines, each a pair of vertices,
+		// releaseLines forgets them all, and drawRetained draws every
+		// one in the current mode and clip through a model to device
+		// transform given as the top two rows of a 3x3 matrix, row by
+		// row.  Contexts that cannot, which is the default, return
+		// false from canRetain and ignore the rest.
+		virtual bool canRetain();
+		virtual void retainLines(const ModelVertex* vertices, size_t count);
+		virtual void releaseLines();
+		virtual void drawRetained(const double* transform);
+
 		// These are the naive implementations that use setPixel,
 		// but are overridable should a context have a better-
 		// performing version available.
@@ -108,6 +222,18 @@ class GraphicsContext
 		// a default version is supplied
 		virtual void endLoop();
 
+		// Ask a running (or about to run) event loop to call the
+		// drawing's idle() as soon as it can.  Unlike every other
+		// method this may be called from any thread; several wakes
+		// before the loop gets to them are delivered as one idle call.
+		// The default does nothing, so the drawing is never idled.
+		virtual void wake();
+
+		// Select how runLoop delivers pointer motion.  Defaults to
+		// MOTION_LATEST.
+		virtual void setMotionPolicy(motionPolicy policy);
+		motionPolicy getMotionPolicy();
+
 
 		/*********************************************************
 		 * Utility operations
@@ -123,6 +249,13 @@ class GraphicsContext
 		// this flag is used to control whether the event loop
 		// continues to run.
 		bool run;
+
+		// how queued pointer motion is delivered
+		motionPolicy motion_policy = MOTION_LATEST;
+
+		// the overlay, and whether it changed since it was last shown
+		std::vector<OverlayLine> overlay;
+		bool overlay_changed = false;
 };
 
 #endif
@@ -0,0 +1,946 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    glcontext.cpp
+ * @brief   Graphics context that renders with OpenGL into an X11 window
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+// the buffer, shader and framebuffer functions are past OpenGL 1.3
+# define GL_GLEXT_PROTOTYPES
+
+# include <algorithm>
+# include <cmath>
+# include <cstddef>
+
+# include "framestats.h"
+# include "glcontext.h"
+
+
+# ifdef HAVE_OPENGL
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+// maps model or device space to clip space, with y pointing down like the
+// window and vertices at the centres of pixels
+static const char *VERTEX_SHADER =
+    "#version 130\n"
+    "uniform vec3 transformX;\n"
+    "uniform vec3 transformY;\n"
+    "uniform vec2 viewport;\n"
+    "in vec2 position;\n"
+    "in uint color;\n"
+    "flat out vec4 tint;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 p = vec3( position, 1.0 );\n"
+    "    vec2 device = vec2( dot( transformX, p ), dot( transformY, p ) ) + 0.5;\n"
+    "    gl_Position = vec4( device.x * 2.0 / viewport.x - 1.0,\n"
+    "                        1.0 - device.y * 2.0 / viewport.y, 0.0, 1.0 );\n"
+    "    tint = vec4( float( ( color >> 16u ) & 255u ),\n"
+    "                 float( ( color >> 8u ) & 255u ),\n"
+    "                 float( color & 255u ), 255.0 ) / 255.0;\n"
+    "}\n";
+
+static const char *FRAGMENT_SHADER =
+    "#version 130\n"
+    "flat in vec4 tint;\n"
+    "out vec4 fragment;\n"
+    "void main()\n"
+    "{\n"
+    "    fragment = tint;\n"
+    "}\n";
+
+static const GLuint POSITION_ATTRIBUTE = 0;
+static const GLuint COLOR_ATTRIBUTE = 1;
+
+// the transform immediate drawing goes through, being in device space
+static const double IDENTITY[6] = { 1, 0, 0, 0, 1, 0 };
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Opens a window and an OpenGL context to render into it with
+ *
+ * @param   width       The width of the window
+ * @param   height      The height of the window
+ * @param   background  The 24-bit RGB color clear() fills with
+ *
+ * @return  The created context
+ *
+ * @throws  GLException if the display has no OpenGL 3.0 for the window
+ */
+GLContext::GLContext( unsigned int width, unsigned int height, unsigned int background ):
+X11Context( width, height, background, BUFFER_SINGLE ),
+background( background )
+{
+    int major = 0;
+    int minor = 0;
+
+    if ( !glXQueryVersion( display, &major, &minor ) ||
+         ( major < 1 ) || ( ( major == 1 ) && ( minor < 3 ) ) )
+    {
+        throw GLException( "GLX 1.3 is not available." );
+    }
+
+    // the window already exists, so the configuration has to be one for
+    // its visual
+    const int attributes[] =
+    {
+        GLX_X_RENDERABLE, True,
+        GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT,
+        GLX_RENDER_TYPE, GLX_RGBA_BIT,
+        GLX_DOUBLEBUFFER, True,
+        None
+    };
+
+    int screen = DefaultScreen( display );
+    VisualID visual = XVisualIDFromVisual( DefaultVisual( display, screen ) );
+
+    int count = 0;
+    GLXFBConfig *configs = glXChooseFBConfig( display, screen, attributes, &count );
+    GLXFBConfig config = nullptr;
+
+    for ( int i = 0; i < count; i++ )
+    {
+        int id = 0;
+        glXGetFBConfigAttrib( display, configs[i], GLX_VISUAL_ID, &id );
+
+        if ( VisualID( id ) == visual )
+        {
+            config = configs[i];
+            break;
+        }
+    }
+
+    if ( configs != nullptr )
+    {
+        XFree( configs );
+    }
+
+    if ( config == nullptr )
+    {
+        throw GLException( "No double buffered configuration matches the window." );
+    }
+
+    context = glXCreateNewContext( display, config, GLX_RGBA_TYPE, nullptr, True );
+
+    if ( context == nullptr )
+    {
+        throw GLException( "Could not create a rendering context." );
+    }
+
+    surface = glXCreateWindow( display, config, window, nullptr );
+
+    if ( !glXMakeContextCurrent( display, surface, surface, context ) )
+    {
+        glXDestroyWindow( display, surface );
+        glXDestroyContext( display, context );
+        throw GLException( "Could not make the rendering context current." );
+    }
+
+    // every frame covers the whole window, so the server filling exposed
+    // parts with the background first would only flicker
+    XSetWindowBackgroundPixmap( display, window, None );
+
+    GLint version = 0;
+    glGetIntegerv( GL_MAJOR_VERSION, &version );
+
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+
+    try
+    {
+        if ( version < 3 )
+        {
+            throw GLException( "OpenGL 3.0 is not available." );
+        }
+
+        vertexShader = compile( GL_VERTEX_SHADER, VERTEX_SHADER );
+        fragmentShader = compile( GL_FRAGMENT_SHADER, FRAGMENT_SHADER );
+    }
+    catch ( const GLException & )
+    {
+        glDeleteShader( vertexShader );
+        glXMakeContextCurrent( display, None, None, nullptr );
+        glXDestroyWindow( display, surface );
+        glXDestroyContext( display, context );
+        throw;
+    }
+
+    program = glCreateProgram();
+    glAttachShader( program, vertexShader );
+    glAttachShader( program, fragmentShader );
+    glBindAttribLocation( program, POSITION_ATTRIBUTE, "position" );
+    glBindAttribLocation( program, COLOR_ATTRIBUTE, "color" );
+    glBindFragDataLocation( program, 0, "fragment" );
+    glLinkProgram( program );
+    glDeleteShader( vertexShader );
+    glDeleteShader( fragmentShader );
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv( program, GL_LINK_STATUS, &linked );
+
+    if ( linked != GL_TRUE )
+    {
+        glDeleteProgram( program );
+        glXMakeContextCurrent( display, None, None, nullptr );
+        glXDestroyWindow( display, surface );
+        glXDestroyContext( display, context );
+        throw GLException( "Could not link the line shader." );
+    }
+
+    glUseProgram( program );
+    transformXLocation = glGetUniformLocation( program, "transformX" );
+    transformYLocation = glGetUniformLocation( program, "transformY" );
+    viewportLocation = glGetUniformLocation( program, "viewport" );
+
+    glGenVertexArrays( 1, &vertexArray );
+    glBindVertexArray( vertexArray );
+    glEnableVertexAttribArray( POSITION_ATTRIBUTE );
+    glEnableVertexAttribArray( COLOR_ATTRIBUTE );
+
+    glGenBuffers( 1, &batchBuffer );
+    glGenFramebuffers( 1, &canvas );
+    glGenRenderbuffers( 1, &canvasBuffer );
+
+    glDisable( GL_DEPTH_TEST );
+    glDisable( GL_BLEND );
+    glLogicOp( GL_XOR );
+
+    layout();
+}
+
+
+/**
+ * @brief   GL context destructor, releasing the GPU resources before the
+ *          window goes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+GLContext::~GLContext()
+{
+    for ( const Chunk &chunk : chunks )
+    {
+        glDeleteBuffers( 1, &chunk.buffer );
+    }
+
+    glDeleteBuffers( 1, &batchBuffer );
+    glDeleteRenderbuffers( 1, &canvasBuffer );
+    glDeleteFramebuffers( 1, &canvas );
+    glDeleteVertexArrays( 1, &vertexArray );
+    glDeleteProgram( program );
+
+    glXMakeContextCurrent( display, None, None, nullptr );
+    glXDestroyWindow( display, surface );
+    glXDestroyContext( display, context );
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Sets the drawing mode
+ *
+ * @param   newMode     The mode to draw in
+ *
+ * @return  void
+ */
+void GLContext::setMode( drawMode newMode )
+{
+    if ( newMode == mode )
+    {
+        return;
+    }
+
+    flushBatch();
+    mode = newMode;
+    applyMode();
+}
+
+
+/**
+ * @brief   Sets the drawing color
+ *
+ * @param   color   The 24-bit RGB color to draw in
+ *
+ * @return  void
+ */
+void GLContext::setColor( unsigned int color )
+{
+    this->color = color & 0xFFFFFF;
+}
+
+
+/**
+ * @brief   Sets a pixel to the drawing color
+ *
+ * @param   x   The x-coordinate of the pixel
+ * @param   y   The y-coordinate of the pixel
+ *
+ * @return  void
+ */
+void GLContext::setPixel( int x, int y )
+{
+    submit( GL_POINTS );
+    batch.push_back( { float( x ), float( y ), color } );
+}
+
+
+/**
+ * @brief   Gets the color of a pixel of the canvas
+ *
+ * @param   x   The x-coordinate of the pixel
+ * @param   y   The y-coordinate of the pixel
+ *
+ * @return  The 24-bit RGB color of the pixel, or zero outside the canvas
+ */
+unsigned int GLContext::getPixel( int x, int y )
+{
+    uint32_t pixel = 0;
+    getPixels( x, y, 1, 1, &pixel );
+    return pixel;
+}
+
+
+/**
+ * @brief   Reads a rectangle of pixels of the canvas
+ *
+ * @param   x       The left edge of the rectangle
+ * @param   y       The top edge of the rectangle
+ * @param   width   The width of the rectangle
+ * @param   height  The height of the rectangle
+ * @param   *out    Where to write the 24-bit RGB pixels, row by row
+ *
+ * @return  void
+ */
+void GLContext::getPixels( int x, int y, int width, int height, uint32_t *out )
+{
+    if ( ( width <= 0 ) || ( height <= 0 ) )
+    {
+        return;
+    }
+
+    std::fill( out, out + size_t( width ) * height, 0 );
+    flushBatch();
+
+    int x0 = std::max( x, 0 );
+    int y0 = std::max( y, 0 );
+    int x1 = std::min( x + width, canvasWidth );
+    int y1 = std::min( y + height, canvasHeight );
+
+    if ( ( x0 >= x1 ) || ( y0 >= y1 ) )
+    {
+        return;
+    }
+
+    // rows come back bottom up, so they are read into place one at a time
+    glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+
+    for ( int row = y0; row < y1; row++ )
+    {
+        uint32_t *dst = out + size_t( row - y ) * width + ( x0 - x );
+
+        glReadPixels( x0, canvasHeight - 1 - row, x1 - x0, 1,
+                      GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, dst );
+
+        for ( int i = 0; i < x1 - x0; i++ )
+        {
+            dst[i] &= 0xFFFFFF;
+        }
+    }
+
+    FRAME_STATS_ADD( requests, y1 - y0 );
+}
+
+
+/**
+ * @brief   Draws a line in the drawing color
+ *
+ * @param   x1  The x-coordinate of the first end
+ * @param   y1  The y-coordinate of the first end
+ * @param   x2  The x-coordinate of the second end
+ * @param   y2  The y-coordinate of the second end
+ *
+ * @return  void
+ */
+void GLContext::drawLine( int x1, int y1, int x2, int y2 )
+{
+    submit( GL_LINES );
+    batch.push_back( { float( x1 ), float( y1 ), color } );
+    batch.push_back( { float( x2 ), float( y2 ), color } );
+    FRAME_STATS_ADD( segments, 1 );
+}
+
+
+/**
+ * @brief   Draws a circle in the drawing color, as a polygon fine enough
+ *          that its edges are no longer than a few pixels
+ *
+ * @param   x       The x-coordinate of the centre
+ * @param   y       The y-coordinate of the centre
+ * @param   radius  The radius
+ *
+ * @return  void
+ */
+void GLContext::drawCircle( int x, int y, int radius )
+{
+    if ( radius <= 0 )
+    {
+        setPixel( x, y );
+        return;
+    }
+
+    const double TAU = 6.283185307179586;
+    int steps = std::min( std::max( int( TAU * radius / 4 ), 16 ), 1024 );
+
+    submit( GL_LINES );
+
+    float px = float( x + radius );
+    float py = float( y );
+
+    for ( int i = 1; i <= steps; i++ )
+    {
+        double angle = TAU * i / steps;
+        float qx = float( x + radius * std::cos( angle ) );
+        float qy = float( y + radius * std::sin( angle ) );
+
+        batch.push_back( { px, py, color } );
+        batch.push_back( { qx, qy, color } );
+        px = qx;
+        py = qy;
+    }
+
+    FRAME_STATS_ADD( segments, steps );
+}
+
+
+/**
+ * @brief   Draws independent line segments in the drawing color
+ *
+ * @param   *segments   The segments to draw
+ * @param   count       The number of segments
+ *
+ * @return  void
+ */
+void GLContext::drawLines( const Segment *segments, size_t count )
+{
+    submit( GL_LINES );
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        const Segment &s = segments[i];
+        batch.push_back( { float( s.x1 ), float( s.y1 ), color } );
+        batch.push_back( { float( s.x2 ), float( s.y2 ), color } );
+    }
+
+    FRAME_STATS_ADD( segments, count );
+}
+
+
+/**
+ * @brief   Draws a connected polyline in the drawing color
+ *
+ * @param   *points     The vertices of the polyline
+ * @param   count       The number of vertices
+ *
+ * @return  void
+ */
+void GLContext::drawPolyline( const Point *points, size_t count )
+{
+    submit( GL_LINES );
+
+    for ( size_t i = 1; i < count; i++ )
+    {
+        batch.push_back( { float( points[i - 1].x ), float( points[i - 1].y ), color } );
+        batch.push_back( { float( points[i].x ), float( points[i].y ), color } );
+    }
+
+    FRAME_STATS_ADD( segments, ( count > 1 ) ? count - 1 : 0 );
+}
+
+
+/**
+ * @brief   Submits the drawing batched so far
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::flush()
+{
+    flushBatch();
+    glFlush();
+    FRAME_STATS_ADD( flushes, 1 );
+}
+
+
+/**
+ * @brief   Copies the canvas to the window with the overlay over it, if
+ *          either changed or the window lost them
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::present()
+{
+    flushBatch();
+
+    if ( !dirty && !overlay_changed && !exposed )
+    {
+        return;
+    }
+
+    int width = canvasWidth;
+    int height = canvasHeight;
+
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, canvas );
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+    glDisable( GL_SCISSOR_TEST );
+    glDisable( GL_COLOR_LOGIC_OP );
+    glBlitFramebuffer( 0, 0, width, height, 0, 0, width, height,
+                       GL_COLOR_BUFFER_BIT, GL_NEAREST );
+
+    // the overlay is drawn over the copy, never into the canvas
+    if ( !overlay.empty() )
+    {
+        for ( const OverlayLine &line : overlay )
+        {
+            const Segment &s = line.segment;
+            batch.push_back( { float( s.x1 ), float( s.y1 ), line.color } );
+            batch.push_back( { float( s.x2 ), float( s.y2 ), line.color } );
+        }
+
+        batchPrimitive = GL_LINES;
+        flushBatch();
+    }
+
+    glXSwapBuffers( display, surface );
+    FRAME_STATS_ADD( requests, 1 );
+
+    glBindFramebuffer( GL_FRAMEBUFFER, canvas );
+    applyClip();
+    applyMode();
+
+    dirty = false;
+    exposed = false;
+    overlay_changed = false;
+}
+
+
+/**
+ * @brief   Fills the canvas, or the clip rectangle when one is set, with the
+ *          background
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::clear()
+{
+    flushBatch();
+    layout();
+
+    glDisable( GL_COLOR_LOGIC_OP );
+    glClearColor( ( ( background >> 16 ) & 0xFF ) / 255.0f,
+                  ( ( background >> 8 ) & 0xFF ) / 255.0f,
+                  ( background & 0xFF ) / 255.0f, 1.0f );
+    glClear( GL_COLOR_BUFFER_BIT );
+    applyMode();
+
+    if ( !clipActive )
+    {
+        painted = true;
+    }
+
+    dirty = true;
+    FRAME_STATS_ADD( requests, 1 );
+}
+
+
+/**
+ * @brief   Restricts drawing and clearing to a rectangle
+ *
+ * @param   &rect   The rectangle to draw in
+ *
+ * @return  void
+ */
+void GLContext::setClip( const Rect &rect )
+{
+    flushBatch();
+    clipActive = true;
+    clip = rect;
+    applyClip();
+}
+
+
+/**
+ * @brief   Lifts the restriction set by setClip
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::resetClip()
+{
+    flushBatch();
+    clipActive = false;
+    applyClip();
+}
+
+
+/**
+ * @brief   Declines to scroll, since repainting the whole canvas from
+ *          retained lines costs no more than moving it
+ *
+ * @param   dx  The distance to move right
+ * @param   dy  The distance to move down
+ *
+ * @return  False, having moved nothing
+ */
+bool GLContext::scroll( int, int )
+{
+    return false;
+}
+
+
+/**
+ * @brief   Determines if this context keeps retained lines, which it does
+ *
+ * @param   void
+ *
+ * @return  True
+ */
+bool GLContext::canRetain()
+{
+    return true;
+}
+
+
+/**
+ * @brief   Appends lines to the retained lines, filling the last buffer and
+ *          adding one twice its size when it is full
+ *
+ * @param   *vertices   The ends of the lines, two per line
+ * @param   count       The number of vertices
+ *
+ * @return  void
+ */
+void GLContext::retainLines( const ModelVertex *vertices, size_t count )
+{
+    // capacities are even, so a line never straddles two buffers
+    count -= count % 2;
+
+    while ( count > 0 )
+    {
+        if ( filled == chunks.size() )
+        {
+            size_t capacity = chunks.empty() ? FIRST_CHUNK : chunks.back().capacity * 2;
+            Chunk chunk = { 0, ( capacity < MAX_CHUNK ) ? capacity : MAX_CHUNK, 0 };
+
+            glGenBuffers( 1, &chunk.buffer );
+            glBindBuffer( GL_ARRAY_BUFFER, chunk.buffer );
+            glBufferData( GL_ARRAY_BUFFER, chunk.capacity * sizeof( ModelVertex ),
+                          nullptr, GL_STATIC_DRAW );
+            chunks.push_back( chunk );
+        }
+
+        Chunk &chunk = chunks[filled];
+        size_t n = std::min( count, chunk.capacity - chunk.count );
+
+        glBindBuffer( GL_ARRAY_BUFFER, chunk.buffer );
+        glBufferSubData( GL_ARRAY_BUFFER, chunk.count * sizeof( ModelVertex ),
+                         n * sizeof( ModelVertex ), vertices );
+        FRAME_STATS_ADD( requests, 1 );
+
+        chunk.count += n;
+        vertices += n;
+        count -= n;
+
+        if ( chunk.count == chunk.capacity )
+        {
+            filled++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Forgets every retained line, keeping the buffers to refill
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::releaseLines()
+{
+    for ( Chunk &chunk : chunks )
+    {
+        chunk.count = 0;
+    }
+
+    filled = 0;
+}
+
+
+/**
+ * @brief   Draws every retained line in the drawing mode and clip
+ *
+ * @param   *transform  The model to device transform, the top two rows of a
+ *                      3x3 matrix, row by row
+ *
+ * @return  void
+ */
+void GLContext::drawRetained( const double *transform )
+{
+    flushBatch();
+    setTransform( transform );
+
+    for ( const Chunk &chunk : chunks )
+    {
+        if ( chunk.count == 0 )
+        {
+            break;
+        }
+
+        drawVertices( chunk.buffer, GL_LINES, chunk.count );
+        FRAME_STATS_ADD( segments, chunk.count / 2 );
+    }
+}
+
+
+/* --------------------------- Protected Functions -------------------------- */
+
+
+/**
+ * @brief   Shows a damaged part of the window again from the canvas
+ *
+ * @param   &region     The damaged part of the window
+ *
+ * @return  True if the canvas holds a frame to show, false if the drawing
+ *          has to paint one
+ */
+bool GLContext::repair( const Rect & )
+{
+    if ( !painted || ( canvasWidth != getWindowWidth() ) ||
+         ( canvasHeight != getWindowHeight() ) )
+    {
+        return false;
+    }
+
+    exposed = true;
+    return true;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Resizes the canvas to the window, losing what it held if the size
+ *          changed
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::layout()
+{
+    int width = std::max( getWindowWidth(), 1 );
+    int height = std::max( getWindowHeight(), 1 );
+
+    if ( ( width == canvasWidth ) && ( height == canvasHeight ) )
+    {
+        return;
+    }
+
+    canvasWidth = width;
+    canvasHeight = height;
+    painted = false;
+
+    glBindRenderbuffer( GL_RENDERBUFFER, canvasBuffer );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+    glBindFramebuffer( GL_FRAMEBUFFER, canvas );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER, canvasBuffer );
+
+    glViewport( 0, 0, width, height );
+    glUniform2f( viewportLocation, float( width ), float( height ) );
+    applyClip();
+}
+
+
+/**
+ * @brief   Readies the batch for vertices of a primitive, drawing what it
+ *          holds first if that is another primitive or it is full
+ *
+ * @param   primitive   The primitive about to be batched
+ *
+ * @return  void
+ */
+void GLContext::submit( GLenum primitive )
+{
+    if ( ( primitive != batchPrimitive ) || ( batch.size() >= MAX_BATCH ) )
+    {
+        flushBatch();
+        batchPrimitive = primitive;
+    }
+
+    dirty = true;
+}
+
+
+/**
+ * @brief   Draws the batch in device space and empties it
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::flushBatch()
+{
+    if ( batch.empty() )
+    {
+        return;
+    }
+
+    // orphaning the buffer lets the driver keep drawing the last batch
+    glBindBuffer( GL_ARRAY_BUFFER, batchBuffer );
+    glBufferData( GL_ARRAY_BUFFER, batch.size() * sizeof( ModelVertex ),
+                  batch.data(), GL_STREAM_DRAW );
+
+    setTransform( IDENTITY );
+    drawVertices( batchBuffer, batchPrimitive, batch.size() );
+    batch.clear();
+}
+
+
+/**
+ * @brief   Draws vertices from a buffer with the line shader
+ *
+ * @param   buffer      The buffer holding the vertices
+ * @param   primitive   The primitive the vertices make
+ * @param   count       The number of vertices
+ *
+ * @return  void
+ */
+void GLContext::drawVertices( GLuint buffer, GLenum primitive, size_t count )
+{
+    glBindBuffer( GL_ARRAY_BUFFER, buffer );
+    glVertexAttribPointer( POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, sizeof( ModelVertex ),
+                           reinterpret_cast<const void*>( offsetof( ModelVertex, x ) ) );
+    glVertexAttribIPointer( COLOR_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof( ModelVertex ),
+                            reinterpret_cast<const void*>( offsetof( ModelVertex, color ) ) );
+    glDrawArrays( primitive, 0, GLsizei( count ) );
+
+    dirty = true;
+    FRAME_STATS_ADD( requests, 1 );
+}
+
+
+/**
+ * @brief   Sets the transform the line shader applies to positions
+ *
+ * @param   *transform  The transform, the top two rows of a 3x3 matrix, row
+ *                      by row
+ *
+ * @return  void
+ */
+void GLContext::setTransform( const double *transform )
+{
+    glUniform3f( transformXLocation, float( transform[0] ), float( transform[1] ),
+                 float( transform[2] ) );
+    glUniform3f( transformYLocation, float( transform[3] ), float( transform[4] ),
+                 float( transform[5] ) );
+}
+
+
+/**
+ * @brief   Applies the clip rectangle as the scissor box, which counts rows
+ *          from the bottom of the canvas
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::applyClip()
+{
+    if ( !clipActive )
+    {
+        glDisable( GL_SCISSOR_TEST );
+        return;
+    }
+
+    glEnable( GL_SCISSOR_TEST );
+    glScissor( clip.x, canvasHeight - ( clip.y + clip.height ),
+               std::max( clip.width, 0 ), std::max( clip.height, 0 ) );
+}
+
+
+/**
+ * @brief   Applies the drawing mode, XOR being a logic op on the canvas
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void GLContext::applyMode()
+{
+    if ( mode == MODE_XOR )
+    {
+        glEnable( GL_COLOR_LOGIC_OP );
+    }
+    else
+    {
+        glDisable( GL_COLOR_LOGIC_OP );
+    }
+}
+
+
+/**
+ * @brief   Compiles a shader
+ *
+ * @param   type        The kind of shader
+ * @param   *source     The shader's GLSL source
+ *
+ * @return  The compiled shader
+ *
+ * @throws  GLException if the shader does not compile
+ */
+GLuint GLContext::compile( GLenum type, const char *source )
+{
+    GLuint shader = glCreateShader( type );
+    glShaderSource( shader, 1, &source, nullptr );
+    glCompileShader( shader );
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+
+    if ( compiled != GL_TRUE )
+    {
+        char log[512] = "";
+        glGetShaderInfoLog( shader, sizeof( log ), nullptr, log );
+        glDeleteShader( shader );
+        throw GLException( std::string( "Could not compile a shader: " ) + log );
+    }
+
+    return shader;
+}
+
+
+# endif // HAVE_OPENGL
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,200 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    glcontext.h
+ * @brief   Graphics context that renders with OpenGL into an X11 window
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_GLCONTEXT_H
+# define GRAPHICS_CONTEXT_GLCONTEXT_H
+
+
+# ifdef HAVE_OPENGL
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include <GL/gl.h>
+# include <GL/glx.h>
+
+# include "gcontext.h"
+# include "x11context.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class GLException : public std::runtime_error
+{
+public:
+    explicit GLException( const std::string& msg ):
+    std::runtime_error( ( std::string( "GL Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/*
+ * Renders with OpenGL 3.0 through GLX into the window an X11 context opens,
+ * taking over its drawing while keeping its event loop.
+ *
+ * The canvas is a renderbuffer the size of the window, so it holds the last
+ * frame for exposures and reads the way a back buffer does, and present()
+ * copies it to the window with the overlay drawn over the copy. Immediate
+ * drawing is batched per primitive and color changes are free, since every
+ * vertex carries its color.
+ *
+ * Retained lines stay in GPU memory in buffers that double in size as they
+ * fill, so appending never copies what was kept before, and drawing all of
+ * them is one draw call per buffer with the view transform applied by the
+ * vertex shader. A change of view therefore costs no work on the CPU for
+ * any shape.
+ */
+class GLContext : public X11Context
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    GLContext( unsigned int width, unsigned int height, unsigned int background );
+    ~GLContext() override;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void setMode( drawMode newMode ) override;
+    void setColor( unsigned int color ) override;
+    void setPixel( int x, int y ) override;
+    unsigned int getPixel( int x, int y ) override;
+    void getPixels( int x, int y, int width, int height, uint32_t *out ) override;
+
+    void drawLine( int x1, int y1, int x2, int y2 ) override;
+    void drawCircle( int x, int y, int radius ) override;
+    void drawLines( const Segment *segments, size_t count ) override;
+    void drawPolyline( const Point *points, size_t count ) override;
+
+    void flush() override;
+    void present() override;
+    void clear() override;
+    void setClip( const Rect &rect ) override;
+    void resetClip() override;
+    bool scroll( int dx, int dy ) override;
+
+    bool canRetain() override;
+    void retainLines( const ModelVertex *vertices, size_t count ) override;
+    void releaseLines() override;
+    void drawRetained( const double *transform ) override;
+
+
+    /* ============================== PROTECTED ============================= */
+
+protected:
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool repair( const Rect &region ) override;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the size of the first retained line buffer, and the most any grows
+    // to, in vertices
+    constexpr static const size_t FIRST_CHUNK = 1 << 16;
+    constexpr static const size_t MAX_CHUNK = 1 << 22;
+
+    // the immediate batch is drawn once it holds this many vertices
+    constexpr static const size_t MAX_BATCH = 1 << 16;
+
+    // a buffer of retained lines, filled from the start
+    struct Chunk
+    {
+        GLuint buffer;
+        size_t capacity;
+        size_t count;
+    };
+
+    GLXContext context = nullptr;
+    GLXWindow surface = 0;
+
+    GLuint program = 0;
+    GLint transformXLocation = -1;
+    GLint transformYLocation = -1;
+    GLint viewportLocation = -1;
+    GLuint vertexArray = 0;
+
+    // the canvas, and its size in pixels
+    GLuint canvas = 0;
+    GLuint canvasBuffer = 0;
+    int canvasWidth = 0;
+    int canvasHeight = 0;
+
+    unsigned int background;
+    unsigned int color = WHITE;
+    drawMode mode = MODE_NORMAL;
+
+    bool clipActive = false;
+    Rect clip = { 0, 0, 0, 0 };
+
+    // drawing not yet submitted, all of one primitive, in device space
+    GLenum batchPrimitive = GL_LINES;
+    std::vector<ModelVertex> batch;
+    GLuint batchBuffer = 0;
+
+    std::vector<Chunk> chunks;
+
+    // the chunk being filled; those before it are full
+    size_t filled = 0;
+
+    bool dirty = false;     // drawn to since the last present
+    bool painted = false;   // the canvas holds a frame started by clear
+    bool exposed = false;   // the window lost what was last presented
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void layout();
+    void submit( GLenum primitive );
+    void flushBatch();
+    void drawVertices( GLuint buffer, GLenum primitive, size_t count );
+    void setTransform( const double *transform );
+    void applyClip();
+    void applyMode();
+
+    static GLuint compile( GLenum type, const char *source );
+
+
+    /* ====================================================================== */
+};
+
+
+# endif // HAVE_OPENGL
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_GLCONTEXT_H
+
+
+/* -------------------------------------------------------------------------- */
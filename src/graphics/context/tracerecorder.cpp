@@ -0,0 +1,332 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    tracerecorder.cpp
+ * @brief   Drawing decorator that records its input events to a trace file
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstring>
+
+# include "tracerecorder.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+static const char MAGIC[8] = { 'S', 'H', 'A', 'P', 'E', 'T', 'R', 'C' };
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a trace recorder, starting a new trace file
+ *
+ * @param   *drawing    The drawing to forward events to
+ * @param   *gc         The graphics context the drawing will run in, whose
+ *                      window size starts the trace
+ * @param   &fileName   The name of the trace file, replaced if it exists
+ *
+ * @return  The created trace recorder
+ */
+TraceRecorder::TraceRecorder( DrawingBase *drawing, GraphicsContext *gc, const std::string &fileName ):
+drawing( drawing ), trace( fileName.c_str(), std::ios::binary | std::ios::trunc ),
+last( std::chrono::steady_clock::now() )
+{
+    FileHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+    header.version = VERSION;
+    header.width = gc->getWindowWidth();
+    header.height = gc->getWindowHeight();
+
+    trace.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+
+    if ( !trace )
+    {
+        throw TraceException( "Could not write " + fileName + "." );
+    }
+}
+
+
+/**
+ * @brief   Trace recorder destructor, flushing the trace
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+TraceRecorder::~TraceRecorder() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Records and forwards a full repaint
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void TraceRecorder::paint( GraphicsContext *gc )
+{
+    record( EVENT_PAINT );
+    drawing->paint( gc );
+}
+
+
+/**
+ * @brief   Records and forwards a repaint of a damaged region
+ *
+ * @param   *gc         The graphics context to draw to
+ * @param   &region     The damaged region
+ *
+ * @return  void
+ */
+void TraceRecorder::paint( GraphicsContext *gc, const GraphicsContext::Rect &region )
+{
+    record( EVENT_PAINT_REGION );
+    integer( region.x );
+    integer( region.y );
+    integer( region.width );
+    integer( region.height );
+    drawing->paint( gc, region );
+}
+
+
+/**
+ * @brief   Records and forwards a key press
+ *
+ * @param   *gc         The graphics context the key was pressed in
+ * @param   keycode     The key pressed
+ *
+ * @return  void
+ */
+void TraceRecorder::keyDown( GraphicsContext *gc, unsigned int keycode )
+{
+    record( EVENT_KEY_DOWN );
+    number( keycode );
+    drawing->keyDown( gc, keycode );
+}
+
+
+/**
+ * @brief   Records and forwards a key release
+ *
+ * @param   *gc         The graphics context the key was released in
+ * @param   keycode     The key released
+ *
+ * @return  void
+ */
+void TraceRecorder::keyUp( GraphicsContext *gc, unsigned int keycode )
+{
+    record( EVENT_KEY_UP );
+    number( keycode );
+    drawing->keyUp( gc, keycode );
+}
+
+
+/**
+ * @brief   Records and forwards a mouse button press
+ *
+ * @param   *gc         The graphics context the button was pressed in
+ * @param   button      The button pressed
+ * @param   x           The x-coordinate of the pointer
+ * @param   y           The y-coordinate of the pointer
+ *
+ * @return  void
+ */
+void TraceRecorder::mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y )
+{
+    record( EVENT_BUTTON_DOWN );
+    number( button );
+    integer( x );
+    integer( y );
+    drawing->mouseButtonDown( gc, button, x, y );
+}
+
+
+/**
+ * @brief   Records and forwards a mouse button release
+ *
+ * @param   *gc         The graphics context the button was released in
+ * @param   button      The button released
+ * @param   x           The x-coordinate of the pointer
+ * @param   y           The y-coordinate of the pointer
+ *
+ * @return  void
+ */
+void TraceRecorder::mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y )
+{
+    record( EVENT_BUTTON_UP );
+    number( button );
+    integer( x );
+    integer( y );
+    drawing->mouseButtonUp( gc, button, x, y );
+}
+
+
+/**
+ * @brief   Records and forwards a pointer move
+ *
+ * @param   *gc     The graphics context the pointer moved in
+ * @param   x       The x-coordinate of the pointer
+ * @param   y       The y-coordinate of the pointer
+ *
+ * @return  void
+ */
+void TraceRecorder::mouseMove( GraphicsContext *gc, int x, int y )
+{
+    record( EVENT_MOUSE_MOVE );
+    integer( x );
+    integer( y );
+    drawing->mouseMove( gc, x, y );
+}
+
+
+/**
+ * @brief   Records and forwards a change of window size
+ *
+ * @param   *gc         The graphics context that changed size
+ * @param   width       The new width
+ * @param   height      The new height
+ *
+ * @return  void
+ */
+void TraceRecorder::resize( GraphicsContext *gc, int width, int height )
+{
+    record( EVENT_RESIZE );
+    integer( width );
+    integer( height );
+    drawing->resize( gc, width, height );
+}
+
+
+/**
+ * @brief   Forwards an idle call, which the drawing reports the work of
+ *
+ * @param   *gc     The graphics context that was woken
+ *
+ * @return  void
+ */
+void TraceRecorder::idle( GraphicsContext *gc )
+{
+    drawing->idle( gc );
+}
+
+
+/**
+ * @brief   Records a line the drawing read from the console
+ *
+ * @param   &line   The line that was read
+ *
+ * @return  void
+ */
+void TraceRecorder::recordCommand( const std::string &line )
+{
+    record( EVENT_COMMAND );
+    number( line.size() );
+    trace.write( line.data(), line.size() );
+}
+
+
+/**
+ * @brief   Records the drawing finishing a background file operation
+ *
+ * @param   type    The kind of operation that finished
+ *
+ * @return  void
+ */
+void TraceRecorder::recordFinish( FileWorker::JobType type )
+{
+    record( EVENT_FINISH );
+    number( type );
+}
+
+
+/**
+ * @brief   Determines if a block of memory starts with a trace header
+ *
+ * @param   *data   The memory to check
+ * @param   size    The size of the memory in bytes
+ *
+ * @return  True if the memory holds a trace of this version, false otherwise
+ */
+bool TraceRecorder::isTrace( const void *data, size_t size )
+{
+    if ( size < sizeof( FileHeader ) )
+    {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy( &header, data, sizeof( header ) );
+
+    return ( std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) == 0 ) &&
+           ( header.version == VERSION );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Starts a record with its event type and the time since the last
+ *          event
+ *
+ * @param   type    The event type
+ *
+ * @return  void
+ */
+void TraceRecorder::record( EventType type )
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>( now - last );
+    last = now;
+
+    trace.put( char( type ) );
+    number( uint64_t( elapsed.count() ) );
+}
+
+
+/**
+ * @brief   Writes an unsigned integer seven bits at a time, least
+ *          significant first, with the top bit set on all but the last byte
+ *
+ * @param   value   The integer to write
+ *
+ * @return  void
+ */
+void TraceRecorder::number( uint64_t value )
+{
+    while ( value >= 0x80 )
+    {
+        trace.put( char( ( value & 0x7F ) | 0x80 ) );
+        value >>= 7;
+    }
+
+    trace.put( char( value ) );
+}
+
+
+/**
+ * @brief   Writes a signed integer zigzag-encoded, so small magnitudes of
+ *          either sign stay short
+ *
+ * @param   value   The integer to write
+ *
+ * @return  void
+ */
+void TraceRecorder::integer( int64_t value )
+{
+    number( ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 ) );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,166 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    tracerecorder.h
+ * @brief   Drawing decorator that records its input events to a trace file
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_TRACERECORDER_H
+# define GRAPHICS_CONTEXT_TRACERECORDER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <chrono>
+# include <cstddef>
+# include <cstdint>
+# include <fstream>
+# include <stdexcept>
+# include <string>
+
+# include "drawbase.h"
+# include "fileworker.h"
+# include "gcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class TraceException : public std::runtime_error
+{
+public:
+    explicit TraceException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Trace Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/*
+ * Sits between a graphics context's event loop and the drawing it runs,
+ * forwarding every call and logging it with the time it arrived, so a live
+ * session can be replayed later with TraceReplay.
+ *
+ * A trace is a header holding the window size when recording started,
+ * followed by one record per call: the event type as a byte, then the
+ * microseconds since the previous event and the event's arguments as
+ * variable-length integers, signed ones zigzag-encoded. A pointer move
+ * usually takes five to seven bytes.
+ *
+ * Idle calls are not recorded themselves, only what they handle: the drawing
+ * reports every line typed at the console, which is stored as its length
+ * and bytes, and every background file operation it finishes. A replay
+ * waits at each finish for its own file operation, so the drawing is in the
+ * same state for the events that follow as it was when they were recorded.
+ * A drawing opened before recording started has to be opened before the
+ * replay starts too.
+ */
+class TraceRecorder : public DrawingBase
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    constexpr static const uint32_t VERSION = 2;
+
+    enum EventType : uint8_t
+    {
+        EVENT_PAINT = 1,
+        EVENT_PAINT_REGION,
+        EVENT_KEY_DOWN,
+        EVENT_KEY_UP,
+        EVENT_BUTTON_DOWN,
+        EVENT_BUTTON_UP,
+        EVENT_MOUSE_MOVE,
+        EVENT_RESIZE,
+        EVENT_COMMAND,
+        EVENT_FINISH
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        int32_t width;
+        int32_t height;
+        uint32_t reserved;
+    };
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    TraceRecorder( DrawingBase *drawing, GraphicsContext *gc, const std::string &fileName );
+    TraceRecorder( const TraceRecorder &recorder ) = delete;
+
+    ~TraceRecorder() override;
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    TraceRecorder &operator=( const TraceRecorder &recorder ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void paint( GraphicsContext *gc ) override;
+    void paint( GraphicsContext *gc, const GraphicsContext::Rect &region ) override;
+
+    void keyDown( GraphicsContext *gc, unsigned int keycode ) override;
+    void keyUp( GraphicsContext *gc, unsigned int keycode ) override;
+
+    void mouseButtonDown( GraphicsContext *gc, unsigned int button, int x, int y ) override;
+    void mouseButtonUp( GraphicsContext *gc, unsigned int button, int x, int y ) override;
+    void mouseMove( GraphicsContext *gc, int x, int y ) override;
+
+    void resize( GraphicsContext *gc, int width, int height ) override;
+    void idle( GraphicsContext *gc ) override;
+
+    void recordCommand( const std::string &line );
+    void recordFinish( FileWorker::JobType type );
+
+    static bool isTrace( const void *data, size_t size );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    DrawingBase *drawing;
+    std::ofstream trace;
+
+    std::chrono::steady_clock::time_point last;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void record( EventType type );
+    void number( uint64_t value );
+    void integer( int64_t value );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_TRACERECORDER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,339 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    tracereplay.cpp
+ * @brief   Feeds a recorded trace of input events back into a drawing
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <chrono>
+# include <cstring>
+# include <thread>
+
+# include "mappedfile.h"
+# include "tracereplay.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Reads a trace file
+ *
+ * @param   &fileName   The name of the trace file
+ *
+ * @return  The trace, ready to replay
+ */
+TraceReplay::TraceReplay( const std::string &fileName )
+{
+    MappedFile file( fileName );
+
+    if ( !TraceRecorder::isTrace( file.data(), file.size() ) )
+    {
+        throw TraceException( fileName + " is not a trace." );
+    }
+
+    TraceRecorder::FileHeader header;
+    std::memcpy( &header, file.data(), sizeof( header ) );
+    width = header.width;
+    height = header.height;
+
+    const unsigned char *p = file.data() + sizeof( header );
+    const unsigned char *end = file.data() + file.size();
+    uint64_t time = 0;
+
+    while ( p < end )
+    {
+        Event event = {};
+        event.type = TraceRecorder::EventType( *p++ );
+
+        uint64_t elapsed;
+
+        if ( !number( p, end, elapsed ) )
+        {
+            return;
+        }
+
+        time += elapsed;
+        event.time = time;
+
+        // the number of arguments each event type was recorded with
+        int count;
+
+        switch ( event.type )
+        {
+        case TraceRecorder::EVENT_PAINT:
+        case TraceRecorder::EVENT_COMMAND:
+            count = 0;
+            break;
+
+        case TraceRecorder::EVENT_KEY_DOWN:
+        case TraceRecorder::EVENT_KEY_UP:
+        case TraceRecorder::EVENT_FINISH:
+            count = 1;
+            break;
+
+        case TraceRecorder::EVENT_MOUSE_MOVE:
+        case TraceRecorder::EVENT_RESIZE:
+            count = 2;
+            break;
+
+        case TraceRecorder::EVENT_BUTTON_DOWN:
+        case TraceRecorder::EVENT_BUTTON_UP:
+            count = 3;
+            break;
+
+        case TraceRecorder::EVENT_PAINT_REGION:
+            count = 4;
+            break;
+
+        default:
+            throw TraceException( fileName + " has an unknown event." );
+        }
+
+        bool whole = true;
+
+        for ( int i = 0; ( i < count ) && whole; i++ )
+        {
+            // key codes, buttons and job types are unsigned, everything
+            // else signed
+            bool isUnsigned = ( i == 0 ) &&
+                              ( ( event.type == TraceRecorder::EVENT_KEY_DOWN ) ||
+                                ( event.type == TraceRecorder::EVENT_KEY_UP ) ||
+                                ( event.type == TraceRecorder::EVENT_BUTTON_DOWN ) ||
+                                ( event.type == TraceRecorder::EVENT_BUTTON_UP ) ||
+                                ( event.type == TraceRecorder::EVENT_FINISH ) );
+
+            if ( isUnsigned )
+            {
+                uint64_t value;
+                whole = number( p, end, value );
+                event.args[i] = int( value );
+            }
+            else
+            {
+                whole = integer( p, end, event.args[i] );
+            }
+        }
+
+        // a command's line follows it as a length and the bytes
+        if ( event.type == TraceRecorder::EVENT_COMMAND )
+        {
+            uint64_t length;
+            whole = number( p, end, length ) && ( length <= uint64_t( end - p ) );
+
+            if ( whole )
+            {
+                event.line.assign( reinterpret_cast<const char*>( p ), length );
+                p += length;
+            }
+        }
+
+        if ( !whole )
+        {
+            return;
+        }
+
+        events.push_back( event );
+    }
+}
+
+
+/**
+ * @brief   Trace replay destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+TraceReplay::~TraceReplay() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the recorded events
+ *
+ * @param   void
+ *
+ * @return  The events in the order they were recorded
+ */
+const std::vector<TraceReplay::Event> &TraceReplay::getEvents() const
+{
+    return events;
+}
+
+
+/**
+ * @brief   Gets the width of the window when recording started
+ *
+ * @param   void
+ *
+ * @return  The width in pixels
+ */
+int TraceReplay::getWidth() const
+{
+    return width;
+}
+
+
+/**
+ * @brief   Gets the height of the window when recording started
+ *
+ * @param   void
+ *
+ * @return  The height in pixels
+ */
+int TraceReplay::getHeight() const
+{
+    return height;
+}
+
+
+/**
+ * @brief   Replays every event into a drawing
+ *
+ * @param   *gc         The graphics context to pass to the drawing
+ * @param   *drawing    The drawing to replay into
+ * @param   realTime    True to wait until each event's recorded time, false
+ *                      to replay as fast as possible
+ *
+ * @return  void
+ */
+void TraceReplay::replay( GraphicsContext *gc, DrawContext *drawing, bool realTime ) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for ( const Event &event : events )
+    {
+        if ( realTime )
+        {
+            std::this_thread::sleep_until( start + std::chrono::microseconds( event.time ) );
+        }
+
+        deliver( event, gc, drawing );
+    }
+}
+
+
+/**
+ * @brief   Makes the call an event recorded
+ *
+ * @param   &event      The event
+ * @param   *gc         The graphics context to pass to the drawing
+ * @param   *drawing    The drawing to call
+ *
+ * @return  void
+ */
+void TraceReplay::deliver( const Event &event, GraphicsContext *gc, DrawContext *drawing )
+{
+    const int *a = event.args;
+
+    switch ( event.type )
+    {
+    case TraceRecorder::EVENT_PAINT:
+        drawing->paint( gc );
+        break;
+
+    case TraceRecorder::EVENT_PAINT_REGION:
+    {
+        GraphicsContext::Rect region = { a[0], a[1], a[2], a[3] };
+        drawing->paint( gc, region );
+        break;
+    }
+
+    case TraceRecorder::EVENT_KEY_DOWN:
+        drawing->keyDown( gc, unsigned( a[0] ) );
+        break;
+
+    case TraceRecorder::EVENT_KEY_UP:
+        drawing->keyUp( gc, unsigned( a[0] ) );
+        break;
+
+    case TraceRecorder::EVENT_BUTTON_DOWN:
+        drawing->mouseButtonDown( gc, unsigned( a[0] ), a[1], a[2] );
+        break;
+
+    case TraceRecorder::EVENT_BUTTON_UP:
+        drawing->mouseButtonUp( gc, unsigned( a[0] ), a[1], a[2] );
+        break;
+
+    case TraceRecorder::EVENT_MOUSE_MOVE:
+        drawing->mouseMove( gc, a[0], a[1] );
+        break;
+
+    case TraceRecorder::EVENT_RESIZE:
+        drawing->resize( gc, a[0], a[1] );
+        break;
+
+    case TraceRecorder::EVENT_COMMAND:
+        drawing->command( gc, event.line );
+        break;
+
+    case TraceRecorder::EVENT_FINISH:
+        drawing->finish( gc );
+        break;
+    }
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Reads an unsigned integer written seven bits at a time
+ *
+ * @param   *&p     The position to read from, moved past the integer
+ * @param   *end    The end of the trace
+ * @param   &value  Replaced by the integer
+ *
+ * @return  True if the integer was whole, false if the trace ended first
+ */
+bool TraceReplay::number( const unsigned char *&p, const unsigned char *end, uint64_t &value )
+{
+    value = 0;
+
+    for ( int shift = 0; ( p < end ) && ( shift < 64 ); shift += 7 )
+    {
+        unsigned char byte = *p++;
+        value |= uint64_t( byte & 0x7F ) << shift;
+
+        if ( ( byte & 0x80 ) == 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Reads a zigzag-encoded signed integer
+ *
+ * @param   *&p     The position to read from, moved past the integer
+ * @param   *end    The end of the trace
+ * @param   &value  Replaced by the integer
+ *
+ * @return  True if the integer was whole, false if the trace ended first
+ */
+bool TraceReplay::integer( const unsigned char *&p, const unsigned char *end, int &value )
+{
+    uint64_t zigzag;
+
+    if ( !number( p, end, zigzag ) )
+    {
+        return false;
+    }
+
+    value = int( int64_t( zigzag >> 1 ) ^ -int64_t( zigzag & 1 ) );
+    return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
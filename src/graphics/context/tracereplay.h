@@ -0,0 +1,116 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    tracereplay.h
+ * @brief   Feeds a recorded trace of input events back into a drawing
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_CONTEXT_TRACEREPLAY_H
+# define GRAPHICS_CONTEXT_TRACEREPLAY_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <cstdint>
+# include <string>
+# include <vector>
+
+# include "drawcontext.h"
+# include "gcontext.h"
+# include "tracerecorder.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Reads a whole trace written by TraceRecorder up front, so decoding costs
+ * nothing while it is replayed. A replay calls the drawing exactly as the
+ * recorded session's event loop did, in the same order and with the same
+ * arguments, either keeping the recorded pacing or as fast as the drawing
+ * can keep up. Console lines are handed to the drawing as commands, and
+ * every finished file operation makes the replay wait for the drawing's
+ * own.
+ *
+ * A trace cut short by a crash replays up to its last whole event.
+ */
+class TraceReplay
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    struct Event
+    {
+        TraceRecorder::EventType type;
+
+        // microseconds from the start of the recording
+        uint64_t time;
+
+        // the call's arguments in order, unused ones zero
+        int args[4];
+
+        // the line of a command
+        std::string line;
+    };
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit TraceReplay( const std::string &fileName );
+    ~TraceReplay();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    const std::vector<Event> &getEvents() const;
+    int getWidth() const;
+    int getHeight() const;
+
+    void replay( GraphicsContext *gc, DrawContext *drawing, bool realTime ) const;
+
+    static void deliver( const Event &event, GraphicsContext *gc, DrawContext *drawing );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::vector<Event> events;
+    int width = 0;
+    int height = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool number( const unsigned char *&p, const unsigned char *end, uint64_t &value );
+    static bool integer( const unsigned char *&p, const unsigned char *end, int &value );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_CONTEXT_TRACEREPLAY_H
+
+
+/* -------------------------------------------------------------------------- */
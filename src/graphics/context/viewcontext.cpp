@@ -10,11 +10,26 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <atomic>
 # include <cmath>
 
+# if defined( __AVX__ )
+# include <immintrin.h>
+# elif defined( __SSE2__ )
+# include <emmintrin.h>
+# endif
+
+# include "framestats.h"
 # include "viewcontext.h"
 
 
+/* ------------------------------- Constants -------------------------------- */
+
+
+// the last transform version handed out, by any view context
+static std::atomic<unsigned long> lastVersion( 0 );
+
+
 /* ----------------------- Constructors / Destructors ----------------------- */
 
 
@@ -55,7 +70,8 @@ ViewContext::~ViewContext() = default;
  */
 Point2D ViewContext::modelToDevice( const Point2D &p )
 {
-    return Point2D( transform * p );
+    return Point2D( transform.transformX( p.getX(), p.getY() ),
+                    transform.transformY( p.getX(), p.getY() ) );
 }
 
 
@@ -69,7 +85,225 @@ Point2D ViewContext::modelToDevice( const Point2D &p )
  */
 Point2D ViewContext::deviceToModel( const Point2D &p )
 {
-    return Point2D( invTransform * p );
+    return Point2D( invTransform.transformX( p.getX(), p.getY() ),
+                    invTransform.transformY( p.getX(), p.getY() ) );
+}
+
+
+/**
+ * @brief   Transforms model coordinates to device coordinates without
+ *          constructing any intermediate points
+ *
+ * @param   x       The model x-coordinate
+ * @param   y       The model y-coordinate
+ * @param   &dx     The device x-coordinate
+ * @param   &dy     The device y-coordinate
+ *
+ * @return  void
+ */
+void ViewContext::modelToDevice( double x, double y, double &dx, double &dy ) const
+{
+    dx = transform.transformX( x, y );
+    dy = transform.transformY( x, y );
+}
+
+
+/**
+ * @brief   Transforms device coordinates to model coordinates without
+ *          constructing any intermediate points
+ *
+ * @param   x       The device x-coordinate
+ * @param   y       The device y-coordinate
+ * @param   &mx     The model x-coordinate
+ * @param   &my     The model y-coordinate
+ *
+ * @return  void
+ */
+void ViewContext::deviceToModel( double x, double y, double &mx, double &my ) const
+{
+    mx = invTransform.transformX( x, y );
+    my = invTransform.transformY( x, y );
+}
+
+
+/**
+ * @brief   Transforms a batch of model coordinates to integer device
+ *          coordinates, rounding down so that a translation by whole pixels
+ *          moves every coordinate by exactly that many
+ *
+ * @param   *xs     The model x-coordinates
+ * @param   *ys     The model y-coordinates
+ * @param   *outX   The device x-coordinates
+ * @param   *outY   The device y-coordinates
+ * @param   n       The number of coordinates to transform
+ *
+ * @return  void
+ */
+void ViewContext::modelToDevice( const double *xs, const double *ys,
+                                 int *outX, int *outY, size_t n ) const
+{
+    FRAME_STATS_TIME( transformTime );
+    FRAME_STATS_ADD( vertices, n );
+
+    transformToDevice( xs, ys, outX, outY, n );
+}
+
+
+/**
+ * @brief   Transforms a batch of model coordinates to integer device
+ *          coordinates like modelToDevice, but without counting them in the
+ *          frame stats, which only the painting thread may touch, so it can
+ *          be called from any thread
+ *
+ * @param   *xs     The model x-coordinates
+ * @param   *ys     The model y-coordinates
+ * @param   *outX   The device x-coordinates
+ * @param   *outY   The device y-coordinates
+ * @param   n       The number of coordinates to transform
+ *
+ * @return  void
+ */
+void ViewContext::transformToDevice( const double *xs, const double *ys,
+                                     int *outX, int *outY, size_t n ) const
+{
+    size_t i = 0;
+
+# if defined( __AVX__ )
+    // four points per iteration
+    const __m256d a00 = _mm256_set1_pd( transform.get( 0, 0 ) );
+    const __m256d a01 = _mm256_set1_pd( transform.get( 0, 1 ) );
+    const __m256d a02 = _mm256_set1_pd( transform.get( 0, 2 ) );
+    const __m256d a10 = _mm256_set1_pd( transform.get( 1, 0 ) );
+    const __m256d a11 = _mm256_set1_pd( transform.get( 1, 1 ) );
+    const __m256d a12 = _mm256_set1_pd( transform.get( 1, 2 ) );
+
+    for ( ; i + 4 <= n; i += 4 )
+    {
+        __m256d x = _mm256_loadu_pd( xs + i );
+        __m256d y = _mm256_loadu_pd( ys + i );
+
+        __m256d dx = _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( a00, x ), _mm256_mul_pd( a01, y ) ), a02 );
+        __m256d dy = _mm256_add_pd( _mm256_add_pd( _mm256_mul_pd( a10, x ), _mm256_mul_pd( a11, y ) ), a12 );
+
+        _mm_storeu_si128( ( __m128i * ) ( outX + i ), _mm256_cvttpd_epi32( _mm256_floor_pd( dx ) ) );
+        _mm_storeu_si128( ( __m128i * ) ( outY + i ), _mm256_cvttpd_epi32( _mm256_floor_pd( dy ) ) );
+    }
+# elif defined( __SSE2__ )
+    // two points per iteration, rounding down by taking one off wherever
+    // truncation rounded up
+    const __m128d one = _mm_set1_pd( 1 );
+    const __m128d a00 = _mm_set1_pd( transform.get( 0, 0 ) );
+    const __m128d a01 = _mm_set1_pd( transform.get( 0, 1 ) );
+    const __m128d a02 = _mm_set1_pd( transform.get( 0, 2 ) );
+    const __m128d a10 = _mm_set1_pd( transform.get( 1, 0 ) );
+    const __m128d a11 = _mm_set1_pd( transform.get( 1, 1 ) );
+    const __m128d a12 = _mm_set1_pd( transform.get( 1, 2 ) );
+
+    for ( ; i + 2 <= n; i += 2 )
+    {
+        __m128d x = _mm_loadu_pd( xs + i );
+        __m128d y = _mm_loadu_pd( ys + i );
+
+        __m128d dx = _mm_add_pd( _mm_add_pd( _mm_mul_pd( a00, x ), _mm_mul_pd( a01, y ) ), a02 );
+        __m128d dy = _mm_add_pd( _mm_add_pd( _mm_mul_pd( a10, x ), _mm_mul_pd( a11, y ) ), a12 );
+
+        __m128d tx = _mm_cvtepi32_pd( _mm_cvttpd_epi32( dx ) );
+        __m128d ty = _mm_cvtepi32_pd( _mm_cvttpd_epi32( dy ) );
+        tx = _mm_sub_pd( tx, _mm_and_pd( _mm_cmpgt_pd( tx, dx ), one ) );
+        ty = _mm_sub_pd( ty, _mm_and_pd( _mm_cmpgt_pd( ty, dy ), one ) );
+
+        _mm_storel_epi64( ( __m128i * ) ( outX + i ), _mm_cvttpd_epi32( tx ) );
+        _mm_storel_epi64( ( __m128i * ) ( outY + i ), _mm_cvttpd_epi32( ty ) );
+    }
+# endif
+
+    // scalar remainder
+    for ( ; i < n; i++ )
+    {
+        outX[i] = ( int ) std::floor( transform.transformX( xs[i], ys[i] ) );
+        outY[i] = ( int ) std::floor( transform.transformY( xs[i], ys[i] ) );
+    }
+}
+
+
+/**
+ * @brief   Determines the model space bounding box of everything that can
+ *          appear in a device rectangle
+ *
+ * @param   &rect   The device rectangle
+ *
+ * @return  The model space bounding box of the device rectangle
+ */
+BoundingBox ViewContext::deviceToModel( const GraphicsContext::Rect &rect ) const
+{
+    // widen by a pixel to cover truncation of device coordinates
+    double left = rect.x - 1;
+    double top = rect.y - 1;
+    double right = rect.x + rect.width + 1;
+    double bottom = rect.y + rect.height + 1;
+
+    // the view may be rotated, so bound all four corners
+    BoundingBox box;
+    box.expand( invTransform.transformX( left, top ), invTransform.transformY( left, top ) );
+    box.expand( invTransform.transformX( right, top ), invTransform.transformY( right, top ) );
+    box.expand( invTransform.transformX( left, bottom ), invTransform.transformY( left, bottom ) );
+    box.expand( invTransform.transformX( right, bottom ), invTransform.transformY( right, bottom ) );
+
+    return box;
+}
+
+
+/**
+ * @brief   Gets the model space region that is visible in the window
+ *
+ * @param   void
+ *
+ * @return  A bounding box around the visible model space region
+ */
+BoundingBox ViewContext::getViewBounds() const
+{
+    GraphicsContext::Rect window = { 0, 0, gc->getWindowWidth(), gc->getWindowHeight() };
+    return deviceToModel( window );
+}
+
+
+/**
+ * @brief   Gets the model to device transformation
+ *
+ * @param   void
+ *
+ * @return  A reference to the model to device transformation
+ */
+const Affine2D &ViewContext::getTransform() const
+{
+    return transform;
+}
+
+
+/**
+ * @brief   Gets the device to model transformation
+ *
+ * @param   void
+ *
+ * @return  A reference to the device to model transformation
+ */
+const Affine2D &ViewContext::getInvTransform() const
+{
+    return invTransform;
+}
+
+
+/**
+ * @brief   Gets the version of the transformation matrices, so that work
+ *          done with them can be kept until they change
+ *
+ * @param   void
+ *
+ * @return  The version, different after every update
+ */
+unsigned long ViewContext::getVersion() const
+{
+    return version;
 }
 
 
@@ -298,6 +532,8 @@ void ViewContext::resetView()
  */
 void ViewContext::update()
 {
+    FRAME_STATS_TIME( viewUpdateTime );
+
     // determine transformation matrix
     transform =
             genScreenTranslationMatrix() *
@@ -307,12 +543,9 @@ void ViewContext::update()
             genViewTranslationMatrix();
 
     // determine inverse transformation matrix
-    invTransform =
-            genInvViewTranslationMatrix()    *
-            genInvViewRotationMatrix()       *
-            genInvViewScaleMatrix()          *
-            genInvScreenFlipMatrix()         *
-            genInvScreenTranslationMatrix();
+    invTransform = transform.inverse();
+
+    version = ++lastVersion;
 }
 
 
@@ -340,21 +573,9 @@ std::ostream &ViewContext::out( std::ostream &os ) const
  *
  * @return  The view translation matrix
  */
-Matrix<double> ViewContext::genViewTranslationMatrix() const
+Affine2D ViewContext::genViewTranslationMatrix() const
 {
-    Matrix<double> viewTranslationMatrix = Matrix<double>( 3, 3 );
-
-    viewTranslationMatrix[0][0] = 1;
-    viewTranslationMatrix[1][1] = 1;
-    viewTranslationMatrix[2][2] = 1;
-
-    viewTranslationMatrix[0][2] = viewTranslationX;
-    viewTranslationMatrix[1][2] = viewTranslationY;
-
-    // std::cout << std::endl << "View Translation: " << std::endl;
-    // viewTranslationMatrix.out(std::cout);
-
-    return viewTranslationMatrix;
+    return Affine2D::translation( viewTranslationX, viewTranslationY );
 }
 
 
@@ -365,21 +586,9 @@ Matrix<double> ViewContext::genViewTranslationMatrix() const
  *
  * @return  The view rotation matrix
  */
-Matrix<double> ViewContext::genViewRotationMatrix() const
+Affine2D ViewContext::genViewRotationMatrix() const
 {
-    Matrix<double> viewRotationMatrix = Matrix<double>( 3, 3 );
-
-    viewRotationMatrix[2][2] = 1;
-
-    viewRotationMatrix[0][0] = cos( viewRotation );
-    viewRotationMatrix[0][1] = -sin( viewRotation );
-    viewRotationMatrix[1][0] = sin( viewRotation );
-    viewRotationMatrix[1][1] = cos( viewRotation );
-
-    // std::cout << std::endl << "View Rotation: " << std::endl;
-    // viewRotationMatrix.out(std::cout);
-
-    return viewRotationMatrix;
+    return Affine2D::rotation( viewRotation );
 }
 
 
@@ -390,80 +599,9 @@ Matrix<double> ViewContext::genViewRotationMatrix() const
  *
  * @return  The view scale matrix
  */
-Matrix<double> ViewContext::genViewScaleMatrix() const
-{
-    Matrix<double> viewScaleMatrix = Matrix<double>( 3, 3 );
-
-    viewScaleMatrix[0][0] = viewScaleX;
-    viewScaleMatrix[1][1] = viewScaleY;
-    viewScaleMatrix[2][2] = 1;
-
-    // std::cout << std::endl << "View Scale: " << std::endl;
-    // viewScaleMatrix.out(std::cout);
-
-    return viewScaleMatrix;
-}
-
-
-/**
- * @brief   Generates the inverse view translation matrix from internal parameters
- *
- * @param   void
- *
- * @return  The inverse view translation matrix
- */
-Matrix<double> ViewContext::genInvViewTranslationMatrix() const
+Affine2D ViewContext::genViewScaleMatrix() const
 {
-    Matrix<double> invViewTranslationMatrix = genViewTranslationMatrix();
-
-    invViewTranslationMatrix[0][2] = -1 * invViewTranslationMatrix[0][2];
-    invViewTranslationMatrix[1][2] = -1 * invViewTranslationMatrix[1][2];
-
-    // std::cout << std::endl << "Inverse View Translation: " << std::endl;
-    // invViewTranslationMatrix.out(std::cout);
-
-    return invViewTranslationMatrix;
-}
-
-
-/**
- * @brief   Generates the inverse view rotation matrix from internal parameters
- *
- * @param   void
- *
- * @return  The inverse view rotation matrix
- */
-Matrix<double> ViewContext::genInvViewRotationMatrix() const
-{
-    Matrix<double> invViewRotationMatrix = genViewRotationMatrix();
-
-    invViewRotationMatrix = ~invViewRotationMatrix;
-
-    // std::cout << std::endl << "Inverse View Rotation: " << std::endl;
-    // invViewRotationMatrix.out(std::cout);
-
-    return invViewRotationMatrix;
-}
-
-
-/**
- * @brief   Generates the inverse view scale matrix from internal parameters
- *
- * @param   void
- *
- * @return  The inverse view scale matrix
- */
-Matrix<double> ViewContext::genInvViewScaleMatrix() const
-{
-    Matrix<double> invViewScaleMatrix = genViewScaleMatrix();
-
-    invViewScaleMatrix[0][0] = 1 / invViewScaleMatrix[0][0];
-    invViewScaleMatrix[1][1] = 1 / invViewScaleMatrix[1][1];
-
-    // std::cout << std::endl << "Inverse View Scale: " << std::endl;
-    // invViewScaleMatrix.out(std::cout);
-
-    return invViewScaleMatrix;
+    return Affine2D::scale( viewScaleX, viewScaleY );
 }
 
 
@@ -474,21 +612,12 @@ Matrix<double> ViewContext::genInvViewScaleMatrix() const
  *
  * @return  The screen translation matrix
  */
-Matrix<double> ViewContext::genScreenTranslationMatrix() const
+Affine2D ViewContext::genScreenTranslationMatrix() const
 {
-    Matrix<double> screenTranslationMatrix = Matrix<double>( 3, 3 );
-
-    screenTranslationMatrix[0][0] = 1;
-    screenTranslationMatrix[1][1] = 1;
-    screenTranslationMatrix[2][2] = 1;
-
-    screenTranslationMatrix[0][2] = ( ( double ) gc->getWindowWidth() ) / 2;
-    screenTranslationMatrix[1][2] = ( ( double ) gc->getWindowHeight() ) / 2;
-
-    // std::cout << std::endl << "Screen Translation: " << std::endl;
-    // screenTranslationMatrix.out( std::cout);
-
-    return screenTranslationMatrix;
+    return Affine2D::translation(
+        ( ( double ) gc->getWindowWidth() ) / 2,
+        ( ( double ) gc->getWindowHeight() ) / 2
+    );
 }
 
 
@@ -499,60 +628,9 @@ Matrix<double> ViewContext::genScreenTranslationMatrix() const
  *
  * @return  The screen flip matrix
  */
-Matrix<double> ViewContext::genScreenFlipMatrix() const
+Affine2D ViewContext::genScreenFlipMatrix() const
 {
-    Matrix<double> screenFlipMatrix = Matrix<double>( 3, 3 );
-
-    screenFlipMatrix[0][0] = 1;
-    screenFlipMatrix[1][1] = -1;
-    screenFlipMatrix[2][2] = 1;
-
-    // std::cout << std::endl << "Screen Flip: " << std::endl;
-    // screenFlipMatrix.out( std::cout);
-
-    return screenFlipMatrix;
-}
-
-
-/**
- * @brief   Generates the inverse screen translation matrix from internal parameters
- *
- * @param   void
- *
- * @return  The inverse screen translation matrix
- */
-Matrix<double> ViewContext::genInvScreenTranslationMatrix() const
-{
-    Matrix<double> invScreenTranslationMatrix = genScreenTranslationMatrix();
-
-    invScreenTranslationMatrix[0][2] = -1 * invScreenTranslationMatrix[0][2];
-    invScreenTranslationMatrix[1][2] = -1 * invScreenTranslationMatrix[1][2];
-
-    // std::cout << std::endl << "Inverse Screen Translation: " << std::endl;
-    // invScreenTranslationMatrix.out( std::cout);
-
-    return invScreenTranslationMatrix;
-}
-
-
-/**
- * @brief   Generates the inverse screen flip matrix from internal parameters
- *
- * @param   void
- *
- * @return  The inverse screen flip matrix
- */
-Matrix<double> ViewContext::genInvScreenFlipMatrix() const
-{
-    Matrix<double> invScreenFlipMatrix = genScreenFlipMatrix();
-
-    invScreenFlipMatrix[0][0] = 1 / invScreenFlipMatrix[0][0];
-    invScreenFlipMatrix[1][1] = 1 / invScreenFlipMatrix[1][1];
-
-    // std::cout << std::endl << "Inverse Screen Flip: " << std::endl;
-    // invScreenFlipMatrix.out( std::cout);
-
-    return invScreenFlipMatrix;
+    return Affine2D::scale( 1, -1 );
 }
 
 
@@ -17,7 +17,10 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include "matrix.h"
+# include <cstddef>
+
+# include "affine2d.h"
+# include "boundingbox.h"
 # include "point2d.h"
 # include "gcontext.h"
 
@@ -54,6 +57,21 @@ public:
     Point2D modelToDevice( const Point2D &p );
     Point2D deviceToModel( const Point2D &p );
 
+    void modelToDevice( double x, double y, double &dx, double &dy ) const;
+    void deviceToModel( double x, double y, double &mx, double &my ) const;
+
+    void modelToDevice( const double *xs, const double *ys,
+                        int *outX, int *outY, size_t n ) const;
+    void transformToDevice( const double *xs, const double *ys,
+                            int *outX, int *outY, size_t n ) const;
+
+    BoundingBox deviceToModel( const GraphicsContext::Rect &rect ) const;
+    BoundingBox getViewBounds() const;
+
+    const Affine2D &getTransform() const;
+    const Affine2D &getInvTransform() const;
+    unsigned long getVersion() const;
+
     void translate( double x, double y );
     void rotate( double r );
     void scale( double x, double y );
@@ -89,8 +107,11 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    Matrix<double> transform = Matrix<double>( 3, 3 );
-    Matrix<double> invTransform = Matrix<double>( 3, 3 );
+    Affine2D transform = Affine2D();
+    Affine2D invTransform = Affine2D();
+
+    // changes with every update, and is never shared by two view contexts
+    unsigned long version = 0;
 
     double viewTranslationX = DEFAULT_VIEW_TRANSLATION_X;
     double viewTranslationY = DEFAULT_VIEW_TRANSLATION_Y;
@@ -104,19 +125,12 @@ private:
     /* ------------------------------ Functions ----------------------------- */
 
 
-    Matrix<double> genViewTranslationMatrix() const;
-    Matrix<double> genViewRotationMatrix() const;
-    Matrix<double> genViewScaleMatrix() const;
-
-    Matrix<double> genInvViewTranslationMatrix() const;
-    Matrix<double> genInvViewRotationMatrix() const;
-    Matrix<double> genInvViewScaleMatrix() const;
-
-    Matrix<double> genScreenTranslationMatrix() const;
-    Matrix<double> genScreenFlipMatrix() const;
+    Affine2D genViewTranslationMatrix() const;
+    Affine2D genViewRotationMatrix() const;
+    Affine2D genViewScaleMatrix() const;
 
-    Matrix<double> genInvScreenTranslationMatrix() const;
-    Matrix<double> genInvScreenFlipMatrix() const;
+    Affine2D genScreenTranslationMatrix() const;
+    Affine2D genScreenFlipMatrix() const;
 
 
     /* ====================================================================== */
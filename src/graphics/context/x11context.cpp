@@ -3,23 +3,153 @@
  * 'sudo apt-get install libx11-dev' should help.
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <fcntl.h>	// wake pipe
+#include <sys/select.h>
+#include <unistd.h>
 #include <X11/Xlib.h> // Every Xlib program must include this
 #include <X11/Xutil.h> // needed for XGetPixel
 #include <X11/XKBlib.h> // needed for keyboard setup
 
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>	// shared memory back buffer
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
 #include "drawbase.h"
+#include "framestats.h"
 #include "point2d.h"
 #include "x11context.h"
 
 
 
+#ifdef HAVE_XSHM
+// The shared memory segment behind a back buffer
+struct X11Context::ShmSegment
+{
+	XShmSegmentInfo info;
+};
+
+// XShmAttach reports failure asynchronously through the error handler
+static bool shm_attach_failed = false;
+
+// Error handler installed around XShmAttach, noting the failure instead of
+// letting the default handler exit
+static int shmErrorHandler(Display*, XErrorEvent*)
+{
+	shm_attach_failed = true;
+	return 0;
+}
+#endif
+
+// Position and width of a color mask, for scaling its channel to 8 bits
+static void maskShape(unsigned long mask, int& shift, int& bits)
+{
+	shift = 0;
+	bits = 0;
+	while (mask && !(mask & 1))
+	{
+		mask >>= 1;
+		shift++;
+	}
+	while (mask & 1)
+	{
+		mask >>= 1;
+		bits++;
+	}
+}
+
+static uint32_t maskChannel(unsigned long pixel, unsigned long mask,
+							int shift, int bits)
+{
+	unsigned long value = (pixel & mask) >> shift;
+	if (bits >= 8)
+		return value >> (bits - 8);
+	return value * 255 / ((1ul << bits) - 1);
+}
+
+// Convert a w x h area of a ZPixmap image, starting at (sx, sy), to 24-bit
+// RGB in out, whose rows are stride pixels apart.  TrueColor pixels are
+// taken apart with the visual's masks; anything else goes through the
+// colormap, in a single query for the whole area.
+static void convertImage(Display* display, XImage* image, int sx, int sy,
+							int w, int h, uint32_t* out, int stride)
+{
+	const uint32_t one = 1;
+	int native_order = *(const char*) &one ? LSBFirst : MSBFirst;
+
+	// the usual 24-bit layout only needs the padding byte dropped
+	if (image->bits_per_pixel == 32 && image->byte_order == native_order &&
+		image->red_mask == 0xff0000 && image->green_mask == 0xff00 &&
+		image->blue_mask == 0xff)
+	{
+		for (int row = 0; row < h; row++)
+		{
+			const uint32_t* source = (const uint32_t*)
+				(image->data + size_t(sy + row) * image->bytes_per_line) + sx;
+			uint32_t* line = out + size_t(row) * stride;
+			for (int col = 0; col < w; col++)
+				line[col] = source[col] & 0xffffff;
+		}
+		return;
+	}
+
+	if (image->red_mask && image->green_mask && image->blue_mask)
+	{
+		int rs, rb, gs, gb, bs, bb;
+		maskShape(image->red_mask, rs, rb);
+		maskShape(image->green_mask, gs, gb);
+		maskShape(image->blue_mask, bs, bb);
+
+		for (int row = 0; row < h; row++)
+		{
+			uint32_t* line = out + size_t(row) * stride;
+			for (int col = 0; col < w; col++)
+			{
+				unsigned long pixel = XGetPixel(image, sx + col, sy + row);
+				line[col] = maskChannel(pixel, image->red_mask, rs, rb) << 16 |
+							maskChannel(pixel, image->green_mask, gs, gb) << 8 |
+							maskChannel(pixel, image->blue_mask, bs, bb);
+			}
+		}
+		return;
+	}
+
+	std::vector<XColor> colors(size_t(w) * h);
+	for (int row = 0; row < h; row++)
+		for (int col = 0; col < w; col++)
+			colors[size_t(row) * w + col].pixel =
+				XGetPixel(image, sx + col, sy + row);
+
+	XQueryColors(display, DefaultColormap(display, DefaultScreen(display)),
+					colors.data(), colors.size());
+
+	// 16 bits per channel, only the top 8 are wanted
+	for (int row = 0; row < h; row++)
+	{
+		uint32_t* line = out + size_t(row) * stride;
+		for (int col = 0; col < w; col++)
+		{
+			const XColor& color = colors[size_t(row) * w + col];
+			line[col] = (color.red & 0xff00) << 8 | (color.green & 0xff00) |
+						color.blue >> 8;
+		}
+	}
+}
+
+
 /**
  * The only constructor provided.  Allows size of window and background
  * color be specified.
  * */
 X11Context::X11Context(unsigned int sizex=400,unsigned int sizey=400,
-						unsigned int bg_color=X11Context::BLACK)
+						unsigned int bg_color=X11Context::BLACK,
+						bufferMode mode) :
+	mode(mode), dirty(false), painted(false), clip_active(false),
+	background(bg_color), compose_buffer(None)
 {
 	// Open the display
 	display = XOpenDisplay(NULL);
@@ -59,8 +189,9 @@ X11Context::X11Context(unsigned int sizex=400,unsigned int sizey=400,
 		break;
 	}
 
-	// We also want exposure, mouse, and keyboard events
+	// We also want exposure, resize, mouse, and keyboard events
 	XSelectInput(display, window, ExposureMask|
+								StructureNotifyMask|
 								ButtonPressMask|
 								ButtonReleaseMask|
 								KeyPressMask|
@@ -72,6 +203,48 @@ X11Context::X11Context(unsigned int sizex=400,unsigned int sizey=400,
 	Atom atomKill = XInternAtom(display, "WM_DELETE_WINDOW", False);
 	XSetWMProtocols(display, window, &atomKill, 1);
 
+	// PolySegment requests are 3 words of header plus 2 words per
+	// segment, PolyLine requests are 3 words plus 1 word per point
+	long maxRequest = XExtendedMaxRequestSize(display);
+	if (maxRequest == 0)
+		maxRequest = XMaxRequestSize(display);
+	maxSegmentsPerRequest = (maxRequest - 3) / 2;
+	maxPointsPerRequest = maxRequest - 3;
+
+	// Ask for the size once, ConfigureNotify keeps it current after this
+	XWindowAttributes window_attributes;
+	XGetWindowAttributes(display, window, &window_attributes);
+	window_width = window_attributes.width;
+	window_height = window_attributes.height;
+
+	// Off-screen buffering - filled with the background on clear and
+	// copied to the window on present
+	target = window;
+	buffer_context = XCreateGC(display, window, 0, NULL);
+	XSetForeground(display, buffer_context, bg_color);
+	XSetGraphicsExposures(display, buffer_context, False);
+	scroll_context = XCreateGC(display, window, 0, NULL);
+	overlay_context = XCreateGC(display, window, 0, NULL);
+	XSetGraphicsExposures(display, overlay_context, False);
+
+	if (mode != BUFFER_SINGLE)
+	{
+		createBackBuffer(getWindowWidth(), getWindowHeight());
+	}
+	else
+	{
+		XSetFunction(display, overlay_context, GXxor);
+	}
+
+	// Other threads wake the event loop by writing to this pipe, which
+	// runLoop waits on alongside the display connection
+	if (pipe(wake_pipe) != 0)
+	{
+		throw "Unable to create wake pipe";
+	}
+	fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
 	return;
 }
 
@@ -79,9 +252,15 @@ X11Context::X11Context(unsigned int sizex=400,unsigned int sizey=400,
 // Destructor  - shut down window and connection to server
 X11Context::~X11Context()
 {
+	destroyBackBuffer();
+	XFreeGC(display, overlay_context);
+	XFreeGC(display, scroll_context);
+	XFreeGC(display, buffer_context);
 	XFreeGC(display, graphics_context);
 	XDestroyWindow(display,window);
 	XCloseDisplay(display);
+	close(wake_pipe[0]);
+	close(wake_pipe[1]);
 }
 
 
@@ -111,53 +290,495 @@ void X11Context::setColor(unsigned int color)
 // Set a pixel in the current color
 void X11Context::setPixel(int x, int y)
 {
-	XDrawPoint(display, window, graphics_context, x, y);
-	XFlush(display);
+	liftOverlay();
+	XDrawPoint(display, target, graphics_context, x, y);
+	FRAME_STATS_ADD(requests, 1);
+	dirty = true;
 }
 
 
 // Get the color of a pixel
 unsigned int X11Context::getPixel(int x, int y)
 {
-	XImage *image;
-	image = XGetImage (display, window, x, y, 1, 1, AllPlanes, XYPixmap);
-	XColor color;
-	color.pixel = XGetPixel (image, 0, 0);
-	XFree (image);
-	XQueryColor (display, DefaultColormap(display, DefaultScreen (display)),
-					&color);
-	// I now have RGB values, but, they are 16 bits each, I only want 8-bits
-	// each since I want a 24-bit RGB color value
-	unsigned int pixcolor = color.red & 0xff00;
-	pixcolor |= (color.green >> 8);
-	pixcolor <<= 8;
-	pixcolor |= (color.blue >> 8);
-	return pixcolor;
+	uint32_t pixel;
+	getPixels(x, y, 1, 1, &pixel);
+	return pixel;
+}
+
+
+// Get the colors of a rectangle of pixels with a single image request,
+// or straight from the shared back buffer, zero outside the canvas
+void X11Context::getPixels(int x, int y, int width, int height, uint32_t* out)
+{
+	std::fill(out, out + size_t(width) * height, 0);
+	liftOverlay();
+
+	int canvas_width = (mode == BUFFER_SINGLE) ? window_width : buffer_width;
+	int canvas_height = (mode == BUFFER_SINGLE) ? window_height : buffer_height;
+
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + width, canvas_width);
+	int y1 = std::min(y + height, canvas_height);
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	uint32_t* first = out + size_t(y0 - y) * width + (x0 - x);
+
+#ifdef HAVE_XSHM
+	if (mode == BUFFER_SHM)
+	{
+		// the segment is only current once the server has drawn into it
+		XSync(display, False);
+		convertImage(display, shm_image, x0, y0, x1 - x0, y1 - y0,
+						first, width);
+		return;
+	}
+#endif
+
+	XImage* image = XGetImage(display, target, x0, y0, x1 - x0, y1 - y0,
+								AllPlanes, ZPixmap);
+	FRAME_STATS_ADD(requests, 1);
+	if (!image)
+		return;
+
+	convertImage(display, image, 0, 0, x1 - x0, y1 - y0, first, width);
+	XDestroyImage(image);
 }
 
 
 // Draw a line in the current color
 void X11Context::drawLine(int x1, int y1, int x2, int y2)
 {
-    XDrawLine(display, window, graphics_context, x1, y1, x2, y2);
-    XFlush(display);
+	liftOverlay();
+    XDrawLine(display, target, graphics_context, x1, y1, x2, y2);
+    FRAME_STATS_ADD(requests, 1);
+    dirty = true;
 }
 
 
 // Draw a circle in the current color
 void X11Context::drawCircle(int x, int y, int radius)
 {
-    XDrawArc(display, window, graphics_context, x-radius,
+	liftOverlay();
+    XDrawArc(display, target, graphics_context, x-radius,
              y-radius, radius*2, radius*2, 0, 360*64);
-    XFlush(display);
+    FRAME_STATS_ADD(requests, 1);
+    dirty = true;
+}
+
+
+// Draw many segments in the current color, as few requests as possible
+void X11Context::drawLines(const Segment* segments, size_t count)
+{
+	liftOverlay();
+
+	while (count > 0)
+	{
+		size_t chunk = count < maxSegmentsPerRequest ?
+						count : maxSegmentsPerRequest;
+
+		xsegments.resize(chunk);
+		for (size_t i = 0; i < chunk; i++)
+		{
+			xsegments[i].x1 = segments[i].x1;
+			xsegments[i].y1 = segments[i].y1;
+			xsegments[i].x2 = segments[i].x2;
+			xsegments[i].y2 = segments[i].y2;
+		}
+
+		XDrawSegments(display, target, graphics_context,
+						xsegments.data(), chunk);
+		FRAME_STATS_ADD(requests, 1);
+
+		segments += chunk;
+		count -= chunk;
+		dirty = true;
+	}
+}
+
+
+// Draw a connected polyline in the current color.  Long polylines are
+// split into requests that share their end points.
+void X11Context::drawPolyline(const Point* points, size_t count)
+{
+	liftOverlay();
+
+	while (count > 1)
+	{
+		size_t chunk = count < maxPointsPerRequest ?
+						count : maxPointsPerRequest;
+
+		xpoints.resize(chunk);
+		for (size_t i = 0; i < chunk; i++)
+		{
+			xpoints[i].x = points[i].x;
+			xpoints[i].y = points[i].y;
+		}
+
+		XDrawLines(display, target, graphics_context,
+					xpoints.data(), chunk, CoordModeOrigin);
+		FRAME_STATS_ADD(requests, 1);
+
+		points += chunk - 1;
+		count -= chunk - 1;
+		dirty = true;
+	}
 }
 
 
 // Clear graphics context
 void X11Context::clear()
 {
-	XClearWindow(display, window);
+	liftOverlay();
+	dirty = true;
+
+	if (mode == BUFFER_SINGLE)
+	{
+		if (clip_active)
+			XClearArea(display, window, clip.x, clip.y,
+						clip.width, clip.height, False);
+		else
+			XClearWindow(display, window);
+		return;
+	}
+
+	if (clip_active)
+		XFillRectangle(display, back_buffer, buffer_context, clip.x, clip.y,
+						clip.width, clip.height);
+	else
+		XFillRectangle(display, back_buffer, buffer_context, 0, 0,
+						buffer_width, buffer_height);
+	painted = true;
+}
+
+
+// Restrict drawing and clearing to a rectangle
+void X11Context::setClip(const Rect& rect)
+{
+	XRectangle xrect;
+	xrect.x = rect.x;
+	xrect.y = rect.y;
+	xrect.width = rect.width;
+	xrect.height = rect.height;
+	XSetClipRectangles(display, graphics_context, 0, 0, &xrect, 1, Unsorted);
+
+	clip = rect;
+	clip_active = true;
+}
+
+
+// Lift the clip rectangle
+void X11Context::resetClip()
+{
+	XSetClipMask(display, graphics_context, None);
+	clip_active = false;
+}
+
+
+// Move the canvas contents by (dx, dy), copying only the part that stays
+// visible so the uncovered strips raise no exposures of their own
+bool X11Context::scroll(int dx, int dy)
+{
+	int width = (mode == BUFFER_SINGLE) ? window_width : buffer_width;
+	int height = (mode == BUFFER_SINGLE) ? window_height : buffer_height;
+
+	if (std::abs(dx) >= width || std::abs(dy) >= height)
+		return false;
+
+	liftOverlay();
+
+	int sx = (dx < 0) ? -dx : 0;
+	int sy = (dy < 0) ? -dy : 0;
+	unsigned int w = width - std::abs(dx);
+	unsigned int h = height - std::abs(dy);
+
+	if (mode == BUFFER_SINGLE)
+		XCopyArea(display, window, window, scroll_context,
+					sx, sy, w, h, sx + dx, sy + dy);
+	else
+		XCopyArea(display, back_buffer, back_buffer, buffer_context,
+					sx, sy, w, h, sx + dx, sy + dy);
+
+	FRAME_STATS_ADD(requests, 1);
+	dirty = true;
+	return true;
+}
+
+
+// Send all buffered requests to the server
+void X11Context::flush()
+{
 	XFlush(display);
+	FRAME_STATS_ADD(flushes, 1);
+}
+
+
+// Show the frame.  The back buffer is copied to the window, with the
+// overlay over it, if anything was drawn; if only the overlay changed,
+// just the part of the window it covered before or covers now is.
+void X11Context::present()
+{
+	if (mode == BUFFER_SINGLE)
+	{
+		if (overlay_changed)
+			liftOverlay();
+
+		if (overlay_shown.empty() && !overlay.empty())
+		{
+			drawOverlay(window, overlay);
+			overlay_shown = overlay;
+		}
+	}
+	else if (dirty)
+	{
+		composite(0, 0, buffer_width, buffer_height);
+		overlay_shown = overlay;
+	}
+	else if (overlay_changed)
+	{
+		int x0 = buffer_width;
+		int y0 = buffer_height;
+		int x1 = 0;
+		int y1 = 0;
+
+		for (const std::vector<OverlayLine>* lines : {&overlay_shown, &overlay})
+		{
+			for (const OverlayLine& line : *lines)
+			{
+				const Segment& s = line.segment;
+				x0 = std::min(x0, std::min(s.x1, s.x2));
+				y0 = std::min(y0, std::min(s.y1, s.y2));
+				x1 = std::max(x1, std::max(s.x1, s.x2) + 1);
+				y1 = std::max(y1, std::max(s.y1, s.y2) + 1);
+			}
+		}
+
+		composite(x0, y0, x1 - x0, y1 - y0);
+		overlay_shown = overlay;
+	}
+
+	overlay_changed = false;
+	dirty = false;
+	flush();
+}
+
+
+// Copy part of the back buffer to the window with the overlay over it,
+// going through the compose buffer so the window never shows the frame
+// without its overlay
+void X11Context::composite(int x, int y, int width, int height)
+{
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + width, buffer_width);
+	int y1 = std::min(y + height, buffer_height);
+
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	if (overlay.empty())
+	{
+		XCopyArea(display, back_buffer, window, buffer_context,
+					x0, y0, x1 - x0, y1 - y0, x0, y0);
+		FRAME_STATS_ADD(requests, 1);
+		return;
+	}
+
+	if (compose_buffer == None)
+		compose_buffer = XCreatePixmap(display, window, buffer_width,
+						buffer_height, DefaultDepth(display, DefaultScreen(display)));
+
+	XCopyArea(display, back_buffer, compose_buffer, buffer_context,
+				x0, y0, x1 - x0, y1 - y0, x0, y0);
+	drawOverlay(compose_buffer, overlay);
+	XCopyArea(display, compose_buffer, window, buffer_context,
+				x0, y0, x1 - x0, y1 - y0, x0, y0);
+	FRAME_STATS_ADD(requests, 2);
+}
+
+
+// Draw overlay lines, a request per run of lines of one color.  On a
+// single buffered window they are XORed with their color against the
+// background, so they show in their color over an empty canvas and
+// drawing them again removes them.
+void X11Context::drawOverlay(Drawable drawable,
+							const std::vector<OverlayLine>& lines)
+{
+	size_t i = 0;
+
+	while (i < lines.size())
+	{
+		unsigned int color = lines[i].color;
+
+		xsegments.clear();
+		for (; i < lines.size() && lines[i].color == color &&
+				xsegments.size() < maxSegmentsPerRequest; i++)
+		{
+			XSegment segment;
+			segment.x1 = lines[i].segment.x1;
+			segment.y1 = lines[i].segment.y1;
+			segment.x2 = lines[i].segment.x2;
+			segment.y2 = lines[i].segment.y2;
+			xsegments.push_back(segment);
+		}
+
+		XSetForeground(display, overlay_context,
+						mode == BUFFER_SINGLE ? color ^ background : color);
+		XDrawSegments(display, drawable, overlay_context,
+						xsegments.data(), xsegments.size());
+		FRAME_STATS_ADD(requests, 1);
+	}
+}
+
+
+// Take the overlay off a single buffered window before the canvas under
+// it is drawn on or read
+void X11Context::liftOverlay()
+{
+	if (mode != BUFFER_SINGLE || overlay_shown.empty())
+		return;
+
+	drawOverlay(window, overlay_shown);
+	overlay_shown.clear();
+}
+
+
+// Get the buffering in use
+X11Context::bufferMode X11Context::getBufferMode()
+{
+	return mode;
+}
+
+
+// Create an off-screen buffer the size of the window and direct all
+// drawing to it
+void X11Context::createBackBuffer(int width, int height)
+{
+	int depth = DefaultDepth(display, DefaultScreen(display));
+
+	buffer_width = width;
+	buffer_height = height;
+	painted = false;
+
+#ifdef HAVE_XSHM
+	shm_image = NULL;
+
+	if (mode == BUFFER_SHM && !createShmBackBuffer(width, height, depth))
+		mode = BUFFER_PIXMAP;
+
+	if (mode == BUFFER_PIXMAP)
+		back_buffer = XCreatePixmap(display, window, width, height, depth);
+#else
+	mode = BUFFER_PIXMAP;
+	back_buffer = XCreatePixmap(display, window, width, height, depth);
+#endif
+
+	target = back_buffer;
+}
+
+
+#ifdef HAVE_XSHM
+// Create the back buffer as a pixmap over a shared memory segment.
+// Returns false if the server cannot share memory with us.
+bool X11Context::createShmBackBuffer(int width, int height, int depth)
+{
+	if (!XShmQueryExtension(display) || XShmPixmapFormat(display) != ZPixmap)
+		return false;
+
+	shm_segment = new ShmSegment();
+	XShmSegmentInfo& shm_info = shm_segment->info;
+
+	// the image describes the segment layout (and lets us read it back)
+	shm_image = XShmCreateImage(display,
+						DefaultVisual(display, DefaultScreen(display)),
+						depth, ZPixmap, NULL, &shm_info, width, height);
+	if (!shm_image)
+	{
+		delete shm_segment;
+		shm_segment = NULL;
+		return false;
+	}
+
+	shm_info.shmid = shmget(IPC_PRIVATE,
+						shm_image->bytes_per_line * shm_image->height,
+						IPC_CREAT | 0600);
+	if (shm_info.shmid < 0)
+	{
+		XDestroyImage(shm_image);
+		shm_image = NULL;
+		delete shm_segment;
+		shm_segment = NULL;
+		return false;
+	}
+
+	shm_info.shmaddr = (char*) shmat(shm_info.shmid, NULL, 0);
+	shm_info.readOnly = False;
+
+	// Attach, catching the BadAccess a remote server will send
+	bool attached = false;
+	if (shm_info.shmaddr != (char*) -1)
+	{
+		XSync(display, False);
+		shm_attach_failed = false;
+		XErrorHandler old_handler = XSetErrorHandler(shmErrorHandler);
+		XShmAttach(display, &shm_info);
+		XSync(display, False);
+		XSetErrorHandler(old_handler);
+		attached = !shm_attach_failed;
+	}
+
+	// the segment goes away once both sides have detached
+	shmctl(shm_info.shmid, IPC_RMID, NULL);
+
+	if (!attached)
+	{
+		if (shm_info.shmaddr != (char*) -1)
+			shmdt(shm_info.shmaddr);
+		XDestroyImage(shm_image);
+		shm_image = NULL;
+		delete shm_segment;
+		shm_segment = NULL;
+		return false;
+	}
+
+	shm_image->data = shm_info.shmaddr;
+	back_buffer = XShmCreatePixmap(display, window, shm_info.shmaddr,
+						&shm_info, width, height, depth);
+	return true;
+}
+#endif
+
+
+// Release the off-screen buffer
+void X11Context::destroyBackBuffer()
+{
+	if (mode == BUFFER_SINGLE)
+		return;
+
+	XFreePixmap(display, back_buffer);
+
+	if (compose_buffer != None)
+	{
+		XFreePixmap(display, compose_buffer);
+		compose_buffer = None;
+	}
+
+#ifdef HAVE_XSHM
+	if (shm_image)
+	{
+		XShmDetach(display, &shm_segment->info);
+		shmdt(shm_segment->info.shmaddr);
+		shm_image->data = NULL;
+		XDestroyImage(shm_image);
+		shm_image = NULL;
+		delete shm_segment;
+		shm_segment = NULL;
+	}
+#endif
+
+	target = window;
 }
 
 
@@ -167,15 +788,87 @@ void X11Context::runLoop(DrawingBase* drawing)
 	run = true;
 	
     drawing->paint(this);
+	present();
+
+	// accumulated Expose rectangles
+	Region damage = XCreateRegion();
 	
 	while(run)
 	{
+		// Nothing queued - sleep until the server sends something or
+		// another thread wakes the loop, then let the drawing pick up
+		// whatever that thread left for it
+		if (XPending(display) == 0)
+		{
+			int x_fd = ConnectionNumber(display);
+			fd_set fds;
+			FD_ZERO(&fds);
+			FD_SET(x_fd, &fds);
+			FD_SET(wake_pipe[0], &fds);
+
+			if (select(std::max(x_fd, wake_pipe[0]) + 1, &fds,
+					NULL, NULL, NULL) > 0 && FD_ISSET(wake_pipe[0], &fds))
+			{
+				char drain[64];
+				while (read(wake_pipe[0], drain, sizeof(drain)) > 0);
+
+				drawing->idle(this);
+				present();
+			}
+			continue;
+		}
+
 		XEvent e;
 		XNextEvent(display, &e);
 
-		// Exposure event - lets not worry about region
-		if (e.type == Expose)
-			drawing->paint(this);
+		// Exposure event - merge rectangles into the damage region until
+		// the last of the series (count == 0), then repair its bounding
+		// box.  What still holds a frame, such as a back buffer, only
+		// needs showing again; otherwise the drawing repaints the region.
+		// GraphicsExpose reports what a scroll could not copy because it
+		// was covered, and is repaired the same way.
+		if (e.type == Expose || e.type == GraphicsExpose)
+		{
+			XRectangle exposed;
+			int count;
+
+			if (e.type == Expose)
+			{
+				exposed.x = e.xexpose.x;
+				exposed.y = e.xexpose.y;
+				exposed.width = e.xexpose.width;
+				exposed.height = e.xexpose.height;
+				count = e.xexpose.count;
+			}
+			else
+			{
+				exposed.x = e.xgraphicsexpose.x;
+				exposed.y = e.xgraphicsexpose.y;
+				exposed.width = e.xgraphicsexpose.width;
+				exposed.height = e.xgraphicsexpose.height;
+				count = e.xgraphicsexpose.count;
+			}
+
+			XUnionRectWithRegion(&exposed, damage, damage);
+
+			if (count == 0)
+			{
+				XRectangle box;
+				XClipBox(damage, &box);
+				XDestroyRegion(damage);
+				damage = XCreateRegion();
+
+				Rect region = {box.x, box.y, box.width, box.height};
+
+				if (!repair(region))
+				{
+					if (mode != BUFFER_SINGLE)
+						drawing->paint(this);
+					else
+						drawing->paint(this, region);
+				}
+			}
+		}
 
 		// Key Down
 		else if (e.type == KeyPress)
@@ -204,33 +897,93 @@ void X11Context::runLoop(DrawingBase* drawing)
 			e.xbutton.x,
 			e.xbutton.y);
 			
-		// Mouse Move	
+		// Mouse Move - optionally skipping ahead to the newest of a run
+		// of queued motion events.  Only events directly behind this
+		// one are merged so ordering with clicks and keys is kept.
 		else if (e.type == MotionNotify)
+		{
+			if (motion_policy == MOTION_LATEST)
+			{
+				XEvent next;
+				while (XEventsQueued(display, QueuedAfterReading) > 0)
+				{
+					XPeekEvent(display, &next);
+					if (next.type != MotionNotify)
+						break;
+					XNextEvent(display, &e);
+				}
+			}
+
 			drawing->mouseMove(this,
 			e.xmotion.x,
 			e.xmotion.y);
+		}
+
+		// Window moved or resized - only a size change matters
+		else if (e.type == ConfigureNotify)
+		{
+			if (e.xconfigure.width != window_width ||
+				e.xconfigure.height != window_height)
+			{
+				window_width = e.xconfigure.width;
+				window_height = e.xconfigure.height;
+
+				if (mode != BUFFER_SINGLE)
+				{
+					destroyBackBuffer();
+					createBackBuffer(window_width, window_height);
+				}
+
+				drawing->resize(this, window_width, window_height);
+			}
+		}
 
 		// This will respond to the WM_DELETE_WINDOW from the
 		// window manager.
 		else if (e.type == ClientMessage)
 		break;
+
+		// Drawing is buffered, show whatever this event produced
+		present();
 	}
+
+	XDestroyRegion(damage);
+}
+
+
+// Copy a damaged part of the window back from a back buffer that already
+// holds a frame
+bool X11Context::repair(const Rect& region)
+{
+	if (mode == BUFFER_SINGLE || !painted ||
+		region.x + region.width > buffer_width ||
+		region.y + region.height > buffer_height)
+		return false;
+
+	composite(region.x, region.y, region.width, region.height);
+	return true;
+}
+
+
+// Wake the event loop from any thread - a full pipe already holds a
+// pending wake, so a failed write needs no handling
+void X11Context::wake()
+{
+	char c = 0;
+	if (write(wake_pipe[1], &c, 1) < 0)
+		return;
 }
 
 
 // Get the width of the window
 int X11Context::getWindowWidth()
 {
-	XWindowAttributes window_attributes;
-	XGetWindowAttributes(display,window, &window_attributes);
-	return window_attributes.width;
+	return window_width;
 }
 
 
 // Get the height of the window
 int X11Context::getWindowHeight()
 {
-	XWindowAttributes window_attributes;
-	XGetWindowAttributes(display,window, &window_attributes);
-	return window_attributes.height;
+	return window_height;
 }
\ No newline at end of file
@@ -5,14 +5,24 @@
  * for the X11 / XWindows system.
  * */    
  
+#include <vector>
 #include <X11/Xlib.h>   // Every Xlib program must include this
 #include "gcontext.h"	// base class
 
 class X11Context : public GraphicsContext
 {
 	public:
+		// How drawing reaches the window.  BUFFER_SINGLE draws straight
+		// onto the window.  BUFFER_PIXMAP draws into an off-screen pixmap
+		// that present() copies to the window in a single request.
+		// BUFFER_SHM does the same with a pixmap in memory shared with
+		// the server, falling back to BUFFER_PIXMAP when the MIT-SHM
+		// extension is unavailable (e.g. on a remote display).
+		enum bufferMode {BUFFER_SINGLE, BUFFER_PIXMAP, BUFFER_SHM};
+
 		// Default Constructor
-		X11Context(unsigned int sizex,unsigned int sizey,unsigned int bg_color);
+		X11Context(unsigned int sizex,unsigned int sizey,unsigned int bg_color,
+					bufferMode mode=BUFFER_SINGLE);
 
 		// Destructor
 		virtual ~X11Context();
@@ -22,9 +32,26 @@ class X11Context : public GraphicsContext
 		void setColor(unsigned int color);
 		void setPixel(int x, int y);
 		unsigned int getPixel(int x, int y);
+		void getPixels(int x, int y, int width, int height, uint32_t* out);
         void drawLine(int x1, int y1, int x2, int y2);
         void drawCircle(int x, int y, int radius);
+		void drawLines(const Segment* segments, size_t count);
+		void drawPolyline(const Point* points, size_t count);
 		void clear();
+		void flush();
+		void present();
+		void setClip(const Rect& rect);
+		void resetClip();
+		bool scroll(int dx, int dy);
+
+		// The overlay is composited on the way to the window in buffered
+		// modes, so the back buffer never holds it.  A single buffered
+		// window has nowhere else to keep the canvas, so the overlay is
+		// XORed onto it instead, and XORed off again before the canvas
+		// is next drawn on or read.
+
+		// the buffering actually in use, after any fallback
+		bufferMode getBufferMode();
 
 		/*
 		 * These are not currently overridden, but could be as XLib
@@ -38,17 +65,84 @@ class X11Context : public GraphicsContext
 		void runLoop(DrawingBase* drawing);
 		
 		// we will use endLoop provided by base class
+		void wake();
 		
 		// Utility functions
 		int getWindowWidth();
 		int getWindowHeight();
 		
 
-	private:
-		// X11 stuff - specific to this context
+	protected:
+		// X11 stuff - specific to this context, and shared with
+		// contexts that draw into the window by other means
 		Display* display;
 		Window window;
+
+		// Show a damaged part of the window again from what was last
+		// drawn, returning false if the drawing has to repaint it
+		virtual bool repair(const Rect& region);
+
+	private:
 		GC graphics_context;
+
+		// unclipped copy-mode GC for scrolling the window onto itself,
+		// reporting the parts it could not copy as GraphicsExpose
+		GC scroll_context;
+
+		// window size, kept up to date from ConfigureNotify so it never
+		// needs a round trip
+		int window_width;
+		int window_height;
+
+		// largest number of segments / points that fit in one request
+		size_t maxSegmentsPerRequest;
+		size_t maxPointsPerRequest;
+
+		// conversion buffers reused between bulk draws
+		std::vector<XSegment> xsegments;
+		std::vector<XPoint> xpoints;
+
+		// double buffering - target is either the window or back_buffer
+		bufferMode mode;
+		Drawable target;
+		Pixmap back_buffer;
+		GC buffer_context;
+		int buffer_width;
+		int buffer_height;
+		bool dirty;		// drawn to since the last present
+		bool painted;	// back buffer holds a frame started by clear
+
+		// clip rectangle, also limits clear
+		bool clip_active;
+		Rect clip;
+
+		// overlay compositing - the back buffer is copied into
+		// compose_buffer, created the first time an overlay is shown,
+		// and the overlay drawn over it there with the unclipped
+		// overlay_context before it goes to the window
+		unsigned int background;
+		GC overlay_context;
+		Pixmap compose_buffer;
+		std::vector<OverlayLine> overlay_shown;	// on the window now
+
+		// read and write ends of the pipe wake() writes to
+		int wake_pipe[2];
+
+		// the shared memory back buffer, if there is one.  The segment is
+		// only defined where MIT-SHM is built in, so the layout of this
+		// class is the same whether or not it is.
+		struct ShmSegment;
+		ShmSegment* shm_segment = NULL;
+		XImage* shm_image = NULL;
+		bool createShmBackBuffer(int width, int height, int depth);
+
+		void createBackBuffer(int width, int height);
+		void destroyBackBuffer();
+
+		void composite(int x, int y, int width, int height);
+		void drawOverlay(Drawable drawable,
+						const std::vector<OverlayLine>& lines);
+		void liftOverlay();
 };
 
 #endif
@@ -0,0 +1,317 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    displaylist.cpp
+ * @brief   Retained device space line segments of stored shapes
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+
+# include "displaylist.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+// how far from a whole pixel a translation may be and still count as one
+static const double PIXEL_TOLERANCE = 1e-6;
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty display list
+ *
+ * @param   void
+ *
+ * @return  The created display list
+ */
+DisplayList::DisplayList() = default;
+
+
+/**
+ * @brief   Display list destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+DisplayList::~DisplayList() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Brings the display list up to date with a view, keeping the
+ *          segments if the view only moved by whole pixels since they were
+ *          made and emptying the list otherwise
+ *
+ * @param   *vc     The view context about to be drawn with
+ *
+ * @return  void
+ */
+void DisplayList::update( const ViewContext *vc )
+{
+    if ( hasView && ( vc->getVersion() == version ) )
+    {
+        return;
+    }
+
+    const Affine2D &transform = vc->getTransform();
+
+    double dx = transform.get( 0, 2 ) - baseX;
+    double dy = transform.get( 1, 2 ) - baseY;
+
+    bool translated = hasView &&
+                      ( transform.get( 0, 0 ) == linear[0] ) &&
+                      ( transform.get( 0, 1 ) == linear[1] ) &&
+                      ( transform.get( 1, 0 ) == linear[2] ) &&
+                      ( transform.get( 1, 1 ) == linear[3] ) &&
+                      ( std::fabs( dx - std::round( dx ) ) < PIXEL_TOLERANCE ) &&
+                      ( std::fabs( dy - std::round( dy ) ) < PIXEL_TOLERANCE );
+
+    // a view change is also the time to drop the segments of removed shapes
+    bool compact = ( deadSegments > COMPACT_THRESHOLD ) && ( deadSegments * 2 > segments.size() );
+
+    // offsets stay relative to the transform the segments were made with,
+    // so rounding never accumulates over a long pan
+    if ( translated && !compact )
+    {
+        offsetX = int( std::round( dx ) );
+        offsetY = int( std::round( dy ) );
+    }
+    else
+    {
+        clear();
+
+        linear[0] = transform.get( 0, 0 );
+        linear[1] = transform.get( 0, 1 );
+        linear[2] = transform.get( 1, 0 );
+        linear[3] = transform.get( 1, 1 );
+        baseX = transform.get( 0, 2 );
+        baseY = transform.get( 1, 2 );
+        offsetX = 0;
+        offsetY = 0;
+        hasView = true;
+    }
+
+    version = vc->getVersion();
+}
+
+
+/**
+ * @brief   Starts the entry of a shape, replacing any it had
+ *
+ * @param   handle  The handle of the shape
+ * @param   pixel   The shape's color
+ *
+ * @return  The segment pool, to append the shape's segments to as they are
+ *          drawn with the current view before calling end()
+ */
+std::vector<GraphicsContext::Segment> &DisplayList::begin( Handle handle, unsigned int pixel )
+{
+    remove( handle );
+
+    if ( handle >= entries.size() )
+    {
+        entries.resize( handle + 1, Entry { NONE, 0, 0 } );
+    }
+
+    entries[handle] = Entry { unsigned( segments.size() ), 0, pixel };
+    return segments;
+}
+
+
+/**
+ * @brief   Finishes the entry of a shape, moving the segments appended since
+ *          begin() back to the view the list was made with
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  void
+ */
+void DisplayList::end( Handle handle )
+{
+    Entry &entry = entries[handle];
+    entry.count = segments.size() - entry.first;
+
+    if ( ( offsetX != 0 ) || ( offsetY != 0 ) )
+    {
+        for ( size_t i = entry.first; i < segments.size(); i++ )
+        {
+            segments[i].x1 -= offsetX;
+            segments[i].y1 -= offsetY;
+            segments[i].x2 -= offsetX;
+            segments[i].y2 -= offsetY;
+        }
+    }
+
+    live++;
+}
+
+
+/**
+ * @brief   Determines if a shape has an entry
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  True if the shape's segments are kept, false otherwise
+ */
+bool DisplayList::contains( Handle handle ) const
+{
+    return ( handle < entries.size() ) && ( entries[handle].first != NONE );
+}
+
+
+/**
+ * @brief   Removes the entry of a shape, if it has one
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  void
+ */
+void DisplayList::remove( Handle handle )
+{
+    if ( !contains( handle ) )
+    {
+        return;
+    }
+
+    deadSegments += entries[handle].count;
+    entries[handle].first = NONE;
+    live--;
+}
+
+
+/**
+ * @brief   Draws every kept shape into a segment buffer
+ *
+ * @param   &sb     The segment buffer to draw to
+ *
+ * @return  void
+ */
+void DisplayList::draw( SegmentBuffer &sb ) const
+{
+    std::vector<GraphicsContext::Segment> *batch = nullptr;
+    unsigned int pixel = 0;
+
+    for ( const Entry &entry : entries )
+    {
+        if ( entry.first == NONE )
+        {
+            continue;
+        }
+
+        if ( ( batch == nullptr ) || ( entry.pixel != pixel ) )
+        {
+            pixel = entry.pixel;
+            batch = &sb.batch( pixel );
+        }
+
+        append( *batch, entry );
+    }
+}
+
+
+/**
+ * @brief   Draws a selection of kept shapes into a segment buffer, skipping
+ *          any without an entry
+ *
+ * @param   &sb         The segment buffer to draw to
+ * @param   *handles    The handles of the shapes to draw
+ * @param   n           The number of handles
+ *
+ * @return  void
+ */
+void DisplayList::draw( SegmentBuffer &sb, const Handle *handles, size_t n ) const
+{
+    std::vector<GraphicsContext::Segment> *batch = nullptr;
+    unsigned int pixel = 0;
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        if ( !contains( handles[i] ) )
+        {
+            continue;
+        }
+
+        const Entry &entry = entries[handles[i]];
+
+        if ( ( batch == nullptr ) || ( entry.pixel != pixel ) )
+        {
+            pixel = entry.pixel;
+            batch = &sb.batch( pixel );
+        }
+
+        append( *batch, entry );
+    }
+}
+
+
+/**
+ * @brief   Removes every entry, keeping the view the list was made with
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void DisplayList::clear()
+{
+    segments.clear();
+    entries.clear();
+    live = 0;
+    deadSegments = 0;
+}
+
+
+/**
+ * @brief   Gets the number of shapes with an entry
+ *
+ * @param   void
+ *
+ * @return  The number of kept shapes
+ */
+unsigned int DisplayList::size() const
+{
+    return live;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Appends the segments of an entry to a batch, offset to the
+ *          current view
+ *
+ * @param   &batch  The batch to append to
+ * @param   &entry  The entry to append
+ *
+ * @return  void
+ */
+void DisplayList::append( std::vector<GraphicsContext::Segment> &batch, const Entry &entry ) const
+{
+    const GraphicsContext::Segment *first = segments.data() + entry.first;
+    const GraphicsContext::Segment *last = first + entry.count;
+
+    if ( ( offsetX == 0 ) && ( offsetY == 0 ) )
+    {
+        batch.insert( batch.end(), first, last );
+        return;
+    }
+
+    for ( const GraphicsContext::Segment *s = first; s < last; s++ )
+    {
+        batch.push_back( { s->x1 + offsetX, s->y1 + offsetY, s->x2 + offsetX, s->y2 + offsetY } );
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
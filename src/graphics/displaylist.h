@@ -0,0 +1,136 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    displaylist.h
+ * @brief   Retained device space line segments of stored shapes
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_DISPLAYLIST_H
+# define GRAPHICS_DISPLAYLIST_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <vector>
+
+# include "gcontext.h"
+# include "segmentbuffer.h"
+# include "viewcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Keeps the device space segments every shape was last drawn with, by the
+ * shape's handle in its ShapeStore, so repainting an unchanged view copies
+ * them instead of transforming every vertex again.
+ *
+ * The list is tied to the view transform it was built with. A pan or a
+ * resize only moves the transform's translation by whole pixels, so the
+ * segments are kept and offset as they are submitted; any other change to
+ * the view empties the list. Entries are filled lazily: a shape drawn for
+ * the first time since the list was emptied, newly added or just scrolled
+ * into view, is transformed once and appended.
+ */
+class DisplayList
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the handles of the shapes in a ShapeStore
+    typedef unsigned int Handle;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    DisplayList();
+    ~DisplayList();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void update( const ViewContext *vc );
+
+    std::vector<GraphicsContext::Segment> &begin( Handle handle, unsigned int pixel );
+    void end( Handle handle );
+
+    bool contains( Handle handle ) const;
+    void remove( Handle handle );
+
+    void draw( SegmentBuffer &sb ) const;
+    void draw( SegmentBuffer &sb, const Handle *handles, size_t n ) const;
+
+    void clear();
+
+    unsigned int size() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    constexpr static const unsigned int NONE = ~0u;
+
+    // rebuild once removed shapes leave more dead segments than this and
+    // more dead segments than live ones
+    constexpr static const size_t COMPACT_THRESHOLD = 4096;
+
+    // the segments of a shape in the pool, and its color
+    struct Entry
+    {
+        unsigned int first;
+        unsigned int count;
+        unsigned int pixel;
+    };
+
+    std::vector<GraphicsContext::Segment> segments;
+    std::vector<Entry> entries;
+
+    unsigned int live = 0;
+    size_t deadSegments = 0;
+
+    // the transform the segments were made with, and the whole pixel offset
+    // of the current transform's translation from it
+    bool hasView = false;
+    unsigned long version = 0;
+    double linear[4] = { 0, 0, 0, 0 };
+    double baseX = 0;
+    double baseY = 0;
+    int offsetX = 0;
+    int offsetY = 0;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void append( std::vector<GraphicsContext::Segment> &batch, const Entry &entry ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_DISPLAYLIST_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,439 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    fileworker.cpp
+ * @brief   Background thread for opening and saving drawings
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <fstream>
+# include <memory>
+# include <utility>
+
+# include <sys/stat.h>
+
+# include "fileworker.h"
+# include "journal.h"
+# include "mappedfile.h"
+# include "shape.h"
+# include "shapeparser.h"
+# include "shapestore.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an idle file worker
+ *
+ * @param   void
+ *
+ * @return  The created file worker
+ */
+FileWorker::FileWorker():
+cancelled( false ), progress( 0 )
+{}
+
+
+/**
+ * @brief   File worker destructor, abandoning any running job
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+FileWorker::~FileWorker()
+{
+    cancel();
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Starts opening a drawing file in the background
+ *
+ * @param   &fileName   The name of the file to open
+ * @param   notify      Called from the worker whenever there is something to
+ *                      take
+ *
+ * @return  void
+ */
+void FileWorker::open( const std::string &fileName, std::function<void()> notify )
+{
+    start( JOB_OPEN, fileName, notify, [this]() { load(); } );
+}
+
+
+/**
+ * @brief   Starts saving a snapshot of a drawing in the background
+ *
+ * @param   &snapshot   The shapes to save, which must not change meanwhile
+ * @param   &fileName   The name of the file to save to
+ * @param   notify      Called from the worker once the save is done
+ *
+ * @return  void
+ */
+void FileWorker::save( const std::shared_ptr<const ShapeStore> &snapshot,
+                       const std::string &fileName, std::function<void()> notify )
+{
+    start( JOB_SAVE, fileName, notify, [this, snapshot, fileName]()
+       {
+           try
+           {
+               snapshot->save( fileName, ShapeContainer::isBinaryName( fileName ) );
+               finish( "", Journal::fingerprint( fileName ) );
+           }
+           catch ( const std::exception &e )
+           {
+               finish( e.what() );
+           }
+       }
+    );
+}
+
+
+/**
+ * @brief   Starts writing a snapshot of a journaled drawing in the
+ *          background, for the journal to be folded into once it is done
+ *
+ * @param   &snapshot   The shapes to write, which must not change meanwhile
+ * @param   &fileName   The name of the file to write to
+ * @param   binary      True to write the binary format, false for text
+ * @param   notify      Called from the worker once the write is done
+ *
+ * @return  void
+ */
+void FileWorker::compact( const std::shared_ptr<const ShapeStore> &snapshot,
+                          const std::string &fileName, bool binary,
+                          std::function<void()> notify )
+{
+    start( JOB_COMPACT, fileName, notify, [this, snapshot, fileName, binary]()
+       {
+           try
+           {
+               snapshot->save( fileName, binary );
+               finish( "", Journal::fingerprint( fileName ) );
+           }
+           catch ( const std::exception &e )
+           {
+               finish( e.what() );
+           }
+       }
+    );
+}
+
+
+/**
+ * @brief   Abandons the running job, waiting for the worker to stop and
+ *          dropping anything it left behind
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FileWorker::cancel()
+{
+    if ( type == JOB_NONE )
+    {
+        return;
+    }
+
+    // an open stops at the next shape, a save or compaction runs to
+    // completion
+    cancelled = true;
+
+    if ( thread.joinable() )
+    {
+        thread.join();
+    }
+
+    batches.clear();
+    type = JOB_NONE;
+}
+
+
+/**
+ * @brief   Waits for the running job to be done, leaving its batches and
+ *          result to be taken
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FileWorker::wait()
+{
+    if ( thread.joinable() )
+    {
+        thread.join();
+    }
+}
+
+
+/**
+ * @brief   Determines if a job is running or has results left to take
+ *
+ * @param   void
+ *
+ * @return  True if the worker is busy, false otherwise
+ */
+bool FileWorker::isBusy() const
+{
+    return type != JOB_NONE;
+}
+
+
+/**
+ * @brief   Gets the type of the running job
+ *
+ * @param   void
+ *
+ * @return  The job type, or JOB_NONE if the worker is idle
+ */
+FileWorker::JobType FileWorker::getJobType() const
+{
+    return type;
+}
+
+
+/**
+ * @brief   Gets how far the running job has got
+ *
+ * @param   void
+ *
+ * @return  The fraction of the file processed, from zero to one
+ */
+double FileWorker::getProgress() const
+{
+    return progress;
+}
+
+
+/**
+ * @brief   Takes the oldest batch of shapes opened so far
+ *
+ * @param   &batch  Replaced by the batch
+ *
+ * @return  True if a batch was taken, false if none is waiting
+ */
+bool FileWorker::takeBatch( ShapeContainer &batch )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+
+    if ( batches.empty() )
+    {
+        return false;
+    }
+
+    batch = std::move( batches.front() );
+    batches.pop_front();
+    return true;
+}
+
+
+/**
+ * @brief   Takes the result of a job once it is done and all of its batches
+ *          have been taken, leaving the worker idle
+ *
+ * @param   &result     Filled in with the result
+ *
+ * @return  True if a result was taken, false if the job is not done
+ */
+bool FileWorker::takeResult( Result &result )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+
+        if ( ( type == JOB_NONE ) || !done || !batches.empty() )
+        {
+            return false;
+        }
+
+        result.error = error;
+        result.fingerprint = fingerprint;
+    }
+
+    if ( thread.joinable() )
+    {
+        thread.join();
+    }
+
+    result.type = type;
+    result.fileName = fileName;
+    type = JOB_NONE;
+    return true;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Starts a job on a new worker thread
+ *
+ * @param   type        The job type
+ * @param   &fileName   The name of the file the job works on
+ * @param   notify      Called from the worker whenever there is something to
+ *                      take
+ * @param   work        The job itself, run on the worker thread
+ *
+ * @return  void
+ */
+void FileWorker::start( JobType type, const std::string &fileName,
+                        std::function<void()> notify, std::function<void()> work )
+{
+    cancel();
+
+    this->type = type;
+    this->fileName = fileName;
+    this->notify = notify;
+
+    cancelled = false;
+    progress = 0;
+    error.clear();
+    fingerprint = 0;
+    done = false;
+
+    thread = std::thread( work );
+}
+
+
+/**
+ * @brief   Opens the drawing file, runs on the worker thread
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FileWorker::load()
+{
+    ShapeContainer batch;
+
+    try
+    {
+        // pipes and other streams cannot be mapped, so they are only
+        // parsed, and without a fingerprint no journal is replayed on them
+        std::unique_ptr<MappedFile> file;
+        struct stat info;
+
+        if ( ( stat( fileName.c_str(), &info ) == 0 ) && S_ISREG( info.st_mode ) )
+        {
+            try
+            {
+                file.reset( new MappedFile( fileName ) );
+            }
+            catch ( const MappedFileException & )
+            {
+                file.reset();
+            }
+        }
+
+        // binary drawings are mapped rather than parsed, so there is
+        // nothing to gain from splitting them up
+        if ( file && ShapeStore::isBinary( file->data(), file->size() ) )
+        {
+            batch.open( fileName );
+            progress = 1;
+            publish( batch );
+            finish( "", Journal::fingerprint( file->data(), file->size() ) );
+            return;
+        }
+
+        std::ifstream filein( fileName.c_str() );
+
+        if ( !filein )
+        {
+            throw ShapeException( "Could not read " + fileName + "." );
+        }
+
+        ShapeParser parser( filein );
+
+        while ( !cancelled && parser.next() )
+        {
+            batch.add( parser.getType(), parser.getXs(), parser.getYs(),
+                       parser.getVertexCount(),
+                       parser.getOriginX(), parser.getOriginY(),
+                       PackedColor( parser.getRed(), parser.getGreen(),
+                                    parser.getBlue() ) );
+
+            if ( batch.size() >= BATCH_SIZE )
+            {
+                std::streamoff position = filein.tellg();
+
+                if ( file && ( position >= 0 ) && ( file->size() != 0 ) )
+                {
+                    progress = double( position ) / file->size();
+                }
+
+                publish( batch );
+            }
+        }
+
+        progress = 1;
+
+        if ( batch.size() != 0 )
+        {
+            publish( batch );
+        }
+
+        // a cancelled open is waited for, and its journal never replayed
+        bool replayable = file && !cancelled;
+        finish( "", replayable ? Journal::fingerprint( file->data(), file->size() ) : 0 );
+    }
+    catch ( const std::exception &e )
+    {
+        // batches already published stay, like shapes read before an error
+        finish( e.what() );
+    }
+}
+
+
+/**
+ * @brief   Hands a batch of opened shapes to the owner, runs on the worker
+ *          thread
+ *
+ * @param   &batch  The batch to hand over, left empty
+ *
+ * @return  void
+ */
+void FileWorker::publish( ShapeContainer &batch )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        batches.push_back( std::move( batch ) );
+    }
+
+    batch.erase();
+    notify();
+}
+
+
+/**
+ * @brief   Marks the job as done, runs on the worker thread
+ *
+ * @param   &error          The reason the job failed, or empty if it
+ *                          succeeded
+ * @param   fingerprint     The journal fingerprint of the file opened or
+ *                          written
+ *
+ * @return  void
+ */
+void FileWorker::finish( const std::string &error, uint64_t fingerprint )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        this->error = error;
+        this->fingerprint = fingerprint;
+        done = true;
+    }
+
+    notify();
+}
+
+
+/* -------------------------------------------------------------------------- */
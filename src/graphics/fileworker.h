@@ -0,0 +1,160 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    fileworker.h
+ * @brief   Background thread for opening and saving drawings
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_FILEWORKER_H
+# define GRAPHICS_FILEWORKER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+# include <cstdint>
+# include <deque>
+# include <functional>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+
+# include "shapecontainer.h"
+# include "shapestore.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Runs one file operation at a time on its own thread. Opening parses the
+ * drawing into batches of shapes that the owner takes as they arrive, so a
+ * large drawing appears bit by bit instead of all at the end; a binary
+ * drawing maps in one go and arrives as a single batch, and every batch
+ * comes with its index built, ready to be spliced in. Saving writes a
+ * snapshot of the shapes taken when the save was started, so the drawing
+ * may keep changing meanwhile, and compacting does the same for the fresh
+ * snapshot a journal is folded into.
+ *
+ * Everything except the notify function is called from the owner's thread.
+ * The worker calls notify after every batch and once when it is done, and
+ * never after cancel or the destructor has returned.
+ */
+class FileWorker
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    enum JobType
+    {
+        JOB_NONE,
+        JOB_OPEN,
+        JOB_SAVE,
+        JOB_COMPACT
+    };
+
+    struct Result
+    {
+        JobType type;
+        std::string fileName;
+        std::string error;
+
+        // of the file opened or written, for matching it with its journal
+        uint64_t fingerprint;
+    };
+
+    // shapes parsed between two batches handed to the owner
+    constexpr static const unsigned int BATCH_SIZE = 4096;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    FileWorker();
+    FileWorker( const FileWorker &worker ) = delete;
+
+    ~FileWorker();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    FileWorker &operator=( const FileWorker &worker ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void open( const std::string &fileName, std::function<void()> notify );
+    void save( const std::shared_ptr<const ShapeStore> &snapshot,
+               const std::string &fileName, std::function<void()> notify );
+    void compact( const std::shared_ptr<const ShapeStore> &snapshot,
+                  const std::string &fileName, bool binary,
+                  std::function<void()> notify );
+    void cancel();
+    void wait();
+
+    bool isBusy() const;
+    JobType getJobType() const;
+    double getProgress() const;
+
+    bool takeBatch( ShapeContainer &batch );
+    bool takeResult( Result &result );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    JobType type = JOB_NONE;
+    std::string fileName;
+    std::function<void()> notify;
+    std::thread thread;
+
+    std::atomic<bool> cancelled;
+    std::atomic<double> progress;
+
+    // shared with the worker thread
+    mutable std::mutex mutex;
+    std::deque<ShapeContainer> batches;
+    std::string error;
+    uint64_t fingerprint = 0;
+    bool done = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void start( JobType type, const std::string &fileName,
+                std::function<void()> notify, std::function<void()> work );
+
+    void load();
+    void publish( ShapeContainer &batch );
+    void finish( const std::string &error, uint64_t fingerprint = 0 );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_FILEWORKER_H
+
+
+/* -------------------------------------------------------------------------- */
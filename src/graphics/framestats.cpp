@@ -0,0 +1,417 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framestats.cpp
+ * @brief   Per-frame performance counters for the repaint path
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <atomic>
+# include <cstdio>
+# include <fstream>
+# include <stdexcept>
+
+# include "framestats.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+// counted from the first allocation on, before any constructor runs
+static std::atomic<uint64_t> allocationTotal( 0 );
+static std::atomic<uint64_t> allocationByteTotal( 0 );
+
+
+/* ------------------------------- Variables -------------------------------- */
+
+
+FrameStats FrameStats::frame;
+FrameStats FrameStats::previous;
+std::vector<FrameStats> FrameStats::frames;
+
+std::chrono::steady_clock::time_point FrameStats::frameStart;
+uint64_t FrameStats::lastAllocations = 0;
+uint64_t FrameStats::lastAllocatedBytes = 0;
+
+bool FrameStats::overlay = false;
+bool FrameStats::recording = false;
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Starts timing, if stats are active
+ *
+ * @param   &counter    The counter to add the time to
+ *
+ * @return  The created timer
+ */
+FrameStats::Timer::Timer( uint64_t &counter ):
+counter( isActive() ? &counter : nullptr )
+{
+    if ( this->counter != nullptr )
+    {
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+
+/**
+ * @brief   Timer destructor, adding the time since construction
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+FrameStats::Timer::~Timer()
+{
+    if ( counter != nullptr )
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        *counter += std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count();
+    }
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Describes the counters as short lines of upper case text, for an
+ *          overlay drawn with a small stroke font
+ *
+ * @param   void
+ *
+ * @return  The lines of text
+ */
+std::vector<std::string> FrameStats::summary() const
+{
+    char line[64];
+    std::vector<std::string> lines;
+
+    auto ms = []( uint64_t ns ) { return ns / 1e6; };
+
+    std::snprintf( line, sizeof( line ), "PAINT %.2f MS", ms( paintTime ) );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "VIEW %.2f XFORM %.2f", ms( viewUpdateTime ), ms( transformTime ) );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "DRAW %.2f MS", ms( drawTime ) );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "SHAPES %llu CULLED %llu",
+                   ( unsigned long long ) shapesDrawn, ( unsigned long long ) shapesCulled );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "VERTS %llu SEGS %llu",
+                   ( unsigned long long ) vertices, ( unsigned long long ) segments );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "REQS %llu FLUSH %llu",
+                   ( unsigned long long ) requests, ( unsigned long long ) flushes );
+    lines.push_back( line );
+    std::snprintf( line, sizeof( line ), "ALLOC %llu KB %.1f",
+                   ( unsigned long long ) allocations, allocatedBytes / 1024.0 );
+    lines.push_back( line );
+
+    return lines;
+}
+
+
+/**
+ * @brief   Gets the counters of the frame being collected
+ *
+ * @param   void
+ *
+ * @return  The current frame's counters
+ */
+FrameStats &FrameStats::current()
+{
+    return frame;
+}
+
+
+/**
+ * @brief   Gets the counters of the last finished frame
+ *
+ * @param   void
+ *
+ * @return  The last frame's counters
+ */
+const FrameStats &FrameStats::last()
+{
+    return previous;
+}
+
+
+/**
+ * @brief   Marks the start of a paint, for timing it
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameStats::beginFrame()
+{
+    if ( isActive() )
+    {
+        frameStart = std::chrono::steady_clock::now();
+    }
+}
+
+
+/**
+ * @brief   Marks the end of a paint, finishing the current frame and
+ *          starting the next one from zero
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void FrameStats::endFrame()
+{
+    if ( isActive() )
+    {
+        auto elapsed = std::chrono::steady_clock::now() - frameStart;
+        frame.paintTime = std::chrono::duration_cast<std::chrono::nanoseconds>( elapsed ).count();
+    }
+
+    uint64_t count = allocationCount();
+    uint64_t bytes = allocationBytes();
+    frame.allocations = count - lastAllocations;
+    frame.allocatedBytes = bytes - lastAllocatedBytes;
+    lastAllocations = count;
+    lastAllocatedBytes = bytes;
+
+    previous = frame;
+    frame = FrameStats();
+
+    if ( recording )
+    {
+        frames.push_back( previous );
+    }
+}
+
+
+/**
+ * @brief   Determines if the counters were compiled in
+ *
+ * @param   void
+ *
+ * @return  True if built with FRAME_STATS, false otherwise
+ */
+bool FrameStats::isBuiltIn()
+{
+# ifdef FRAME_STATS
+    return true;
+# else
+    return false;
+# endif
+}
+
+
+/**
+ * @brief   Determines if timers run, which is while the overlay is shown or
+ *          frames are recorded
+ *
+ * @param   void
+ *
+ * @return  True if stats are active, false otherwise
+ */
+bool FrameStats::isActive()
+{
+    return overlay || recording;
+}
+
+
+/**
+ * @brief   Shows or hides the overlay
+ *
+ * @param   shown   True to show the overlay, false to hide it
+ *
+ * @return  void
+ */
+void FrameStats::setOverlay( bool shown )
+{
+    overlay = shown;
+}
+
+
+/**
+ * @brief   Determines if the overlay is shown
+ *
+ * @param   void
+ *
+ * @return  True if the overlay is shown, false otherwise
+ */
+bool FrameStats::getOverlay()
+{
+    return overlay;
+}
+
+
+/**
+ * @brief   Starts or stops keeping every finished frame for a dump
+ *
+ * @param   recording   True to keep frames, false to stop
+ *
+ * @return  void
+ */
+void FrameStats::setRecording( bool recording )
+{
+    FrameStats::recording = recording;
+}
+
+
+/**
+ * @brief   Gets the frames kept while recording
+ *
+ * @param   void
+ *
+ * @return  The frames in the order they finished
+ */
+const std::vector<FrameStats> &FrameStats::history()
+{
+    return frames;
+}
+
+
+/**
+ * @brief   Writes the recorded frames to a file, as JSON if the file name
+ *          ends in .json and as CSV otherwise
+ *
+ * @param   &fileName   The name of the file to write
+ *
+ * @return  void
+ */
+void FrameStats::save( const std::string &fileName )
+{
+    std::ofstream fileout( fileName.c_str() );
+
+    if ( !fileout )
+    {
+        throw std::runtime_error( "Could not write " + fileName + "." );
+    }
+
+    std::string extension = ".json";
+
+    bool json = ( fileName.size() >= extension.size() ) &&
+                ( fileName.compare( fileName.size() - extension.size(),
+                                    extension.size(), extension ) == 0 );
+
+    if ( json )
+    {
+        writeJson( fileout );
+    }
+    else
+    {
+        writeCsv( fileout );
+    }
+}
+
+
+/**
+ * @brief   Writes the recorded frames as CSV, one frame per row
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  void
+ */
+void FrameStats::writeCsv( std::ostream &os )
+{
+    os << "frame,paint_ns,view_update_ns,transform_ns,draw_ns,vertices,"
+          "shapes_drawn,shapes_culled,segments,requests,flushes,"
+          "allocations,allocated_bytes\n";
+
+    for ( size_t i = 0; i < frames.size(); i++ )
+    {
+        const FrameStats &f = frames[i];
+
+        os << i << ',' << f.paintTime << ',' << f.viewUpdateTime << ','
+           << f.transformTime << ',' << f.drawTime << ',' << f.vertices << ','
+           << f.shapesDrawn << ',' << f.shapesCulled << ',' << f.segments << ','
+           << f.requests << ',' << f.flushes << ',' << f.allocations << ','
+           << f.allocatedBytes << '\n';
+    }
+}
+
+
+/**
+ * @brief   Writes the recorded frames as a JSON array of objects
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  void
+ */
+void FrameStats::writeJson( std::ostream &os )
+{
+    os << "[\n";
+
+    for ( size_t i = 0; i < frames.size(); i++ )
+    {
+        const FrameStats &f = frames[i];
+
+        os << "  { \"paint_ns\": " << f.paintTime
+           << ", \"view_update_ns\": " << f.viewUpdateTime
+           << ", \"transform_ns\": " << f.transformTime
+           << ", \"draw_ns\": " << f.drawTime
+           << ", \"vertices\": " << f.vertices
+           << ", \"shapes_drawn\": " << f.shapesDrawn
+           << ", \"shapes_culled\": " << f.shapesCulled
+           << ", \"segments\": " << f.segments
+           << ", \"requests\": " << f.requests
+           << ", \"flushes\": " << f.flushes
+           << ", \"allocations\": " << f.allocations
+           << ", \"allocated_bytes\": " << f.allocatedBytes
+           << " }" << ( ( i + 1 < frames.size() ) ? "," : "" ) << "\n";
+    }
+
+    os << "]\n";
+}
+
+
+/**
+ * @brief   Gets the number of allocations made by the process so far
+ *
+ * @param   void
+ *
+ * @return  The number of allocations, always zero unless the allocation
+ *          hook is linked in
+ */
+uint64_t FrameStats::allocationCount()
+{
+    return allocationTotal.load( std::memory_order_relaxed );
+}
+
+
+/**
+ * @brief   Gets the number of bytes allocated by the process so far
+ *
+ * @param   void
+ *
+ * @return  The number of bytes, always zero unless the allocation hook is
+ *          linked in
+ */
+uint64_t FrameStats::allocationBytes()
+{
+    return allocationByteTotal.load( std::memory_order_relaxed );
+}
+
+
+/**
+ * @brief   Counts an allocation, called by the allocation hook from any
+ *          thread
+ *
+ * @param   size    The number of bytes allocated
+ *
+ * @return  void
+ */
+void FrameStats::countAllocation( size_t size )
+{
+    allocationTotal.fetch_add( 1, std::memory_order_relaxed );
+    allocationByteTotal.fetch_add( size, std::memory_order_relaxed );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,158 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    framestats.h
+ * @brief   Per-frame performance counters for the repaint path
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_FRAMESTATS_H
+# define GRAPHICS_FRAMESTATS_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <chrono>
+# include <cstddef>
+# include <cstdint>
+# include <ostream>
+# include <string>
+# include <vector>
+
+
+/* --------------------------------- Macros --------------------------------- */
+
+
+// the repaint path is instrumented through these, so a build without
+// FRAME_STATS carries no trace of the counters
+# ifdef FRAME_STATS
+# define FRAME_STATS_ADD( counter, n ) ( FrameStats::current().counter += ( n ) )
+# define FRAME_STATS_TIME( counter ) FrameStats::Timer frameStatsTimer( FrameStats::current().counter )
+# define FRAME_STATS_BEGIN() FrameStats::beginFrame()
+# define FRAME_STATS_END() FrameStats::endFrame()
+# else
+# define FRAME_STATS_ADD( counter, n ) ( ( void ) 0 )
+# define FRAME_STATS_TIME( counter ) ( ( void ) 0 )
+# define FRAME_STATS_BEGIN() ( ( void ) 0 )
+# define FRAME_STATS_END() ( ( void ) 0 )
+# endif
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * The counters of one frame, from the end of the previous paint to the end
+ * of this one, so work done between paints (a view update on resize, say)
+ * is charged to the paint it leads to.
+ *
+ * Counting is plain increments and always on. Reading the clock is not
+ * free, so timers only run while stats are active, which is while the
+ * overlay is shown or frames are being recorded for a dump. Allocations are
+ * counted process-wide, by the replacement global operator new in
+ * allochook.cpp, so they include those of background threads. Only the
+ * benchmarks and builds with ENABLE_ALLOCATION_HOOK link the hook, and
+ * elsewhere allocations count as zero. The counters themselves belong to
+ * the thread that paints and must only be touched from it.
+ */
+class FrameStats
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // times are in nanoseconds
+    uint64_t paintTime = 0;
+    uint64_t viewUpdateTime = 0;
+    uint64_t transformTime = 0;
+    uint64_t drawTime = 0;
+
+    uint64_t vertices = 0;
+    uint64_t shapesDrawn = 0;
+    uint64_t shapesCulled = 0;
+    uint64_t segments = 0;
+    uint64_t requests = 0;
+    uint64_t flushes = 0;
+
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+
+
+    // adds the time until it goes out of scope to a counter, if active
+    class Timer
+    {
+    public:
+        explicit Timer( uint64_t &counter );
+        ~Timer();
+
+    private:
+        uint64_t *counter;
+        std::chrono::steady_clock::time_point start;
+    };
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    std::vector<std::string> summary() const;
+
+    static FrameStats &current();
+    static const FrameStats &last();
+
+    static void beginFrame();
+    static void endFrame();
+
+    static bool isBuiltIn();
+    static bool isActive();
+    static void setOverlay( bool shown );
+    static bool getOverlay();
+    static void setRecording( bool recording );
+
+    static const std::vector<FrameStats> &history();
+    static void save( const std::string &fileName );
+    static void writeCsv( std::ostream &os );
+    static void writeJson( std::ostream &os );
+
+    static uint64_t allocationCount();
+    static uint64_t allocationBytes();
+    static void countAllocation( size_t size );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static FrameStats frame;
+    static FrameStats previous;
+    static std::vector<FrameStats> frames;
+
+    static std::chrono::steady_clock::time_point frameStart;
+    static uint64_t lastAllocations;
+    static uint64_t lastAllocatedBytes;
+
+    static bool overlay;
+    static bool recording;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_FRAMESTATS_H
+
+
+/* -------------------------------------------------------------------------- */
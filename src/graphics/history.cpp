@@ -0,0 +1,316 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    history.cpp
+ * @brief   Undo and redo history of drawing changes
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <utility>
+
+# include "history.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty history
+ *
+ * @param   void
+ *
+ * @return  The created history
+ */
+History::History() = default;
+
+
+/**
+ * @brief   History destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+History::~History() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Starts a group of adds that are undone and redone as one step,
+ *          such as the lines of a single stroke
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void History::begin()
+{
+    grouping = true;
+    groupStarted = false;
+}
+
+
+/**
+ * @brief   Ends a group of adds started with begin()
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void History::end()
+{
+    grouping = false;
+    groupStarted = false;
+    trim();
+}
+
+
+/**
+ * @brief   Records a shape that was just added to the drawing
+ *
+ * @param   &shape  The added shape, shared rather than copied
+ * @param   handle  The shape's handle in the drawing
+ *
+ * @return  void
+ */
+void History::add( const std::shared_ptr<const Shape> &shape, ShapeStore::Handle handle )
+{
+    Step &step = ( grouping && groupStarted ) ? steps.back() : record( STEP_ADD );
+    groupStarted = grouping;
+
+    step.shapes.push_back( Added { shape, handle } );
+}
+
+
+/**
+ * @brief   Clears the drawing, moving its shapes into the history
+ *
+ * @param   &sc     The drawing to clear
+ *
+ * @return  void
+ */
+void History::clear( ShapeContainer &sc )
+{
+    Step &step = record( STEP_CLEAR );
+    step.drawing.reset( new ShapeContainer( std::move( sc ) ) );
+    sc.erase();
+
+    groupStarted = false;
+}
+
+
+/**
+ * @brief   Undoes the last step that is done
+ *
+ * @param   &sc     The drawing the step was made to
+ *
+ * @return  The step that was undone, or nullptr if there is none
+ */
+const History::Step *History::undo( ShapeContainer &sc )
+{
+    if ( !canUndo() )
+    {
+        return nullptr;
+    }
+
+    Step &step = steps[--done];
+
+    if ( step.kind == STEP_ADD )
+    {
+        for ( auto added = step.shapes.rbegin(); added != step.shapes.rend(); added++ )
+        {
+            sc.remove( added->handle );
+            added->handle = ShapeStore::INVALID_HANDLE;
+        }
+    }
+    else if ( sc.size() == 0 )
+    {
+        sc = std::move( *step.drawing );
+        step.drawing.reset();
+    }
+    else
+    {
+        // shapes arrived since the clear, so the drawing goes under them
+        // with its handles moved up, and the steps that added to it since
+        // the clear before follow their shapes
+        ShapeStore::Handle base = sc.add( *step.drawing );
+        step.drawing.reset();
+
+        for ( size_t i = done; ( i > 0 ) && ( steps[i - 1].kind == STEP_ADD ); i-- )
+        {
+            for ( Added &added : steps[i - 1].shapes )
+            {
+                if ( added.handle != ShapeStore::INVALID_HANDLE ) added.handle += base;
+            }
+        }
+    }
+
+    grouping = false;
+    groupStarted = false;
+    return &step;
+}
+
+
+/**
+ * @brief   Redoes the first step that was undone
+ *
+ * @param   &sc     The drawing to make the step to
+ *
+ * @return  The step that was redone, or nullptr if there is none
+ */
+const History::Step *History::redo( ShapeContainer &sc )
+{
+    if ( !canRedo() )
+    {
+        return nullptr;
+    }
+
+    Step &step = steps[done++];
+
+    if ( step.kind == STEP_ADD )
+    {
+        for ( Added &added : step.shapes )
+        {
+            added.handle = sc.add( *added.shape );
+        }
+    }
+    else
+    {
+        step.drawing.reset( new ShapeContainer( std::move( sc ) ) );
+        sc.erase();
+    }
+
+    grouping = false;
+    groupStarted = false;
+    return &step;
+}
+
+
+/**
+ * @brief   Determines if there is a step to undo
+ *
+ * @param   void
+ *
+ * @return  True if a step is done, false otherwise
+ */
+bool History::canUndo() const
+{
+    return done > 0;
+}
+
+
+/**
+ * @brief   Determines if there is a step to redo
+ *
+ * @param   void
+ *
+ * @return  True if a step was undone, false otherwise
+ */
+bool History::canRedo() const
+{
+    return done < steps.size();
+}
+
+
+/**
+ * @brief   Forgets every step, such as when the drawing is replaced
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void History::reset()
+{
+    steps.clear();
+    done = 0;
+    grouping = false;
+    groupStarted = false;
+}
+
+
+/**
+ * @brief   Gets the number of steps kept, done or undone
+ *
+ * @param   void
+ *
+ * @return  The number of steps
+ */
+size_t History::size() const
+{
+    return steps.size();
+}
+
+
+/**
+ * @brief   Sets the most steps to keep, forgetting the oldest beyond it
+ *
+ * @param   count   The step limit, at least one
+ *
+ * @return  void
+ */
+void History::setLimit( size_t count )
+{
+    limit = ( count > 0 ) ? count : 1;
+    trim();
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Starts a new step after the last one done, dropping the steps
+ *          that were undone
+ *
+ * @param   kind    The kind of step
+ *
+ * @return  The new step
+ */
+History::Step &History::record( StepKind kind )
+{
+    steps.erase( steps.begin() + done, steps.end() );
+
+    steps.emplace_back();
+    steps.back().kind = kind;
+    done = steps.size();
+
+    // a group is trimmed once it is complete
+    if ( !grouping )
+    {
+        trim();
+    }
+
+    return steps.back();
+}
+
+
+/**
+ * @brief   Forgets the oldest steps beyond the step limit
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void History::trim()
+{
+    while ( ( steps.size() > limit ) && ( done > 0 ) )
+    {
+        steps.pop_front();
+        done--;
+    }
+
+    // with every step undone, the furthest redo goes instead
+    while ( steps.size() > limit )
+    {
+        steps.pop_back();
+    }
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,154 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    history.h
+ * @brief   Undo and redo history of drawing changes
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_HISTORY_H
+# define GRAPHICS_HISTORY_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <deque>
+# include <memory>
+# include <vector>
+
+# include "shape.h"
+# include "shapecontainer.h"
+# include "shapestore.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Keeps the changes made to a drawing as steps that can be undone and
+ * redone, rather than snapshots of the drawing between them, so a long
+ * history costs as much memory as the edits it holds.
+ *
+ * An added shape is held as an immutable shape behind a shared pointer,
+ * which the journal record of the same change can share, along with its
+ * handle in the drawing so undoing it removes exactly that shape. Clearing
+ * moves the whole drawing into its step instead of copying it, and
+ * undoing the clear moves it back, handles and all, so earlier steps still
+ * name the right shapes. If shapes arrived in the meantime the drawing is
+ * added under them instead, and the handles of the steps that built it are
+ * moved up with it. Recording a change drops any steps undone before it.
+ * Past the step limit the oldest step is forgotten.
+ */
+class History
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    constexpr static const size_t DEFAULT_LIMIT = 1000;
+
+    enum StepKind : unsigned char
+    {
+        STEP_ADD,
+        STEP_CLEAR
+    };
+
+    // a shape added by a step, and its handle while it is in the drawing
+    struct Added
+    {
+        std::shared_ptr<const Shape> shape;
+        ShapeStore::Handle handle;
+    };
+
+    struct Step
+    {
+        StepKind kind;
+        std::vector<Added> shapes;
+
+        // the cleared drawing, while the clear is done
+        std::unique_ptr<ShapeContainer> drawing;
+    };
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    History();
+    History( const History &history ) = delete;
+
+    ~History();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    History &operator=( const History &history ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void begin();
+    void end();
+
+    void add( const std::shared_ptr<const Shape> &shape, ShapeStore::Handle handle );
+    void clear( ShapeContainer &sc );
+
+    const Step *undo( ShapeContainer &sc );
+    const Step *redo( ShapeContainer &sc );
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    void reset();
+
+    size_t size() const;
+    void setLimit( size_t count );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::deque<Step> steps;
+
+    // the number of steps that are done, the rest having been undone
+    size_t done = 0;
+
+    size_t limit = DEFAULT_LIMIT;
+
+    // adds go to the last step until end() while a group is open
+    bool grouping = false;
+    bool groupStarted = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    Step &record( StepKind kind );
+    void trim();
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_HISTORY_H
+
+
+/* -------------------------------------------------------------------------- */
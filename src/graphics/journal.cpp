@@ -0,0 +1,621 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    journal.cpp
+ * @brief   Append-only log of drawing changes made since a snapshot
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+# include <cstdio>
+# include <cstring>
+# include <memory>
+
+# include <unistd.h>
+
+# include "journal.h"
+# include "mappedfile.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+static const char MAGIC[8] = { 'S', 'H', 'A', 'P', 'E', 'J', 'N', 'L' };
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a journal that is not attached to any snapshot
+ *
+ * @param   void
+ *
+ * @return  The created journal
+ */
+Journal::Journal() = default;
+
+
+/**
+ * @brief   Journal destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+Journal::~Journal() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Starts journaling changes to a snapshot
+ *
+ * @param   &snapshotName   The name of the snapshot file, which must exist
+ * @param   fingerprint     The fingerprint of the snapshot file
+ * @param   fresh           True if the snapshot was just written and any
+ *                          existing journal is obsolete, false to continue
+ *                          the existing journal
+ *
+ * @return  void
+ */
+void Journal::attach( const std::string &snapshotName, uint64_t fingerprint,
+                      bool fresh )
+{
+    detach();
+
+    std::string journalName = nameOf( snapshotName );
+    size_t valid = 0;
+
+    if ( !fresh && ( access( journalName.c_str(), F_OK ) == 0 ) )
+    {
+        MappedFile file( journalName );
+        valid = scan( file.data(), file.size(), fingerprint, nullptr );
+    }
+
+    snapshot = snapshotName;
+
+    if ( valid == 0 )
+    {
+        start( journalName, fingerprint );
+        return;
+    }
+
+    // drop whatever follows the last intact record before appending
+    if ( truncate( journalName.c_str(), valid ) != 0 )
+    {
+        throw JournalException( "Could not truncate " + journalName + "." );
+    }
+
+    log.open( journalName.c_str(), std::ios::binary | std::ios::app );
+
+    if ( !log )
+    {
+        throw JournalException( "Could not open " + journalName + "." );
+    }
+
+    bytes = valid;
+}
+
+
+/**
+ * @brief   Stops journaling changes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Journal::detach()
+{
+    if ( log.is_open() )
+    {
+        log.close();
+    }
+
+    log.clear();
+    snapshot.clear();
+    bytes = 0;
+}
+
+
+/**
+ * @brief   Determines if this journal is recording changes to a snapshot
+ *
+ * @param   void
+ *
+ * @return  True if the journal is attached, false otherwise
+ */
+bool Journal::isAttached() const
+{
+    return log.is_open();
+}
+
+
+/**
+ * @brief   Gets the name of the snapshot this journal is attached to
+ *
+ * @param   void
+ *
+ * @return  The name of the snapshot, or an empty string if detached
+ */
+const std::string &Journal::getSnapshotName() const
+{
+    return snapshot;
+}
+
+
+/**
+ * @brief   Records that a shape was added to the drawing
+ *
+ * @param   &shape  The shape that was added
+ *
+ * @return  void
+ */
+void Journal::add( const Shape &shape )
+{
+    record( RECORD_ADD, shape );
+}
+
+
+/**
+ * @brief   Records that a shape was removed from the drawing
+ *
+ * @param   &shape  The shape that was removed
+ *
+ * @return  void
+ */
+void Journal::erase( const Shape &shape )
+{
+    record( RECORD_ERASE, shape );
+}
+
+
+/**
+ * @brief   Records that every shape was removed from the drawing
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Journal::clear()
+{
+    if ( !isAttached() )
+    {
+        return;
+    }
+
+    payload.assign( 1, RECORD_CLEAR );
+    append();
+}
+
+
+/**
+ * @brief   Gets the size of the journal file
+ *
+ * @param   void
+ *
+ * @return  The size of the journal in bytes, or zero if detached
+ */
+size_t Journal::size() const
+{
+    return bytes;
+}
+
+
+/**
+ * @brief   Sets the journal size past which it should be compacted
+ *
+ * @param   bytes   The compaction threshold in bytes
+ *
+ * @return  void
+ */
+void Journal::setThreshold( size_t bytes )
+{
+    threshold = bytes;
+}
+
+
+/**
+ * @brief   Determines if the journal has grown past its threshold
+ *
+ * @param   void
+ *
+ * @return  True if the journal should be compacted, false otherwise
+ */
+bool Journal::needsCompaction() const
+{
+    return isAttached() && ( bytes > threshold );
+}
+
+
+/**
+ * @brief   Gets the name a fresh snapshot is written to before it replaces
+ *          the one this journal is attached to
+ *
+ * @param   void
+ *
+ * @return  The name of the staged snapshot, or an empty string if detached
+ */
+std::string Journal::getStagingName() const
+{
+    return isAttached() ? snapshot + ".tmp" : std::string();
+}
+
+
+/**
+ * @brief   Replaces the snapshot with the staged one, which must hold the
+ *          drawing up to the last change journaled, and starts the journal
+ *          over
+ *
+ * @param   fingerprint     The fingerprint of the staged snapshot
+ *
+ * @return  void
+ */
+void Journal::compact( uint64_t fingerprint )
+{
+    if ( !isAttached() )
+    {
+        return;
+    }
+
+    std::string journalName = nameOf( snapshot );
+    std::string snapshotTemp = getStagingName();
+    std::string journalTemp = journalName + ".tmp";
+
+    log.close();
+    log.clear();
+    start( journalTemp, fingerprint );
+
+    // a crash between the renames leaves the old journal, which no longer
+    // matches the snapshot's fingerprint and is ignored
+    if ( ( std::rename( snapshotTemp.c_str(), snapshot.c_str() ) != 0 ) ||
+         ( std::rename( journalTemp.c_str(), journalName.c_str() ) != 0 ) )
+    {
+        throw JournalException( "Could not replace " + snapshot + "." );
+    }
+}
+
+
+/**
+ * @brief   Applies the journal of a snapshot to a shape container holding
+ *          that snapshot
+ *
+ * @param   &snapshotName   The name of the snapshot file
+ * @param   fingerprint     The fingerprint of the snapshot file
+ * @param   &sc             The shape container to apply the journal to
+ *
+ * @return  The number of journal bytes that were applied, which is zero if
+ *          there is no journal or it belongs to another snapshot
+ */
+size_t Journal::replay( const std::string &snapshotName, uint64_t fingerprint,
+                        ShapeContainer &sc )
+{
+    std::string journalName = nameOf( snapshotName );
+
+    if ( access( journalName.c_str(), F_OK ) != 0 )
+    {
+        return 0;
+    }
+
+    MappedFile file( journalName );
+    return scan( file.data(), file.size(), fingerprint, &sc );
+}
+
+
+/**
+ * @brief   Gets the name of the journal that belongs to a snapshot
+ *
+ * @param   &snapshotName   The name of the snapshot file
+ *
+ * @return  The name of the journal file
+ */
+std::string Journal::nameOf( const std::string &snapshotName )
+{
+    return snapshotName + EXTENSION;
+}
+
+
+/**
+ * @brief   Computes the 64-bit FNV-1a hash of a snapshot's contents, which
+ *          ties a journal to the exact snapshot it was started from
+ *
+ * @param   *data   The contents of the snapshot
+ * @param   size    The size of the snapshot in bytes
+ *
+ * @return  The fingerprint
+ */
+uint64_t Journal::fingerprint( const unsigned char *data, size_t size )
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief   Computes the fingerprint of a snapshot file, reading all of it
+ *
+ * @param   &fileName   The name of the snapshot file
+ *
+ * @return  The fingerprint
+ */
+uint64_t Journal::fingerprint( const std::string &fileName )
+{
+    MappedFile file( fileName );
+    return fingerprint( file.data(), file.size() );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Creates an empty journal file and appends to it from now on
+ *
+ * @param   &fileName               The name of the journal file to create
+ * @param   snapshotFingerprint     The fingerprint of the snapshot the
+ *                                  journal belongs to
+ *
+ * @return  void
+ */
+void Journal::start( const std::string &fileName, uint64_t snapshotFingerprint )
+{
+    log.open( fileName.c_str(), std::ios::binary | std::ios::trunc );
+
+    if ( !log )
+    {
+        throw JournalException( "Could not create " + fileName + "." );
+    }
+
+    FileHeader header;
+    std::memset( &header, 0, sizeof( header ) );
+    std::memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+    header.version = VERSION;
+    header.snapshotFingerprint = snapshotFingerprint;
+
+    log.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    log.flush();
+
+    if ( !log )
+    {
+        throw JournalException( "Could not write " + fileName + "." );
+    }
+
+    bytes = sizeof( header );
+}
+
+
+/**
+ * @brief   Appends a record carrying a whole shape
+ *
+ * @param   kind    The kind of record
+ * @param   &shape  The shape to record
+ *
+ * @return  void
+ */
+void Journal::record( RecordKind kind, const Shape &shape )
+{
+    if ( !isAttached() )
+    {
+        return;
+    }
+
+    const Shape::Vertex *verts = shape.data();
+    unsigned int n = shape.size();
+    PackedColor color = shape.getColor();
+    const Point2D &origin = shape.getOrigin();
+
+    ShapeRecord fixed;
+    std::memset( &fixed, 0, sizeof( fixed ) );
+    fixed.kind = kind;
+    fixed.type = ShapeStore::typeOf( shape );
+    fixed.vertices = n;
+    fixed.originX = origin.getX();
+    fixed.originY = origin.getY();
+    fixed.color = color.toARGB();
+
+    payload.resize( sizeof( fixed ) + 2 * n * sizeof( double ) );
+    std::memcpy( payload.data(), &fixed, sizeof( fixed ) );
+
+    // vertices are widened to doubles so the journal does not depend on how
+    // shapes store them
+    unsigned char *xs = payload.data() + sizeof( fixed );
+    unsigned char *ys = xs + n * sizeof( double );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        double x = verts[i].x;
+        double y = verts[i].y;
+        std::memcpy( xs + i * sizeof( double ), &x, sizeof( double ) );
+        std::memcpy( ys + i * sizeof( double ), &y, sizeof( double ) );
+    }
+
+    append();
+}
+
+
+/**
+ * @brief   Writes the pending payload to the journal as one record and
+ *          flushes it
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void Journal::append()
+{
+    RecordHeader header;
+    header.length = payload.size();
+    header.checksum = checksum( payload.data(), payload.size() );
+
+    log.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    log.write( reinterpret_cast<const char*>( payload.data() ), payload.size() );
+    log.flush();
+
+    if ( !log )
+    {
+        throw JournalException( "Could not write " + nameOf( snapshot ) + "." );
+    }
+
+    bytes += sizeof( header ) + payload.size();
+}
+
+
+/**
+ * @brief   Walks the records of a journal, optionally applying them
+ *
+ * @param   *data                   The contents of the journal
+ * @param   size                    The size of the journal in bytes
+ * @param   snapshotFingerprint     The fingerprint of the snapshot the
+ *                                  journal must belong to
+ * @param   *sc                     The shape container to apply the records
+ *                                  to, or null to only validate them
+ *
+ * @return  The number of bytes up to the end of the last intact record, or
+ *          zero if the journal is unusable
+ */
+size_t Journal::scan( const unsigned char *data, size_t size,
+                      uint64_t snapshotFingerprint, ShapeContainer *sc )
+{
+    FileHeader header;
+
+    if ( size < sizeof( header ) )
+    {
+        return 0;
+    }
+
+    std::memcpy( &header, data, sizeof( header ) );
+
+    if ( ( std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) != 0 ) ||
+         ( header.version != VERSION ) ||
+         ( header.snapshotFingerprint != snapshotFingerprint ) )
+    {
+        return 0;
+    }
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    size_t pos = sizeof( header );
+
+    while ( size - pos >= sizeof( RecordHeader ) )
+    {
+        RecordHeader record;
+        std::memcpy( &record, data + pos, sizeof( record ) );
+
+        const unsigned char *body = data + pos + sizeof( record );
+
+        if ( ( record.length == 0 ) ||
+             ( size - pos - sizeof( record ) < record.length ) ||
+             ( checksum( body, record.length ) != record.checksum ) )
+        {
+            break;
+        }
+
+        if ( body[0] == RECORD_CLEAR )
+        {
+            if ( record.length != 1 )
+            {
+                break;
+            }
+
+            if ( sc != nullptr ) sc->erase();
+        }
+        else if ( ( body[0] == RECORD_ADD ) || ( body[0] == RECORD_ERASE ) )
+        {
+            ShapeRecord fixed;
+
+            if ( record.length < sizeof( fixed ) )
+            {
+                break;
+            }
+
+            std::memcpy( &fixed, body, sizeof( fixed ) );
+
+            unsigned int n = fixed.vertices;
+            ShapeStore::ShapeType type = static_cast<ShapeStore::ShapeType>( fixed.type );
+
+            if ( ( record.length != sizeof( fixed ) + 2 * uint64_t( n ) * sizeof( double ) ) ||
+                 ( type > ShapeStore::TYPE_POLYGON ) ||
+                 ( ( type == ShapeStore::TYPE_LINE ) && ( n != 2 ) ) ||
+                 ( ( type == ShapeStore::TYPE_TRIANGLE ) && ( n != 3 ) ) )
+            {
+                break;
+            }
+
+            // records are not aligned, so copy the coordinates out
+            xs.resize( n );
+            ys.resize( n );
+            std::memcpy( xs.data(), body + sizeof( fixed ), n * sizeof( double ) );
+            std::memcpy( ys.data(), body + sizeof( fixed ) + n * sizeof( double ),
+                         n * sizeof( double ) );
+
+            // a record that would put a shape at infinity is as bad as a
+            // torn one
+            if ( !ShapeStore::isFinite( xs.data(), n ) || !ShapeStore::isFinite( ys.data(), n ) ||
+                 !std::isfinite( fixed.originX ) || !std::isfinite( fixed.originY ) )
+            {
+                break;
+            }
+
+            if ( sc != nullptr )
+            {
+                if ( body[0] == RECORD_ADD )
+                {
+                    sc->add( type, xs.data(), ys.data(), n,
+                             fixed.originX, fixed.originY,
+                             PackedColor( fixed.color ) );
+                }
+                else
+                {
+                    sc->remove( type, xs.data(), ys.data(), n,
+                                fixed.originX, fixed.originY,
+                                PackedColor( fixed.color ) );
+                }
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        pos += sizeof( record ) + record.length;
+    }
+
+    return pos;
+}
+
+
+/**
+ * @brief   Computes the 32-bit FNV-1a hash of a block of bytes
+ *
+ * @param   *data   The bytes to hash
+ * @param   size    The number of bytes
+ *
+ * @return  The hash
+ */
+uint32_t Journal::checksum( const unsigned char *data, size_t size )
+{
+    uint32_t hash = 2166136261u;
+
+    for ( size_t i = 0; i < size; i++ )
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+/* -------------------------------------------------------------------------- */
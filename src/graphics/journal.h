@@ -0,0 +1,193 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    journal.h
+ * @brief   Append-only log of drawing changes made since a snapshot
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_JOURNAL_H
+# define GRAPHICS_JOURNAL_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <cstdint>
+# include <fstream>
+# include <stdexcept>
+# include <string>
+# include <vector>
+
+# include "shape.h"
+# include "shapecontainer.h"
+# include "shapestore.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class JournalException : public std::runtime_error
+{
+public:
+    explicit JournalException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Journal Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+/*
+ * A journal sits next to a drawing file (the snapshot) and records every
+ * change made after the snapshot was written, so saving costs as much as
+ * the change rather than the whole drawing. Each record is flushed as soon
+ * as it is appended, which also makes the journal a crash log: opening a
+ * drawing replays its snapshot and then its journal.
+ *
+ * The journal is a short header followed by records, each a payload length,
+ * an FNV-1a checksum of the payload and the payload itself. A torn or
+ * corrupt record ends the replay and is cut off when the journal is next
+ * attached. The header stamps a 64-bit FNV-1a fingerprint of every byte of
+ * the snapshot the journal belongs to, so a journal left behind by an
+ * interrupted compaction, or by a snapshot rewritten some other way, is
+ * recognized as stale rather than replayed against the wrong drawing.
+ * Fingerprinting reads the whole snapshot, so it is done by whoever just
+ * read or wrote it, off the event thread. Once the journal grows past its
+ * threshold it is folded into a fresh snapshot and started over.
+ */
+class Journal
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // journals are named after their snapshot with this suffix appended
+    constexpr static const char *EXTENSION = ".journal";
+
+    constexpr static const uint32_t VERSION = 3;
+
+    constexpr static const size_t DEFAULT_THRESHOLD = 4 * 1024 * 1024;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    Journal();
+    Journal( const Journal &journal ) = delete;
+
+    ~Journal();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    Journal &operator=( const Journal &journal ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void attach( const std::string &snapshotName, uint64_t fingerprint,
+                 bool fresh );
+    void detach();
+    bool isAttached() const;
+    const std::string &getSnapshotName() const;
+
+    void add( const Shape &shape );
+    void erase( const Shape &shape );
+    void clear();
+
+    size_t size() const;
+    void setThreshold( size_t bytes );
+    bool needsCompaction() const;
+    std::string getStagingName() const;
+    void compact( uint64_t fingerprint );
+
+    static size_t replay( const std::string &snapshotName, uint64_t fingerprint,
+                          ShapeContainer &sc );
+    static std::string nameOf( const std::string &snapshotName );
+    static uint64_t fingerprint( const unsigned char *data, size_t size );
+    static uint64_t fingerprint( const std::string &fileName );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    enum RecordKind : unsigned char
+    {
+        RECORD_ADD = 1,
+        RECORD_ERASE = 2,
+        RECORD_CLEAR = 3
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t snapshotFingerprint;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t length;
+        uint32_t checksum;
+    };
+
+    // the fixed part of an add or erase payload, with the color packed as
+    // 0xAARRGGBB, followed by the x and then the y coordinates of every
+    // vertex
+    struct ShapeRecord
+    {
+        unsigned char kind;
+        unsigned char type;
+        unsigned char reserved[2];
+        uint32_t vertices;
+        uint32_t color;
+        uint32_t padding;
+        double originX;
+        double originY;
+    };
+
+    std::string snapshot;
+    std::ofstream log;
+    size_t bytes = 0;
+    size_t threshold = DEFAULT_THRESHOLD;
+
+    std::vector<unsigned char> payload;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void start( const std::string &fileName, uint64_t snapshotFingerprint );
+    void record( RecordKind kind, const Shape &shape );
+    void append();
+
+    static size_t scan( const unsigned char *data, size_t size,
+                        uint64_t snapshotFingerprint, ShapeContainer *sc );
+    static uint32_t checksum( const unsigned char *data, size_t size );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_JOURNAL_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,116 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mappedfile.cpp
+ * @brief   Read-only memory mapping of a file
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+
+# include "mappedfile.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Maps a file into memory for reading
+ *
+ * @param   &fileName   The name of the file to map
+ *
+ * @return  The created mapping
+ */
+MappedFile::MappedFile( const std::string &fileName )
+{
+    int fd = open( fileName.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        throw MappedFileException( "Could not open " + fileName + "." );
+    }
+
+    struct stat info;
+
+    if ( fstat( fd, &info ) != 0 )
+    {
+        close( fd );
+        throw MappedFileException( "Could not stat " + fileName + "." );
+    }
+
+    length = info.st_size;
+
+    // mmap rejects empty mappings, so an empty file simply has no data
+    if ( length != 0 )
+    {
+        void *mapping = mmap( nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if ( mapping == MAP_FAILED )
+        {
+            close( fd );
+            throw MappedFileException( "Could not map " + fileName + "." );
+        }
+
+        // the whole file is about to be read front to back
+        madvise( mapping, length, MADV_SEQUENTIAL );
+        bytes = static_cast<const unsigned char*>( mapping );
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    close( fd );
+}
+
+
+/**
+ * @brief   Mapped file destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+MappedFile::~MappedFile()
+{
+    if ( bytes != nullptr )
+    {
+        munmap( const_cast<unsigned char*>( bytes ), length );
+    }
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the mapped contents of the file
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first byte of the file, or null if it is empty
+ */
+const unsigned char *MappedFile::data() const
+{
+    return bytes;
+}
+
+
+/**
+ * @brief   Gets the size of the mapped file
+ *
+ * @param   void
+ *
+ * @return  The size of the file in bytes
+ */
+size_t MappedFile::size() const
+{
+    return length;
+}
+
+
+/* -------------------------------------------------------------------------- */
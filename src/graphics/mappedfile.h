@@ -0,0 +1,86 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    mappedfile.h
+ * @brief   Read-only memory mapping of a file
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_MAPPEDFILE_H
+# define GRAPHICS_MAPPEDFILE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class MappedFileException : public std::runtime_error
+{
+public:
+    explicit MappedFileException( const std::string& msg ):
+    std::runtime_error( ( std::string( "Mapped File Exception: " ) + msg ).c_str() )
+    {}
+};
+
+
+class MappedFile
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit MappedFile( const std::string &fileName );
+    MappedFile( const MappedFile &file ) = delete;
+
+    ~MappedFile();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    MappedFile &operator=( const MappedFile &file ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    const unsigned char *data() const;
+    size_t size() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_MAPPEDFILE_H
+
+
+/* -------------------------------------------------------------------------- */
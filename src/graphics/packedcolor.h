@@ -0,0 +1,275 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    packedcolor.h
+ * @brief   Compact 32-bit color used as shape storage
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_PACKEDCOLOR_H
+# define GRAPHICS_PACKEDCOLOR_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstdint>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Holds a color as four 8-bit channels packed into one word, laid out as
+ * 0xAARRGGBB so the low 24 bits are already the pixel value of a 24-bit
+ * TrueColor visual and converting to X11 is a mask. Color is the floating
+ * point type to do color math with; a packed color converts to and from it.
+ *
+ * Channels are clamped to [0, 1] and rounded to the nearest step, so
+ * unpacking a packed color and packing it again gives the same color.
+ */
+class PackedColor
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    PackedColor() = default;
+    explicit PackedColor( uint32_t argb );
+    PackedColor( double r, double g, double b, double a = 1 );
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    bool operator==( PackedColor c ) const;
+    bool operator!=( PackedColor c ) const;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    double getRed() const;
+    double getGreen() const;
+    double getBlue() const;
+    double getAlpha() const;
+
+    uint32_t toARGB() const;
+    unsigned int toX11() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    uint32_t argb = 0xFF000000;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static uint32_t pack( double channel );
+    double unpack( unsigned int shift ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a color from its packed 0xAARRGGBB value
+ *
+ * @param   argb    The packed value
+ *
+ * @return  The created color
+ */
+inline PackedColor::PackedColor( uint32_t argb ):
+argb( argb )
+{}
+
+
+/**
+ * @brief   Creates a color from floating point channel values
+ *
+ * @param   r   The color's red channel
+ * @param   g   The color's green channel
+ * @param   b   The color's blue channel
+ * @param   a   The color's alpha channel
+ *
+ * @return  The created color
+ */
+inline PackedColor::PackedColor( double r, double g, double b, double a ):
+argb( ( pack( a ) << 24 ) | ( pack( r ) << 16 ) | ( pack( g ) << 8 ) | pack( b ) )
+{}
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Determines if two colors are equal
+ *
+ * @param   c   The color to compare against
+ *
+ * @return  True if every channel is equal, false otherwise
+ */
+inline bool PackedColor::operator==( PackedColor c ) const
+{
+    return argb == c.argb;
+}
+
+
+/**
+ * @brief   Determines if two colors differ
+ *
+ * @param   c   The color to compare against
+ *
+ * @return  True if any channel differs, false otherwise
+ */
+inline bool PackedColor::operator!=( PackedColor c ) const
+{
+    return argb != c.argb;
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the red channel of this color
+ *
+ * @param   void
+ *
+ * @return  The red channel, from 0 to 1
+ */
+inline double PackedColor::getRed() const
+{
+    return unpack( 16 );
+}
+
+
+/**
+ * @brief   Gets the green channel of this color
+ *
+ * @param   void
+ *
+ * @return  The green channel, from 0 to 1
+ */
+inline double PackedColor::getGreen() const
+{
+    return unpack( 8 );
+}
+
+
+/**
+ * @brief   Gets the blue channel of this color
+ *
+ * @param   void
+ *
+ * @return  The blue channel, from 0 to 1
+ */
+inline double PackedColor::getBlue() const
+{
+    return unpack( 0 );
+}
+
+
+/**
+ * @brief   Gets the alpha channel of this color
+ *
+ * @param   void
+ *
+ * @return  The alpha channel, from 0 to 1
+ */
+inline double PackedColor::getAlpha() const
+{
+    return unpack( 24 );
+}
+
+
+/**
+ * @brief   Gets the packed value of this color
+ *
+ * @param   void
+ *
+ * @return  The color as 0xAARRGGBB
+ */
+inline uint32_t PackedColor::toARGB() const
+{
+    return argb;
+}
+
+
+/**
+ * @brief   Converts this color to an X11 compatible color
+ *
+ * @param   void
+ *
+ * @return  The 24-bit RGB pixel value of this color
+ */
+inline unsigned int PackedColor::toX11() const
+{
+    return argb & 0x00FFFFFF;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Packs a floating point channel into 8 bits
+ *
+ * @param   channel     The channel value, clamped to [0, 1]
+ *
+ * @return  The 8-bit channel value
+ */
+inline uint32_t PackedColor::pack( double channel )
+{
+    // written so that NaN packs as zero
+    if ( !( channel > 0 ) )
+    {
+        return 0;
+    }
+
+    if ( channel >= 1 )
+    {
+        return 255;
+    }
+
+    return uint32_t( channel * 255 + 0.5 );
+}
+
+
+/**
+ * @brief   Unpacks an 8-bit channel of this color
+ *
+ * @param   shift   The bit position of the channel
+ *
+ * @return  The channel value, from 0 to 1
+ */
+inline double PackedColor::unpack( unsigned int shift ) const
+{
+    return ( ( argb >> shift ) & 0xFF ) / 255.0;
+}
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_PACKEDCOLOR_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,373 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    quadtree.h
+ * @brief   Templated loose quadtree spatial index
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_QUADTREE_H
+# define GRAPHICS_QUADTREE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <unordered_map>
+# include <vector>
+
+# include "boundingbox.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * A loose quadtree over model space. Every node owns a square cell; its
+ * loose bounds are the cell grown to twice its size, so an item is stored
+ * in the smallest cell that contains its center and whose loose bounds
+ * contain the whole item. Placement depends only on an item's own bounding
+ * box, so insertion and removal are incremental and never rebalance. The
+ * root grows outward on demand, so no world bounds need to be known ahead
+ * of time.
+ */
+template<typename T>
+class QuadTree
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    QuadTree() = default;
+    ~QuadTree() = default;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool insert( const T &item, const BoundingBox &box )
+    {
+        // the root only grows as far as the largest coordinate, so a box
+        // that is not finite, or too far out to place precisely, is refused
+        if ( !placeable( box.getMinX() ) || !placeable( box.getMaxX() ) ||
+             !placeable( box.getMinY() ) || !placeable( box.getMaxY() ) )
+        {
+            return false;
+        }
+
+        double cx = ( box.getMinX() + box.getMaxX() ) / 2;
+        double cy = ( box.getMinY() + box.getMaxY() ) / 2;
+        double extent = std::max( box.getWidth(), box.getHeight() ) / 2;
+
+        // plant the root on the very first item
+        if ( nodes.empty() )
+        {
+            double half = MIN_HALF_SIZE;
+            while ( half < extent ) half *= 2;
+            nodes.push_back( Node( cx, cy, half ) );
+            root = 0;
+        }
+
+        // grow the root until the item fits inside it
+        while ( !fits( nodes[root], cx, cy, extent ) )
+        {
+            grow( cx, cy );
+        }
+
+        // descend while the item also fits in the child holding its center
+        int index = root;
+        unsigned int depth = 0;
+
+        while ( ( depth < MAX_DEPTH ) && ( extent <= nodes[index].half / 2 ) )
+        {
+            int quadrant = quadrantOf( nodes[index], cx, cy );
+            index = child( index, quadrant );
+            depth++;
+        }
+
+        nodes[index].entries.push_back( Entry( item, box ) );
+        locations[item] = index;
+        count++;
+        return true;
+    }
+
+
+    bool remove( const T &item )
+    {
+        auto location = locations.find( item );
+
+        if ( location == locations.end() )
+        {
+            return false;
+        }
+
+        std::vector<Entry> &entries = nodes[location->second].entries;
+
+        for ( unsigned int i = 0; i < entries.size(); i++ )
+        {
+            if ( entries[i].item == item )
+            {
+                entries[i] = entries.back();
+                entries.pop_back();
+                break;
+            }
+        }
+
+        locations.erase( location );
+        count--;
+        return true;
+    }
+
+
+    void query( const BoundingBox &box, std::vector<T> &results ) const
+    {
+        if ( nodes.empty() )
+        {
+            return;
+        }
+
+        std::vector<int> &stack = scratch;
+        stack.clear();
+        stack.push_back( root );
+
+        while ( !stack.empty() )
+        {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+
+            BoundingBox loose = looseBounds( node );
+
+            if ( !box.intersects( loose ) )
+            {
+                continue;
+            }
+
+            // everything below a fully covered node is a hit without tests
+            if ( box.contains( loose ) )
+            {
+                collect( node, results );
+                continue;
+            }
+
+            for ( const Entry &entry : node.entries )
+            {
+                if ( box.intersects( entry.box ) )
+                {
+                    results.push_back( entry.item );
+                }
+            }
+
+            for ( int c : node.children )
+            {
+                if ( c >= 0 ) stack.push_back( c );
+            }
+        }
+    }
+
+
+    // calls fn( item, box ) for every item, in no particular order
+    template<typename F>
+    void forEach( F fn ) const
+    {
+        for ( const Node &node : nodes )
+        {
+            for ( const Entry &entry : node.entries )
+            {
+                fn( entry.item, entry.box );
+            }
+        }
+    }
+
+
+    bool contains( const T &item ) const
+    {
+        return locations.find( item ) != locations.end();
+    }
+
+
+    const BoundingBox *find( const T &item ) const
+    {
+        auto location = locations.find( item );
+
+        if ( location == locations.end() )
+        {
+            return nullptr;
+        }
+
+        for ( const Entry &entry : nodes[location->second].entries )
+        {
+            if ( entry.item == item ) return &entry.box;
+        }
+
+        return nullptr;
+    }
+
+
+    void clear()
+    {
+        nodes.clear();
+        locations.clear();
+        count = 0;
+        root = -1;
+    }
+
+
+    unsigned int size() const
+    {
+        return count;
+    }
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    static constexpr double MIN_HALF_SIZE = 1.0 / 1024;
+    static constexpr unsigned int MAX_DEPTH = 24;
+
+    // the largest coordinate magnitude a box may have, which bounds the
+    // root to a few hundred doublings of the smallest cell
+    static constexpr double MAX_COORDINATE = 1e150;
+
+    struct Entry
+    {
+        Entry( const T &item, const BoundingBox &box ):
+            item( item ), box( box )
+        {}
+
+        T item;
+        BoundingBox box;
+    };
+
+    struct Node
+    {
+        Node( double cx, double cy, double half ):
+            cx( cx ), cy( cy ), half( half )
+        {}
+
+        double cx;
+        double cy;
+        double half;
+        int children[4] = { -1, -1, -1, -1 };
+        std::vector<Entry> entries;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<T, int> locations;
+    mutable std::vector<int> scratch;
+    unsigned int count = 0;
+    int root = -1;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static bool placeable( double value )
+    {
+        return std::isfinite( value ) && ( std::fabs( value ) <= MAX_COORDINATE );
+    }
+
+
+    static bool fits( const Node &node, double cx, double cy, double extent )
+    {
+        return ( std::fabs( cx - node.cx ) <= node.half ) &&
+               ( std::fabs( cy - node.cy ) <= node.half ) &&
+               ( extent <= node.half );
+    }
+
+
+    static int quadrantOf( const Node &node, double x, double y )
+    {
+        return ( ( x >= node.cx ) ? 1 : 0 ) + ( ( y >= node.cy ) ? 2 : 0 );
+    }
+
+
+    static BoundingBox looseBounds( const Node &node )
+    {
+        double loose = node.half * 2;
+        return BoundingBox( node.cx - loose, node.cy - loose,
+                            node.cx + loose, node.cy + loose );
+    }
+
+
+    int child( int index, int quadrant )
+    {
+        if ( nodes[index].children[quadrant] < 0 )
+        {
+            double half = nodes[index].half / 2;
+            double cx = nodes[index].cx + ( ( quadrant & 1 ) ? half : -half );
+            double cy = nodes[index].cy + ( ( quadrant & 2 ) ? half : -half );
+
+            // push_back may move the nodes, so index rather than reference
+            nodes.push_back( Node( cx, cy, half ) );
+            nodes[index].children[quadrant] = nodes.size() - 1;
+        }
+
+        return nodes[index].children[quadrant];
+    }
+
+
+    void grow( double towardX, double towardY )
+    {
+        // the old root becomes one quadrant of a root twice its size,
+        // extended in the direction of the point that did not fit
+        const Node old = Node( nodes[root].cx, nodes[root].cy, nodes[root].half );
+
+        double sx = ( towardX >= old.cx ) ? 1 : -1;
+        double sy = ( towardY >= old.cy ) ? 1 : -1;
+
+        nodes.push_back( Node( old.cx + sx * old.half, old.cy + sy * old.half, old.half * 2 ) );
+        int grown = nodes.size() - 1;
+
+        int quadrant = ( ( sx < 0 ) ? 1 : 0 ) + ( ( sy < 0 ) ? 2 : 0 );
+        nodes[grown].children[quadrant] = root;
+        root = grown;
+    }
+
+
+    void collect( const Node &top, std::vector<T> &results ) const
+    {
+        std::vector<const Node *> stack;
+        stack.push_back( &top );
+
+        while ( !stack.empty() )
+        {
+            const Node *node = stack.back();
+            stack.pop_back();
+
+            for ( const Entry &entry : node->entries )
+            {
+                results.push_back( entry.item );
+            }
+
+            for ( int c : node->children )
+            {
+                if ( c >= 0 ) stack.push_back( &nodes[c] );
+            }
+        }
+    }
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_QUADTREE_H
+
+
+/* -------------------------------------------------------------------------- */
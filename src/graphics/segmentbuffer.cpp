@@ -0,0 +1,144 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    segmentbuffer.cpp
+ * @brief   Per-color accumulator of device space line segments
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "framestats.h"
+# include "segmentbuffer.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty segment buffer
+ *
+ * @param   void
+ *
+ * @return  The created segment buffer
+ */
+SegmentBuffer::SegmentBuffer() = default;
+
+
+/**
+ * @brief   Segment buffer destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+SegmentBuffer::~SegmentBuffer() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the batch of segments for a color so that a shape can append
+ *          all of its edges with a single lookup
+ *
+ * @param   color   The 24-bit RGB color of the batch
+ *
+ * @return  A reference to the batch of segments for the color
+ */
+std::vector<GraphicsContext::Segment> &SegmentBuffer::batch( unsigned int color )
+{
+    return batches[color];
+}
+
+
+/**
+ * @brief   Adds a single segment to the batch for a color
+ *
+ * @param   color   The 24-bit RGB color of the segment
+ * @param   x1      The x-coordinate of the start of the segment
+ * @param   y1      The y-coordinate of the start of the segment
+ * @param   x2      The x-coordinate of the end of the segment
+ * @param   y2      The y-coordinate of the end of the segment
+ *
+ * @return  void
+ */
+void SegmentBuffer::add( unsigned int color, int x1, int y1, int x2, int y2 )
+{
+    GraphicsContext::Segment segment = { x1, y1, x2, y2 };
+    batches[color].push_back( segment );
+}
+
+
+/**
+ * @brief   Submits the buffered segments to a graphics context, setting
+ *          each color once
+ *
+ * @param   *gc     The graphics context to draw to
+ *
+ * @return  void
+ */
+void SegmentBuffer::submit( GraphicsContext *gc ) const
+{
+    for ( const auto &entry : batches )
+    {
+        if ( !entry.second.empty() )
+        {
+            FRAME_STATS_ADD( segments, entry.second.size() );
+            gc->setColor( entry.first );
+            gc->drawLines( entry.second.data(), entry.second.size() );
+        }
+    }
+}
+
+
+/**
+ * @brief   Removes all buffered segments, keeping the storage of colors that
+ *          were used since the last clear for reuse
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void SegmentBuffer::clear()
+{
+    auto it = batches.begin();
+
+    while ( it != batches.end() )
+    {
+        if ( it->second.empty() )
+        {
+            it = batches.erase( it );
+        }
+        else
+        {
+            it->second.clear();
+            ++it;
+        }
+    }
+}
+
+
+/**
+ * @brief   Gets the number of buffered segments
+ *
+ * @param   void
+ *
+ * @return  The number of buffered segments across all colors
+ */
+size_t SegmentBuffer::size() const
+{
+    size_t count = 0;
+
+    for ( const auto &entry : batches )
+    {
+        count += entry.second.size();
+    }
+
+    return count;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,75 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    segmentbuffer.h
+ * @brief   Per-color accumulator of device space line segments
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SEGMENTBUFFER_H
+# define GRAPHICS_SEGMENTBUFFER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <map>
+# include <vector>
+
+# include "gcontext.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+class SegmentBuffer
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    SegmentBuffer();
+    ~SegmentBuffer();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    std::vector<GraphicsContext::Segment> &batch( unsigned int color );
+
+    void add( unsigned int color, int x1, int y1, int x2, int y2 );
+
+    void submit( GraphicsContext *gc ) const;
+    void clear();
+
+    size_t size() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::map<unsigned int, std::vector<GraphicsContext::Segment>> batches;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SEGMENTBUFFER_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -3,7 +3,7 @@
 
 /**
  * @file    shapecontainer.cpp
- * @brief   Set container of shape pointers
+ * @brief   Spatially indexed container of shapes
  */
 
 
@@ -11,14 +11,22 @@
 
 
 # include <algorithm>
-# include <set>
-# include <sstream>
+# include <atomic>
+# include <fstream>
+# include <functional>
+# include <memory>
 
-# include "line.h"
-# include "polygon.h"
+# include "framestats.h"
 # include "shape.h"
 # include "shapecontainer.h"
-# include "triangle.h"
+# include "shapeparser.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+// the last container version handed out, by any shape container
+static std::atomic<unsigned long> lastVersion( 0 );
 
 
 /* ----------------------- Constructors / Destructors ----------------------- */
@@ -35,16 +43,26 @@ ShapeContainer::ShapeContainer() = default;
 
 
 /**
- * @brief   Creates a shape container from an existing shape container
+ * @brief   Creates a shape container from an existing shape container,
+ *          copying its store and index as they are rather than re-adding
+ *          every shape
  *
  * @param   &sc     The shape container to create from
  *
  * @return  The created shape container
  */
-ShapeContainer::ShapeContainer( const ShapeContainer &sc )
-{
-    add( sc );
-}
+ShapeContainer::ShapeContainer( const ShapeContainer &sc ) = default;
+
+
+/**
+ * @brief   Creates a shape container from a shape container that is no
+ *          longer needed, taking over its shapes and index
+ *
+ * @param   &&sc    The shape container to move from
+ *
+ * @return  The created shape container
+ */
+ShapeContainer::ShapeContainer( ShapeContainer &&sc ) = default;
 
 
 /**
@@ -54,14 +72,7 @@ ShapeContainer::ShapeContainer( const ShapeContainer &sc )
  *
  * @return  void
  */
-ShapeContainer::~ShapeContainer()
-{
-    std::for_each( shapes.begin(), shapes.end(), [this]( Shape *shape )
-       {
-           delete shape;
-       }
-    );
-}
+ShapeContainer::~ShapeContainer() = default;
 
 
 /* -------------------------- Overloaded Operators -------------------------- */
@@ -75,12 +86,18 @@ ShapeContainer::~ShapeContainer()
  *
  * @return  This shape container
  */
-ShapeContainer &ShapeContainer::operator=( const ShapeContainer &sc )
-{
-    erase();
-    add( sc );
-    return *this;
-}
+ShapeContainer &ShapeContainer::operator=( const ShapeContainer &sc ) = default;
+
+
+/**
+ * @brief   Assigns the shapes from a shape container that is no longer needed
+ *          to this shape container, taking over its shapes and index
+ *
+ * @param   &&sc    The shape container to move from
+ *
+ * @return  This shape container
+ */
+ShapeContainer &ShapeContainer::operator=( ShapeContainer &&sc ) = default;
 
 
 /**
@@ -107,11 +124,13 @@ std::ostream &operator<<( std::ostream &os, const ShapeContainer &sc )
  *
  * @param   &shape  The shape to add
  *
- * @return  void
+ * @return  The handle of the added shape
  */
-void ShapeContainer::add( const Shape &shape )
+ShapeStore::Handle ShapeContainer::add( const Shape &shape )
 {
-    shapes.insert( shape.clone() );
+    ShapeStore::Handle handle = store.add( shape );
+    insert( handle );
+    return handle;
 }
 
 
@@ -121,15 +140,164 @@ void ShapeContainer::add( const Shape &shape )
  *
  * @param   &sc  The shape container to add
  *
- * @return  void
+ * @return  The amount every handle of the added shapes moved up by
  */
-void ShapeContainer::add( const ShapeContainer &sc )
+ShapeStore::Handle ShapeContainer::add( const ShapeContainer &sc )
 {
-    std::for_each( sc.shapes.begin(), sc.shapes.end(), [this]( Shape *shape )
+    // adding to the index being read would read what was added
+    if ( &sc == this )
+    {
+        ShapeContainer copy( sc );
+        return add( copy );
+    }
+
+    // the other container's shapes keep their order and their handles all
+    // move up by the same amount, so the bounding boxes its index holds are
+    // placed again rather than recomputed from the vertices
+    ShapeStore::Handle base = store.splice( sc.store );
+
+    sc.index.forEach( [this, base]( ShapeStore::Handle handle, const BoundingBox &box )
        {
-           add( *shape );
+           // placement only depends on the box, which the other index took
+           index.insert( base + handle, box );
        }
     );
+
+    extent.expand( sc.extent );
+
+    return base;
+}
+
+
+/**
+ * @brief   Adds a shape to this shape container from its raw attributes
+ *
+ * @param   type        The shape type
+ * @param   *xs         The x-coordinates of the shape's vertices
+ * @param   *ys         The y-coordinates of the shape's vertices
+ * @param   n           The number of vertices
+ * @param   originX     The x-coordinate of the shape's origin
+ * @param   originY     The y-coordinate of the shape's origin
+ * @param   color       The shape's color
+ *
+ * @return  void
+ */
+void ShapeContainer::add( ShapeStore::ShapeType type, const double *xs,
+                          const double *ys, unsigned int n,
+                          double originX, double originY,
+                          PackedColor color )
+{
+    insert( store.add( type, xs, ys, n, originX, originY, color ) );
+}
+
+
+/**
+ * @brief   Removes the newest stored shape identical to a shape from this
+ *          shape container
+ *
+ * @param   &shape  The shape to remove
+ *
+ * @return  True if a shape was removed, false if none matched
+ */
+bool ShapeContainer::remove( const Shape &shape )
+{
+    std::vector<double> xs;
+    std::vector<double> ys;
+
+    const Shape::Vertex *verts = shape.data();
+
+    for ( unsigned int i = 0; i < shape.size(); i++ )
+    {
+        xs.push_back( verts[i].x );
+        ys.push_back( verts[i].y );
+    }
+
+    return remove( ShapeStore::typeOf( shape ), xs.data(), ys.data(), shape.size(),
+                   shape.getOrigin().getX(), shape.getOrigin().getY(),
+                   shape.getColor() );
+}
+
+
+/**
+ * @brief   Removes the newest stored shape with the specified type,
+ *          vertices, origin and color from this shape container
+ *
+ * @param   type    The shape type
+ * @param   *xs     The x-coordinates of the shape's vertices
+ * @param   *ys     The y-coordinates of the shape's vertices
+ * @param   n       The number of vertices
+ * @param   originX The x-coordinate of the shape's origin
+ * @param   originY The y-coordinate of the shape's origin
+ * @param   color   The shape's color
+ *
+ * @return  True if a shape was removed, false if none matched
+ */
+bool ShapeContainer::remove( ShapeStore::ShapeType type, const double *xs,
+                             const double *ys, unsigned int n, double originX,
+                             double originY, PackedColor color )
+{
+    BoundingBox box;
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        box.expand( xs[i], ys[i] );
+    }
+
+    // only shapes overlapping the same box can match, so ask the index
+    std::vector<ShapeStore::Handle> candidates;
+
+    if ( box.isEmpty() )
+    {
+        store.forEach( [&candidates]( ShapeStore::Handle handle )
+           {
+               candidates.push_back( handle );
+           }
+        );
+    }
+    else
+    {
+        index.query( box, candidates );
+    }
+
+    // handles grow with insertion order, and the newest match is the one
+    // undoing an add takes away
+    std::sort( candidates.begin(), candidates.end(), std::greater<ShapeStore::Handle>() );
+
+    for ( ShapeStore::Handle handle : candidates )
+    {
+        if ( store.matches( handle, type, xs, ys, n, originX, originY, color ) )
+        {
+            index.remove( handle );
+            store.remove( handle );
+            list.remove( handle );
+            version.next();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Removes a shape from this shape container by its handle
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  True if the shape was removed, false if it was not stored
+ */
+bool ShapeContainer::remove( ShapeStore::Handle handle )
+{
+    if ( !store.contains( handle ) )
+    {
+        return false;
+    }
+
+    index.remove( handle );
+    store.remove( handle );
+    list.remove( handle );
+    version.next();
+    return true;
 }
 
 
@@ -143,11 +311,200 @@ void ShapeContainer::add( const ShapeContainer &sc )
  */
 void ShapeContainer::draw( GraphicsContext *gc, ViewContext *vc ) const
 {
-    std::for_each( shapes.begin(), shapes.end(), [gc, vc]( Shape *shape )
-       {
-           shape->draw( gc, vc );
-       }
-    );
+    frame.clear();
+    draw( frame, vc );
+    frame.submit( gc );
+}
+
+
+/**
+ * @brief   Draws the shapes in this shape container that are visible in the
+ *          window into a segment buffer
+ *
+ * @param   &sb         The segment buffer to draw to
+ * @param   *vc         The view context to draw with
+ * @param   *workers    The work pool to transform shapes on, or null to
+ *                      transform them on this thread
+ *
+ * @return  void
+ */
+void ShapeContainer::draw( SegmentBuffer &sb, ViewContext *vc, WorkPool *workers ) const
+{
+    draw( sb, vc, vc->getViewBounds(), workers );
+}
+
+
+/**
+ * @brief   Draws the shapes in this shape container that overlap a model
+ *          space region into a segment buffer
+ *
+ * @param   &sb         The segment buffer to draw to
+ * @param   *vc         The view context to draw with
+ * @param   &region     The model space region to draw
+ * @param   *workers    The work pool to transform shapes on, or null to
+ *                      transform them on this thread
+ *
+ * @return  void
+ */
+void ShapeContainer::draw( SegmentBuffer &sb, ViewContext *vc, const BoundingBox &region,
+                           WorkPool *workers ) const
+{
+    FRAME_STATS_TIME( drawTime );
+
+    // shapes are only transformed when first drawn since the view was last
+    // scaled or rotated, and otherwise drawn from the display list
+    list.update( vc );
+    missing.clear();
+
+    // with everything in view the whole store is drawn in bulk
+    if ( region.contains( extent ) )
+    {
+        FRAME_STATS_ADD( shapesDrawn, store.size() );
+
+        if ( list.size() == 0 )
+        {
+            if ( workers != nullptr ) store.draw( list, vc, *workers );
+            else store.draw( list, vc );
+        }
+        else if ( list.size() < store.size() )
+        {
+            store.forEach( [this]( ShapeStore::Handle handle )
+               {
+                   if ( !list.contains( handle ) ) missing.push_back( handle );
+               }
+            );
+            drawMissing( vc, workers );
+        }
+
+        list.draw( sb );
+        return;
+    }
+
+    visible.clear();
+    index.query( region, visible );
+    FRAME_STATS_ADD( shapesDrawn, visible.size() );
+    FRAME_STATS_ADD( shapesCulled, store.size() - visible.size() );
+
+    for ( ShapeStore::Handle handle : visible )
+    {
+        if ( !list.contains( handle ) ) missing.push_back( handle );
+    }
+
+    drawMissing( vc, workers );
+    list.draw( sb, visible.data(), visible.size() );
+}
+
+
+/**
+ * @brief   Finds the shape nearest to a point, such as the one under the
+ *          pointer, among those within a tolerance of it
+ *
+ * @param   &point      The model space point
+ * @param   tolerance   The farthest a shape's outline may be from the point,
+ *                      in model space
+ *
+ * @return  The handle of the nearest shape, preferring the most recently
+ *          added on a tie, or ShapeStore::INVALID_HANDLE if none is close
+ *          enough
+ */
+ShapeStore::Handle ShapeContainer::pick( const Point2D &point, double tolerance ) const
+{
+    double x = point.getX();
+    double y = point.getY();
+
+    // only shapes whose bounding boxes come within the tolerance can
+    BoundingBox near( x - tolerance, y - tolerance, x + tolerance, y + tolerance );
+
+    candidates.clear();
+    index.query( near, candidates );
+
+    ShapeStore::Handle nearest = ShapeStore::INVALID_HANDLE;
+    double nearestDistance = tolerance;
+
+    for ( ShapeStore::Handle handle : candidates )
+    {
+        double distance = store.distance( handle, x, y );
+
+        if ( ( distance < nearestDistance ) ||
+             ( ( distance == nearestDistance ) &&
+               ( ( nearest == ShapeStore::INVALID_HANDLE ) || ( handle > nearest ) ) ) )
+        {
+            nearest = handle;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
+}
+
+
+/**
+ * @brief   Finds the shapes whose outlines pass through a rectangle, such as
+ *          a selection box
+ *
+ * @param   &rect       The model space rectangle
+ * @param   &results    The vector to append the handles of the shapes to
+ *
+ * @return  void
+ */
+void ShapeContainer::queryRect( const BoundingBox &rect, std::vector<ShapeStore::Handle> &results ) const
+{
+    candidates.clear();
+    index.query( rect, candidates );
+
+    for ( ShapeStore::Handle handle : candidates )
+    {
+        // a shape inside the rectangle needs no edge tests
+        const BoundingBox *box = index.find( handle );
+
+        if ( ( ( box != nullptr ) && rect.contains( *box ) ) || store.intersects( handle, rect ) )
+        {
+            results.push_back( handle );
+        }
+    }
+}
+
+
+/**
+ * @brief   Determines if a shape is in this shape container
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  True if the shape is stored, false otherwise
+ */
+bool ShapeContainer::contains( ShapeStore::Handle handle ) const
+{
+    return store.contains( handle );
+}
+
+
+/**
+ * @brief   Gets the model space bounding box of a shape in this shape
+ *          container
+ *
+ * @param   handle  The handle of the shape, which must be stored
+ *
+ * @return  The bounding box of the shape's vertices
+ */
+BoundingBox ShapeContainer::bounds( ShapeStore::Handle handle ) const
+{
+    return store.bounds( handle );
+}
+
+
+/**
+ * @brief   Appends the model space edges of the shapes added from a handle
+ *          on to a list of line ends
+ *
+ * @param   from        The first handle whose shape to append
+ * @param   &vertices   The line ends to append to, two per edge
+ *
+ * @return  The handle to append from next
+ */
+ShapeStore::Handle ShapeContainer::edges( ShapeStore::Handle from,
+                                          std::vector<GraphicsContext::ModelVertex> &vertices ) const
+{
+    return store.edges( from, vertices );
 }
 
 
@@ -161,13 +518,7 @@ void ShapeContainer::draw( GraphicsContext *gc, ViewContext *vc ) const
  */
 std::ostream &ShapeContainer::out( std::ostream &os ) const
 {
-    std::for_each( shapes.begin(), shapes.end(), [&os]( Shape *shape )
-       {
-           shape->out( const_cast<std::ostream&>( os ) );
-           os << std::endl;
-       }
-    );
-    return os;
+    return store.out( os );
 }
 
 
@@ -181,71 +532,120 @@ std::ostream &ShapeContainer::out( std::ostream &os ) const
  */
 std::istream &ShapeContainer::in( std::istream &is )
 {
-    // for each line in the file
-    while ( is.rdbuf()->in_avail() != 0 )
+    ShapeParser parser( is );
+
+    // shapes go straight into the store without building shape objects
+    while ( parser.next() )
     {
-        // get description string and seek back
-        std::string desc;
-        std::streampos pos = is.tellg();
-        std::getline( is, desc );
-        is.seekg( pos, std::ios_base::beg );
+        insert( store.add( parser.getType(), parser.getXs(), parser.getYs(),
+                           parser.getVertexCount(),
+                           parser.getOriginX(), parser.getOriginY(),
+                           PackedColor( parser.getRed(), parser.getGreen(),
+                                        parser.getBlue() ) ) );
+    }
 
-        // tokenize the description string
-        std::vector<std::string> tokens;
-        std::stringstream ss = std::stringstream( desc );
+    return is;
+}
 
-        while( ss )
-        {
-            std::string token;
-            ss >> token;
-            tokens.push_back( token );
-        }
 
-        // determine shape type from tokenized string length
-        if ( !tokens.empty() )
-        {
-            // line shape token length = 21
-            if ( tokens.size() == 21 )
-            {
-
-                Line line(
-                    Point2D( 0, 0 ),
-                    Point2D( 0, 0 )
-                );
-                line.in( is );
-                add( line );
-            }
-
-            // triangle shape token length = 25
-            else if ( tokens.size() == 25 )
-            {
-
-                Triangle triangle(
-                    Point2D( 0, 0 ),
-                    Point2D( 0, 0 ),
-                    Point2D( 0, 0 )
-                );
-                triangle.in( is );
-                add( triangle );
-            }
-
-            // polygon shape token length > 25
-            else if ( tokens.size() > 25 )
-            {
-                Polygon polygon( ( std::vector<Point2D*>() ) );
-                polygon.in( is );
-                add( polygon );
-            }
-
-            // any other token length is invalid
-            else
-            {
-                throw ShapeException("Invalid shape description.");
-            }
-        }
+/**
+ * @brief   Writes the shapes in this shape container to an output stream in
+ *          the binary drawing format
+ *
+ * @param   &os     The output stream to write to, opened in binary mode
+ *
+ * @return  void
+ */
+void ShapeContainer::write( std::ostream &os ) const
+{
+    store.write( os );
+}
+
+
+/**
+ * @brief   Adds the shapes in a drawing file to this shape container,
+ *          detecting the binary format by its magic bytes and otherwise
+ *          reading the text format
+ *
+ * @param   &fileName   The name of the file to open
+ *
+ * @return  void
+ */
+void ShapeContainer::open( const std::string &fileName )
+{
+    std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>( fileName );
+
+    if ( !ShapeStore::isBinary( file->data(), file->size() ) )
+    {
+        std::ifstream filein( fileName.c_str() );
+        in( filein );
+        return;
     }
 
-    return is;
+    ShapeStore mapped;
+    mapped.read( file );
+
+    // an empty container can adopt the mapped store without copying it
+    if ( store.size() == 0 )
+    {
+        store = std::move( mapped );
+        version.next();
+        reindex();
+        return;
+    }
+
+    mapped.forEach( [this, &mapped]( ShapeStore::Handle handle )
+       {
+           insert( store.add( mapped, handle ) );
+       }
+    );
+}
+
+
+/**
+ * @brief   Saves the shapes in this shape container to a drawing file,
+ *          choosing the binary format by the file's extension and otherwise
+ *          writing the text format
+ *
+ * @param   &fileName   The name of the file to save to
+ *
+ * @return  void
+ */
+void ShapeContainer::save( const std::string &fileName ) const
+{
+    save( fileName, isBinaryName( fileName ) );
+}
+
+
+/**
+ * @brief   Saves the shapes in this shape container to a drawing file in the
+ *          specified format
+ *
+ * @param   &fileName   The name of the file to save to
+ * @param   binary      True for the binary format, false for the text format
+ *
+ * @return  void
+ */
+void ShapeContainer::save( const std::string &fileName, bool binary ) const
+{
+    store.save( fileName, binary );
+}
+
+
+/**
+ * @brief   Determines if a drawing file name selects the binary format
+ *
+ * @param   &fileName   The name of the file
+ *
+ * @return  True if the name ends in the binary extension, false otherwise
+ */
+bool ShapeContainer::isBinaryName( const std::string &fileName )
+{
+    std::string extension = BINARY_EXTENSION;
+
+    return ( fileName.size() >= extension.size() ) &&
+           ( fileName.compare( fileName.size() - extension.size(),
+                               extension.size(), extension ) == 0 );
 }
 
 
@@ -258,12 +658,11 @@ std::istream &ShapeContainer::in( std::istream &is )
  */
 void ShapeContainer::erase()
 {
-    std::for_each( shapes.begin(), shapes.end(), []( Shape *shape )
-       {
-           delete shape;
-       }
-    );
-    shapes.clear();
+    store.clear();
+    index.clear();
+    list.clear();
+    extent = BoundingBox();
+    version.next();
 }
 
 
@@ -276,7 +675,199 @@ void ShapeContainer::erase()
  */
 unsigned int ShapeContainer::size()
 {
-    return shapes.size();
+    return store.size();
+}
+
+
+/**
+ * @brief   Gets the version of the shapes in this shape container, so that
+ *          work done with them can be kept while shapes are only added
+ *
+ * @param   void
+ *
+ * @return  The version, different after a shape is removed
+ */
+unsigned long ShapeContainer::getVersion() const
+{
+    return version.value;
+}
+
+
+/**
+ * @brief   Gets the store holding the shapes of this shape container, which
+ *          is all a snapshot of the drawing needs
+ *
+ * @param   void
+ *
+ * @return  The shape store
+ */
+const ShapeStore &ShapeContainer::getStore() const
+{
+    return store;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Adds a stored shape to the spatial index
+ *
+ * @param   handle  The handle of the stored shape
+ *
+ * @return  False if the shape is too far out to index, true otherwise
+ */
+bool ShapeContainer::place( ShapeStore::Handle handle )
+{
+    BoundingBox box = store.bounds( handle );
+
+    // a shape without vertices has nothing to draw
+    if ( box.isEmpty() )
+    {
+        return true;
+    }
+
+    if ( !index.insert( handle, box ) )
+    {
+        return false;
+    }
+
+    extent.expand( box );
+    return true;
+}
+
+
+/**
+ * @brief   Adds a stored shape to the spatial index, removing it from the
+ *          store again if it cannot be indexed
+ *
+ * @param   handle  The handle of the stored shape
+ *
+ * @return  void
+ */
+void ShapeContainer::insert( ShapeStore::Handle handle )
+{
+    if ( !place( handle ) )
+    {
+        store.remove( handle );
+        throw ShapeException( "Shape is too far from the origin to index." );
+    }
+}
+
+
+/**
+ * @brief   Rebuilds the spatial index from the stored shapes, removing any
+ *          that cannot be indexed
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::reindex()
+{
+    index.clear();
+    list.clear();
+    extent = BoundingBox();
+
+    std::vector<ShapeStore::Handle> refused;
+
+    store.forEach( [this, &refused]( ShapeStore::Handle handle )
+       {
+           if ( !place( handle ) )
+           {
+               refused.push_back( handle );
+           }
+       }
+    );
+
+    // removing may compact a bucket, so it waits until iterating is done
+    for ( ShapeStore::Handle handle : refused )
+    {
+        store.remove( handle );
+    }
+
+    if ( !refused.empty() )
+    {
+        throw ShapeException( "Shape is too far from the origin to index." );
+    }
+}
+
+
+/**
+ * @brief   Gives the shapes about to be drawn that have no display list entry
+ *          their entries
+ *
+ * @param   *vc         The view context to draw with
+ * @param   *workers    The work pool to transform shapes on, or null to
+ *                      transform them on this thread
+ *
+ * @return  void
+ */
+void ShapeContainer::drawMissing( ViewContext *vc, WorkPool *workers ) const
+{
+    if ( workers != nullptr )
+    {
+        store.draw( list, vc, missing.data(), missing.size(), *workers );
+    }
+    else
+    {
+        store.draw( list, vc, missing.data(), missing.size() );
+    }
+}
+
+
+/* ----------------------------- Version Functions -------------------------- */
+
+
+/**
+ * @brief   Creates a new container version
+ *
+ * @param   void
+ *
+ * @return  The created version
+ */
+ShapeContainer::Version::Version():
+value( ++lastVersion )
+{}
+
+
+/**
+ * @brief   Creates the version of a copied container, which is new since the
+ *          copy may go on to differ from the original
+ *
+ * @param   &version    The version to copy, which is not used
+ *
+ * @return  The created version
+ */
+ShapeContainer::Version::Version( const Version & ):
+value( ++lastVersion )
+{}
+
+
+/**
+ * @brief   Gives an assigned container a new version
+ *
+ * @param   &version    The version to assign, which is not used
+ *
+ * @return  This version
+ */
+ShapeContainer::Version &ShapeContainer::Version::operator=( const Version & )
+{
+    next();
+    return *this;
+}
+
+
+/**
+ * @brief   Moves on to a new version
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeContainer::Version::next()
+{
+    value = ++lastVersion;
 }
 
 
@@ -3,7 +3,7 @@
 
 /**
  * @file    shapecontainer.h
- * @brief   Set container of shape pointers
+ * @brief   Spatially indexed container of shapes
  */
 
 
@@ -17,11 +17,20 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include <set>
+# include <memory>
+# include <string>
+# include <vector>
 
+# include "boundingbox.h"
+# include "displaylist.h"
 # include "gcontext.h"
-# include "viewcontext.h"
+# include "point2d.h"
+# include "quadtree.h"
+# include "segmentbuffer.h"
 # include "shape.h"
+# include "shapestore.h"
+# include "viewcontext.h"
+# include "workpool.h"
 
 
 /* --------------------------------- Class ---------------------------------- */
@@ -33,11 +42,19 @@ class ShapeContainer
 
 public:
 
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // files saved with this extension use the binary drawing format
+    constexpr static const char *BINARY_EXTENSION = ".bin";
+
+
     /* --------------------- Constructors / Destructors --------------------- */
 
 
     ShapeContainer();
     ShapeContainer( const ShapeContainer &sc );
+    ShapeContainer( ShapeContainer &&sc );
 
     ~ShapeContainer();
 
@@ -46,20 +63,55 @@ public:
 
 
     ShapeContainer &operator=( const ShapeContainer &sc );
+    ShapeContainer &operator=( ShapeContainer &&sc );
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
-    void add( const Shape &shape );
-    void add( const ShapeContainer &sc );
+    ShapeStore::Handle add( const Shape &shape );
+    ShapeStore::Handle add( const ShapeContainer &sc );
+    void add( ShapeStore::ShapeType type, const double *xs, const double *ys,
+              unsigned int n, double originX, double originY,
+              PackedColor color );
+
+    bool remove( const Shape &shape );
+    bool remove( ShapeStore::Handle handle );
+    bool remove( ShapeStore::ShapeType type, const double *xs,
+                 const double *ys, unsigned int n, double originX,
+                 double originY, PackedColor color );
+
     unsigned int size();
+    unsigned long getVersion() const;
+    const ShapeStore &getStore() const;
+
+    ShapeStore::Handle pick( const Point2D &point, double tolerance ) const;
+    void queryRect( const BoundingBox &rect, std::vector<ShapeStore::Handle> &results ) const;
+    bool contains( ShapeStore::Handle handle ) const;
+    BoundingBox bounds( ShapeStore::Handle handle ) const;
+
+    template<typename F>
+    void forEach( F fn ) const;
 
     void draw( GraphicsContext *gc, ViewContext *vc ) const;
+    void draw( SegmentBuffer &sb, ViewContext *vc, WorkPool *workers = nullptr ) const;
+    void draw( SegmentBuffer &sb, ViewContext *vc, const BoundingBox &region,
+               WorkPool *workers = nullptr ) const;
+
+    ShapeStore::Handle edges( ShapeStore::Handle from,
+                              std::vector<GraphicsContext::ModelVertex> &vertices ) const;
 
     std::ostream &out( std::ostream &os ) const;
     std::istream &in( std::istream &is );
 
+    void write( std::ostream &os ) const;
+
+    void open( const std::string &fileName );
+    void save( const std::string &fileName ) const;
+    void save( const std::string &fileName, bool binary ) const;
+
+    static bool isBinaryName( const std::string &fileName );
+
     void erase();
 
 
@@ -70,13 +122,74 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    std::set<Shape*> shapes = std::set<Shape*>();
+    // a value no other container has had, taken afresh by copies and when
+    // shapes are removed, while adding shapes keeps it
+    struct Version
+    {
+        unsigned long value;
+
+        Version();
+        Version( const Version &version );
+        Version &operator=( const Version &version );
+
+        void next();
+    };
+
+    ShapeStore store = ShapeStore();
+    QuadTree<ShapeStore::Handle> index = QuadTree<ShapeStore::Handle>();
+    BoundingBox extent = BoundingBox();
+
+    mutable std::vector<ShapeStore::Handle> visible = std::vector<ShapeStore::Handle>();
+
+    // device space segments kept between draws, and the shapes about to be
+    // drawn that have none yet
+    mutable DisplayList list = DisplayList();
+    mutable std::vector<ShapeStore::Handle> missing = std::vector<ShapeStore::Handle>();
+
+    // shapes whose bounding boxes passed the coarse test of a query
+    mutable std::vector<ShapeStore::Handle> candidates = std::vector<ShapeStore::Handle>();
+
+    mutable SegmentBuffer frame = SegmentBuffer();
+
+    Version version = Version();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool place( ShapeStore::Handle handle );
+    void insert( ShapeStore::Handle handle );
+    void reindex();
+    void drawMissing( ViewContext *vc, WorkPool *workers ) const;
 
 
     /* ====================================================================== */
 };
 
 
+/* ---------------------------- Template Functions -------------------------- */
+
+
+/**
+ * @brief   Calls a function with a standalone copy of every shape, in the
+ *          order the shape store visits them
+ *
+ * @param   fn  The function to call with each shape
+ *
+ * @return  void
+ */
+template<typename F>
+void ShapeContainer::forEach( F fn ) const
+{
+    store.forEach( [this, &fn]( ShapeStore::Handle handle )
+       {
+           std::unique_ptr<Shape> shape( store.create( handle ) );
+           fn( *shape );
+       }
+    );
+}
+
+
 /* ----------------------- Global Overloaded Operators ---------------------- */
 
 
@@ -0,0 +1,364 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapeparser.cpp
+ * @brief   Single-pass streaming parser for the text drawing format
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cctype>
+# include <cmath>
+# include <cstdlib>
+# include <cstring>
+
+# include "shapeparser.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a parser that reads shapes from an input stream
+ *
+ * @param   &is     The input stream to read from
+ *
+ * @return  The created parser
+ */
+ShapeParser::ShapeParser( std::istream &is ):
+is( is )
+{}
+
+
+/**
+ * @brief   Shape parser destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ShapeParser::~ShapeParser() = default;
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Reads the next shape from the input stream
+ *
+ * @param   void
+ *
+ * @return  True if a shape was read, false at the end of the stream
+ */
+bool ShapeParser::next()
+{
+    // the line buffer keeps its capacity, so steady state reads don't allocate
+    while ( std::getline( is, line ) )
+    {
+        lineNumber++;
+        cursor = line.c_str();
+        skipSpace();
+
+        if ( *cursor != '\0' )
+        {
+            parse();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Gets the type of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The shape type
+ */
+ShapeStore::ShapeType ShapeParser::getType() const
+{
+    return type;
+}
+
+
+/**
+ * @brief   Gets the number of vertices of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The number of vertices
+ */
+unsigned int ShapeParser::getVertexCount() const
+{
+    return xs.size();
+}
+
+
+/**
+ * @brief   Gets the vertex x-coordinates of the last shape read
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first x-coordinate
+ */
+const double *ShapeParser::getXs() const
+{
+    return xs.data();
+}
+
+
+/**
+ * @brief   Gets the vertex y-coordinates of the last shape read
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first y-coordinate
+ */
+const double *ShapeParser::getYs() const
+{
+    return ys.data();
+}
+
+
+/**
+ * @brief   Gets the red channel of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The red channel
+ */
+double ShapeParser::getRed() const
+{
+    return color[0];
+}
+
+
+/**
+ * @brief   Gets the green channel of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The green channel
+ */
+double ShapeParser::getGreen() const
+{
+    return color[1];
+}
+
+
+/**
+ * @brief   Gets the blue channel of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The blue channel
+ */
+double ShapeParser::getBlue() const
+{
+    return color[2];
+}
+
+
+/**
+ * @brief   Gets the origin x-coordinate of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The origin x-coordinate
+ */
+double ShapeParser::getOriginX() const
+{
+    return origin[0];
+}
+
+
+/**
+ * @brief   Gets the origin y-coordinate of the last shape read
+ *
+ * @param   void
+ *
+ * @return  The origin y-coordinate
+ */
+double ShapeParser::getOriginY() const
+{
+    return origin[1];
+}
+
+
+/**
+ * @brief   Gets the number of the line the last shape was read from
+ *
+ * @param   void
+ *
+ * @return  The line number, starting at one
+ */
+unsigned int ShapeParser::getLineNumber() const
+{
+    return lineNumber;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Parses the shape description in the current line
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeParser::parse()
+{
+    expect( "SHAPE" );
+
+    expect( "COLOR(" );
+    color[0] = number();
+    color[1] = number();
+    color[2] = number();
+    expect( ")" );
+
+    expect( "ORIGIN(" );
+    origin[0] = number();
+    origin[1] = number();
+    expect( ")" );
+
+    expect( "VERTICES(" );
+    xs.clear();
+    ys.clear();
+
+    while ( accept( "POINT2D(" ) )
+    {
+        xs.push_back( number() );
+        ys.push_back( number() );
+        expect( ")" );
+    }
+
+    expect( ")" );
+
+    if ( *cursor != '\0' )
+    {
+        fail( "unexpected text after shape description" );
+    }
+
+    if ( xs.size() < 2 )
+    {
+        fail( "a shape needs at least two vertices" );
+    }
+
+    type = ( xs.size() == 2 ) ? ShapeStore::TYPE_LINE :
+           ( xs.size() == 3 ) ? ShapeStore::TYPE_TRIANGLE :
+                                ShapeStore::TYPE_POLYGON;
+}
+
+
+/**
+ * @brief   Advances the cursor past any whitespace
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeParser::skipSpace()
+{
+    while ( std::isspace( static_cast<unsigned char>( *cursor ) ) )
+    {
+        cursor++;
+    }
+}
+
+
+/**
+ * @brief   Consumes a token at the cursor if it is present
+ *
+ * @param   *token  The token to consume
+ *
+ * @return  True if the token was consumed, false otherwise
+ */
+bool ShapeParser::accept( const char *token )
+{
+    size_t length = std::strlen( token );
+
+    // a token is only matched as a whole word
+    if ( ( std::strncmp( cursor, token, length ) != 0 ) ||
+         ( ( cursor[length] != '\0' ) &&
+           !std::isspace( static_cast<unsigned char>( cursor[length] ) ) ) )
+    {
+        return false;
+    }
+
+    cursor += length;
+    skipSpace();
+    return true;
+}
+
+
+/**
+ * @brief   Consumes a token at the cursor, failing if it is not present
+ *
+ * @param   *token  The token to consume
+ *
+ * @return  void
+ */
+void ShapeParser::expect( const char *token )
+{
+    if ( !accept( token ) )
+    {
+        fail( std::string( "expected '" ) + token + "'" );
+    }
+}
+
+
+/**
+ * @brief   Consumes a number at the cursor, failing if it is not present or
+ *          is not finite
+ *
+ * @param   void
+ *
+ * @return  The number
+ */
+double ShapeParser::number()
+{
+    char *end;
+    double value = std::strtod( cursor, &end );
+
+    if ( ( end == cursor ) ||
+         ( ( *end != '\0' ) && !std::isspace( static_cast<unsigned char>( *end ) ) ) )
+    {
+        fail( "expected a number" );
+    }
+
+    // strtod also takes inf, nan and hex floats, which the format does not
+    // have, and a value too large for a double comes back infinite
+    if ( ( std::strspn( cursor, "0123456789+-.eE" ) != size_t( end - cursor ) ) ||
+         !std::isfinite( value ) )
+    {
+        fail( "expected a finite number" );
+    }
+
+    cursor = end;
+    skipSpace();
+    return value;
+}
+
+
+/**
+ * @brief   Reports a malformed shape description
+ *
+ * @param   &msg    A description of the problem
+ *
+ * @return  void
+ */
+void ShapeParser::fail( const std::string &msg ) const
+{
+    throw ShapeException( "Line " + std::to_string( lineNumber ) + ": " + msg +
+                          " at column " + std::to_string( cursor - line.c_str() + 1 ) + "." );
+}
+
+
+/* -------------------------------------------------------------------------- */
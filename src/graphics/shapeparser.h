@@ -0,0 +1,115 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapeparser.h
+ * @brief   Single-pass streaming parser for the text drawing format
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SHAPEPARSER_H
+# define GRAPHICS_SHAPEPARSER_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <iostream>
+# include <string>
+# include <vector>
+
+# include "shapestore.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Reads one shape description per line of the form
+ *
+ *     SHAPE  COLOR( r g b )  ORIGIN( x y )  VERTICES( POINT2D( x y ) ... )
+ *
+ * scanning each line exactly once without tokenizing it into strings. Two
+ * vertices describe a line, three a triangle and more a polygon. Blank lines
+ * are skipped. The stream is only ever read forwards, so pipes work as well
+ * as files.
+ */
+class ShapeParser
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit ShapeParser( std::istream &is );
+    ~ShapeParser();
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    bool next();
+
+    ShapeStore::ShapeType getType() const;
+    unsigned int getVertexCount() const;
+    const double *getXs() const;
+    const double *getYs() const;
+
+    double getRed() const;
+    double getGreen() const;
+    double getBlue() const;
+    double getOriginX() const;
+    double getOriginY() const;
+
+    unsigned int getLineNumber() const;
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    std::istream &is;
+
+    std::string line;
+    const char *cursor = nullptr;
+    unsigned int lineNumber = 0;
+
+    ShapeStore::ShapeType type = ShapeStore::TYPE_LINE;
+    std::vector<double> xs;
+    std::vector<double> ys;
+    double color[3] = { 0, 0, 0 };
+    double origin[2] = { 0, 0 };
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void parse();
+
+    void skipSpace();
+    bool accept( const char *token );
+    void expect( const char *token );
+    double number();
+
+    void fail( const std::string &msg ) const;
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SHAPEPARSER_H
+
+
+/* -------------------------------------------------------------------------- */
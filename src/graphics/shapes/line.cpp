@@ -10,9 +10,9 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include <sstream>
 
 # include "line.h"
+# include "shapeparser.h"
 # include "viewcontext.h"
 
 
@@ -28,7 +28,7 @@
  * @return  The created line
  */
 Line::Line( const Point2D &start, const Point2D &end ):
-Line( start, end, Color( 0, 0, 0 ) )
+Line( start, end, PackedColor( 0, 0, 0 ) )
 {}
 
 
@@ -37,13 +37,13 @@ Line( start, end, Color( 0, 0, 0 ) )
  *
  * @param   &start  The starting point of the line
  * @param   &end    The ending point of the line
- * @param   &color  The color of the line
+ * @param   color   The color of the line
  *
  * @return  The created line
  */
-Line::Line( const Point2D &start, const Point2D &end, const Color &color ):
+Line::Line( const Point2D &start, const Point2D &end, PackedColor color ):
 Shape( color, midpoint( start, end ) ),
-verts( Vector2<Point2D*>( start.clone(), end.clone() ) )
+verts{ toVertex( start ), toVertex( end ) }
 {}
 
 
@@ -54,9 +54,17 @@ verts( Vector2<Point2D*>( start.clone(), end.clone() ) )
  *
  * @return  The created line
  */
-Line::Line( const Line &line ):
-Shape( line.color, line.origin ), verts( line.verts )
-{}
+Line::Line( const Line &line ) = default;
+
+
+/**
+ * @brief   Creates a line by moving from an existing line
+ *
+ * @param   &&line  The line to move from
+ *
+ * @return  The created line
+ */
+Line::Line( Line &&line ) = default;
 
 
 /**
@@ -66,10 +74,7 @@ Shape( line.color, line.origin ), verts( line.verts )
  *
  * @return  void
  */
-Line::~Line()
-{
-    Point2D::vector2DeepDelete( verts );
-}
+Line::~Line() = default;
 
 
 /* -------------------------- Overloaded Operators -------------------------- */
@@ -82,16 +87,17 @@ Line::~Line()
  *
  * @return  A reference to this line
  */
-Line &Line::operator=( const Line &line )
-{
-    Point2D::vector2DeepDelete( verts );
+Line &Line::operator=( const Line &line ) = default;
 
-    this->verts = Point2D::vector2DeepCopy( line.verts );
-    this->color = line.color;
-    this->origin = line.origin;
 
-    return *this;
-}
+/**
+ * @brief   Moves a line into this line
+ *
+ * @param   &&line  The line to move from
+ *
+ * @return  A reference to this line
+ */
+Line &Line::operator=( Line &&line ) = default;
 
 
 /**
@@ -101,9 +107,9 @@ Line &Line::operator=( const Line &line )
  *
  * @return  An immutable reference to the vertex at the specified index
  */
-const Point2D &Line::operator[]( unsigned int index ) const
+const Shape::Vertex &Line::operator[]( unsigned int index ) const
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -114,9 +120,9 @@ const Point2D &Line::operator[]( unsigned int index ) const
  *
  * @return  A mutable reference to the vertex at the specified index
  */
-Point2D &Line::operator[]( unsigned int index )
+Shape::Vertex &Line::operator[]( unsigned int index )
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -148,18 +154,31 @@ std::ostream &operator<<( std::ostream &os, const Line &line )
  */
 void Line::draw( GraphicsContext *gc, ViewContext *vc ) const
 {
-    // convert from model to device coordinates
-    Point2D start = vc->modelToDevice( *verts[0] );
-    Point2D end = vc->modelToDevice( *verts[1] );
+    SegmentBuffer sb;
+    draw( sb, vc );
+    sb.submit( gc );
+}
 
-    // set color
-    gc->setColor( color.toX11() );
+
+/**
+ * @brief   Draws this line into a segment buffer for bulk submission to a
+ *          graphics context
+ *
+ * @param   &sb     The segment buffer to draw to
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+void Line::draw( SegmentBuffer &sb, ViewContext *vc ) const
+{
+    // convert from model to device coordinates
+    double xs[2] = { verts[0].x, verts[1].x };
+    double ys[2] = { verts[0].y, verts[1].y };
+    int dxs[2], dys[2];
+    vc->modelToDevice( xs, ys, dxs, dys, 2 );
 
     // draw line
-    gc->drawLine(
-        ( int ) start.getX(), ( int ) start.getY(),
-        ( int ) end.getX(),   ( int ) end.getY()
-    );
+    sb.add( color.toX11(), dxs[0], dys[0], dxs[1], dys[1] );
 }
 
 
@@ -172,7 +191,49 @@ void Line::draw( GraphicsContext *gc, ViewContext *vc ) const
  */
 Line *Line::clone() const
 {
-    return new Line( *verts[0], *verts[1], color );
+    return new Line( *this );
+}
+
+
+/**
+ * @brief   Gets the model space bounding box of this line
+ *
+ * @param   void
+ *
+ * @return  The bounding box of this line's vertices
+ */
+BoundingBox Line::bounds() const
+{
+    BoundingBox box;
+    box.expand( verts[0].x, verts[0].y );
+    box.expand( verts[1].x, verts[1].y );
+    return box;
+}
+
+
+/**
+ * @brief   Gets the number of vertices in this line
+ *
+ * @param   void
+ *
+ * @return  The number of vertices in this line
+ */
+unsigned int Line::size() const
+{
+    return 2;
+}
+
+
+/**
+ * @brief   Gets the vertices of this line as a contiguous array
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first vertex of this line
+ */
+const Shape::Vertex *Line::data() const
+{
+    return verts;
 }
 
 
@@ -187,7 +248,8 @@ Line *Line::clone() const
 std::ostream &Line::out( std::ostream &os ) const
 {
     Shape::out( os );
-    os << "  VERTICES( " << *verts[0] << " " << *verts[1] << " )";
+    os << "  VERTICES( POINT2D( " << verts[0].x << " " << verts[0].y << " ) "
+       <<            "POINT2D( " << verts[1].x << " " << verts[1].y << " ) )";
     return os;
 }
 
@@ -196,48 +258,26 @@ std::ostream &Line::out( std::ostream &os ) const
  * @brief   Extracts a line from an input stream and assigns it to this
  *          line
  *
- * @param   &os     The input stream to extract from
+ * @param   &is     The input stream to extract from
  *
  * @return  A reference to the input stream
  */
 std::istream &Line::in( std::istream &is )
 {
-    // process shape attributes
-    Shape::in( is );
+    ShapeParser parser( is );
 
-    // get description string
-    std::string desc;
-    std::getline( is, desc );
-
-    // tokenize the description string
-    std::vector<std::string> tokens;
-    std::stringstream ss = std::stringstream( desc );
-
-    while( ss )
-    {
-        std::string token;
-        ss >> token;
-        tokens.push_back( token );
-    }
-
-    // validate that the line describes a line
-    if ( ( tokens.size() != 21 )  || ( tokens[10] != "VERTICES(" ) ||
-         ( tokens[11] != "POINT2D(" ) || ( tokens[15] != "POINT2D(" )  )
+    if ( !parser.next() || ( parser.getType() != ShapeStore::TYPE_LINE ) )
     {
         throw ShapeException("Invalid line description.");
     }
 
-    // extract and set the line's vertices
-    double startX = std::stod( tokens[ 12 ] );
-    double startY = std::stod( tokens[ 13 ] );
-    double endX = std::stod( tokens[ 16 ] );
-    double endY = std::stod( tokens[ 17 ] );
-
-    Point2D::vector2DeepDelete( verts );
-    verts = Vector2<Point2D*>(
-        new Point2D( startX, startY),
-        new Point2D( endX, endY )
-    );
+    assign( parser );
+
+    const double *xs = parser.getXs();
+    const double *ys = parser.getYs();
+
+    verts[0] = toVertex( xs[0], ys[0] );
+    verts[1] = toVertex( xs[1], ys[1] );
 
     return is;
 }
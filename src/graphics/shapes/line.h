@@ -34,8 +34,9 @@ public:
 
 
     Line( const Point2D &start, const Point2D &end );
-    Line( const Point2D &start, const Point2D &end, const Color &color );
+    Line( const Point2D &start, const Point2D &end, PackedColor color );
     Line( const Line &line );
+    Line( Line &&line );
 
     ~Line() override;
 
@@ -44,16 +45,21 @@ public:
 
 
     Line &operator=( const Line &line );
+    Line &operator=( Line &&line );
 
-    const Point2D &operator[]( unsigned int index ) const override;
-    Point2D &operator[]( unsigned int index ) override;
+    const Vertex &operator[]( unsigned int index ) const override;
+    Vertex &operator[]( unsigned int index ) override;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
     void draw( GraphicsContext *gc, ViewContext *vc ) const override;
+    void draw( SegmentBuffer &sb, ViewContext *vc ) const override;
     Line *clone() const override;
+    BoundingBox bounds() const override;
+    unsigned int size() const override;
+    const Vertex *data() const override;
 
     std::ostream &out( std::ostream &os ) const override;
     std::istream &in( std::istream &is ) override;
@@ -66,7 +72,7 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    Vector2<Point2D*> verts;
+    Vertex verts[2];
 
 
     /* ------------------------------ Functions ----------------------------- */
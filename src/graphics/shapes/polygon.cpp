@@ -11,10 +11,12 @@
 
 
 # include <algorithm>
-# include <sstream>
+# include <utility>
+# include <vector>
 
-# include "color.h"
+# include "packedcolor.h"
 # include "polygon.h"
+# include "shapeparser.h"
 
 
 /* --------------------- Constructors / Destructors --------------------- */
@@ -28,7 +30,7 @@
  * @return  The created polygon
  */
 Polygon::Polygon( const std::vector<Point2D*> &verts ):
-Polygon( verts, Color( 0, 0, 0 ) )
+Polygon( verts, PackedColor( 0, 0, 0 ) )
 {}
 
 
@@ -36,13 +38,27 @@ Polygon( verts, Color( 0, 0, 0 ) )
  * @brief   Creates a colored polygon from a vector of points
  *
  * @param   &verts  The points of the polygon
- * @param   &color  The color of the polygon
+ * @param   color   The color of the polygon
  *
  * @return  The created polygon
  */
-Polygon::Polygon( const std::vector<Point2D*> &verts, const Color &color ):
+Polygon::Polygon( const std::vector<Point2D*> &verts, PackedColor color ):
+Polygon( toVertices( verts ), color )
+{}
+
+
+/**
+ * @brief   Creates a colored polygon from a vector of vertices, taking over
+ *          the vector's storage when it is passed as an rvalue
+ *
+ * @param   verts   The vertices of the polygon
+ * @param   color   The color of the polygon
+ *
+ * @return  The created polygon
+ */
+Polygon::Polygon( std::vector<Vertex> verts, PackedColor color ):
 Shape( color, midpoint( verts ) ),
-verts( Point2D::vectorDeepCopy( verts ) )
+verts( std::move( verts ) )
 {}
 
 
@@ -53,9 +69,17 @@ verts( Point2D::vectorDeepCopy( verts ) )
  *
  * @return  The created polygon
  */
-Polygon::Polygon( const Polygon &polygon ) :
-Shape( polygon.color, polygon.origin ), verts( polygon.verts )
-{}
+Polygon::Polygon( const Polygon &polygon ) = default;
+
+
+/**
+ * @brief   Creates a polygon by moving from an existing polygon
+ *
+ * @param   &&polygon   The polygon to move from
+ *
+ * @return  The created polygon
+ */
+Polygon::Polygon( Polygon &&polygon ) = default;
 
 
 /**
@@ -65,10 +89,7 @@ Shape( polygon.color, polygon.origin ), verts( polygon.verts )
  *
  * @return  void
  */
-Polygon::~Polygon()
-{
-    Point2D::vectorDeepDelete( verts );
-}
+Polygon::~Polygon() = default;
 
 
 /* -------------------------- Overloaded Operators -------------------------- */
@@ -81,16 +102,17 @@ Polygon::~Polygon()
  *
  * @return  A reference to this polygon
  */
-Polygon &Polygon::operator=( const Polygon &polygon )
-{
-    Point2D::vectorDeepDelete( verts );
+Polygon &Polygon::operator=( const Polygon &polygon ) = default;
 
-    this->verts = Point2D::vectorDeepCopy( polygon.verts );
-    this->color = polygon.color;
-    this->origin = polygon.origin;
 
-    return *this;
-}
+/**
+ * @brief   Moves a polygon into this polygon
+ *
+ * @param   &&polygon   The polygon to move from
+ *
+ * @return  A reference to this polygon
+ */
+Polygon &Polygon::operator=( Polygon &&polygon ) = default;
 
 
 /**
@@ -100,9 +122,9 @@ Polygon &Polygon::operator=( const Polygon &polygon )
  *
  * @return  An immutable reference to the vertex at the specified index
  */
-const Point2D &Polygon::operator[]( unsigned int index ) const
+const Shape::Vertex &Polygon::operator[]( unsigned int index ) const
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -113,9 +135,9 @@ const Point2D &Polygon::operator[]( unsigned int index ) const
  *
  * @return  A mutable reference to the vertex at the specified index
  */
-Point2D &Polygon::operator[]( unsigned int index )
+Shape::Vertex &Polygon::operator[]( unsigned int index )
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -147,35 +169,57 @@ std::ostream &operator<<( std::ostream &os, const Polygon &polygon )
  */
 void Polygon::draw( GraphicsContext *gc, ViewContext *vc ) const
 {
-    // set color
-    gc->setColor( color.toX11() );
+    SegmentBuffer sb;
+    draw( sb, vc );
+    sb.submit( gc );
+}
+
+
+/**
+ * @brief   Draws this polygon into a segment buffer for bulk submission to a
+ *          graphics context
+ *
+ * @param   &sb     The segment buffer to draw to
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+void Polygon::draw( SegmentBuffer &sb, ViewContext *vc ) const
+{
+    // per-thread scratch buffers, reused across frames
+    static thread_local std::vector<double> xs;
+    static thread_local std::vector<double> ys;
+    static thread_local std::vector<int> dxs;
+    static thread_local std::vector<int> dys;
+
+    unsigned int n = verts.size();
+
+    xs.resize( n );
+    ys.resize( n );
+    dxs.resize( n );
+    dys.resize( n );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        xs[i] = verts[i].x;
+        ys[i] = verts[i].y;
+    }
+
+    // convert every vertex from model to device coordinates once
+    vc->modelToDevice( xs.data(), ys.data(), dxs.data(), dys.data(), n );
+
+    std::vector<GraphicsContext::Segment> &segments = sb.batch( color.toX11() );
 
     // draw polygon
-    for ( unsigned int i = 0; i < verts.size() - 1; i++ )
+    for ( unsigned int i = 0; i + 1 < n; i++ )
     {
-        // convert from model to device coordinates
-        Point2D current = vc->modelToDevice( *verts[i] ) ;
-        Point2D next = vc->modelToDevice( *verts[i+1] ) ;
-
-        // draw line
-        gc->drawLine(
-            ( int ) current.getX(), ( int ) current.getY(),
-            ( int ) next.getX(),    ( int ) next.getY()
-        );
+        segments.push_back( { dxs[i], dys[i], dxs[i + 1], dys[i + 1] } );
     }
 
     // draw closing edge if applicable
-    if ( verts.size() > 2 )
+    if ( n > 2 )
     {
-        // convert from model to device coordinates
-        Point2D first = vc->modelToDevice( *verts[0] );
-        Point2D last = vc->modelToDevice( *verts[verts.size() - 1] );
-
-        // draw line
-        gc->drawLine(
-            ( int ) first.getX(), ( int ) first.getY(),
-            ( int ) last.getX(),  ( int ) last.getY()
-        );
+        segments.push_back( { dxs[0], dys[0], dxs[n - 1], dys[n - 1] } );
     }
 }
 
@@ -189,7 +233,54 @@ void Polygon::draw( GraphicsContext *gc, ViewContext *vc ) const
  */
 Polygon *Polygon::clone() const
 {
-    return new Polygon( verts, color );
+    return new Polygon( *this );
+}
+
+
+/**
+ * @brief   Gets the model space bounding box of this polygon
+ *
+ * @param   void
+ *
+ * @return  The bounding box of this polygon's vertices
+ */
+BoundingBox Polygon::bounds() const
+{
+    BoundingBox box;
+
+    std::for_each( verts.begin(), verts.end(), [&box]( const Vertex &vert )
+        {
+            box.expand( vert.x, vert.y );
+        }
+    );
+
+    return box;
+}
+
+
+/**
+ * @brief   Gets the number of vertices in this polygon
+ *
+ * @param   void
+ *
+ * @return  The number of vertices in this polygon
+ */
+unsigned int Polygon::size() const
+{
+    return verts.size();
+}
+
+
+/**
+ * @brief   Gets the vertices of this polygon as a contiguous array
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first vertex of this polygon
+ */
+const Shape::Vertex *Polygon::data() const
+{
+    return verts.data();
 }
 
 
@@ -205,9 +296,9 @@ std::ostream &Polygon::out( std::ostream &os ) const
 {
     Shape::out( os );
     os << "  VERTICES( ";
-    std::for_each( verts.begin(), verts.end(), [&os]( Point2D *vert )
+    std::for_each( verts.begin(), verts.end(), [&os]( const Vertex &vert )
         {
-            os << *vert << " ";
+            os << "POINT2D( " << vert.x << " " << vert.y << " ) ";
         }
     );
     os << ")";
@@ -220,53 +311,30 @@ std::ostream &Polygon::out( std::ostream &os ) const
  * @brief   Extracts a polygon from an input stream and assigns it to this
  *          polygon
  *
- * @param   &os     The input stream to extract from
+ * @param   &is     The input stream to extract from
  *
  * @return  A reference to the input stream
  */
 std::istream &Polygon::in( std::istream &is )
 {
-    // process shape attributes
-    Shape::in( is );
-
-    // get description string
-    std::string desc;
-    std::getline( is, desc );
-
-    // tokenize the description string
-    std::vector<std::string> tokens;
-    std::stringstream ss = std::stringstream( desc );
-
-    while( ss )
-    {
-        std::string token;
-        ss >> token;
-        tokens.push_back( token );
-    }
+    ShapeParser parser( is );
 
-    // validate that the line describes a polygon
-    if ( ( tokens.size() < 25 )       || ( tokens[10] != "VERTICES(" ) ||
-         ( tokens[11] != "POINT2D(" ) || ( tokens[15] != "POINT2D(" )  ||
-         ( tokens[19] != "POINT2D(" ) )
+    if ( !parser.next() || ( parser.getType() != ShapeStore::TYPE_POLYGON ) )
     {
         throw ShapeException("Invalid polygon description.");
     }
 
-    // extract points and store in a vector
-    std::vector<Point2D*> newVerts = std::vector<Point2D*>();
+    assign( parser );
 
-    for ( unsigned int i = 12; i < tokens.size() - 1; i += 4 )
-    {
-        double x = std::stod( tokens[i] );
-        double y = std::stod( tokens[i+1] );
-        newVerts.push_back( new Point2D( x, y ) );
-    }
+    const double *xs = parser.getXs();
+    const double *ys = parser.getYs();
 
-    // deep delete existing verts
-    Point2D::vectorDeepDelete( verts );
+    verts.resize( parser.getVertexCount() );
 
-    // reassign new verts
-    verts = newVerts;
+    for ( unsigned int i = 0; i < verts.size(); i++ )
+    {
+        verts[i] = toVertex( xs[i], ys[i] );
+    }
 
     return is;
 }
@@ -280,19 +348,41 @@ std::istream &Polygon::in( std::istream &is )
  *
  * @return  The midpoint between three points
  */
-Point2D Polygon::midpoint( const std::vector<Point2D*> &verts )
+Point2D Polygon::midpoint( const std::vector<Vertex> &verts )
 {
     double sumX = 0;
     double sumY = 0;
 
-    std::for_each( verts.begin(), verts.end(), [ &sumX, &sumY ]( Point2D *vert )
+    std::for_each( verts.begin(), verts.end(), [ &sumX, &sumY ]( const Vertex &vert )
        {
-           sumX += vert->getX();
-           sumY += vert->getY();
+           sumX += vert.x;
+           sumY += vert.y;
        }
     );
 
     return Point2D( ( sumX / verts.size() ), ( sumY / verts.size() ) );
 }
 
+
+/**
+ * @brief   Converts a vector of points to a vector of vertices
+ *
+ * @param   &points     The points to convert
+ *
+ * @return  The converted vertices
+ */
+std::vector<Shape::Vertex> Polygon::toVertices( const std::vector<Point2D*> &points )
+{
+    std::vector<Vertex> verts;
+    verts.reserve( points.size() );
+
+    std::for_each( points.begin(), points.end(), [ &verts ]( Point2D *point )
+       {
+           verts.push_back( toVertex( *point ) );
+       }
+    );
+
+    return verts;
+}
+
 /* -------------------------------------------------------------------------- */
\ No newline at end of file
@@ -17,6 +17,8 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <vector>
+
 # include "point2d.h"
 # include "shape.h"
 
@@ -34,8 +36,10 @@ public:
 
 
     explicit Polygon( const std::vector<Point2D*> &verts );
-    Polygon( const std::vector<Point2D*> &verts, const Color &color );
+    Polygon( const std::vector<Point2D*> &verts, PackedColor color );
+    Polygon( std::vector<Vertex> verts, PackedColor color );
     Polygon( const Polygon &polygon );
+    Polygon( Polygon &&polygon );
 
     ~Polygon() override;
 
@@ -44,16 +48,21 @@ public:
 
 
     Polygon &operator=( const Polygon &polygon );
+    Polygon &operator=( Polygon &&polygon );
 
-    const Point2D &operator[]( unsigned int index ) const override;
-    Point2D &operator[]( unsigned int index ) override;
+    const Vertex &operator[]( unsigned int index ) const override;
+    Vertex &operator[]( unsigned int index ) override;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
     void draw( GraphicsContext *gc, ViewContext *vc ) const override;
+    void draw( SegmentBuffer &sb, ViewContext *vc ) const override;
     Polygon *clone() const override;
+    BoundingBox bounds() const override;
+    unsigned int size() const override;
+    const Vertex *data() const override;
 
     std::ostream &out( std::ostream &os ) const override;
     std::istream &in( std::istream &is ) override;
@@ -66,13 +75,14 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    std::vector<Point2D*> verts;
+    std::vector<Vertex> verts;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
-    static Point2D midpoint( const std::vector<Point2D*> &verts );
+    static Point2D midpoint( const std::vector<Vertex> &verts );
+    static std::vector<Vertex> toVertices( const std::vector<Point2D*> &points );
 
 
     /* ====================================================================== */
@@ -10,8 +10,8 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include <sstream>
 # include "shape.h"
+# include "shapeparser.h"
 
 
 /* ------------------------ Constructors / Destructors ---------------------- */
@@ -25,7 +25,7 @@
  * @return  The created shape
  */
 Shape::Shape():
-color( Color( 0, 0, 0 ) ), origin( Point2D( 0, 0 ) )
+color( PackedColor( 0, 0, 0 ) ), origin( Point2D( 0, 0 ) )
 {}
 
 
@@ -33,11 +33,11 @@ color( Color( 0, 0, 0 ) ), origin( Point2D( 0, 0 ) )
  * @brief   Creates a shape object with the specified color and an origin at
  *          (0, 0)
  *
- * @param   &color      The color of the shape
+ * @param   color       The color of the shape
  *
  * @return  The created shape
  */
-Shape::Shape( const Color &color ):
+Shape::Shape( PackedColor color ):
 color( color ),
 origin( Point2D( 0, 0 ) )
 {}
@@ -52,7 +52,7 @@ origin( Point2D( 0, 0 ) )
  * @return  The created shape
  */
 Shape::Shape( const Point2D &origin ):
-color( Color( 0, 0, 0 ) ), origin( origin )
+color( PackedColor( 0, 0, 0 ) ), origin( origin )
 {}
 
 
@@ -60,12 +60,12 @@ color( Color( 0, 0, 0 ) ), origin( origin )
  * @brief   Creates a shape with the specified color and an origin at the
  *          specified coordinates
  *
- * @param   &color      The color of the shape
+ * @param   color       The color of the shape
  * @param   &origin     The origin of the shape
  *
  * @return  The created shape
  */
-Shape::Shape( const Color &color, const Point2D &origin ):
+Shape::Shape( PackedColor color, const Point2D &origin ):
 color( color ), origin( origin )
 {}
 
@@ -82,6 +82,16 @@ color( shape.color ), origin( shape.origin )
 {}
 
 
+/**
+ * @brief   Creates a shape by moving from an existing shape
+ *
+ * @param   &&shape     The shape to move from
+ *
+ * @return  The created shape
+ */
+Shape::Shape( Shape &&shape ) = default;
+
+
 /**
 * @brief   Shape destructor
 *
@@ -95,6 +105,26 @@ Shape::~Shape() = default;
 /* -------------------------- Overloaded Operators -------------------------- */
 
 
+/**
+ * @brief   Assigns the attributes of a shape to this shape
+ *
+ * @param   &shape  The shape to assign from
+ *
+ * @return  A reference to this shape
+ */
+Shape &Shape::operator=( const Shape &shape ) = default;
+
+
+/**
+ * @brief   Moves the attributes of a shape into this shape
+ *
+ * @param   &&shape     The shape to move from
+ *
+ * @return  A reference to this shape
+ */
+Shape &Shape::operator=( Shape &&shape ) = default;
+
+
 /**
  * @brief   Converts a shape to a string and writes it to an output stream
  *
@@ -118,9 +148,9 @@ std::ostream &operator<<( std::ostream &os, const Shape &shape )
  *
  * @param   void
  *
- * @return  A reference to the color of this shape
+ * @return  The color of this shape
  */
-const Color &Shape::getColor() const
+PackedColor Shape::getColor() const
 {
     return color;
 }
@@ -142,11 +172,11 @@ const Point2D &Shape::getOrigin() const
 /**
  * @brief   Sets the color of this shape
  *
- * @param   &color      The shape's color
+ * @param   color       The shape's color
  *
  * @return  void
  */
-void Shape::setColor( const Color &color )
+void Shape::setColor( PackedColor color )
 {
     this->color = color;
 }
@@ -175,58 +205,79 @@ void Shape::setOrigin( const Point2D &origin )
  */
 std::ostream &Shape::out( std::ostream &os ) const
 {
-    os << "SHAPE  COLOR( " << color[0] << " " << color[1] << " " << color[2] <<
+    os << "SHAPE  COLOR( " << color.getRed() << " " << color.getGreen() << " " << color.getBlue() <<
        " )  ORIGIN( " << origin[0] << " " << origin[1] << " )";
     return os;
 }
 
 
 /**
- * @brief   Extracts a shape from an input stream and assigns it to this
- *          shape (NOTE: Does not advance the input stream)
+ * @brief   Extracts a shape description from an input stream and assigns its
+ *          color and origin to this shape
  *
- * @param   &os     The input stream to extract from
+ * @param   &is     The input stream to extract from
  *
  * @return  A reference to the input stream
  */
 std::istream &Shape::in( std::istream &is )
 {
-    // get description string and seek back
-    std::string desc;
-    std::streampos pos = is.tellg();
-    std::getline( is, desc );
-    is.seekg( pos, std::ios_base::beg );
+    ShapeParser parser( is );
 
-    // tokenize the description string
-    std::vector<std::string> tokens;
-    std::stringstream ss = std::stringstream( desc );
-
-    while( ss )
-    {
-        std::string token;
-        ss >> token;
-        tokens.push_back( token );
-    }
-
-    // validate that the line describes a shape
-    if ( ( tokens.size() < 10 )     || ( tokens[0]  != "SHAPE" )  ||
-         ( tokens[1]  != "COLOR(" ) || ( tokens[6]  != "ORIGIN(" ) )
+    if ( !parser.next() )
     {
         throw ShapeException("Invalid shape description.");
     }
 
-    // extract and set the line's color channels
-    double colorRed = std::stod( tokens[2] );
-    double colorGreen = std::stod( tokens[3] );
-    double colorBlue = std::stod( tokens[4] );
-    color = Color( colorRed, colorGreen, colorBlue );
+    assign( parser );
+    return is;
+}
+
 
-    // extract and set the line's origin
-    double originX = std::stod( tokens[7] );
-    double originY = std::stod( tokens[8] );
-    origin = Point2D( originX, originY );
+/* --------------------------- Protected Functions -------------------------- */
 
-    return is;
+
+/**
+ * @brief   Creates a vertex from a pair of coordinates
+ *
+ * @param   x   The x-coordinate of the vertex
+ * @param   y   The y-coordinate of the vertex
+ *
+ * @return  The created vertex
+ */
+Shape::Vertex Shape::toVertex( double x, double y )
+{
+    Vertex vertex;
+    vertex.x = x;
+    vertex.y = y;
+    return vertex;
+}
+
+
+/**
+ * @brief   Creates a vertex from a point
+ *
+ * @param   &p  The point to create the vertex from
+ *
+ * @return  The created vertex
+ */
+Shape::Vertex Shape::toVertex( const Point2D &p )
+{
+    return toVertex( p.getX(), p.getY() );
+}
+
+
+/**
+ * @brief   Assigns the color and origin of the last shape read by a parser
+ *          to this shape
+ *
+ * @param   &parser     The parser that read the shape
+ *
+ * @return  void
+ */
+void Shape::assign( const ShapeParser &parser )
+{
+    color = PackedColor( parser.getRed(), parser.getGreen(), parser.getBlue() );
+    origin = Point2D( parser.getOriginX(), parser.getOriginY() );
 }
 
 
@@ -19,8 +19,11 @@
 
 # include <stdexcept>
 
-# include "color.h"
+# include "boundingbox.h"
+# include "packedcolor.h"
 # include "point2d.h"
+# include "segmentbuffer.h"
+# include "vertex2.h"
 # include "viewcontext.h"
 # include "gcontext.h"
 
@@ -28,6 +31,9 @@
 /* --------------------------------- Class ---------------------------------- */
 
 
+class ShapeParser;
+
+
 class ShapeException : public std::runtime_error
 {
 public:
@@ -43,14 +49,25 @@ class Shape
 
 public:
 
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+# ifdef SHAPE_FLOAT_VERTICES
+    typedef Vertex2f Vertex;
+# else
+    typedef Vertex2d Vertex;
+# endif
+
+
     /* --------------------- Constructors / Destructors --------------------- */
 
 
     Shape();
-    explicit Shape( const Color &color );
+    explicit Shape( PackedColor color );
     explicit Shape( const Point2D &origin );
-    Shape( const Color &color, const Point2D &origin );
+    Shape( PackedColor color, const Point2D &origin );
     Shape( const Shape &shape );
+    Shape( Shape &&shape );
 
     virtual ~Shape();
 
@@ -58,20 +75,27 @@ public:
     /* ------------------------ Overloaded Operators ------------------------ */
 
 
-    virtual const Point2D &operator[]( unsigned int index ) const = 0;
-    virtual Point2D &operator[]( unsigned int index ) = 0;
+    Shape &operator=( const Shape &shape );
+    Shape &operator=( Shape &&shape );
+
+    virtual const Vertex &operator[]( unsigned int index ) const = 0;
+    virtual Vertex &operator[]( unsigned int index ) = 0;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
     virtual void draw( GraphicsContext *gc, ViewContext *vc ) const = 0;
+    virtual void draw( SegmentBuffer &sb, ViewContext *vc ) const = 0;
     virtual Shape *clone() const = 0;
+    virtual BoundingBox bounds() const = 0;
+    virtual unsigned int size() const = 0;
+    virtual const Vertex *data() const = 0;
 
-    const Color &getColor() const;
+    PackedColor getColor() const;
     const Point2D &getOrigin() const;
 
-    void setColor( const Color &color );
+    void setColor( PackedColor color );
     void setOrigin( const Point2D &origin );
 
     virtual std::ostream &out( std::ostream &os ) const;
@@ -85,10 +109,19 @@ protected:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    Color color;
+    PackedColor color;
     Point2D origin;
 
 
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static Vertex toVertex( double x, double y );
+    static Vertex toVertex( const Point2D &p );
+
+    void assign( const ShapeParser &parser );
+
+
     /* =============================== PRIVATE ============================== */
 
 private:
@@ -10,9 +10,9 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
-# include <sstream>
-# include "color.h"
+# include "packedcolor.h"
 # include "triangle.h"
+# include "shapeparser.h"
 
 
 /* --------------------- Constructors / Destructors --------------------- */
@@ -28,7 +28,7 @@
  * @return  The created triangle
  */
 Triangle::Triangle( const Point2D &start, const Point2D &mid, const Point2D &end ):
-Triangle( start, mid, end, Color( 0, 0, 0 ) )
+Triangle( start, mid, end, PackedColor( 0, 0, 0 ) )
 {}
 
 
@@ -38,13 +38,13 @@ Triangle( start, mid, end, Color( 0, 0, 0 ) )
  * @param   &start  The starting point of the triangle
  * @param   &mid    The middle point of the triangle
  * @param   &end    The ending point of the triangle
- * @param   &color  The color of the triangle
+ * @param   color   The color of the triangle
  *
  * @return  The created triangle
  */
-Triangle::Triangle( const Point2D &start, const Point2D &mid, const Point2D &end, const Color &color ):
+Triangle::Triangle( const Point2D &start, const Point2D &mid, const Point2D &end, PackedColor color ):
 Shape( color, midpoint( start, mid, end ) ),
-verts( Vector3<Point2D*>( start.clone(), mid.clone(), end.clone() ) )
+verts{ toVertex( start ), toVertex( mid ), toVertex( end ) }
 {}
 
 
@@ -55,9 +55,17 @@ verts( Vector3<Point2D*>( start.clone(), mid.clone(), end.clone() ) )
  *
  * @return  The created triangle
  */
-Triangle::Triangle( const Triangle &triangle ) :
-Shape( triangle.color, triangle.origin ), verts( triangle.verts )
-{}
+Triangle::Triangle( const Triangle &triangle ) = default;
+
+
+/**
+ * @brief   Creates a triangle by moving from an existing triangle
+ *
+ * @param   &&triangle  The triangle to move from
+ *
+ * @return  The created triangle
+ */
+Triangle::Triangle( Triangle &&triangle ) = default;
 
 
 /**
@@ -67,10 +75,7 @@ Shape( triangle.color, triangle.origin ), verts( triangle.verts )
  *
  * @return  void
  */
-Triangle::~Triangle()
-{
-    Point2D::vector3DeepDelete( verts );
-}
+Triangle::~Triangle() = default;
 
 
 /* -------------------------- Overloaded Operators -------------------------- */
@@ -83,16 +88,17 @@ Triangle::~Triangle()
  *
  * @return  A reference to this triangle
  */
-Triangle &Triangle::operator=( const Triangle &triangle )
-{
-    Point2D::vector3DeepDelete( verts );
+Triangle &Triangle::operator=( const Triangle &triangle ) = default;
 
-    this->verts = Point2D::vector3DeepCopy( triangle.verts );
-    this->color = triangle.color;
-    this->origin = triangle.origin;
 
-    return *this;
-}
+/**
+ * @brief   Moves a triangle into this triangle
+ *
+ * @param   &&triangle  The triangle to move from
+ *
+ * @return  A reference to this triangle
+ */
+Triangle &Triangle::operator=( Triangle &&triangle ) = default;
 
 
 /**
@@ -102,9 +108,9 @@ Triangle &Triangle::operator=( const Triangle &triangle )
  *
  * @return  An immutable reference to the vertex at the specified index
  */
-const Point2D &Triangle::operator[]( unsigned int index ) const
+const Shape::Vertex &Triangle::operator[]( unsigned int index ) const
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -115,9 +121,9 @@ const Point2D &Triangle::operator[]( unsigned int index ) const
  *
  * @return  A mutable reference to the vertex at the specified index
  */
-Point2D &Triangle::operator[]( unsigned int index )
+Shape::Vertex &Triangle::operator[]( unsigned int index )
 {
-    return *verts[index];
+    return verts[index];
 }
 
 
@@ -149,23 +155,34 @@ std::ostream &operator<<( std::ostream &os, const Triangle &triangle )
  */
 void Triangle::draw( GraphicsContext *gc, ViewContext *vc ) const
 {
-    // convert from model to device coordinates
-    Point2D start = vc->modelToDevice( *verts[0] );
-    Point2D mid = vc->modelToDevice( *verts[1] );
-    Point2D end = vc->modelToDevice( *verts[2] );
-
-    // set color
-    gc->setColor( color.toX11() );
+    SegmentBuffer sb;
+    draw( sb, vc );
+    sb.submit( gc );
+}
 
-    // draw lines
-    gc->drawLine( ( int ) start.getX(), ( int ) start.getY(),
-                  ( int ) mid.getX(),   ( int ) mid.getY() );
 
-    gc->drawLine( ( int ) mid.getX(),   ( int ) mid.getY(),
-                  ( int ) end.getX(),   ( int ) end.getY() );
+/**
+ * @brief   Draws this triangle into a segment buffer for bulk submission to a
+ *          graphics context
+ *
+ * @param   &sb     The segment buffer to draw to
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+void Triangle::draw( SegmentBuffer &sb, ViewContext *vc ) const
+{
+    // convert from model to device coordinates
+    double xs[3] = { verts[0].x, verts[1].x, verts[2].x };
+    double ys[3] = { verts[0].y, verts[1].y, verts[2].y };
+    int dxs[3], dys[3];
+    vc->modelToDevice( xs, ys, dxs, dys, 3 );
 
-    gc->drawLine( ( int ) end.getX(),   ( int ) end.getY(),
-                  ( int ) start.getX(), ( int ) start.getY() );
+    // draw lines
+    std::vector<GraphicsContext::Segment> &segments = sb.batch( color.toX11() );
+    segments.push_back( { dxs[0], dys[0], dxs[1], dys[1] } );
+    segments.push_back( { dxs[1], dys[1], dxs[2], dys[2] } );
+    segments.push_back( { dxs[2], dys[2], dxs[0], dys[0] } );
 }
 
 
@@ -178,7 +195,50 @@ void Triangle::draw( GraphicsContext *gc, ViewContext *vc ) const
  */
 Triangle *Triangle::clone() const
 {
-    return new Triangle( *verts[0], *verts[1], *verts[2], color );
+    return new Triangle( *this );
+}
+
+
+/**
+ * @brief   Gets the model space bounding box of this triangle
+ *
+ * @param   void
+ *
+ * @return  The bounding box of this triangle's vertices
+ */
+BoundingBox Triangle::bounds() const
+{
+    BoundingBox box;
+    box.expand( verts[0].x, verts[0].y );
+    box.expand( verts[1].x, verts[1].y );
+    box.expand( verts[2].x, verts[2].y );
+    return box;
+}
+
+
+/**
+ * @brief   Gets the number of vertices in this triangle
+ *
+ * @param   void
+ *
+ * @return  The number of vertices in this triangle
+ */
+unsigned int Triangle::size() const
+{
+    return 3;
+}
+
+
+/**
+ * @brief   Gets the vertices of this triangle as a contiguous array
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first vertex of this triangle
+ */
+const Shape::Vertex *Triangle::data() const
+{
+    return verts;
 }
 
 
@@ -193,9 +253,9 @@ Triangle *Triangle::clone() const
 std::ostream &Triangle::out( std::ostream &os ) const
 {
     Shape::out( os );
-    os << "  VERTICES( " << *verts[0] << " "
-                         << *verts[1] << " "
-                         << *verts[2] << " )";
+    os << "  VERTICES( POINT2D( " << verts[0].x << " " << verts[0].y << " ) "
+       <<            "POINT2D( " << verts[1].x << " " << verts[1].y << " ) "
+       <<            "POINT2D( " << verts[2].x << " " << verts[2].y << " ) )";
     return os;
 }
 
@@ -204,52 +264,27 @@ std::ostream &Triangle::out( std::ostream &os ) const
  * @brief   Extracts a triangle from an input stream and assigns it to this
  *          triangle
  *
- * @param   &os     The input stream to extract from
+ * @param   &is     The input stream to extract from
  *
  * @return  A reference to the input stream
  */
 std::istream &Triangle::in( std::istream &is )
 {
-    // process shape attributes
-    Shape::in( is );
-
-    // get description string
-    std::string desc;
-    std::getline( is, desc );
-
-    // tokenize the description string
-    std::vector<std::string> tokens;
-    std::stringstream ss = std::stringstream( desc );
-
-    while( ss )
-    {
-        std::string token;
-        ss >> token;
-        tokens.push_back( token );
-    }
+    ShapeParser parser( is );
 
-    // validate that the line describes a triangle
-    if ( ( tokens.size() != 25 )      || ( tokens[10] != "VERTICES(" ) ||
-         ( tokens[11] != "POINT2D(" ) || ( tokens[15] != "POINT2D(" )  ||
-         ( tokens[19] != "POINT2D(" ) )
+    if ( !parser.next() || ( parser.getType() != ShapeStore::TYPE_TRIANGLE ) )
     {
         throw ShapeException("Invalid triangle description.");
     }
 
-    // extract and set the line's vertices
-    double startX = std::stod( tokens[ 12 ] );
-    double startY = std::stod( tokens[ 13 ] );
-    double midX = std::stod( tokens[ 16 ] );
-    double midY = std::stod( tokens[ 17 ] );
-    double endX = std::stod( tokens[ 20 ] );
-    double endY = std::stod( tokens[ 21 ] );
-
-    Point2D::vector3DeepDelete( verts );
-    verts = Vector3<Point2D*>(
-        new Point2D( startX, startY),
-        new Point2D( midX, midY),
-        new Point2D( endX, endY )
-    );
+    assign( parser );
+
+    const double *xs = parser.getXs();
+    const double *ys = parser.getYs();
+
+    verts[0] = toVertex( xs[0], ys[0] );
+    verts[1] = toVertex( xs[1], ys[1] );
+    verts[2] = toVertex( xs[2], ys[2] );
 
     return is;
 }
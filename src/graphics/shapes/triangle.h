@@ -34,8 +34,9 @@ public:
 
 
     Triangle( const Point2D &start, const Point2D &mid, const Point2D &end );
-    Triangle( const Point2D &start, const Point2D &mid, const Point2D &end, const Color &color );
+    Triangle( const Point2D &start, const Point2D &mid, const Point2D &end, PackedColor color );
     Triangle( const Triangle &tri );
+    Triangle( Triangle &&triangle );
 
     ~Triangle() override;
 
@@ -44,16 +45,21 @@ public:
 
 
     Triangle &operator=( const Triangle &triangle );
+    Triangle &operator=( Triangle &&triangle );
 
-    const Point2D &operator[]( unsigned int index ) const override;
-    Point2D &operator[]( unsigned int index ) override;
+    const Vertex &operator[]( unsigned int index ) const override;
+    Vertex &operator[]( unsigned int index ) override;
 
 
     /* ------------------------------ Functions ----------------------------- */
 
 
     void draw( GraphicsContext *gc, ViewContext *vc ) const override;
+    void draw( SegmentBuffer &sb, ViewContext *vc ) const override;
     Triangle *clone() const override;
+    BoundingBox bounds() const override;
+    unsigned int size() const override;
+    const Vertex *data() const override;
 
     std::ostream &out( std::ostream &os ) const override;
     std::istream &in( std::istream &is ) override;
@@ -66,7 +72,7 @@ private:
     /* ----------------------------- Attributes ----------------------------- */
 
 
-    Vector3<Point2D*> verts;
+    Vertex verts[3];
 
 
     /* ------------------------------ Functions ----------------------------- */
@@ -0,0 +1,2231 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapestore.cpp
+ * @brief   Contiguous type-bucketed storage of shapes
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+# include <cmath>
+# include <cstdio>
+# include <cstring>
+# include <fstream>
+# include <utility>
+
+# include "framestats.h"
+# include "line.h"
+# include "polygon.h"
+# include "shapestore.h"
+# include "simplify.h"
+# include "triangle.h"
+
+
+/* ------------------------------- Constants -------------------------------- */
+
+
+static const char BINARY_MAGIC[8] = { 'S', 'H', 'A', 'P', 'E', 'B', 'I', 'N' };
+
+// written in native order, so a file from a foreign host reads back swapped
+static const uint32_t BINARY_BYTE_ORDER = 0x01020304;
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates an empty shape store
+ *
+ * @param   void
+ *
+ * @return  The created shape store
+ */
+ShapeStore::ShapeStore() = default;
+
+
+/**
+ * @brief   Creates a shape store from an existing shape store, sharing any
+ *          mapped pools with it but none of its caches, which are rebuilt
+ *          when first needed
+ *
+ * @param   &store  The shape store to copy from
+ *
+ * @return  The created shape store
+ */
+ShapeStore::ShapeStore( const ShapeStore &store ):
+slots( store.slots ),
+lines( store.lines ),
+triangles( store.triangles ),
+polygons( store.polygons ),
+live( store.live )
+{}
+
+
+/**
+ * @brief   Creates a shape store from a shape store that is no longer needed
+ *
+ * @param   &&store     The shape store to move from
+ *
+ * @return  The created shape store
+ */
+ShapeStore::ShapeStore( ShapeStore &&store ) = default;
+
+
+/**
+ * @brief   Shape store destructor
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+ShapeStore::~ShapeStore() = default;
+
+
+/* -------------------------- Overloaded Operators -------------------------- */
+
+
+/**
+ * @brief   Assigns the shapes from another shape store to this shape store,
+ *          dropping the caches of both stores' shapes
+ *
+ * @param   &store  The shape store to copy from
+ *
+ * @return  This shape store
+ */
+ShapeStore &ShapeStore::operator=( const ShapeStore &store )
+{
+    if ( &store != this )
+    {
+        slots = store.slots;
+        lines = store.lines;
+        triangles = store.triangles;
+        polygons = store.polygons;
+        live = store.live;
+        details.clear();
+    }
+
+    return *this;
+}
+
+
+/**
+ * @brief   Assigns the shapes from a shape store that is no longer needed to
+ *          this shape store
+ *
+ * @param   &&store     The shape store to move from
+ *
+ * @return  This shape store
+ */
+ShapeStore &ShapeStore::operator=( ShapeStore &&store ) = default;
+
+
+/**
+ * @brief   Creates an empty bucket
+ *
+ * @param   stride  The number of vertices in every row, or zero if rows have
+ *                  varying numbers of vertices
+ *
+ * @return  The created bucket
+ */
+ShapeStore::Bucket::Bucket( unsigned int stride ):
+stride( stride )
+{}
+
+
+/**
+ * @brief   Creates a sink that draws into a segment buffer
+ *
+ * @param   &sb     The segment buffer to draw to
+ *
+ * @return  The created sink
+ */
+ShapeStore::BufferSink::BufferSink( SegmentBuffer &sb ):
+sb( sb )
+{}
+
+
+/**
+ * @brief   Creates a sink that fills a display list
+ *
+ * @param   &list   The display list to fill
+ *
+ * @return  The created sink
+ */
+ShapeStore::ListSink::ListSink( DisplayList &list ):
+list( list )
+{}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Copies a shape into this shape store
+ *
+ * @param   &shape  The shape to add
+ *
+ * @return  The handle of the stored shape
+ */
+ShapeStore::Handle ShapeStore::add( const Shape &shape )
+{
+    ShapeType type = typeOf( shape );
+
+    // split the contiguous vertices into the same layout as the pools
+    static thread_local std::vector<double> xs;
+    static thread_local std::vector<double> ys;
+
+    const Shape::Vertex *verts = shape.data();
+    unsigned int n = shape.size();
+
+    xs.resize( n );
+    ys.resize( n );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        xs[i] = verts[i].x;
+        ys[i] = verts[i].y;
+    }
+
+    const Point2D &origin = shape.getOrigin();
+
+    return add( type, xs.data(), ys.data(), n, origin.getX(), origin.getY(),
+                shape.getColor() );
+}
+
+
+/**
+ * @brief   Copies a shape from another shape store into this shape store
+ *
+ * @param   &store      The shape store to copy from
+ * @param   handle      The handle of the shape in the other shape store
+ *
+ * @return  The handle of the stored shape
+ */
+ShapeStore::Handle ShapeStore::add( const ShapeStore &store, Handle handle )
+{
+    const Slot &slot = store.slots[handle];
+    const Bucket &b = store.bucket( slot.type );
+    unsigned int row = slot.row;
+    unsigned int first = b.first( row );
+
+    return add( slot.type, b.x() + first, b.y() + first, b.count( row ),
+                b.originX[row], b.originY[row], b.colors[row] );
+}
+
+
+/**
+ * @brief   Adds a shape to this shape store from its raw attributes
+ *
+ * @param   type        The shape type
+ * @param   *xs         The x-coordinates of the shape's vertices
+ * @param   *ys         The y-coordinates of the shape's vertices
+ * @param   n           The number of vertices
+ * @param   originX     The x-coordinate of the shape's origin
+ * @param   originY     The y-coordinate of the shape's origin
+ * @param   color       The shape's color
+ *
+ * @return  The handle of the stored shape
+ */
+ShapeStore::Handle ShapeStore::add( ShapeType type, const double *xs,
+                                    const double *ys, unsigned int n,
+                                    double originX, double originY,
+                                    PackedColor color )
+{
+    Bucket &b = bucket( type );
+    Handle handle = slots.size();
+
+    if ( ( b.stride != 0 ) && ( n != b.stride ) )
+    {
+        throw ShapeException( "Wrong number of vertices for shape type." );
+    }
+
+    b.own();
+
+    if ( b.stride == 0 )
+    {
+        b.offsets.push_back( b.xs.size() );
+        b.counts.push_back( n );
+    }
+
+    b.xs.insert( b.xs.end(), xs, xs + n );
+    b.ys.insert( b.ys.end(), ys, ys + n );
+
+    slots.push_back( { type, b.rows() } );
+
+    b.handles.push_back( handle );
+    b.originX.push_back( originX );
+    b.originY.push_back( originY );
+    b.colors.push_back( color );
+
+    live++;
+    return handle;
+}
+
+
+/**
+ * @brief   Appends every shape of another shape store to this shape store a
+ *          column at a time, keeping their order
+ *
+ * @param   &store  The shape store to append
+ *
+ * @return  The handle the other store's first handle became, every other
+ *          handle moving up by the same amount
+ */
+ShapeStore::Handle ShapeStore::splice( const ShapeStore &store )
+{
+    // appending to the columns being read would read what was appended
+    if ( &store == this )
+    {
+        ShapeStore copy( store );
+        return splice( copy );
+    }
+
+    const ShapeType types[] = { TYPE_LINE, TYPE_TRIANGLE, TYPE_POLYGON };
+    Handle base = slots.size();
+    unsigned int rowBase[3];
+
+    for ( ShapeType type : types )
+    {
+        Bucket &b = bucket( type );
+        const Bucket &from = store.bucket( type );
+        rowBase[type] = b.rows();
+
+        if ( from.rows() == 0 )
+        {
+            continue;
+        }
+
+        b.own();
+        size_t vertexBase = b.xs.size();
+
+        b.xs.insert( b.xs.end(), from.x(), from.x() + from.vertices() );
+        b.ys.insert( b.ys.end(), from.y(), from.y() + from.vertices() );
+
+        if ( b.stride == 0 )
+        {
+            for ( unsigned int offset : from.offsets )
+            {
+                b.offsets.push_back( vertexBase + offset );
+            }
+
+            b.counts.insert( b.counts.end(), from.counts.begin(), from.counts.end() );
+        }
+
+        for ( Handle handle : from.handles )
+        {
+            b.handles.push_back( ( handle == INVALID_HANDLE ) ? INVALID_HANDLE : base + handle );
+        }
+
+        b.originX.insert( b.originX.end(), from.originX.begin(), from.originX.end() );
+        b.originY.insert( b.originY.end(), from.originY.begin(), from.originY.end() );
+        b.colors.insert( b.colors.end(), from.colors.begin(), from.colors.end() );
+        b.dead += from.dead;
+    }
+
+    // removed shapes stay removed, so the handles keep lining up
+    for ( const Slot &slot : store.slots )
+    {
+        unsigned int row = ( slot.row == INVALID_HANDLE ) ? INVALID_HANDLE
+                                                          : rowBase[slot.type] + slot.row;
+        slots.push_back( { slot.type, row } );
+    }
+
+    live += store.live;
+    return base;
+}
+
+
+/**
+ * @brief   Removes a shape from this shape store
+ *
+ * @param   handle  The handle of the shape to remove
+ *
+ * @return  True if the shape was removed, false if it was not stored
+ */
+bool ShapeStore::remove( Handle handle )
+{
+    if ( !contains( handle ) )
+    {
+        return false;
+    }
+
+    Slot &slot = slots[handle];
+    Bucket &b = bucket( slot.type );
+
+    b.handles[slot.row] = INVALID_HANDLE;
+    b.dead++;
+    slot.row = INVALID_HANDLE;
+    live--;
+
+    if ( ( b.dead > COMPACT_THRESHOLD ) && ( b.dead * 2 > b.rows() ) )
+    {
+        compact( b );
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Determines if a stored shape has exactly the specified type,
+ *          vertices, origin and color
+ *
+ * @param   handle  The handle of the shape
+ * @param   type    The shape type to compare with
+ * @param   *xs     The x-coordinates to compare with
+ * @param   *ys     The y-coordinates to compare with
+ * @param   n       The number of vertices
+ * @param   originX The x-coordinate of the origin to compare with
+ * @param   originY The y-coordinate of the origin to compare with
+ * @param   color   The color to compare with
+ *
+ * @return  True if the shape matches, false otherwise
+ */
+bool ShapeStore::matches( Handle handle, ShapeType type, const double *xs,
+                          const double *ys, unsigned int n, double originX,
+                          double originY, PackedColor color ) const
+{
+    if ( !contains( handle ) || ( slots[handle].type != type ) )
+    {
+        return false;
+    }
+
+    const Bucket &b = bucket( type );
+    unsigned int row = slots[handle].row;
+    unsigned int first = b.first( row );
+
+    if ( ( b.count( row ) != n ) || ( b.originX[row] != originX ) ||
+         ( b.originY[row] != originY ) || ( b.colors[row] != color ) )
+    {
+        return false;
+    }
+
+    return std::equal( xs, xs + n, b.x() + first ) &&
+           std::equal( ys, ys + n, b.y() + first );
+}
+
+
+/**
+ * @brief   Determines if a shape is stored in this shape store
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  True if the shape is stored, false otherwise
+ */
+bool ShapeStore::contains( Handle handle ) const
+{
+    return ( handle < slots.size() ) && ( slots[handle].row != INVALID_HANDLE );
+}
+
+
+/**
+ * @brief   Gets the type of a stored shape
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  The type of the shape
+ */
+ShapeStore::ShapeType ShapeStore::getType( Handle handle ) const
+{
+    return slots[handle].type;
+}
+
+
+/**
+ * @brief   Gets the model space bounding box of a stored shape
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  The bounding box of the shape's vertices
+ */
+BoundingBox ShapeStore::bounds( Handle handle ) const
+{
+    const Slot &slot = slots[handle];
+    const Bucket &b = bucket( slot.type );
+    unsigned int first = b.first( slot.row );
+    unsigned int last = first + b.count( slot.row );
+    const double *xs = b.x();
+    const double *ys = b.y();
+
+    BoundingBox box;
+
+    for ( unsigned int i = first; i < last; i++ )
+    {
+        box.expand( xs[i], ys[i] );
+    }
+
+    return box;
+}
+
+
+/**
+ * @brief   Gets the distance from a point to the nearest edge of a stored
+ *          shape, treating triangles and polygons as closed outlines
+ *
+ * @param   handle  The handle of the shape
+ * @param   x       The x-coordinate of the point
+ * @param   y       The y-coordinate of the point
+ *
+ * @return  The distance in model space
+ */
+double ShapeStore::distance( Handle handle, double x, double y ) const
+{
+    const Slot &slot = slots[handle];
+    const Bucket &b = bucket( slot.type );
+    unsigned int first = b.first( slot.row );
+    unsigned int n = b.count( slot.row );
+    const double *xs = b.x() + first;
+    const double *ys = b.y() + first;
+
+    if ( n == 1 )
+    {
+        return std::hypot( xs[0] - x, ys[0] - y );
+    }
+
+    // a line has no closing edge
+    unsigned int edges = ( slot.type == TYPE_LINE ) ? n - 1 : n;
+    double nearest = HUGE_VAL;
+
+    for ( unsigned int i = 0; i < edges; i++ )
+    {
+        unsigned int j = ( i + 1 < n ) ? i + 1 : 0;
+        nearest = std::min( nearest, segmentDistance( xs[i], ys[i], xs[j], ys[j], x, y ) );
+    }
+
+    return nearest;
+}
+
+
+/**
+ * @brief   Determines if any edge of a stored shape passes through a box,
+ *          treating triangles and polygons as closed outlines
+ *
+ * @param   handle  The handle of the shape
+ * @param   &box    The box, in model space
+ *
+ * @return  True if the shape's outline touches the box, false otherwise
+ */
+bool ShapeStore::intersects( Handle handle, const BoundingBox &box ) const
+{
+    const Slot &slot = slots[handle];
+    const Bucket &b = bucket( slot.type );
+    unsigned int first = b.first( slot.row );
+    unsigned int n = b.count( slot.row );
+    const double *xs = b.x() + first;
+    const double *ys = b.y() + first;
+
+    if ( n == 1 )
+    {
+        return box.contains( xs[0], ys[0] );
+    }
+
+    unsigned int edges = ( slot.type == TYPE_LINE ) ? n - 1 : n;
+
+    for ( unsigned int i = 0; i < edges; i++ )
+    {
+        unsigned int j = ( i + 1 < n ) ? i + 1 : 0;
+
+        if ( segmentIntersects( xs[i], ys[i], xs[j], ys[j], box ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief   Creates a standalone shape object from a stored shape
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  The created shape, which the caller must delete
+ */
+Shape *ShapeStore::create( Handle handle ) const
+{
+    const Slot &slot = slots[handle];
+    const Bucket &b = bucket( slot.type );
+    unsigned int row = slot.row;
+    unsigned int first = b.first( row );
+    const double *xs = b.x();
+    const double *ys = b.y();
+
+    PackedColor color = b.colors[row];
+    Shape *shape;
+
+    if ( slot.type == TYPE_LINE )
+    {
+        shape = new Line(
+            Point2D( xs[first], ys[first] ),
+            Point2D( xs[first + 1], ys[first + 1] ),
+            color
+        );
+    }
+    else if ( slot.type == TYPE_TRIANGLE )
+    {
+        shape = new Triangle(
+            Point2D( xs[first], ys[first] ),
+            Point2D( xs[first + 1], ys[first + 1] ),
+            Point2D( xs[first + 2], ys[first + 2] ),
+            color
+        );
+    }
+    else
+    {
+        std::vector<Shape::Vertex> verts( b.count( row ) );
+
+        for ( unsigned int i = 0; i < verts.size(); i++ )
+        {
+            verts[i].x = xs[first + i];
+            verts[i].y = ys[first + i];
+        }
+
+        shape = new Polygon( std::move( verts ), color );
+    }
+
+    // the stored origin may differ from the one the constructors derive
+    shape->setOrigin( Point2D( b.originX[row], b.originY[row] ) );
+
+    return shape;
+}
+
+
+/**
+ * @brief   Draws every stored shape into a segment buffer, transforming each
+ *          bucket's vertex pool in a single batch
+ *
+ * @param   &sb     The segment buffer to draw to
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+void ShapeStore::draw( SegmentBuffer &sb, ViewContext *vc ) const
+{
+    BufferSink sink( sb );
+
+    drawBucket<TYPE_LINE>( sink, vc );
+    drawBucket<TYPE_TRIANGLE>( sink, vc );
+    drawBucket<TYPE_POLYGON>( sink, vc );
+}
+
+
+/**
+ * @brief   Draws a selection of stored shapes into a segment buffer
+ *
+ * @param   &sb         The segment buffer to draw to
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes to draw
+ * @param   n           The number of handles
+ *
+ * @return  void
+ */
+void ShapeStore::draw( SegmentBuffer &sb, ViewContext *vc,
+                       const Handle *handles, size_t n ) const
+{
+    BufferSink sink( sb );
+    drawSelection( sink, vc, handles, n );
+}
+
+
+/**
+ * @brief   Gives every stored shape an entry in a display list, transforming
+ *          each bucket's vertex pool in a single batch
+ *
+ * @param   &list   The display list to fill
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+void ShapeStore::draw( DisplayList &list, ViewContext *vc ) const
+{
+    ListSink sink( list );
+
+    drawBucket<TYPE_LINE>( sink, vc );
+    drawBucket<TYPE_TRIANGLE>( sink, vc );
+    drawBucket<TYPE_POLYGON>( sink, vc );
+}
+
+
+/**
+ * @brief   Gives a selection of stored shapes an entry in a display list
+ *
+ * @param   &list       The display list to fill
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes
+ * @param   n           The number of handles
+ *
+ * @return  void
+ */
+void ShapeStore::draw( DisplayList &list, ViewContext *vc,
+                       const Handle *handles, size_t n ) const
+{
+    ListSink sink( list );
+    drawSelection( sink, vc, handles, n );
+}
+
+
+/**
+ * @brief   Gives every stored shape an entry in a display list, sharing the
+ *          work between the threads of a work pool
+ *
+ * @param   &list       The display list to fill
+ * @param   *vc         The view context to draw with
+ * @param   &workers    The work pool to draw on
+ *
+ * @return  void
+ */
+void ShapeStore::draw( DisplayList &list, ViewContext *vc, WorkPool &workers ) const
+{
+    if ( ( workers.size() < 2 ) || ( live < PARALLEL_SHAPES ) )
+    {
+        draw( list, vc );
+        return;
+    }
+
+    // simplified copies are shared, so they are brought up to date first
+    const Bucket &polygonPool = detail( polygons, vc, nullptr, 0 );
+
+    size_t count = 0;
+    addChunks( TYPE_LINE, lines.handles.data(), lines.rows(), count );
+    addChunks( TYPE_TRIANGLE, triangles.handles.data(), triangles.rows(), count );
+    addChunks( TYPE_POLYGON, polygons.handles.data(), polygons.rows(), count );
+
+    drawChunks( list, vc, polygonPool, workers, count );
+}
+
+
+/**
+ * @brief   Gives a selection of stored shapes an entry in a display list,
+ *          sharing the work between the threads of a work pool
+ *
+ * @param   &list       The display list to fill
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes
+ * @param   n           The number of handles
+ * @param   &workers    The work pool to draw on
+ *
+ * @return  void
+ */
+void ShapeStore::draw( DisplayList &list, ViewContext *vc,
+                       const Handle *handles, size_t n, WorkPool &workers ) const
+{
+    if ( ( workers.size() < 2 ) || ( n < PARALLEL_SHAPES ) )
+    {
+        draw( list, vc, handles, n );
+        return;
+    }
+
+    size_t starts[4];
+    group( handles, n, starts );
+
+    const Bucket &polygonPool = detail( polygons, vc, picked.data() + starts[2],
+                                        starts[3] - starts[2] );
+
+    size_t count = 0;
+    addChunks( TYPE_LINE, picked.data() + starts[0], starts[1] - starts[0], count );
+    addChunks( TYPE_TRIANGLE, picked.data() + starts[1], starts[2] - starts[1], count );
+    addChunks( TYPE_POLYGON, picked.data() + starts[2], starts[3] - starts[2], count );
+
+    drawChunks( list, vc, polygonPool, workers, count );
+}
+
+
+/**
+ * @brief   Appends the model space edges of the stored shapes added from a
+ *          handle on to a list of line ends, for a graphics context to keep
+ *
+ * @param   from        The first handle whose shape to append
+ * @param   &vertices   The line ends to append to, two per edge
+ *
+ * @return  The handle the next shape added will get, to append from next
+ */
+ShapeStore::Handle ShapeStore::edges( Handle from,
+                                      std::vector<GraphicsContext::ModelVertex> &vertices ) const
+{
+    for ( Handle handle = from; handle < slots.size(); handle++ )
+    {
+        if ( !contains( handle ) )
+        {
+            continue;
+        }
+
+        const Slot &slot = slots[handle];
+        const Bucket &b = bucket( slot.type );
+        unsigned int first = b.first( slot.row );
+        unsigned int n = b.count( slot.row );
+        unsigned int pixel = b.colors[slot.row].toX11();
+        const double *xs = b.x() + first;
+        const double *ys = b.y() + first;
+
+        // the edges emit() draws, less the closing edge of a line
+        unsigned int edges = ( n > 2 ) ? n : n - 1;
+
+        for ( unsigned int i = 0; ( n > 1 ) && ( i < edges ); i++ )
+        {
+            unsigned int j = ( i + 1 ) % n;
+            vertices.push_back( { float( xs[i] ), float( ys[i] ), pixel } );
+            vertices.push_back( { float( xs[j] ), float( ys[j] ), pixel } );
+        }
+    }
+
+    return slots.size();
+}
+
+
+/**
+ * @brief   Converts the stored shapes to strings and outputs them to an
+ *          output stream, one shape per line
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  The output stream
+ */
+std::ostream &ShapeStore::out( std::ostream &os ) const
+{
+    for ( const Slot &slot : slots )
+    {
+        if ( slot.row != INVALID_HANDLE )
+        {
+            outRow( os, bucket( slot.type ), slot.row );
+            os << std::endl;
+        }
+    }
+
+    return os;
+}
+
+
+/**
+ * @brief   Writes the stored shapes to an output stream in the binary
+ *          drawing format
+ *
+ * @param   &os     The output stream to write to, opened in binary mode
+ *
+ * @return  void
+ */
+void ShapeStore::write( std::ostream &os ) const
+{
+    const Bucket *buckets[] = { &lines, &triangles, &polygons };
+    const ShapeType types[] = { TYPE_LINE, TYPE_TRIANGLE, TYPE_POLYGON };
+
+    FileHeader header;
+    std::memcpy( header.magic, BINARY_MAGIC, sizeof( header.magic ) );
+    header.version = BINARY_VERSION;
+    header.byteOrder = BINARY_BYTE_ORDER;
+    header.typeCount = 3;
+    header.reserved = 0;
+
+    // lay out every array after the table, keeping each one 8-byte aligned
+    // so that a mapped file can be read in place
+    TypeEntry entries[3];
+    uint64_t offset = sizeof( FileHeader ) + sizeof( entries );
+
+    auto place = [&offset]( uint64_t bytes )
+    {
+        uint64_t start = offset;
+        offset += ( bytes + 7 ) & ~( ( uint64_t ) 7 );
+        return start;
+    };
+
+    for ( unsigned int i = 0; i < 3; i++ )
+    {
+        const Bucket &b = *buckets[i];
+        TypeEntry &entry = entries[i];
+
+        uint64_t rows = b.rows() - b.dead;
+        uint64_t vertices = 0;
+
+        for ( unsigned int row = 0; row < b.rows(); row++ )
+        {
+            if ( b.handles[row] != INVALID_HANDLE ) vertices += b.count( row );
+        }
+
+        entry.type = types[i];
+        entry.stride = b.stride;
+        entry.rows = rows;
+        entry.vertices = vertices;
+        entry.xs = place( vertices * sizeof( double ) );
+        entry.ys = place( vertices * sizeof( double ) );
+        entry.counts = ( b.stride == 0 ) ? place( rows * sizeof( uint32_t ) ) : 0;
+        entry.originX = place( rows * sizeof( double ) );
+        entry.originY = place( rows * sizeof( double ) );
+        entry.colors = place( rows * sizeof( uint32_t ) );
+        entry.order = place( rows * sizeof( uint32_t ) );
+    }
+
+    // the position of every live shape among the live shapes, so that a
+    // read hands out handles in the order the shapes were added
+    std::vector<uint32_t> ranks( slots.size() );
+    uint32_t rank = 0;
+
+    for ( Handle handle = 0; handle < slots.size(); handle++ )
+    {
+        if ( slots[handle].row != INVALID_HANDLE ) ranks[handle] = rank++;
+    }
+
+    os.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    os.write( reinterpret_cast<const char*>( entries ), sizeof( entries ) );
+
+    // the arrays follow in the same order they were placed in
+    for ( const Bucket *b : buckets )
+    {
+        writeVertices( os, *b, b->x() );
+        writeVertices( os, *b, b->y() );
+
+        if ( b->stride == 0 )
+        {
+            writeRows( os, *b, b->counts.data() );
+        }
+
+        writeRows( os, *b, b->originX.data() );
+        writeRows( os, *b, b->originY.data() );
+        writeColors( os, *b );
+        writeOrder( os, *b, ranks );
+    }
+}
+
+
+/**
+ * @brief   Saves the stored shapes to a drawing file in the specified format,
+ *          replacing the file only once the whole drawing is written
+ *
+ * @param   &fileName   The name of the file to save to
+ * @param   binary      True for the binary format, false for the text format
+ *
+ * @return  void
+ */
+void ShapeStore::save( const std::string &fileName, bool binary ) const
+{
+    // vertex pools may still be read from a mapping of the file being
+    // replaced, so it is swapped for the new one rather than truncated
+    std::string tempName = fileName + ".tmp";
+
+    {
+        std::ofstream fileout( tempName.c_str(), binary ? std::ios::binary : std::ios::out );
+
+        if ( !fileout )
+        {
+            throw ShapeException( "Could not write " + fileName + "." );
+        }
+
+        if ( binary )
+        {
+            write( fileout );
+        }
+        else
+        {
+            out( fileout );
+        }
+
+        fileout.close();
+
+        if ( !fileout )
+        {
+            std::remove( tempName.c_str() );
+            throw ShapeException( "Could not write " + fileName + "." );
+        }
+    }
+
+    if ( std::rename( tempName.c_str(), fileName.c_str() ) != 0 )
+    {
+        std::remove( tempName.c_str() );
+        throw ShapeException( "Could not replace " + fileName + "." );
+    }
+}
+
+
+/**
+ * @brief   Replaces the contents of this shape store with the shapes in a
+ *          mapped binary drawing, leaving the vertex pools in the mapping,
+ *          or leaves it as it was if the drawing is invalid
+ *
+ * @param   &file   The mapped file to read from
+ *
+ * @return  void
+ */
+void ShapeStore::read( const std::shared_ptr<const MappedFile> &file )
+{
+    const unsigned char *data = file->data();
+    size_t size = file->size();
+
+    if ( !isBinary( data, size ) || ( size < sizeof( FileHeader ) ) )
+    {
+        throw ShapeException( "Invalid binary drawing." );
+    }
+
+    FileHeader header;
+    std::memcpy( &header, data, sizeof( header ) );
+
+    if ( header.version != BINARY_VERSION )
+    {
+        throw ShapeException( "Unsupported binary drawing version." );
+    }
+
+    if ( header.byteOrder != BINARY_BYTE_ORDER )
+    {
+        throw ShapeException( "Binary drawing has a foreign byte order." );
+    }
+
+    if ( sizeof( FileHeader ) + header.typeCount * sizeof( TypeEntry ) > size )
+    {
+        throw ShapeException( "Truncated binary drawing." );
+    }
+
+    // every array must lie inside the file and be aligned for in-place reads
+    auto check = [size]( uint64_t start, uint64_t count, uint64_t width )
+    {
+        if ( ( start % 8 != 0 ) || ( start > size ) ||
+             ( count > ( size - start ) / width ) )
+        {
+            throw ShapeException( "Truncated binary drawing." );
+        }
+    };
+
+    // the shapes are read into a store of their own, so a drawing that fails
+    // a check part way through leaves this one as it was
+    ShapeStore store;
+
+    // every shape names its handle, so the slots are laid out up front
+    uint64_t total = 0;
+
+    for ( unsigned int i = 0; i < header.typeCount; i++ )
+    {
+        TypeEntry entry;
+        std::memcpy( &entry, data + sizeof( FileHeader ) + i * sizeof( TypeEntry ),
+                     sizeof( entry ) );
+
+        check( entry.order, entry.rows, sizeof( uint32_t ) );
+        total += entry.rows;
+    }
+
+    if ( total >= INVALID_HANDLE )
+    {
+        throw ShapeException( "Invalid binary drawing." );
+    }
+
+    store.slots.assign( total, { TYPE_LINE, INVALID_HANDLE } );
+
+    for ( unsigned int i = 0; i < header.typeCount; i++ )
+    {
+        TypeEntry entry;
+        std::memcpy( &entry, data + sizeof( FileHeader ) + i * sizeof( TypeEntry ),
+                     sizeof( entry ) );
+
+        if ( entry.type > TYPE_POLYGON )
+        {
+            throw ShapeException( "Unknown shape type in binary drawing." );
+        }
+
+        ShapeType type = static_cast<ShapeType>( entry.type );
+        Bucket &b = store.bucket( type );
+
+        if ( ( entry.stride != b.stride ) ||
+             ( ( b.stride != 0 ) && ( entry.vertices != entry.rows * b.stride ) ) )
+        {
+            throw ShapeException( "Invalid binary drawing." );
+        }
+
+        check( entry.xs, entry.vertices, sizeof( double ) );
+        check( entry.ys, entry.vertices, sizeof( double ) );
+        check( entry.originX, entry.rows, sizeof( double ) );
+        check( entry.originY, entry.rows, sizeof( double ) );
+        check( entry.colors, entry.rows, sizeof( uint32_t ) );
+
+        if ( b.rows() != 0 )
+        {
+            throw ShapeException( "Duplicate shape type in binary drawing." );
+        }
+
+        unsigned int rows = entry.rows;
+
+        if ( b.stride == 0 )
+        {
+            check( entry.counts, entry.rows, sizeof( uint32_t ) );
+
+            const uint32_t *counts = reinterpret_cast<const uint32_t*>( data + entry.counts );
+            uint64_t vertexTotal = 0;
+
+            b.counts.assign( counts, counts + rows );
+            b.offsets.resize( rows );
+
+            for ( unsigned int row = 0; row < rows; row++ )
+            {
+                b.offsets[row] = vertexTotal;
+                vertexTotal += counts[row];
+            }
+
+            if ( vertexTotal != entry.vertices )
+            {
+                throw ShapeException( "Invalid binary drawing." );
+            }
+        }
+
+        const double *xs = reinterpret_cast<const double*>( data + entry.xs );
+        const double *ys = reinterpret_cast<const double*>( data + entry.ys );
+        const double *originX = reinterpret_cast<const double*>( data + entry.originX );
+        const double *originY = reinterpret_cast<const double*>( data + entry.originY );
+
+        // a shape at infinity could never be indexed or drawn
+        if ( !isFinite( xs, entry.vertices ) || !isFinite( ys, entry.vertices ) ||
+             !isFinite( originX, rows ) || !isFinite( originY, rows ) )
+        {
+            throw ShapeException( "Non-finite coordinate in binary drawing." );
+        }
+
+        b.mapping = file;
+        b.mappedXs = xs;
+        b.mappedYs = ys;
+        b.mappedVertices = entry.vertices;
+
+        // the per-shape attributes are small next to the pools, so copy them
+        const uint32_t *colors = reinterpret_cast<const uint32_t*>( data + entry.colors );
+        const uint32_t *order = reinterpret_cast<const uint32_t*>( data + entry.order );
+
+        b.originX.assign( originX, originX + rows );
+        b.originY.assign( originY, originY + rows );
+
+        b.handles.resize( rows );
+        b.colors.resize( rows );
+
+        for ( unsigned int row = 0; row < rows; row++ )
+        {
+            Handle handle = order[row];
+
+            if ( ( handle >= total ) || ( store.slots[handle].row != INVALID_HANDLE ) )
+            {
+                throw ShapeException( "Invalid binary drawing." );
+            }
+
+            b.handles[row] = handle;
+            b.colors[row] = PackedColor( colors[row] );
+            store.slots[handle] = { type, row };
+        }
+
+        store.live += rows;
+    }
+
+    slots.swap( store.slots );
+    std::swap( lines, store.lines );
+    std::swap( triangles, store.triangles );
+    std::swap( polygons, store.polygons );
+    live = store.live;
+    details.clear();
+}
+
+
+/**
+ * @brief   Determines if a block of data starts with the binary drawing
+ *          format's magic bytes
+ *
+ * @param   *data   The data to test
+ * @param   size    The size of the data in bytes
+ *
+ * @return  True if the data is a binary drawing, false otherwise
+ */
+bool ShapeStore::isBinary( const unsigned char *data, size_t size )
+{
+    return ( size >= sizeof( BINARY_MAGIC ) ) &&
+           ( std::memcmp( data, BINARY_MAGIC, sizeof( BINARY_MAGIC ) ) == 0 );
+}
+
+
+/**
+ * @brief   Determines if every value of an array is finite, as every stored
+ *          coordinate has to be
+ *
+ * @param   *values     The values to test
+ * @param   n           The number of values
+ *
+ * @return  True if no value is infinite or NaN, false otherwise
+ */
+bool ShapeStore::isFinite( const double *values, size_t n )
+{
+    for ( size_t i = 0; i < n; i++ )
+    {
+        if ( !std::isfinite( values[i] ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Compacts every bucket, dropping the storage of removed shapes
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeStore::compact()
+{
+    compact( lines );
+    compact( triangles );
+    compact( polygons );
+}
+
+
+/**
+ * @brief   Removes all shapes from this shape store and invalidates every
+ *          handle
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeStore::clear()
+{
+    slots.clear();
+    lines = Bucket( 2 );
+    triangles = Bucket( 3 );
+    polygons = Bucket( 0 );
+    details.clear();
+    live = 0;
+}
+
+
+/**
+ * @brief   Gets the number of stored shapes
+ *
+ * @param   void
+ *
+ * @return  The number of stored shapes
+ */
+unsigned int ShapeStore::size() const
+{
+    return live;
+}
+
+
+/**
+ * @brief   Determines the stored type of a shape
+ *
+ * @param   &shape  The shape to classify
+ *
+ * @return  The shape type
+ */
+ShapeStore::ShapeType ShapeStore::typeOf( const Shape &shape )
+{
+    if ( dynamic_cast<const Line*>( &shape ) )
+    {
+        return TYPE_LINE;
+    }
+    else if ( dynamic_cast<const Triangle*>( &shape ) )
+    {
+        return TYPE_TRIANGLE;
+    }
+    else if ( dynamic_cast<const Polygon*>( &shape ) )
+    {
+        return TYPE_POLYGON;
+    }
+
+    throw ShapeException( "Unsupported shape type." );
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Gets the number of rows in this bucket, including tombstones
+ *
+ * @param   void
+ *
+ * @return  The number of rows
+ */
+unsigned int ShapeStore::Bucket::rows() const
+{
+    return handles.size();
+}
+
+
+/**
+ * @brief   Gets the index of the first vertex of a row in the vertex pool
+ *
+ * @param   row     The row
+ *
+ * @return  The index of the row's first vertex
+ */
+unsigned int ShapeStore::Bucket::first( unsigned int row ) const
+{
+    return ( stride != 0 ) ? row * stride : offsets[row];
+}
+
+
+/**
+ * @brief   Gets the number of vertices of a row
+ *
+ * @param   row     The row
+ *
+ * @return  The number of vertices of the row
+ */
+unsigned int ShapeStore::Bucket::count( unsigned int row ) const
+{
+    return ( stride != 0 ) ? stride : counts[row];
+}
+
+
+/**
+ * @brief   Gets the number of vertices in this bucket's pools, including
+ *          those of tombstones
+ *
+ * @param   void
+ *
+ * @return  The number of vertices
+ */
+size_t ShapeStore::Bucket::vertices() const
+{
+    return ( mappedXs != nullptr ) ? mappedVertices : xs.size();
+}
+
+
+/**
+ * @brief   Gets this bucket's pool of vertex x-coordinates
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first x-coordinate
+ */
+const double *ShapeStore::Bucket::x() const
+{
+    return ( mappedXs != nullptr ) ? mappedXs : xs.data();
+}
+
+
+/**
+ * @brief   Gets this bucket's pool of vertex y-coordinates
+ *
+ * @param   void
+ *
+ * @return  A pointer to the first y-coordinate
+ */
+const double *ShapeStore::Bucket::y() const
+{
+    return ( mappedYs != nullptr ) ? mappedYs : ys.data();
+}
+
+
+/**
+ * @brief   Copies this bucket's vertex pools out of a mapped file so that
+ *          they can be modified
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+void ShapeStore::Bucket::own()
+{
+    if ( mappedXs == nullptr )
+    {
+        return;
+    }
+
+    xs.assign( mappedXs, mappedXs + mappedVertices );
+    ys.assign( mappedYs, mappedYs + mappedVertices );
+
+    mappedXs = nullptr;
+    mappedYs = nullptr;
+    mappedVertices = 0;
+    mapping.reset();
+}
+
+
+/**
+ * @brief   Starts a shape, getting the batch of its color
+ *
+ * @param   handle  The handle of the shape
+ * @param   pixel   The shape's color
+ *
+ * @return  The batch to append the shape's segments to
+ */
+std::vector<GraphicsContext::Segment> &ShapeStore::BufferSink::begin( Handle, unsigned int pixel )
+{
+    // neighbouring shapes usually share a color, so avoid a batch lookup
+    // per shape
+    if ( ( segments == nullptr ) || ( pixel != this->pixel ) )
+    {
+        this->pixel = pixel;
+        segments = &sb.batch( pixel );
+    }
+
+    return *segments;
+}
+
+
+/**
+ * @brief   Finishes a shape, which needs nothing more in a segment buffer
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  void
+ */
+void ShapeStore::BufferSink::end( Handle )
+{}
+
+
+/**
+ * @brief   Starts a shape, replacing its display list entry
+ *
+ * @param   handle  The handle of the shape
+ * @param   pixel   The shape's color
+ *
+ * @return  The pool to append the shape's segments to
+ */
+std::vector<GraphicsContext::Segment> &ShapeStore::ListSink::begin( Handle handle, unsigned int pixel )
+{
+    return list.begin( handle, pixel );
+}
+
+
+/**
+ * @brief   Finishes a shape's display list entry
+ *
+ * @param   handle  The handle of the shape
+ *
+ * @return  void
+ */
+void ShapeStore::ListSink::end( Handle handle )
+{
+    list.end( handle );
+}
+
+
+/**
+ * @brief   Gets the distance from a point to a line segment
+ *
+ * @param   x1  The x-coordinate of the segment's first end
+ * @param   y1  The y-coordinate of the segment's first end
+ * @param   x2  The x-coordinate of the segment's second end
+ * @param   y2  The y-coordinate of the segment's second end
+ * @param   x   The x-coordinate of the point
+ * @param   y   The y-coordinate of the point
+ *
+ * @return  The distance
+ */
+double ShapeStore::segmentDistance( double x1, double y1, double x2, double y2,
+                                    double x, double y )
+{
+    double dx = x2 - x1;
+    double dy = y2 - y1;
+    double length = dx * dx + dy * dy;
+
+    // the nearest point on the segment, as a fraction of the way along it
+    double t = ( length > 0 ) ? ( ( x - x1 ) * dx + ( y - y1 ) * dy ) / length : 0;
+    t = std::max( 0.0, std::min( 1.0, t ) );
+
+    return std::hypot( x1 + t * dx - x, y1 + t * dy - y );
+}
+
+
+/**
+ * @brief   Determines if a line segment passes through a box, by clipping
+ *          the segment to each of the box's edges in turn
+ *
+ * @param   x1      The x-coordinate of the segment's first end
+ * @param   y1      The y-coordinate of the segment's first end
+ * @param   x2      The x-coordinate of the segment's second end
+ * @param   y2      The y-coordinate of the segment's second end
+ * @param   &box    The box
+ *
+ * @return  True if any part of the segment is inside the box, false
+ *          otherwise
+ */
+bool ShapeStore::segmentIntersects( double x1, double y1, double x2, double y2,
+                                    const BoundingBox &box )
+{
+    double dx = x2 - x1;
+    double dy = y2 - y1;
+
+    // each edge as the component of the direction leaving through it and
+    // how far inside it the first end is
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { x1 - box.getMinX(), box.getMaxX() - x1,
+                    y1 - box.getMinY(), box.getMaxY() - y1 };
+
+    double enter = 0;
+    double leave = 1;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        if ( p[i] == 0 )
+        {
+            // parallel to the edge, so entirely inside or outside it
+            if ( q[i] < 0 ) return false;
+        }
+        else if ( p[i] < 0 )
+        {
+            enter = std::max( enter, q[i] / p[i] );
+        }
+        else
+        {
+            leave = std::min( leave, q[i] / p[i] );
+        }
+
+        if ( enter > leave )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief   Gets the bucket for a shape type
+ *
+ * @param   type    The shape type
+ *
+ * @return  A reference to the bucket
+ */
+ShapeStore::Bucket &ShapeStore::bucket( ShapeType type )
+{
+    return ( type == TYPE_LINE ) ? lines :
+           ( type == TYPE_TRIANGLE ) ? triangles : polygons;
+}
+
+
+/**
+ * @brief   Gets the bucket for a shape type
+ *
+ * @param   type    The shape type
+ *
+ * @return  An immutable reference to the bucket
+ */
+const ShapeStore::Bucket &ShapeStore::bucket( ShapeType type ) const
+{
+    return ( type == TYPE_LINE ) ? lines :
+           ( type == TYPE_TRIANGLE ) ? triangles : polygons;
+}
+
+
+/**
+ * @brief   Drops the tombstones from a bucket, keeping the order of the
+ *          remaining rows
+ *
+ * @param   &b  The bucket to compact
+ *
+ * @return  void
+ */
+void ShapeStore::compact( Bucket &b )
+{
+    if ( b.dead == 0 )
+    {
+        return;
+    }
+
+    // simplified copies are indexed by row
+    if ( &b == &polygons )
+    {
+        details.clear();
+    }
+
+    b.own();
+
+    unsigned int rows = 0;
+    unsigned int verts = 0;
+
+    for ( unsigned int row = 0; row < b.rows(); row++ )
+    {
+        Handle handle = b.handles[row];
+
+        if ( handle == INVALID_HANDLE )
+        {
+            continue;
+        }
+
+        unsigned int first = b.first( row );
+        unsigned int count = b.count( row );
+
+        // rows only ever move towards the front, so copies never overlap
+        // data that is yet to be read
+        for ( unsigned int i = 0; i < count; i++ )
+        {
+            b.xs[verts + i] = b.xs[first + i];
+            b.ys[verts + i] = b.ys[first + i];
+        }
+
+        if ( b.stride == 0 )
+        {
+            b.offsets[rows] = verts;
+            b.counts[rows] = count;
+        }
+
+        b.handles[rows] = handle;
+        b.originX[rows] = b.originX[row];
+        b.originY[rows] = b.originY[row];
+        b.colors[rows] = b.colors[row];
+
+        slots[handle].row = rows;
+
+        rows++;
+        verts += count;
+    }
+
+    b.xs.resize( verts );
+    b.ys.resize( verts );
+
+    if ( b.stride == 0 )
+    {
+        b.offsets.resize( rows );
+        b.counts.resize( rows );
+    }
+
+    b.handles.resize( rows );
+    b.originX.resize( rows );
+    b.originY.resize( rows );
+    b.colors.resize( rows );
+
+    b.dead = 0;
+}
+
+
+/**
+ * @brief   Gets the vertex pools to draw a bucket with at a view's zoom,
+ *          simplifying the polygons to be drawn to the zoom's tolerance if
+ *          they have not been already
+ *
+ * @param   &b          The bucket to draw
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes to draw, or null for all
+ * @param   n           The number of handles
+ *
+ * @return  The simplified polygons, or the bucket itself for other types
+ */
+const ShapeStore::Bucket &ShapeStore::detail( const Bucket &b, const ViewContext *vc,
+                                              const Handle *handles, size_t n ) const
+{
+    if ( ( &b != &polygons ) || ( b.rows() == b.dead ) )
+    {
+        return b;
+    }
+
+    // pixels per model unit; a rotation leaves the determinant alone
+    const Affine2D &transform = vc->getTransform();
+    double scale = std::sqrt( std::fabs( transform.get( 0, 0 ) * transform.get( 1, 1 ) -
+                                         transform.get( 0, 1 ) * transform.get( 1, 0 ) ) );
+
+    if ( !std::isfinite( scale ) || ( scale <= 0 ) )
+    {
+        return b;
+    }
+
+    // round the tolerance down to a power of two, so zooming in or out by a
+    // wheel tick mostly reuses the same copy
+    int level;
+    std::frexp( LOD_TOLERANCE / scale, &level );
+    level--;
+
+    if ( ( details.size() >= LOD_LEVELS ) && ( details.count( level ) == 0 ) )
+    {
+        details.clear();
+    }
+
+    Bucket &d = details.emplace( level, Bucket( 0 ) ).first->second;
+    double tolerance = std::ldexp( 1.0, level );
+
+    // rows are simplified the first time they are drawn at this level
+    d.offsets.resize( b.rows(), unsigned( NOT_SIMPLIFIED ) );
+    d.counts.resize( b.rows(), 0 );
+
+    if ( handles == nullptr )
+    {
+        for ( unsigned int row = 0; row < b.rows(); row++ )
+        {
+            simplify( d, row, tolerance );
+        }
+    }
+    else
+    {
+        for ( size_t i = 0; i < n; i++ )
+        {
+            const Slot &slot = slots[handles[i]];
+            if ( slot.type == TYPE_POLYGON ) simplify( d, slot.row, tolerance );
+        }
+    }
+
+    return d;
+}
+
+
+/**
+ * @brief   Adds a polygon to a simplified copy of the polygons, unless it is
+ *          there already, using Ramer-Douglas-Peucker
+ *
+ * @param   &d          The simplified copy
+ * @param   row         The row of the polygon
+ * @param   tolerance   The most a vertex may be from the simplified outline,
+ *                      in model units
+ *
+ * @return  void
+ */
+void ShapeStore::simplify( Bucket &d, unsigned int row, double tolerance ) const
+{
+    if ( d.offsets[row] != NOT_SIMPLIFIED )
+    {
+        return;
+    }
+
+    unsigned int first = polygons.first( row );
+    unsigned int n = polygons.count( row );
+    const double *xs = polygons.x() + first;
+    const double *ys = polygons.y() + first;
+
+    d.offsets[row] = d.xs.size();
+
+    // removed rows need no vertices
+    if ( polygons.handles[row] == INVALID_HANDLE )
+    {
+        return;
+    }
+
+    if ( n <= 3 )
+    {
+        d.xs.insert( d.xs.end(), xs, xs + n );
+        d.ys.insert( d.ys.end(), ys, ys + n );
+        d.counts[row] = n;
+        return;
+    }
+
+    simplifyPolyline( xs, ys, n, true, tolerance, keep, ranges );
+
+    for ( unsigned int i = 0; i < n; i++ )
+    {
+        if ( keep[i] )
+        {
+            d.xs.push_back( xs[i] );
+            d.ys.push_back( ys[i] );
+            d.counts[row]++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Draws every live row of one bucket, transforming its vertex pool
+ *          in a single batch
+ *
+ * @param   &sink   Where the shapes' segments go
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+template<ShapeStore::ShapeType TYPE, typename Sink>
+void ShapeStore::drawBucket( Sink &sink, ViewContext *vc ) const
+{
+    const Bucket &b = bucket( TYPE );
+
+    if ( b.rows() == b.dead )
+    {
+        return;
+    }
+
+    // tombstoned vertices are transformed too, which is cheaper than
+    // skipping them in the batch
+    const Bucket &pool = detail( b, vc, nullptr, 0 );
+    dxs.resize( pool.vertices() );
+    dys.resize( pool.vertices() );
+    vc->modelToDevice( pool.x(), pool.y(), dxs.data(), dys.data(), pool.vertices() );
+
+    for ( unsigned int row = 0; row < b.rows(); row++ )
+    {
+        Handle handle = b.handles[row];
+
+        if ( handle == INVALID_HANDLE )
+        {
+            continue;
+        }
+
+        unsigned int first = ( strideOf<TYPE>() != 0 ) ? row * strideOf<TYPE>() : pool.offsets[row];
+        unsigned int count = ( strideOf<TYPE>() != 0 ) ? strideOf<TYPE>() : pool.counts[row];
+
+        emit<TYPE>( sink.begin( handle, b.colors[row].toX11() ),
+                    dxs.data() + first, dys.data() + first, count );
+        sink.end( handle );
+    }
+}
+
+
+/**
+ * @brief   Draws a selection of stored shapes one type at a time, keeping the
+ *          order of the selection within each type
+ *
+ * @param   &sink       Where the shapes' segments go
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes to draw
+ * @param   n           The number of handles
+ *
+ * @return  void
+ */
+template<typename Sink>
+void ShapeStore::drawSelection( Sink &sink, ViewContext *vc,
+                                const Handle *handles, size_t n ) const
+{
+    size_t starts[4];
+    group( handles, n, starts );
+
+    drawRows<TYPE_LINE>( sink, vc, picked.data() + starts[0], starts[1] - starts[0] );
+    drawRows<TYPE_TRIANGLE>( sink, vc, picked.data() + starts[1], starts[2] - starts[1] );
+    drawRows<TYPE_POLYGON>( sink, vc, picked.data() + starts[2], starts[3] - starts[2] );
+}
+
+
+/**
+ * @brief   Groups a selection of stored shapes by type into the picked
+ *          handles, keeping the order of the selection within each type
+ *
+ * @param   *handles    The handles of the shapes
+ * @param   n           The number of handles
+ * @param   *starts     Filled in with where each type's handles start in the
+ *                      picked handles, followed by where the last ends
+ *
+ * @return  void
+ */
+void ShapeStore::group( const Handle *handles, size_t n, size_t *starts ) const
+{
+    starts[0] = starts[1] = starts[2] = starts[3] = 0;
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        starts[slots[handles[i]].type + 1]++;
+    }
+
+    starts[2] += starts[1];
+    starts[3] += starts[2];
+
+    picked.resize( n );
+    size_t next[3] = { starts[0], starts[1], starts[2] };
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        picked[next[slots[handles[i]].type]++] = handles[i];
+    }
+}
+
+
+/**
+ * @brief   Draws a selection of shapes of one type, gathering their vertices
+ *          so they are transformed in a single batch
+ *
+ * @param   &sink       Where the shapes' segments go
+ * @param   *vc         The view context to draw with
+ * @param   *handles    The handles of the shapes to draw, all of the type
+ * @param   n           The number of handles
+ *
+ * @return  void
+ */
+template<ShapeStore::ShapeType TYPE, typename Sink>
+void ShapeStore::drawRows( Sink &sink, ViewContext *vc,
+                           const Handle *handles, size_t n ) const
+{
+    if ( n == 0 )
+    {
+        return;
+    }
+
+    const Bucket &b = bucket( TYPE );
+    const Bucket &pool = detail( b, vc, handles, n );
+
+    pickedXs.clear();
+    pickedYs.clear();
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        unsigned int row = slots[handles[i]].row;
+        unsigned int first = ( strideOf<TYPE>() != 0 ) ? row * strideOf<TYPE>() : pool.offsets[row];
+        unsigned int count = ( strideOf<TYPE>() != 0 ) ? strideOf<TYPE>() : pool.counts[row];
+
+        pickedXs.insert( pickedXs.end(), pool.x() + first, pool.x() + first + count );
+        pickedYs.insert( pickedYs.end(), pool.y() + first, pool.y() + first + count );
+    }
+
+    dxs.resize( pickedXs.size() );
+    dys.resize( pickedYs.size() );
+    vc->modelToDevice( pickedXs.data(), pickedYs.data(), dxs.data(), dys.data(),
+                       pickedXs.size() );
+
+    size_t first = 0;
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        unsigned int row = slots[handles[i]].row;
+        unsigned int count = ( strideOf<TYPE>() != 0 ) ? strideOf<TYPE>() : pool.counts[row];
+
+        emit<TYPE>( sink.begin( handles[i], b.colors[row].toX11() ),
+                    dxs.data() + first, dys.data() + first, count );
+        sink.end( handles[i] );
+
+        first += count;
+    }
+}
+
+
+/**
+ * @brief   Splits shapes of one type into the chunks of a parallel draw
+ *
+ * @param   type        The type of the shapes
+ * @param   *handles    The handles of the shapes, where removed shapes are
+ *                      skipped
+ * @param   n           The number of handles
+ * @param   &count      The number of chunks so far, counted on
+ *
+ * @return  void
+ */
+void ShapeStore::addChunks( ShapeType type, const Handle *handles, size_t n,
+                            size_t &count ) const
+{
+    for ( size_t i = 0; i < n; i += CHUNK_SHAPES )
+    {
+        // chunks are kept for their scratch space, so there are only ever
+        // more of them
+        if ( count == chunks.size() )
+        {
+            chunks.emplace_back();
+        }
+
+        Chunk &chunk = chunks[count++];
+        chunk.type = type;
+        chunk.handles = handles + i;
+        chunk.n = ( n - i < CHUNK_SHAPES ) ? n - i : CHUNK_SHAPES;
+    }
+}
+
+
+/**
+ * @brief   Draws the chunks of a parallel draw on a work pool, then gives
+ *          their shapes entries in a display list in chunk order
+ *
+ * @param   &list           The display list to fill
+ * @param   *vc             The view context to draw with
+ * @param   &polygonPool    The polygons to draw, simplified for the view
+ * @param   &workers        The work pool to draw on
+ * @param   count           The number of chunks
+ *
+ * @return  void
+ */
+void ShapeStore::drawChunks( DisplayList &list, const ViewContext *vc,
+                             const Bucket &polygonPool, WorkPool &workers,
+                             size_t count ) const
+{
+    workers.run( count, [this, vc, &polygonPool]( size_t task, unsigned int )
+       {
+           Chunk &chunk = chunks[task];
+
+           if ( chunk.type == TYPE_LINE ) drawChunk<TYPE_LINE>( chunk, lines, vc );
+           else if ( chunk.type == TYPE_TRIANGLE ) drawChunk<TYPE_TRIANGLE>( chunk, triangles, vc );
+           else drawChunk<TYPE_POLYGON>( chunk, polygonPool, vc );
+       }
+    );
+
+    // the tasks leave the frame stats alone, as they belong to this thread
+    for ( size_t i = 0; i < count; i++ )
+    {
+        const Chunk &chunk = chunks[i];
+        const GraphicsContext::Segment *segment = chunk.segments.data();
+
+        FRAME_STATS_ADD( vertices, chunk.xs.size() );
+
+        for ( const Drawn &drawn : chunk.shapes )
+        {
+            std::vector<GraphicsContext::Segment> &segments = list.begin( drawn.handle, drawn.pixel );
+            segments.insert( segments.end(), segment, segment + drawn.segments );
+            list.end( drawn.handle );
+
+            segment += drawn.segments;
+        }
+    }
+}
+
+
+/**
+ * @brief   Draws the shapes of a chunk into the chunk's own segments, as one
+ *          task of a parallel draw
+ *
+ * @param   &chunk  The chunk to draw
+ * @param   &pool   The bucket the chunk's vertices are in
+ * @param   *vc     The view context to draw with
+ *
+ * @return  void
+ */
+template<ShapeStore::ShapeType TYPE>
+void ShapeStore::drawChunk( Chunk &chunk, const Bucket &pool, const ViewContext *vc ) const
+{
+    const Bucket &b = bucket( TYPE );
+
+    chunk.xs.clear();
+    chunk.ys.clear();
+    chunk.shapes.clear();
+    chunk.segments.clear();
+
+    for ( size_t i = 0; i < chunk.n; i++ )
+    {
+        Handle handle = chunk.handles[i];
+
+        if ( handle == INVALID_HANDLE )
+        {
+            continue;
+        }
+
+        unsigned int row = slots[handle].row;
+        unsigned int first = ( strideOf<TYPE>() != 0 ) ? row * strideOf<TYPE>() : pool.offsets[row];
+        unsigned int count = ( strideOf<TYPE>() != 0 ) ? strideOf<TYPE>() : pool.counts[row];
+
+        chunk.xs.insert( chunk.xs.end(), pool.x() + first, pool.x() + first + count );
+        chunk.ys.insert( chunk.ys.end(), pool.y() + first, pool.y() + first + count );
+        chunk.shapes.push_back( Drawn { handle, b.colors[row].toX11(), count, 0 } );
+    }
+
+    chunk.dxs.resize( chunk.xs.size() );
+    chunk.dys.resize( chunk.ys.size() );
+    vc->transformToDevice( chunk.xs.data(), chunk.ys.data(), chunk.dxs.data(),
+                           chunk.dys.data(), chunk.xs.size() );
+
+    size_t first = 0;
+
+    for ( Drawn &drawn : chunk.shapes )
+    {
+        size_t before = chunk.segments.size();
+        emit<TYPE>( chunk.segments, chunk.dxs.data() + first, chunk.dys.data() + first,
+                    drawn.vertices );
+        drawn.segments = chunk.segments.size() - before;
+
+        first += drawn.vertices;
+    }
+}
+
+
+/**
+ * @brief   Appends the device space edges of a shape to a batch of segments
+ *
+ * @param   &segments   The batch of segments to append to
+ * @param   *dxs        The device x-coordinates of the shape's vertices
+ * @param   *dys        The device y-coordinates of the shape's vertices
+ * @param   n           The number of vertices
+ *
+ * @return  void
+ */
+template<ShapeStore::ShapeType TYPE>
+void ShapeStore::emit( std::vector<GraphicsContext::Segment> &segments,
+                       const int *dxs, const int *dys, unsigned int n )
+{
+    if ( n == 0 )
+    {
+        return;
+    }
+
+    // a shape covering a couple of pixels at most looks the same as a point
+    int left = dxs[0], right = dxs[0], top = dys[0], bottom = dys[0];
+
+    for ( unsigned int i = 1; i < n; i++ )
+    {
+        left = std::min( left, dxs[i] );
+        right = std::max( right, dxs[i] );
+        top = std::min( top, dys[i] );
+        bottom = std::max( bottom, dys[i] );
+    }
+
+    if ( ( right - left < LOD_POINT_SIZE ) && ( bottom - top < LOD_POINT_SIZE ) )
+    {
+        segments.push_back( { dxs[0], dys[0], dxs[0], dys[0] } );
+        return;
+    }
+
+    // the type is known when compiling, so only one of these is kept
+    if ( TYPE == TYPE_LINE )
+    {
+        segments.push_back( { dxs[0], dys[0], dxs[1], dys[1] } );
+    }
+    else if ( TYPE == TYPE_TRIANGLE )
+    {
+        segments.push_back( { dxs[0], dys[0], dxs[1], dys[1] } );
+        segments.push_back( { dxs[1], dys[1], dxs[2], dys[2] } );
+        segments.push_back( { dxs[2], dys[2], dxs[0], dys[0] } );
+    }
+    else
+    {
+        for ( unsigned int i = 0; i + 1 < n; i++ )
+        {
+            segments.push_back( { dxs[i], dys[i], dxs[i + 1], dys[i + 1] } );
+        }
+
+        // draw closing edge if applicable
+        if ( n > 2 )
+        {
+            segments.push_back( { dxs[0], dys[0], dxs[n - 1], dys[n - 1] } );
+        }
+    }
+}
+
+
+/**
+ * @brief   Converts a row of a bucket to the text form of its shape and
+ *          writes it to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &b      The bucket holding the row
+ * @param   row     The row to convert
+ *
+ * @return  The output stream
+ */
+std::ostream &ShapeStore::outRow( std::ostream &os, const Bucket &b,
+                                  unsigned int row )
+{
+    unsigned int first = b.first( row );
+    unsigned int last = first + b.count( row );
+    const double *xs = b.x();
+    const double *ys = b.y();
+
+    PackedColor color = b.colors[row];
+
+    os << "SHAPE  COLOR( " << color.getRed() << " " << color.getGreen() << " "
+       << color.getBlue() << " )  ORIGIN( " << b.originX[row] << " "
+       << b.originY[row] << " )  VERTICES( ";
+
+    // polygons end every point with a space, lines and triangles separate
+    // points with one
+    for ( unsigned int i = first; i < last; i++ )
+    {
+        os << "POINT2D( " << xs[i] << " " << ys[i] << " )";
+
+        if ( ( b.stride == 0 ) || ( i + 1 < last ) )
+        {
+            os << " ";
+        }
+    }
+
+    if ( b.stride != 0 )
+    {
+        os << " ";
+    }
+
+    os << ")";
+    return os;
+}
+
+
+/**
+ * @brief   Writes one value per live row of a bucket to an output stream,
+ *          padded to a multiple of 8 bytes
+ *
+ * @param   &os         The output stream to write to
+ * @param   &b          The bucket the column belongs to
+ * @param   *column     The column of per-row values
+ *
+ * @return  void
+ */
+template<typename T>
+void ShapeStore::writeRows( std::ostream &os, const Bucket &b, const T *column )
+{
+    uint64_t bytes = 0;
+
+    if ( b.dead == 0 )
+    {
+        bytes = b.rows() * sizeof( T );
+        os.write( reinterpret_cast<const char*>( column ), bytes );
+    }
+    else
+    {
+        for ( unsigned int row = 0; row < b.rows(); row++ )
+        {
+            if ( b.handles[row] != INVALID_HANDLE )
+            {
+                os.write( reinterpret_cast<const char*>( &column[row] ), sizeof( T ) );
+                bytes += sizeof( T );
+            }
+        }
+    }
+
+    static const char padding[8] = { 0 };
+    os.write( padding, ( 8 - bytes % 8 ) % 8 );
+}
+
+
+/**
+ * @brief   Writes the vertices of every live row of a bucket from one of its
+ *          pools to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &b      The bucket the pool belongs to
+ * @param   *pool   The pool of x or y-coordinates
+ *
+ * @return  void
+ */
+void ShapeStore::writeVertices( std::ostream &os, const Bucket &b,
+                                const double *pool )
+{
+    if ( b.dead == 0 )
+    {
+        os.write( reinterpret_cast<const char*>( pool ), b.vertices() * sizeof( double ) );
+        return;
+    }
+
+    for ( unsigned int row = 0; row < b.rows(); row++ )
+    {
+        if ( b.handles[row] != INVALID_HANDLE )
+        {
+            os.write( reinterpret_cast<const char*>( pool + b.first( row ) ),
+                      b.count( row ) * sizeof( double ) );
+        }
+    }
+}
+
+
+/**
+ * @brief   Writes the color of every live row of a bucket to an output
+ *          stream, packed as 0xAARRGGBB the way the binary format keeps them
+ *
+ * @param   &os     The output stream to write to
+ * @param   &b      The bucket the colors belong to
+ *
+ * @return  void
+ */
+void ShapeStore::writeColors( std::ostream &os, const Bucket &b )
+{
+    static thread_local std::vector<uint32_t> column;
+
+    column.resize( b.rows() );
+
+    for ( unsigned int row = 0; row < b.rows(); row++ )
+    {
+        column[row] = b.colors[row].toARGB();
+    }
+
+    writeRows( os, b, column.data() );
+}
+
+
+/**
+ * @brief   Writes the position of every live row of a bucket among all live
+ *          shapes to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &b      The bucket the rows belong to
+ * @param   &ranks  The position of every live shape, indexed by handle
+ *
+ * @return  void
+ */
+void ShapeStore::writeOrder( std::ostream &os, const Bucket &b,
+                             const std::vector<uint32_t> &ranks )
+{
+    static thread_local std::vector<uint32_t> column;
+
+    column.resize( b.rows() );
+
+    for ( unsigned int row = 0; row < b.rows(); row++ )
+    {
+        Handle handle = b.handles[row];
+        column[row] = ( handle != INVALID_HANDLE ) ? ranks[handle] : 0;
+    }
+
+    writeRows( os, b, column.data() );
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,440 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    shapestore.h
+ * @brief   Contiguous type-bucketed storage of shapes
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SHAPESTORE_H
+# define GRAPHICS_SHAPESTORE_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cstddef>
+# include <cstdint>
+# include <map>
+# include <memory>
+# include <vector>
+
+# include "boundingbox.h"
+# include "displaylist.h"
+# include "mappedfile.h"
+# include "packedcolor.h"
+# include "segmentbuffer.h"
+# include "shape.h"
+# include "viewcontext.h"
+# include "workpool.h"
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Shapes are kept by type in dense buckets instead of as individual heap
+ * objects. Every bucket stores its vertex coordinates as separate x and y
+ * pools, so a whole bucket can be transformed with a single batch call, and
+ * per-shape attributes as parallel arrays. Colors are packed into 32 bits
+ * that already hold the pixel value they are drawn with. Lines and
+ * triangles use a fixed number of vertices per row; polygons index the
+ * shared pool through offsets and counts.
+ *
+ * A handle names a shape for as long as it is stored. Handles are never
+ * reused until the store is cleared. Removal leaves a tombstone which is
+ * compacted away, preserving order, once a bucket is mostly dead. Iteration
+ * visits shapes of every type in the order they were added.
+ *
+ * Drawing is level-of-detail aware. A shape that covers less than a couple
+ * of pixels is drawn as a single point, and polygons are drawn from copies
+ * of their vertex chains simplified to within half a pixel at the current
+ * zoom. Simplified copies are made lazily, one per power-of-two tolerance,
+ * and kept until the polygons are compacted or cleared.
+ *
+ * Filling a display list can be split across a work pool. Each task draws
+ * a chunk of one type's shapes into segments of its own, and the chunks are
+ * then added to the list in order on the calling thread, so the list ends
+ * up exactly as a draw on one thread leaves it. Small draws stay on one
+ * thread.
+ *
+ * The binary drawing format is a header, a table with one entry per shape
+ * type and the packed arrays of every bucket, including the position of
+ * each shape in the order they were added. Reading it from a mapped file
+ * leaves the vertex pools in the mapping; a bucket copies them out only
+ * when it is first modified.
+ */
+class ShapeStore
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    typedef unsigned int Handle;
+
+    enum ShapeType : unsigned char
+    {
+        TYPE_LINE,
+        TYPE_TRIANGLE,
+        TYPE_POLYGON
+    };
+
+    constexpr static const Handle INVALID_HANDLE = ~0u;
+
+    constexpr static const uint32_t BINARY_VERSION = 3;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    ShapeStore();
+    ShapeStore( const ShapeStore &store );
+    ShapeStore( ShapeStore &&store );
+
+    ~ShapeStore();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    ShapeStore &operator=( const ShapeStore &store );
+    ShapeStore &operator=( ShapeStore &&store );
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    Handle add( const Shape &shape );
+    Handle add( const ShapeStore &store, Handle handle );
+    Handle add( ShapeType type, const double *xs, const double *ys,
+                unsigned int n, double originX, double originY,
+                PackedColor color );
+    Handle splice( const ShapeStore &store );
+    bool remove( Handle handle );
+
+    bool contains( Handle handle ) const;
+    bool matches( Handle handle, ShapeType type, const double *xs,
+                  const double *ys, unsigned int n, double originX,
+                  double originY, PackedColor color ) const;
+    ShapeType getType( Handle handle ) const;
+    BoundingBox bounds( Handle handle ) const;
+    double distance( Handle handle, double x, double y ) const;
+    bool intersects( Handle handle, const BoundingBox &box ) const;
+    Shape *create( Handle handle ) const;
+
+    template<typename F>
+    void forEach( F fn ) const;
+
+    void draw( SegmentBuffer &sb, ViewContext *vc ) const;
+    void draw( SegmentBuffer &sb, ViewContext *vc,
+               const Handle *handles, size_t n ) const;
+    void draw( DisplayList &list, ViewContext *vc ) const;
+    void draw( DisplayList &list, ViewContext *vc,
+               const Handle *handles, size_t n ) const;
+    void draw( DisplayList &list, ViewContext *vc, WorkPool &workers ) const;
+    void draw( DisplayList &list, ViewContext *vc,
+               const Handle *handles, size_t n, WorkPool &workers ) const;
+
+    Handle edges( Handle from,
+                  std::vector<GraphicsContext::ModelVertex> &vertices ) const;
+
+    std::ostream &out( std::ostream &os ) const;
+
+    void write( std::ostream &os ) const;
+    void save( const std::string &fileName, bool binary ) const;
+    void read( const std::shared_ptr<const MappedFile> &file );
+    static bool isBinary( const unsigned char *data, size_t size );
+    static bool isFinite( const double *values, size_t n );
+
+    void compact();
+    void clear();
+
+    unsigned int size() const;
+
+    static ShapeType typeOf( const Shape &shape );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // compact a bucket once it holds more tombstones than this and more
+    // tombstones than live shapes
+    constexpr static const unsigned int COMPACT_THRESHOLD = 64;
+
+    // shapes smaller than this many pixels both ways are drawn as a point
+    constexpr static const int LOD_POINT_SIZE = 2;
+
+    // the most a simplified polygon may stray from the original, in pixels
+    constexpr static const double LOD_TOLERANCE = 0.5;
+
+    // simplified copies kept before starting over
+    constexpr static const size_t LOD_LEVELS = 8;
+
+    // the offset of a row of a simplified copy that is yet to be simplified
+    constexpr static const unsigned int NOT_SIMPLIFIED = ~0u;
+
+    // draws of fewer shapes than this stay on one thread, where handing out
+    // the work would cost more than it saves
+    constexpr static const size_t PARALLEL_SHAPES = 8192;
+
+    // the most shapes drawn by one task of a parallel draw
+    constexpr static const size_t CHUNK_SHAPES = 1024;
+
+    struct Slot
+    {
+        ShapeType type;
+        unsigned int row;
+    };
+
+    struct Bucket
+    {
+        explicit Bucket( unsigned int stride );
+
+        unsigned int rows() const;
+        unsigned int first( unsigned int row ) const;
+        unsigned int count( unsigned int row ) const;
+
+        size_t vertices() const;
+        const double *x() const;
+        const double *y() const;
+        void own();
+
+        // vertices per row, or zero when rows are indexed by offsets
+        unsigned int stride;
+
+        // the vertex pools, unless they are still in a mapped file
+        std::vector<double> xs;
+        std::vector<double> ys;
+
+        std::shared_ptr<const MappedFile> mapping;
+        const double *mappedXs = nullptr;
+        const double *mappedYs = nullptr;
+        size_t mappedVertices = 0;
+
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> counts;
+
+        std::vector<Handle> handles;
+        std::vector<double> originX;
+        std::vector<double> originY;
+        std::vector<PackedColor> colors;
+
+        unsigned int dead = 0;
+    };
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t typeCount;
+        uint32_t reserved;
+    };
+
+    // array fields are byte offsets from the start of the file
+    struct TypeEntry
+    {
+        uint32_t type;
+        uint32_t stride;
+        uint64_t rows;
+        uint64_t vertices;
+        uint64_t xs;
+        uint64_t ys;
+        uint64_t counts;
+        uint64_t originX;
+        uint64_t originY;
+        uint64_t colors;
+        uint64_t order;
+    };
+
+    // where drawn shapes go: the batch of their color in a segment buffer,
+    // or their own entry in a display list
+    struct BufferSink
+    {
+        explicit BufferSink( SegmentBuffer &sb );
+
+        std::vector<GraphicsContext::Segment> &begin( Handle handle, unsigned int pixel );
+        void end( Handle handle );
+
+        SegmentBuffer &sb;
+        std::vector<GraphicsContext::Segment> *segments = nullptr;
+        unsigned int pixel = 0;
+    };
+
+    struct ListSink
+    {
+        explicit ListSink( DisplayList &list );
+
+        std::vector<GraphicsContext::Segment> &begin( Handle handle, unsigned int pixel );
+        void end( Handle handle );
+
+        DisplayList &list;
+    };
+
+    // a shape drawn by a task of a parallel draw
+    struct Drawn
+    {
+        Handle handle;
+        unsigned int pixel;
+        unsigned int vertices;
+        unsigned int segments;
+    };
+
+    // a task of a parallel draw: some shapes of one type, with the scratch
+    // space to draw them and the segments they were drawn as
+    struct Chunk
+    {
+        ShapeType type = TYPE_LINE;
+        const Handle *handles = nullptr;
+        size_t n = 0;
+
+        std::vector<double> xs;
+        std::vector<double> ys;
+        std::vector<int> dxs;
+        std::vector<int> dys;
+
+        std::vector<Drawn> shapes;
+        std::vector<GraphicsContext::Segment> segments;
+    };
+
+    std::vector<Slot> slots;
+
+    Bucket lines = Bucket( 2 );
+    Bucket triangles = Bucket( 3 );
+    Bucket polygons = Bucket( 0 );
+
+    unsigned int live = 0;
+
+    // the polygons simplified to within a power of two tolerance, by its
+    // exponent, with only the vertex pools, offsets and counts filled in
+    mutable std::map<int, Bucket> details;
+    mutable std::vector<unsigned char> keep;
+    mutable std::vector<std::pair<unsigned int, unsigned int>> ranges;
+
+    mutable std::vector<int> dxs;
+    mutable std::vector<int> dys;
+
+    // a selection grouped by type, and the vertices of one of its types
+    mutable std::vector<Handle> picked;
+    mutable std::vector<double> pickedXs;
+    mutable std::vector<double> pickedYs;
+
+    // kept between parallel draws along with their scratch space
+    mutable std::vector<Chunk> chunks;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    Bucket &bucket( ShapeType type );
+    const Bucket &bucket( ShapeType type ) const;
+
+    void compact( Bucket &bucket );
+
+    const Bucket &detail( const Bucket &bucket, const ViewContext *vc,
+                          const Handle *handles, size_t n ) const;
+    void simplify( Bucket &detail, unsigned int row, double tolerance ) const;
+
+    // drawing is written once per type, so each loop only handles rows of
+    // one known size and never checks the type of a row
+    template<ShapeType TYPE, typename Sink>
+    void drawBucket( Sink &sink, ViewContext *vc ) const;
+    template<typename Sink>
+    void drawSelection( Sink &sink, ViewContext *vc,
+                        const Handle *handles, size_t n ) const;
+    void group( const Handle *handles, size_t n, size_t *starts ) const;
+    template<ShapeType TYPE, typename Sink>
+    void drawRows( Sink &sink, ViewContext *vc,
+                   const Handle *handles, size_t n ) const;
+
+    void addChunks( ShapeType type, const Handle *handles, size_t n,
+                    size_t &count ) const;
+    void drawChunks( DisplayList &list, const ViewContext *vc,
+                     const Bucket &polygonPool, WorkPool &workers,
+                     size_t count ) const;
+    template<ShapeType TYPE>
+    void drawChunk( Chunk &chunk, const Bucket &pool, const ViewContext *vc ) const;
+
+    template<ShapeType TYPE>
+    static void emit( std::vector<GraphicsContext::Segment> &segments,
+                      const int *dxs, const int *dys, unsigned int n );
+
+    template<ShapeType TYPE>
+    constexpr static unsigned int strideOf();
+
+    static double segmentDistance( double x1, double y1, double x2, double y2,
+                                   double x, double y );
+    static bool segmentIntersects( double x1, double y1, double x2, double y2,
+                                   const BoundingBox &box );
+
+    static std::ostream &outRow( std::ostream &os, const Bucket &bucket,
+                                 unsigned int row );
+
+    template<typename T>
+    static void writeRows( std::ostream &os, const Bucket &bucket,
+                           const T *column );
+    static void writeVertices( std::ostream &os, const Bucket &bucket,
+                               const double *pool );
+    static void writeColors( std::ostream &os, const Bucket &bucket );
+    static void writeOrder( std::ostream &os, const Bucket &bucket,
+                            const std::vector<uint32_t> &ranks );
+
+
+    /* ====================================================================== */
+};
+
+
+/* ---------------------------- Template Functions -------------------------- */
+
+
+/**
+ * @brief   Calls a function with the handle of every stored shape, in the
+ *          order the shapes were added
+ *
+ * @param   fn  The function to call with each handle
+ *
+ * @return  void
+ */
+template<typename F>
+void ShapeStore::forEach( F fn ) const
+{
+    for ( Handle handle = 0; handle < slots.size(); handle++ )
+    {
+        if ( slots[handle].row != INVALID_HANDLE ) fn( handle );
+    }
+}
+
+
+/**
+ * @brief   Gets the number of vertices in every row of a shape type
+ *
+ * @param   void
+ *
+ * @return  The number of vertices, or zero if rows of the type have varying
+ *          numbers of vertices
+ */
+template<ShapeStore::ShapeType TYPE>
+constexpr unsigned int ShapeStore::strideOf()
+{
+    return ( TYPE == TYPE_LINE ) ? 2 : ( TYPE == TYPE_TRIANGLE ) ? 3 : 0;
+}
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SHAPESTORE_H
+
+
+/* -------------------------------------------------------------------------- */
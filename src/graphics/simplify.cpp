@@ -0,0 +1,115 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    simplify.cpp
+ * @brief   Ramer-Douglas-Peucker simplification of polylines and outlines
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+
+# include "simplify.h"
+
+
+/* ------------------------------- Functions -------------------------------- */
+
+
+/**
+ * @brief   Marks the vertices of a polyline or closed outline to keep when
+ *          simplifying it with Ramer-Douglas-Peucker
+ *
+ * @param   *xs         The x-coordinates of the vertices
+ * @param   *ys         The y-coordinates of the vertices
+ * @param   n           The number of vertices, at least two
+ * @param   closed      True if the last vertex joins back to the first
+ * @param   tolerance   The most a dropped vertex may be from the simplified
+ *                      line
+ * @param   &keep       Set to one for every vertex kept and zero otherwise
+ * @param   &ranges     Scratch space for the spans still to simplify
+ *
+ * @return  The number of vertices kept
+ */
+unsigned int simplifyPolyline( const double *xs, const double *ys, unsigned int n,
+                               bool closed, double tolerance,
+                               std::vector<unsigned char> &keep,
+                               std::vector<std::pair<unsigned int, unsigned int>> &ranges )
+{
+    keep.assign( n + 1, 0 );
+    ranges.clear();
+
+    if ( !closed )
+    {
+        keep[0] = keep[n - 1] = 1;
+        ranges.push_back( { 0, n - 1 } );
+    }
+    else
+    {
+        unsigned int far = 0;
+        double farthest = -1;
+
+        for ( unsigned int i = 1; i < n; i++ )
+        {
+            double dx = xs[i] - xs[0];
+            double dy = ys[i] - ys[0];
+
+            if ( dx * dx + dy * dy > farthest )
+            {
+                farthest = dx * dx + dy * dy;
+                far = i;
+            }
+        }
+
+        keep[0] = keep[far] = 1;
+        ranges.push_back( { 0, far } );
+        ranges.push_back( { far, n } );
+    }
+
+    double limit = tolerance * tolerance;
+
+    while ( !ranges.empty() )
+    {
+        unsigned int a = ranges.back().first;
+        unsigned int c = ranges.back().second;
+        ranges.pop_back();
+
+        // the vertex between the ends that is farthest from the segment
+        // joining them, where the end past the last vertex is the first
+        double ax = xs[a], ay = ys[a];
+        double ex = xs[c % n] - ax, ey = ys[c % n] - ay;
+        double length = ex * ex + ey * ey;
+
+        unsigned int worst = a;
+        double error = limit;
+
+        for ( unsigned int i = a + 1; i < c; i++ )
+        {
+            double px = xs[i] - ax, py = ys[i] - ay;
+            double t = ( length > 0 ) ? ( px * ex + py * ey ) / length : 0;
+            t = std::max( 0.0, std::min( 1.0, t ) );
+
+            double dx = px - t * ex, dy = py - t * ey;
+
+            if ( dx * dx + dy * dy > error )
+            {
+                error = dx * dx + dy * dy;
+                worst = i;
+            }
+        }
+
+        if ( worst != a )
+        {
+            keep[worst] = 1;
+            ranges.push_back( { a, worst } );
+            ranges.push_back( { worst, c } );
+        }
+    }
+
+    return std::count( keep.begin(), keep.begin() + n, 1 );
+}
+
+
+/* -------------------------------------------------------------------------- */
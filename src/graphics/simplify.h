@@ -0,0 +1,47 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    simplify.h
+ * @brief   Ramer-Douglas-Peucker simplification of polylines and outlines
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_SIMPLIFY_H
+# define GRAPHICS_SIMPLIFY_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <utility>
+# include <vector>
+
+
+/* ------------------------------- Functions -------------------------------- */
+
+
+/*
+ * Marks the vertices to keep so that none of those dropped is farther than
+ * the tolerance from the simplified line. An open polyline keeps both of its
+ * ends; a closed outline is split at the vertex farthest from the first and
+ * both halves are simplified, the second ending back at the first. The
+ * scratch vectors are only there to be reused between calls, and keep is
+ * left with at least n entries, one per vertex.
+ */
+unsigned int simplifyPolyline( const double *xs, const double *ys, unsigned int n,
+                               bool closed, double tolerance,
+                               std::vector<unsigned char> &keep,
+                               std::vector<std::pair<unsigned int, unsigned int>> &ranges );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_SIMPLIFY_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,51 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    vertex2.h
+ * @brief   Plain two-component vertex used as compact shape storage
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_VERTEX2_H
+# define GRAPHICS_VERTEX2_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <type_traits>
+
+
+/* --------------------------------- Struct --------------------------------- */
+
+
+/*
+ * Unlike Point2D this carries no vtable and no heap storage, so arrays of
+ * vertices are contiguous and copy with a single memcpy.
+ */
+template<typename T>
+struct Vertex2
+{
+    T x;
+    T y;
+};
+
+
+typedef Vertex2<double> Vertex2d;
+typedef Vertex2<float> Vertex2f;
+
+static_assert( std::is_pod<Vertex2d>::value, "Vertex2d must be plain data" );
+static_assert( std::is_pod<Vertex2f>::value, "Vertex2f must be plain data" );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_VERTEX2_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,244 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    workpool.cpp
+ * @brief   Work-stealing pool of threads for data parallel loops
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <algorithm>
+
+# include "workpool.h"
+
+
+/* ----------------------- Constructors / Destructors ----------------------- */
+
+
+/**
+ * @brief   Creates a work pool, starting all of its threads but the caller's
+ *
+ * @param   workers     The number of threads to run tasks on, including the
+ *                      one calling run, or zero for one per hardware thread
+ *
+ * @return  The created work pool
+ */
+WorkPool::WorkPool( unsigned int workers ):
+workers( workers )
+{
+    if ( this->workers == 0 )
+    {
+        this->workers = std::max( std::thread::hardware_concurrency(), 1u );
+    }
+
+    shares.reset( new Share[this->workers] );
+
+    for ( unsigned int i = 1; i < this->workers; i++ )
+    {
+        threads.emplace_back( &WorkPool::work, this, i );
+    }
+}
+
+
+/**
+ * @brief   Work pool destructor, stopping its threads
+ *
+ * @param   void
+ *
+ * @return  void
+ */
+WorkPool::~WorkPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        stopping = true;
+    }
+
+    started.notify_all();
+
+    for ( std::thread &thread : threads )
+    {
+        thread.join();
+    }
+}
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Gets the number of threads tasks run on
+ *
+ * @param   void
+ *
+ * @return  The number of workers, including the caller
+ */
+unsigned int WorkPool::size() const
+{
+    return workers;
+}
+
+
+/**
+ * @brief   Runs tasks numbered from zero and waits for all of them to finish
+ *
+ * @param   count   The number of tasks
+ * @param   &task   Called once with each task's number and the number of
+ *                  the worker running it, below size()
+ *
+ * @return  void
+ */
+void WorkPool::run( size_t count, const Task &task )
+{
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    // a single task is not worth waking anyone for
+    if ( ( workers == 1 ) || ( count == 1 ) )
+    {
+        for ( size_t i = 0; i < count; i++ ) task( i, 0 );
+        return;
+    }
+
+    for ( unsigned int i = 0; i < workers; i++ )
+    {
+        std::lock_guard<std::mutex> lock( shares[i].mutex );
+        shares[i].begin = count * i / workers;
+        shares[i].end = count * ( i + 1 ) / workers;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        this->task = &task;
+        generation++;
+        running = workers - 1;
+    }
+
+    started.notify_all();
+    drain( 0 );
+
+    std::unique_lock<std::mutex> lock( mutex );
+    finished.wait( lock, [this]() { return running == 0; } );
+    this->task = nullptr;
+}
+
+
+/* ---------------------------- Private Functions --------------------------- */
+
+
+/**
+ * @brief   Waits for tasks and runs them until the pool is destroyed, runs on
+ *          each of the pool's threads
+ *
+ * @param   worker  The number of the worker
+ *
+ * @return  void
+ */
+void WorkPool::work( unsigned int worker )
+{
+    size_t seen = 0;
+
+    while ( true )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            started.wait( lock, [this, seen]() { return stopping || ( generation != seen ); } );
+
+            if ( stopping )
+            {
+                return;
+            }
+
+            seen = generation;
+        }
+
+        drain( worker );
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            running--;
+        }
+
+        finished.notify_one();
+    }
+}
+
+
+/**
+ * @brief   Runs tasks until there are none left to take or steal
+ *
+ * @param   worker  The number of the worker
+ *
+ * @return  void
+ */
+void WorkPool::drain( unsigned int worker )
+{
+    size_t number;
+
+    while ( take( worker, number ) )
+    {
+        ( *task )( number, worker );
+    }
+}
+
+
+/**
+ * @brief   Takes the next task of a worker's own share, or steals the back
+ *          half of another worker's share once its own is used up
+ *
+ * @param   worker      The number of the worker
+ * @param   &number     Replaced by the number of the task taken
+ *
+ * @return  True if a task was taken, false if every share is used up
+ */
+bool WorkPool::take( unsigned int worker, size_t &number )
+{
+    {
+        Share &own = shares[worker];
+        std::lock_guard<std::mutex> lock( own.mutex );
+
+        if ( own.begin < own.end )
+        {
+            number = own.begin++;
+            return true;
+        }
+    }
+
+    for ( unsigned int i = 1; i < workers; i++ )
+    {
+        Share &victim = shares[( worker + i ) % workers];
+        size_t begin;
+        size_t end;
+
+        {
+            std::lock_guard<std::mutex> lock( victim.mutex );
+
+            if ( victim.begin >= victim.end )
+            {
+                continue;
+            }
+
+            end = victim.end;
+            begin = end - ( end - victim.begin + 1 ) / 2;
+            victim.end = begin;
+        }
+
+        // the first stolen task runs now, the rest become this worker's
+        Share &own = shares[worker];
+        std::lock_guard<std::mutex> lock( own.mutex );
+        own.begin = begin + 1;
+        own.end = end;
+        number = begin;
+        return true;
+    }
+
+    return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
@@ -0,0 +1,122 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    workpool.h
+ * @brief   Work-stealing pool of threads for data parallel loops
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef GRAPHICS_WORKPOOL_H
+# define GRAPHICS_WORKPOOL_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <condition_variable>
+# include <cstddef>
+# include <functional>
+# include <memory>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * Runs a numbered set of tasks on a fixed set of threads, the calling thread
+ * being one of them. Each worker starts on its own contiguous share of the
+ * tasks, so neighbouring tasks tend to run on the same thread; a worker that
+ * runs out steals the back half of the share of another, so uneven tasks
+ * still keep every thread busy.
+ *
+ * Tasks must not throw. Only one thread may call run at a time.
+ */
+class WorkPool
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    typedef std::function<void( size_t task, unsigned int worker )> Task;
+
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    explicit WorkPool( unsigned int workers = 0 );
+    WorkPool( const WorkPool &pool ) = delete;
+
+    ~WorkPool();
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    WorkPool &operator=( const WorkPool &pool ) = delete;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    unsigned int size() const;
+
+    void run( size_t count, const Task &task );
+
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    // the tasks a worker has yet to run, as a range of task numbers
+    struct Share
+    {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<Share[]> shares;
+    unsigned int workers;
+
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const Task *task = nullptr;
+    size_t generation = 0;
+    unsigned int running = 0;
+    bool stopping = false;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    void work( unsigned int worker );
+    void drain( unsigned int worker );
+    bool take( unsigned int worker, size_t &number );
+
+
+    /* ====================================================================== */
+};
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // GRAPHICS_WORKPOOL_H
+
+
+/* -------------------------------------------------------------------------- */
@@ -10,7 +10,15 @@
 /* -------------------------------- Includes -------------------------------- */
 
 
+# include <cstdlib>
+# include <iostream>
+# include <stdexcept>
+# include <string>
+
 # include "drawcontext.h"
+# include "framestats.h"
+# include "glcontext.h"
+# include "tracerecorder.h"
 # include "viewcontext.h"
 # include "x11context.h"
 
@@ -20,12 +28,38 @@ using namespace std;
 /* ------------------------------- Functions -------------------------------- */
 
 
-int main()
+int main( int argc, char **argv )
 {
     /* ---------------- Create Graphics and Drawing Context ----------------- */
 
 
-    GraphicsContext *gc = new X11Context( 800, 800, X11Context::WHITE );
+    // --gl draws with opengl, keeping the shapes on the gpu, where it can
+    GraphicsContext *gc = nullptr;
+
+# ifdef HAVE_OPENGL
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( string( argv[i] ) != "--gl" )
+        {
+            continue;
+        }
+
+        try
+        {
+            gc = new GLContext( 800, 800, X11Context::WHITE );
+        }
+        catch ( const GLException &e )
+        {
+            cout << e.what() << endl;
+        }
+    }
+# endif
+
+    if ( gc == nullptr )
+    {
+        gc = new X11Context( 800, 800, X11Context::WHITE, X11Context::BUFFER_SHM );
+    }
+
     ViewContext *vc = new ViewContext( gc );
     DrawContext *dc = new DrawContext( vc );
 
@@ -43,6 +77,8 @@ int main()
     cout << "  Y     - Toggle Snap To Y" << endl;
     cout << "  CTRL  - Toggle Loop Mode" << endl;
     cout << "  C     - Clear Canvas" << endl;
+    cout << "  V     - Toggle Stroke Simplification" << endl;
+    cout << "  Z     - Undo (SHIFT+Z To Redo)" << endl;
     cout << endl;
     cout << "  COLOR CONTROLS:" << endl;
     cout << "  1 - Black     6 - Blue" << endl;
@@ -56,26 +92,128 @@ int main()
     cout << "  RMB    - Rotate" << endl;
     cout << "  SCROLL - Zoom" << endl;
     cout << "  A      - Toggle 2D Axes" << endl;
+    cout << "  F      - Toggle Frame Stats Overlay" << endl;
     cout << "  R      - Reset View" << endl;
     cout << endl;
     cout << "  FILE CONTROLS:" << endl;
     cout << "  O - Open File" << endl;
     cout << "  S - Save File" << endl;
+    cout << "  J - Toggle Journaled Saves" << endl;
+    cout << endl;
+    cout << "  TERMINAL COMMANDS (TYPED OR PIPED):" << endl;
+    cout << "  open FILE - Open File" << endl;
+    cout << "  save FILE - Save File" << endl;
+    cout << "  clear     - Clear Canvas" << endl;
+    cout << "  undo      - Undo" << endl;
+    cout << "  redo      - Redo" << endl;
+    cout << endl;
+    cout << "  COMMAND LINE OPTIONS:" << endl;
+    cout << "  FILE          - Open File On Start" << endl;
+    cout << "  --record FILE - Record Input Events For Replay" << endl;
+    cout << "  --stats FILE  - Dump Frame Stats On Exit (CSV, Or JSON For .json)" << endl;
+    cout << "  --threads N   - Draw On N Threads (Default One Per Core)" << endl;
+# ifdef HAVE_OPENGL
+    cout << "  --gl          - Draw With OpenGL" << endl;
+# endif
     cout << endl;
     cout << endl;
     cout << "/* ------------------------------------------------- */" << endl;
     cout << endl;
 
 
+    /* ------------------------ Start Terminal Input ------------------------ */
+
+
+    // prompts and commands are read from the terminal in the background,
+    // and a drawing named on the command line starts opening right away
+    dc->listen( gc, cin );
+
+    string drawingName;
+    string traceName;
+    string statsName;
+    unsigned int threads = 0;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( ( string( argv[i] ) == "--record" ) && ( i + 1 < argc ) )
+        {
+            traceName = argv[++i];
+        }
+        else if ( ( string( argv[i] ) == "--stats" ) && ( i + 1 < argc ) )
+        {
+            statsName = argv[++i];
+        }
+        else if ( ( string( argv[i] ) == "--threads" ) && ( i + 1 < argc ) )
+        {
+            threads = std::strtoul( argv[++i], nullptr, 10 );
+        }
+        else if ( string( argv[i] ) == "--gl" )
+        {
+            continue;
+        }
+        else
+        {
+            drawingName = argv[i];
+        }
+    }
+
+    // big drawings are transformed across every core unless told otherwise
+    dc->setThreads( threads );
+
+    if ( !drawingName.empty() )
+    {
+        dc->open( gc, drawingName );
+    }
+
+    // --stats FILE keeps every frame's counters and writes them on exit
+    if ( !statsName.empty() )
+    {
+        FrameStats::setRecording( true );
+    }
+
+
     /* --------------------------- Enter Run Loop --------------------------- */
 
 
-    gc->runLoop( dc );
+    // --record FILE logs every input event for replaying the session later
+    DrawingBase *drawing = dc;
+    TraceRecorder *recorder = nullptr;
+
+    if ( !traceName.empty() )
+    {
+        try
+        {
+            recorder = new TraceRecorder( dc, gc, traceName );
+            dc->setRecorder( recorder );
+            drawing = recorder;
+            cout << "RECORDING TO: " << traceName << endl;
+        }
+        catch ( const TraceException &e )
+        {
+            cout << e.what() << endl;
+        }
+    }
+
+    gc->runLoop( drawing );
+
+    if ( !statsName.empty() )
+    {
+        try
+        {
+            FrameStats::save( statsName );
+        }
+        catch ( const std::runtime_error &e )
+        {
+            cout << e.what() << endl;
+        }
+    }
 
 
     /* ---------------------- Delete Graphics Context ----------------------- */
 
 
+    dc->setRecorder( nullptr );
+    delete recorder;
     delete dc;
     delete vc;
     delete gc;
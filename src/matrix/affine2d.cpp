@@ -0,0 +1,60 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    affine2d.cpp
+ * @brief   Fixed-size 2D affine transformation class
+ */
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include "affine2d.h"
+
+
+/* ---------------------------- Public Functions ---------------------------- */
+
+
+/**
+ * @brief   Writes this transformation as a 3x3 matrix to an output stream
+ *
+ * @param   &os     The output stream to write to
+ *
+ * @return  The output stream
+ */
+std::ostream &Affine2D::out( std::ostream &os ) const
+{
+    for ( unsigned int row = 0; row < 3; row++ )
+    {
+        os << "[ ";
+        for ( unsigned int col = 0; col < 3; col++ )
+        {
+            os << get( row, col ) << " ";
+        }
+        os << "]" << std::endl;
+    }
+
+    return os;
+}
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+/**
+ * @brief   Writes a transformation to an output stream
+ *
+ * @param   &os     The output stream to write to
+ * @param   &m      The transformation to write
+ *
+ * @return  The output stream
+ */
+std::ostream &operator<<( std::ostream &os, const Affine2D &m )
+{
+    m.out( os );
+    return os;
+}
+
+
+/* -------------------------------------------------------------------------- */
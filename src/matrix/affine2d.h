@@ -0,0 +1,204 @@
+/* --------------------------------- Header --------------------------------- */
+
+
+/**
+ * @file    affine2d.h
+ * @brief   Fixed-size 2D affine transformation class
+ */
+
+
+/* ------------------------------ Header Guard ------------------------------ */
+
+
+# ifndef MATRIX_AFFINE2D_H
+# define MATRIX_AFFINE2D_H
+
+
+/* -------------------------------- Includes -------------------------------- */
+
+
+# include <cmath>
+# include <iostream>
+
+
+/* --------------------------------- Class ---------------------------------- */
+
+
+/*
+ * A 3x3 homogeneous transformation matrix whose bottom row is fixed at
+ * [ 0 0 1 ]. Only the top two rows are stored, inline, so composing and
+ * applying transformations never allocates.
+ *
+ *      [ m00 m01 m02 ]
+ *      [ m10 m11 m12 ]
+ *      [  0   0   1  ]
+ */
+class Affine2D
+{
+    /* =============================== PUBLIC =============================== */
+
+public:
+
+    /* --------------------- Constructors / Destructors --------------------- */
+
+
+    constexpr Affine2D():
+        Affine2D( 1, 0, 0, 0, 1, 0 )
+    {}
+
+
+    constexpr Affine2D( double m00, double m01, double m02,
+                        double m10, double m11, double m12 ):
+        m00( m00 ), m01( m01 ), m02( m02 ),
+        m10( m10 ), m11( m11 ), m12( m12 )
+    {}
+
+
+    /* ------------------------ Overloaded Operators ------------------------ */
+
+
+    constexpr Affine2D operator*( const Affine2D &m ) const
+    {
+        // closed form product of two matrices with a [ 0 0 1 ] bottom row
+        return Affine2D(
+            m00 * m.m00 + m01 * m.m10,
+            m00 * m.m01 + m01 * m.m11,
+            m00 * m.m02 + m01 * m.m12 + m02,
+            m10 * m.m00 + m11 * m.m10,
+            m10 * m.m01 + m11 * m.m11,
+            m10 * m.m02 + m11 * m.m12 + m12
+        );
+    }
+
+
+    constexpr bool operator==( const Affine2D &m ) const
+    {
+        return ( m00 == m.m00 ) && ( m01 == m.m01 ) && ( m02 == m.m02 ) &&
+               ( m10 == m.m10 ) && ( m11 == m.m11 ) && ( m12 == m.m12 );
+    }
+
+
+    constexpr bool operator!=( const Affine2D &m ) const
+    {
+        return !( *this == m );
+    }
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    static constexpr Affine2D identity()
+    {
+        return Affine2D();
+    }
+
+
+    static constexpr Affine2D translation( double x, double y )
+    {
+        return Affine2D( 1, 0, x, 0, 1, y );
+    }
+
+
+    static constexpr Affine2D scale( double x, double y )
+    {
+        return Affine2D( x, 0, 0, 0, y, 0 );
+    }
+
+
+    static Affine2D rotation( double r )
+    {
+        double c = cos( r );
+        double s = sin( r );
+        return Affine2D( c, -s, 0, s, c, 0 );
+    }
+
+
+    constexpr double determinant() const
+    {
+        return m00 * m11 - m01 * m10;
+    }
+
+
+    constexpr Affine2D inverse() const
+    {
+        // closed form inverse: invert the linear part, then undo the
+        // translation through it
+        return inverse( 1 / determinant() );
+    }
+
+
+    constexpr double transformX( double x, double y ) const
+    {
+        return m00 * x + m01 * y + m02;
+    }
+
+
+    constexpr double transformY( double x, double y ) const
+    {
+        return m10 * x + m11 * y + m12;
+    }
+
+
+    constexpr double get( unsigned int row, unsigned int col ) const
+    {
+        return ( row == 0 ) ? ( ( col == 0 ) ? m00 : ( col == 1 ) ? m01 : m02 ) :
+               ( row == 1 ) ? ( ( col == 0 ) ? m10 : ( col == 1 ) ? m11 : m12 ) :
+                              ( ( col == 2 ) ? 1 : 0 );
+    }
+
+
+    std::ostream &out( std::ostream &os ) const;
+
+
+    /* ============================== PROTECTED ============================= */
+
+protected:
+
+    /* =============================== PRIVATE ============================== */
+
+private:
+
+    /* ----------------------------- Attributes ----------------------------- */
+
+
+    double m00;
+    double m01;
+    double m02;
+    double m10;
+    double m11;
+    double m12;
+
+
+    /* ------------------------------ Functions ----------------------------- */
+
+
+    constexpr Affine2D inverse( double invDet ) const
+    {
+        return Affine2D(
+             m11 * invDet,
+            -m01 * invDet,
+            ( m01 * m12 - m11 * m02 ) * invDet,
+            -m10 * invDet,
+             m00 * invDet,
+            ( m10 * m02 - m00 * m12 ) * invDet
+        );
+    }
+
+
+    /* ====================================================================== */
+};
+
+
+/* ----------------------- Global Overloaded Operators ---------------------- */
+
+
+std::ostream &operator<<( std::ostream &os, const Affine2D &m );
+
+
+/* --------------------------------- Footer --------------------------------- */
+
+
+# endif // MATRIX_AFFINE2D_H
+
+
+/* -------------------------------------------------------------------------- */